@@ -0,0 +1,87 @@
+/**
+ * @file fb_blit.h
+ * @brief 帧缓冲直写模块头文件
+ * @details 将 /dev/fb0 映射到内存，预览内核直接把RGB565图像写入屏幕对应区域，
+ *          不经过LVGL图像控件的重绘和 fbdev_flush 整屏拷贝。
+ *          目标不是帧缓冲设备 (如主机上的普通文件) 时按调用者给出的尺寸
+ *          以16位紧凑排列映射，便于在主机上用文件模拟帧缓冲测试
+ */
+
+#ifndef FB_BLIT_H
+#define FB_BLIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+/**
+ * @brief 帧缓冲映射
+ */
+typedef struct {
+    int fd;                 /**< 设备文件描述符，未打开为-1 */
+    uint8_t *map;           /**< 映射起始地址 */
+    size_t map_size;        /**< 映射大小（字节） */
+    int width;              /**< 可见宽度 */
+    int height;             /**< 可见高度 */
+    size_t line_length;     /**< 每行字节数 */
+    int xoffset;            /**< 可见区域在虚拟屏幕中的列偏移 */
+    int yoffset;            /**< 可见区域在虚拟屏幕中的行偏移 */
+} fb_blit_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 打开并映射帧缓冲
+ * @details 只支持16位色深 (RGB565)；普通文件按 width x height x 16位映射，
+ *          文件大小不足时返回失败
+ * @param fb 帧缓冲映射
+ * @param path 设备路径 (如 "/dev/fb0") 或模拟帧缓冲的文件路径
+ * @param width 无法查询屏幕参数时使用的宽度
+ * @param height 无法查询屏幕参数时使用的高度
+ * @return 0成功，-1失败
+ */
+int fb_blit_open(fb_blit_t *fb, const char *path, int width, int height);
+
+/**
+ * @brief 解除映射并关闭帧缓冲
+ * @param fb 帧缓冲映射
+ */
+void fb_blit_close(fb_blit_t *fb);
+
+/**
+ * @brief 获取屏幕矩形区域的写入地址
+ * @param fb 帧缓冲映射
+ * @param x 区域左上角列
+ * @param y 区域左上角行
+ * @param width 区域宽度
+ * @param height 区域高度
+ * @param stride 输出的每行像素数
+ * @return 区域左上角像素地址，区域超出屏幕或帧缓冲未打开时返回NULL
+ */
+uint16_t *fb_blit_region(fb_blit_t *fb, int x, int y, int width, int height, int *stride);
+
+/**
+ * @brief 用单一颜色填充屏幕矩形区域 (超出屏幕的部分被裁掉)
+ * @param fb 帧缓冲映射
+ * @param x 区域左上角列
+ * @param y 区域左上角行
+ * @param width 区域宽度
+ * @param height 区域高度
+ * @param color RGB565颜色
+ */
+void fb_blit_fill(fb_blit_t *fb, int x, int y, int width, int height, uint16_t color);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FB_BLIT_H
@@ -0,0 +1,176 @@
+/**
+ * @file frame_pool.h
+ * @brief 引用计数帧池模块头文件
+ * @details 采集线程把每个 V4L2 缓冲区登记为帧池中的一个描述符，显示、TCP发送、
+ *          拍照等消费者各自持有引用，最后一个引用释放时才把缓冲区交还驱动。
+ *          消费者处理帧期间不持有任何锁，采集不会被长时间的发送阻塞
+ */
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <media.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define FRAME_POOL_MAX_SLOTS 16 /**< 帧池最大容量 */
+
+struct frame_pool;
+
+/**
+ * @brief 缓冲区交还函数 (最后一个引用释放时调用)
+ * @param frame 帧数据
+ * @param user 初始化时传入的用户数据
+ */
+typedef void (*frame_pool_release_fn)(media_frame_t *frame, void *user);
+
+/**
+ * @brief 采集时的帧信息 (由采集线程随帧发布)
+ */
+typedef struct {
+    uint64_t timestamp;         /**< 采集时间戳 (纳秒，CLOCK_MONOTONIC) */
+    uint32_t sequence;          /**< 采集序号 (从驱动取出的每一帧都计数，含帧池丢弃的帧) */
+    int32_t exposure;           /**< 采集时生效的曝光值 */
+    int32_t gain;               /**< 采集时生效的增益值 */
+} frame_meta_t;
+
+/**
+ * @brief 帧描述符 (消费者持有的引用)
+ */
+typedef struct {
+    media_frame_t frame;        /**< 帧数据 (引用有效期间只读) */
+    uint32_t sequence;          /**< 帧序号 (从1开始递增) */
+    frame_meta_t meta;          /**< 采集时的帧信息 */
+    int refcount;               /**< 引用计数 (原子操作) */
+    int in_use;                 /**< 描述符是否已被占用 (受帧池锁保护) */
+    struct frame_pool *pool;    /**< 所属帧池 */
+
+    // 派生数据 (如压缩后的帧)：随描述符复用，由单个消费者线程生成，持有引用期间有效
+    void *aux;                  /**< 派生数据缓冲区 (帧池销毁时释放) */
+    size_t aux_capacity;        /**< 缓冲区大小 */
+    size_t aux_size;            /**< 派生数据大小 */
+    uint32_t aux_tag;           /**< 派生数据种类，0表示本帧尚未生成 (发布新帧时清零) */
+} frame_ref_t;
+
+/**
+ * @brief 帧池
+ */
+typedef struct frame_pool {
+    frame_ref_t slots[FRAME_POOL_MAX_SLOTS]; /**< 帧描述符 */
+    int capacity;               /**< 可同时被持有的帧数 */
+    frame_ref_t *latest;        /**< 最新帧 (帧池自身持有一个引用) */
+    uint32_t sequence;          /**< 最新帧序号 */
+    uint32_t dropped;           /**< 因描述符耗尽而丢弃的帧数 */
+    int shutdown;               /**< 关闭标志，唤醒所有等待者 */
+    frame_pool_release_fn release_fn; /**< 缓冲区交还函数 */
+    void *user;                 /**< 交还函数的用户数据 */
+    pthread_mutex_t lock;       /**< 保护描述符分配和最新帧 */
+    pthread_cond_t cond;        /**< 新帧通知 */
+} frame_pool_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 初始化帧池
+ * @param pool 帧池
+ * @param capacity 可同时被持有的帧数 (1 ~ FRAME_POOL_MAX_SLOTS)，
+ *                 应小于驱动缓冲区数量，保证驱动始终有可写的缓冲区
+ * @param release_fn 缓冲区交还函数
+ * @param user 交还函数的用户数据
+ * @return 0成功，-1参数无效
+ */
+int frame_pool_init(frame_pool_t *pool, int capacity, frame_pool_release_fn release_fn, void *user);
+
+/**
+ * @brief 释放最新帧并销毁帧池 (调用前所有消费者应已释放引用)
+ * @param pool 帧池
+ */
+void frame_pool_destroy(frame_pool_t *pool);
+
+/**
+ * @brief 发布新采集的帧，替换最新帧
+ * @details 描述符耗尽 (消费者仍持有全部帧) 时直接交还该帧并计入丢帧数
+ * @param pool 帧池
+ * @param frame 新采集的帧
+ * @param meta 采集时的帧信息
+ * @return 0成功，-1帧被丢弃
+ */
+int frame_pool_publish(frame_pool_t *pool, const media_frame_t *frame, const frame_meta_t *meta);
+
+/**
+ * @brief 登记一帧并把唯一的引用交给调用者 (不替换最新帧，不唤醒等待者)
+ * @details 用于帧池之外产生的帧 (如断线补发缓存中的帧)，最后一个引用释放时同样调用交还函数
+ * @param pool 帧池
+ * @param frame 帧数据
+ * @param meta 帧信息
+ * @return 帧引用，描述符耗尽时返回NULL (帧仍归调用者所有，不调用交还函数)
+ */
+frame_ref_t *frame_pool_wrap(frame_pool_t *pool, const media_frame_t *frame, const frame_meta_t *meta);
+
+/**
+ * @brief 获取最新帧的引用 (不等待)
+ * @param pool 帧池
+ * @return 帧引用，暂无帧时返回NULL
+ */
+frame_ref_t *frame_pool_acquire_latest(frame_pool_t *pool);
+
+/**
+ * @brief 等待比指定序号更新的帧并获取引用
+ * @param pool 帧池
+ * @param last_sequence 已处理的最后一帧序号 (0表示任意帧)
+ * @param timeout_ms 超时时间（毫秒）
+ * @return 帧引用，超时或帧池关闭时返回NULL
+ */
+frame_ref_t *frame_pool_wait_newer(frame_pool_t *pool, uint32_t last_sequence, int timeout_ms);
+
+/**
+ * @brief 增加引用 (把已持有的帧交给另一个消费者)
+ * @param ref 帧引用
+ */
+void frame_pool_retain(frame_ref_t *ref);
+
+/**
+ * @brief 释放引用，最后一个引用释放时交还缓冲区
+ * @param ref 帧引用 (可为NULL)
+ */
+void frame_pool_release(frame_ref_t *ref);
+
+/**
+ * @brief 确保帧的派生数据缓冲区不小于指定大小
+ * @details 只应由生成派生数据的线程调用；旧内容不保留
+ * @param ref 帧引用
+ * @param size 所需字节数
+ * @return 缓冲区地址，内存不足返回NULL
+ */
+void *frame_pool_aux_reserve(frame_ref_t *ref, size_t size);
+
+/**
+ * @brief 设置关闭标志并唤醒所有等待者
+ * @param pool 帧池
+ */
+void frame_pool_wake_all(frame_pool_t *pool);
+
+/**
+ * @brief 获取丢帧数
+ * @param pool 帧池
+ * @return 因描述符耗尽而丢弃的帧数
+ */
+uint32_t frame_pool_dropped(frame_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,168 @@
+/**
+ * @file frame_queue.h
+ * @brief 有界帧队列模块头文件
+ * @details 采集线程把帧引用放入队列，发送线程从队列取出后发送，两者之间只通过
+ *          队列交接，网络I/O不会反压到采集线程 (阻塞策略除外)。
+ *          队列满时按策略丢弃最旧帧、丢弃新帧或阻塞生产者，并统计每个连接的
+ *          入队、发送和丢弃帧数
+ */
+
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "frame_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define FRAME_QUEUE_MAX_DEPTH FRAME_POOL_MAX_SLOTS /**< 队列最大深度 */
+
+/**
+ * @brief 队列满时的处理策略
+ */
+typedef enum {
+    FRAME_QUEUE_DROP_OLDEST = 0,    /**< 丢弃队首最旧帧，保证发送的是最新画面 */
+    FRAME_QUEUE_DROP_NEWEST,        /**< 丢弃新到达的帧，已入队的帧按序发出 */
+    FRAME_QUEUE_BLOCK,              /**< 阻塞生产者直到有空位 (不丢帧，发送慢时采集随之变慢) */
+    FRAME_QUEUE_POLICY_COUNT
+} frame_queue_policy_t;
+
+/**
+ * @brief 每个连接的帧统计
+ */
+typedef struct {
+    uint32_t queued;    /**< 入队帧数 */
+    uint32_t sent;      /**< 发送完成帧数 */
+    uint32_t dropped;   /**< 因队列满被丢弃的帧数 */
+} frame_queue_stats_t;
+
+/**
+ * @brief 有界帧队列 (环形缓冲区)
+ */
+typedef struct {
+    frame_ref_t *items[FRAME_QUEUE_MAX_DEPTH]; /**< 队列中的帧引用 */
+    int depth;                  /**< 队列深度 */
+    int head;                   /**< 队首位置 */
+    int count;                  /**< 当前帧数 */
+    int open;                   /**< 是否接受入队 (有连接时打开) */
+    frame_queue_policy_t policy; /**< 队列满时的处理策略 */
+    frame_queue_stats_t stats;  /**< 当前连接的统计 */
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;   /**< 有帧可取 */
+    pthread_cond_t not_full;    /**< 有空位可放 */
+} frame_queue_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 初始化帧队列 (初始为关闭状态)
+ * @param queue 帧队列
+ * @param depth 队列深度 (1 ~ FRAME_QUEUE_MAX_DEPTH)
+ * @param policy 队列满时的处理策略
+ * @return 0成功，-1参数无效
+ */
+int frame_queue_init(frame_queue_t *queue, int depth, frame_queue_policy_t policy);
+
+/**
+ * @brief 释放队列中的帧并销毁队列
+ * @param queue 帧队列
+ */
+void frame_queue_destroy(frame_queue_t *queue);
+
+/**
+ * @brief 打开队列并清零统计 (新连接建立时调用)
+ * @param queue 帧队列
+ */
+void frame_queue_open(frame_queue_t *queue);
+
+/**
+ * @brief 关闭队列，释放队列中的帧并唤醒等待者 (连接断开或退出时调用)
+ * @param queue 帧队列
+ * @param stats 输出本次连接的统计 (可为NULL)
+ */
+void frame_queue_close(frame_queue_t *queue, frame_queue_stats_t *stats);
+
+/**
+ * @brief 帧入队 (转移引用的所有权)
+ * @details 帧被丢弃或队列关闭时由本函数释放引用
+ * @param queue 帧队列
+ * @param ref 帧引用
+ * @param timeout_ms 阻塞策略下等待空位的最长时间（毫秒），超时按丢弃计
+ * @return 0入队成功，-1帧被丢弃或队列关闭
+ */
+int frame_queue_push(frame_queue_t *queue, frame_ref_t *ref, int timeout_ms);
+
+/**
+ * @brief 判断入队是否需要等待 (阻塞策略且队列已满)
+ * @param queue 帧队列
+ * @return 1需要等待空位，0可以立即入队或丢弃
+ */
+int frame_queue_would_block(frame_queue_t *queue);
+
+/**
+ * @brief 等待阻塞策略的队列出现空位 (不入队)
+ * @details 供需要在自己的锁外等待、再以0超时入队的调用者使用
+ * @param queue 帧队列
+ * @param timeout_ms 最长等待时间（毫秒）
+ * @return 1有空位或无需等待，0超时或队列已关闭
+ */
+int frame_queue_wait_space(frame_queue_t *queue, int timeout_ms);
+
+/**
+ * @brief 取出队首帧 (调用者负责释放引用)
+ * @param queue 帧队列
+ * @param timeout_ms 超时时间（毫秒）
+ * @return 帧引用，超时或队列关闭时返回NULL
+ */
+frame_ref_t *frame_queue_pop(frame_queue_t *queue, int timeout_ms);
+
+/**
+ * @brief 记录一帧发送完成
+ * @param queue 帧队列
+ */
+void frame_queue_mark_sent(frame_queue_t *queue);
+
+/**
+ * @brief 获取当前连接的统计
+ * @param queue 帧队列
+ * @param stats 输出统计
+ */
+void frame_queue_get_stats(frame_queue_t *queue, frame_queue_stats_t *stats);
+
+/**
+ * @brief 获取队列中的帧数
+ * @param queue 帧队列
+ * @return 帧数
+ */
+int frame_queue_count(frame_queue_t *queue);
+
+/**
+ * @brief 获取策略名称
+ * @param policy 处理策略
+ * @return 策略名称 ("drop-oldest" / "drop-newest" / "block")
+ */
+const char *frame_queue_policy_name(frame_queue_policy_t policy);
+
+/**
+ * @brief 按名称查找策略 (不区分大小写)
+ * @param name 策略名称
+ * @param policy 输出的处理策略
+ * @return 0成功，-1未知名称
+ */
+int frame_queue_policy_from_name(const char *name, frame_queue_policy_t *policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_QUEUE_H
@@ -0,0 +1,164 @@
+/**
+ * @file frame_tx.h
+ * @brief 帧发送模块头文件
+ * @details 把帧同步标识、帧头和图像数据 (整块或逐行) 组成 iovec，用一次 sendmsg
+ *          发出 (行数超过 IOV_MAX 时分批)。内核支持 SO_ZEROCOPY 时以 MSG_ZEROCOPY
+ *          发送，图像数据不再拷贝到套接字缓冲区；此时内核在数据真正发出前仍引用
+ *          用户页面，模块持有帧引用直到错误队列报告发送完成，期间缓冲区不会交还驱动。
+ *          不支持或内核报告已退化为拷贝 (如回环、无分散聚合能力的网卡) 时改为普通的
+ *          聚合发送 (与 writev 相同，附带 MSG_NOSIGNAL)。
+ *          发送过程可分步进行：非阻塞套接字写满时返回，可写后从断点继续
+ */
+
+#ifndef FRAME_TX_H
+#define FRAME_TX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "frame_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define FRAME_TX_MAX_PREFIX 128     /**< 帧前缀 (同步标识 + 帧头) 最大字节数 */
+#define FRAME_TX_MAX_INFLIGHT 2     /**< 等待零拷贝完成的最大帧数 */
+
+/**
+ * @brief 等待零拷贝完成的帧
+ */
+typedef struct {
+    frame_ref_t *ref;                       /**< 帧引用 (完成后释放) */
+    uint32_t end_id;                        /**< 该帧最后一次 sendmsg 的完成序号 + 1 */
+    uint8_t prefix[FRAME_TX_MAX_PREFIX];    /**< 前缀存储 (零拷贝期间内核仍引用) */
+} frame_tx_inflight_t;
+
+/**
+ * @brief 发送统计
+ */
+typedef struct {
+    uint64_t frames;        /**< 发送帧数 */
+    uint64_t bytes;         /**< 发送字节数 (含前缀) */
+    uint64_t syscalls;      /**< sendmsg 调用次数 */
+    uint64_t zc_copied;     /**< 内核报告退化为拷贝的零拷贝发送次数 */
+} frame_tx_stats_t;
+
+/**
+ * @brief 发送上下文 (每个连接一个)
+ */
+typedef struct {
+    int fd;                 /**< 套接字，未初始化为-1 */
+    int zerocopy;           /**< 是否使用 MSG_ZEROCOPY (内核报告拷贝后关闭) */
+    uint32_t next_id;       /**< 下一次零拷贝 sendmsg 的完成序号 */
+    uint32_t completed_id;  /**< 已完成的序号上界 (不含) */
+    frame_tx_inflight_t inflight[FRAME_TX_MAX_INFLIGHT]; /**< 等待完成的帧 (固定槽位，ref为NULL表示空闲) */
+    int inflight_count;     /**< 等待完成的帧数 */
+    uint8_t prefix[FRAME_TX_MAX_PREFIX]; /**< 非零拷贝模式的前缀存储 */
+    frame_tx_stats_t stats; /**< 发送统计 */
+
+    // 当前帧的发送进度
+    int busy;               /**< 是否有未发完的帧 */
+    frame_ref_t *ref;       /**< 当前帧引用 (不持有，零拷贝登记时才增加引用) */
+    const uint8_t *cur_prefix; /**< 当前帧前缀 (指向 prefix 或在途槽位) */
+    size_t prefix_len;      /**< 当前帧前缀长度 */
+    struct iovec *segments; /**< 当前帧数据段 (副本) */
+    int segment_capacity;   /**< 数据段副本容量 */
+    struct iovec *batch;    /**< sendmsg 的 iovec 批次 (与段表副本一同扩容) */
+    int batch_capacity;     /**< 批次容量 (段数 + 1，不超过 IOV_MAX) */
+    int item_count;         /**< 段数 (含前缀) */
+    int item;               /**< 下一个待发送的段 (0为前缀) */
+    size_t offset;          /**< 该段内已发送的字节数 */
+    frame_tx_inflight_t *slot; /**< 零拷贝发送时使用的在途槽位 */
+    int zerocopy_calls;     /**< 当前帧的零拷贝 sendmsg 次数 */
+} frame_tx_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 初始化发送上下文
+ * @param tx 发送上下文
+ * @param fd 已连接的TCP套接字
+ * @param want_zerocopy 1: 尝试启用 SO_ZEROCOPY (内核不支持时自动退化)
+ * @return 0成功，-1参数无效
+ */
+int frame_tx_init(frame_tx_t *tx, int fd, int want_zerocopy);
+
+/**
+ * @brief 开始发送一帧 (复制前缀和段表，不发送数据)
+ * @details 零拷贝模式下在途帧达到上限时该帧改为拷贝发送
+ * @param tx 发送上下文 (不能有未发完的帧)
+ * @param prefix 前缀数据 (同步标识和帧头，会被复制)
+ * @param prefix_len 前缀长度 (不超过 FRAME_TX_MAX_PREFIX)
+ * @param segments 数据段 (指向帧缓冲区，段表会被复制)
+ * @param segment_count 数据段个数
+ * @param ref 数据所属的帧引用 (NULL表示数据不在帧池中，不使用零拷贝)，
+ *            调用者须持有该引用直到本帧发完
+ * @return 0成功，-1参数无效或内存不足
+ */
+int frame_tx_begin(frame_tx_t *tx, const void *prefix, size_t prefix_len,
+                   const struct iovec *segments, int segment_count, frame_ref_t *ref);
+
+/**
+ * @brief 继续发送当前帧，直到发完或套接字缓冲区写满
+ * @param tx 发送上下文
+ * @return 1本帧发送完成，0套接字暂不可写 (等待可写后再次调用)，-1发送失败 (连接断开)
+ */
+int frame_tx_resume(frame_tx_t *tx);
+
+/**
+ * @brief 处理错误队列中的零拷贝完成通知 (套接字报告 POLLERR 时调用)
+ * @param tx 发送上下文
+ * @return 0成功，-1套接字无效
+ */
+int frame_tx_reap(frame_tx_t *tx);
+
+/**
+ * @brief 当前帧尚未交给内核的字节数
+ * @param tx 发送上下文
+ * @return 字节数，没有未发完的帧时为0
+ */
+size_t frame_tx_pending(const frame_tx_t *tx);
+
+/**
+ * @brief 发送一帧 (前缀 + 数据段)，阻塞直到数据全部交给内核
+ * @details 零拷贝模式下帧引用被保留到内核报告完成
+ * @param tx 发送上下文
+ * @param prefix 前缀数据 (同步标识和帧头，会被复制)
+ * @param prefix_len 前缀长度 (不超过 FRAME_TX_MAX_PREFIX)
+ * @param segments 数据段 (指向帧缓冲区)
+ * @param segment_count 数据段个数
+ * @param ref 数据所属的帧引用 (NULL表示数据不在帧池中，不使用零拷贝)
+ * @return 0成功，-1发送失败 (连接断开)
+ */
+int frame_tx_send(frame_tx_t *tx, const void *prefix, size_t prefix_len,
+                  const struct iovec *segments, int segment_count, frame_ref_t *ref);
+
+/**
+ * @brief 放弃未发完的帧 (连接断开时)，不等待
+ * @details 已有零拷贝数据交给内核的未发完帧登记为在途帧；处理一次完成通知后返回。
+ *          在途帧的引用仍由发送上下文持有，之后用 frame_tx_reap 回收、frame_tx_close 释放
+ * @param tx 发送上下文
+ * @return 仍在等待完成的帧数
+ */
+int frame_tx_abort(frame_tx_t *tx);
+
+/**
+ * @brief 等待在途帧完成并释放引用 (连接关闭前调用)
+ * @param tx 发送上下文
+ * @param timeout_ms 最长等待时间（毫秒），超时后直接释放
+ */
+void frame_tx_close(frame_tx_t *tx, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_TX_H
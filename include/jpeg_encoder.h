@@ -0,0 +1,85 @@
+/**
+ * @file jpeg_encoder.h
+ * @brief 整数JPEG编码模块头文件
+ * @details 把RGB565预览图编码为基线JPEG (标准哈夫曼表，无重启标记)：
+ *          彩色图按 YCbCr 4:2:0 编码，灰度图只编码亮度分量 (体积约为彩色的六成)。
+ *          颜色转换、AAN快速DCT和量化全部为定点运算，量化用预先算好的倒数相乘代替除法，
+ *          面向几百像素宽的小尺寸预览，每帧不分配内存
+ */
+
+#ifndef JPEG_ENCODER_H
+#define JPEG_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define JPEG_QUALITY_DEFAULT 50     /**< 默认质量 (IJG 1 ~ 100 标度) */
+
+/**
+ * @brief 哈夫曼编码表 (按符号索引)
+ */
+typedef struct {
+    uint16_t code[256];     /**< 码字 */
+    uint8_t size[256];      /**< 码长 (0表示符号不存在) */
+} jpeg_huffman_t;
+
+/**
+ * @brief 编码器 (只保存与图像无关的表，可重复用于任意尺寸)
+ */
+typedef struct {
+    int quality;                /**< 质量 (1 ~ 100) */
+    uint8_t quant[2][64];       /**< 亮度/色度量化表 (之字形顺序，写入DQT) */
+    uint32_t recip[2][64];      /**< 量化倒数 (自然顺序，已含AAN缩放，Q16) */
+    jpeg_huffman_t dc[2];       /**< 亮度/色度DC哈夫曼表 */
+    jpeg_huffman_t ac[2];       /**< 亮度/色度AC哈夫曼表 */
+} jpeg_encoder_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 按质量建立量化表和哈夫曼表
+ * @param enc 编码器
+ * @param quality 质量 (1 ~ 100，超出范围时限制到该区间)
+ */
+void jpeg_encoder_init(jpeg_encoder_t *enc, int quality);
+
+/**
+ * @brief 编码结果大小的上限 (最坏情况，实际通常只有其几十分之一)
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param gray 1为灰度编码
+ * @return 字节数
+ */
+size_t jpeg_encoder_bound(int width, int height, int gray);
+
+/**
+ * @brief 把RGB565图像编码为JPEG
+ * @details 宽高不是MCU整数倍时复制边缘像素填充；灰度编码取像素的亮度
+ * @param enc 编码器
+ * @param pixels RGB565像素 (左上角)
+ * @param stride 每行像素数
+ * @param width 图像宽度 (1 ~ 65535)
+ * @param height 图像高度 (1 ~ 65535)
+ * @param gray 1为灰度编码 (单分量)，0为 YCbCr 4:2:0
+ * @param out 输出缓冲区
+ * @param capacity 输出缓冲区大小
+ * @return JPEG字节数，0表示参数无效或输出缓冲区不足
+ */
+size_t jpeg_encode_rgb565(const jpeg_encoder_t *enc, const uint16_t *pixels, int stride,
+                          int width, int height, int gray, uint8_t *out, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JPEG_ENCODER_H
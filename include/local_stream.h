@@ -0,0 +1,221 @@
+/**
+ * @file local_stream.h
+ * @brief 本机帧共享模块头文件 (AF_UNIX 套接字 + 文件描述符传递)
+ * @details 设备上的其他进程 (如分析守护进程) 通过 Unix 域套接字 (SOCK_SEQPACKET) 接收帧：
+ *          帧数据放在共享内存缓冲区 (memfd) 中，缓冲区的文件描述符随第一次使用它的帧
+ *          以 SCM_RIGHTS 传给消费者，之后每帧只发送一条几十字节的描述消息。
+ *          消费者映射缓冲区后直接读取，用完发送释放消息，缓冲区在所有消费者都释放后才被复用。
+ *          libmedia 不导出 V4L2 缓冲区 (dma-buf)，因此服务器把每帧复制一次到共享缓冲区，
+ *          复制次数与消费者数量无关，消费者侧没有任何复制。
+ *          每个消费者最多同时持有 max_held 帧，超过时后续帧对它跳过 (计入 dropped)，
+ *          一个不释放帧的消费者不会拖住采集或其他消费者。
+ *          本文件同时包含线上格式、服务器 (mxCamera) 和消费者 (其他进程) 的接口
+ */
+
+#ifndef LOCAL_STREAM_H
+#define LOCAL_STREAM_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define LOCAL_STREAM_MAGIC 0x4C52584Du      /**< 消息魔数 ("MXRL") */
+#define LOCAL_STREAM_MAX_CLIENTS 4          /**< 最大消费者数 */
+#define LOCAL_STREAM_MAX_BUFFERS 8          /**< 最大共享缓冲区数 */
+
+/**
+ * @brief 消息类型
+ */
+typedef enum {
+    LOCAL_MSG_BUFFER = 1,   /**< 服务器 -> 消费者：共享缓冲区 (附带文件描述符)，slot 和 size 有效 */
+    LOCAL_MSG_FRAME = 2,    /**< 服务器 -> 消费者：新帧位于 slot 缓冲区 */
+    LOCAL_MSG_RELEASE = 3,  /**< 消费者 -> 服务器：释放 slot 中的 frame_id 帧 */
+} local_msg_type_t;
+
+/**
+ * @brief 消息 (每个 SOCK_SEQPACKET 数据报一条，所有类型共用)
+ */
+typedef struct {
+    uint32_t magic;         /**< LOCAL_STREAM_MAGIC */
+    uint16_t type;          /**< 消息类型 (local_msg_type_t) */
+    uint16_t slot;          /**< 共享缓冲区编号 */
+    uint32_t frame_id;      /**< 该连接的帧序号 (从0连续递增) */
+    uint32_t sequence;      /**< 采集序号 */
+    uint32_t dropped;       /**< 自上一帧以来未发给该消费者的采集帧数 */
+    uint32_t width;         /**< 图像宽度 */
+    uint32_t height;        /**< 图像高度 */
+    uint32_t pixfmt;        /**< 像素格式 (V4L2 fourcc) */
+    uint32_t stride;        /**< 每行字节数，0表示未知 (按 size / height 计算) */
+    uint32_t size;          /**< 帧数据字节数 (BUFFER 消息中为缓冲区大小) */
+    uint64_t capture_ns;    /**< 采集时间戳 (CLOCK_MONOTONIC，与消费者同一时钟) */
+    int32_t exposure;       /**< 采集时的曝光值 */
+    int32_t gain;           /**< 采集时的增益值 */
+} __attribute__((packed)) local_msg_t;
+
+/**
+ * @brief 服务器配置
+ */
+typedef struct {
+    int max_clients;        /**< 最大消费者数 (1 ~ LOCAL_STREAM_MAX_CLIENTS) */
+    int buffers;            /**< 共享缓冲区数 (2 ~ LOCAL_STREAM_MAX_BUFFERS，首次使用时创建) */
+    int max_held;           /**< 每个消费者最多同时持有的帧数 */
+    size_t stride;          /**< 驱动报告的行字节数，0表示未知 */
+} local_server_config_t;
+
+/**
+ * @brief 共享缓冲区
+ */
+typedef struct {
+    int fd;                 /**< memfd，未创建为-1 */
+    void *map;              /**< 服务器的可写映射 */
+    size_t size;            /**< 缓冲区大小 */
+    int holders;            /**< 持有该缓冲区的消费者数，0表示空闲 */
+} local_buffer_t;
+
+/**
+ * @brief 已连接的消费者 (服务器侧)
+ */
+typedef struct {
+    int fd;                 /**< 套接字，空闲槽位为-1 */
+    int id;                 /**< 连接编号 */
+    uint32_t announced;     /**< 已发送过文件描述符的缓冲区 (位图) */
+    uint32_t held;          /**< 正在持有的缓冲区 (位图) */
+    uint32_t frame_id;      /**< 下一帧的帧序号 */
+    uint32_t last_sequence; /**< 上一帧的采集序号，0表示尚未发送 */
+    uint32_t sent;          /**< 发送的帧数 */
+    uint32_t dropped;       /**< 因持有帧数达到上限而跳过的帧数 */
+} local_peer_t;
+
+/**
+ * @brief 本机帧共享服务器
+ */
+typedef struct {
+    int listen_fd;          /**< 监听套接字，未初始化为-1 */
+    int epoll_fd;           /**< epoll 实例 */
+    int wake_fd;            /**< 事件通知 (eventfd)：新帧或停止 */
+    volatile int stop;      /**< 停止标志 */
+    char path[108];         /**< 套接字路径 (销毁时删除) */
+    local_server_config_t config; /**< 服务器配置 */
+    local_buffer_t buffers[LOCAL_STREAM_MAX_BUFFERS]; /**< 共享缓冲区 */
+    int next_buffer;        /**< 下一次查找空闲缓冲区的起点 */
+    local_peer_t peers[LOCAL_STREAM_MAX_CLIENTS]; /**< 消费者槽位 */
+    int client_count;       /**< 当前消费者数 */
+    int next_id;            /**< 下一个连接编号 */
+    frame_ref_t *pending;   /**< 等待复制的最新帧 (受 lock 保护) */
+    uint32_t skipped;       /**< 尚未复制就被更新帧替换、或没有空闲缓冲区而跳过的帧数 */
+    pthread_mutex_t lock;   /**< 保护 pending */
+} local_server_t;
+
+/**
+ * @brief 消费者收到的一帧
+ */
+typedef struct {
+    const void *data;       /**< 帧数据 (只读映射，释放前有效) */
+    local_msg_t info;       /**< 帧描述 */
+} local_frame_t;
+
+/**
+ * @brief 消费者连接
+ */
+typedef struct {
+    int fd;                 /**< 套接字 */
+    void *maps[LOCAL_STREAM_MAX_BUFFERS];   /**< 共享缓冲区的只读映射 */
+    size_t sizes[LOCAL_STREAM_MAX_BUFFERS]; /**< 映射大小 */
+} local_stream_t;
+
+// ============================================================================
+// 函数声明 (服务器)
+// ============================================================================
+
+/**
+ * @brief 在 path 上创建监听套接字并初始化服务器 (已存在的套接字文件被替换)
+ * @param server 服务器
+ * @param path 套接字路径
+ * @param config 服务器配置
+ * @return 0成功，-1失败
+ */
+int local_server_init(local_server_t *server, const char *path, const local_server_config_t *config);
+
+/**
+ * @brief 运行事件循环 (在服务器线程中调用，直到 local_server_stop)
+ * @param server 服务器
+ */
+void local_server_run(local_server_t *server);
+
+/**
+ * @brief 请求事件循环退出 (可在任意线程和信号处理函数中调用)
+ * @param server 服务器
+ */
+void local_server_stop(local_server_t *server);
+
+/**
+ * @brief 断开所有消费者，释放共享缓冲区并删除套接字文件 (事件循环退出后调用)
+ * @param server 服务器
+ */
+void local_server_destroy(local_server_t *server);
+
+/**
+ * @brief 把新帧交给服务器线程 (采集线程调用，不复制数据，不阻塞)
+ * @details 服务器持有该帧的引用直到复制完成；上一帧尚未复制时被替换
+ * @param server 服务器
+ * @param ref 帧引用 (调用者仍持有自己的引用)
+ */
+void local_server_publish(local_server_t *server, frame_ref_t *ref);
+
+/**
+ * @brief 获取当前消费者数
+ * @param server 服务器
+ * @return 消费者数
+ */
+int local_server_client_count(local_server_t *server);
+
+// ============================================================================
+// 函数声明 (消费者)
+// ============================================================================
+
+/**
+ * @brief 连接服务器
+ * @param stream 消费者连接
+ * @param path 套接字路径
+ * @return 0成功，-1失败
+ */
+int local_stream_connect(local_stream_t *stream, const char *path);
+
+/**
+ * @brief 等待下一帧
+ * @param stream 消费者连接
+ * @param frame 输出帧 (用完后调用 local_stream_release)
+ * @param timeout_ms 超时 (毫秒)，-1为一直等待
+ * @return 0成功，1超时，-1连接断开
+ */
+int local_stream_next(local_stream_t *stream, local_frame_t *frame, int timeout_ms);
+
+/**
+ * @brief 释放一帧，服务器可以复用其缓冲区
+ * @param stream 消费者连接
+ * @param frame 帧
+ * @return 0成功，-1失败
+ */
+int local_stream_release(local_stream_t *stream, const local_frame_t *frame);
+
+/**
+ * @brief 断开连接并解除所有映射 (未释放的帧随之释放)
+ * @param stream 消费者连接
+ */
+void local_stream_close(local_stream_t *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOCAL_STREAM_H
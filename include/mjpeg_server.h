@@ -0,0 +1,167 @@
+/**
+ * @file mjpeg_server.h
+ * @brief HTTP MJPEG 预览服务器头文件
+ * @details 供远程监看的低带宽预览：服务器线程按配置的帧率取最新帧，经预览渲染得到
+ *          RGB565 小图后编码为JPEG (每帧只编码一次)，以 multipart/x-mixed-replace
+ *          推送给所有浏览器/curl 客户端。与原始帧流互不影响，没有客户端时不渲染也不编码。
+ *          GET /stream 为连续的 MJPEG 流，GET /snapshot 返回下一帧单张JPEG，GET / 为内嵌预览的页面。
+ *          客户端来不及接收时跳过中间帧 (总是发送最新的图像)，不会积压
+ */
+
+#ifndef MJPEG_SERVER_H
+#define MJPEG_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jpeg_encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define MJPEG_SERVER_MAX_CLIENTS 4          /**< 最大客户端数 */
+#define MJPEG_SERVER_MAX_FPS 30             /**< 帧率上限 */
+#define MJPEG_REQUEST_MAX 1024              /**< HTTP 请求头的最大长度 */
+#define MJPEG_BOUNDARY "mxcamera-frame"     /**< multipart 分隔符 */
+
+/**
+ * @brief 预览图像 (服务器分配像素缓冲区，图像源填写内容)
+ */
+typedef struct {
+    uint16_t *pixels;       /**< RGB565 缓冲区，每行 max_width 像素 */
+    int max_width;          /**< 缓冲区宽度 (配置的预览宽度) */
+    int max_height;         /**< 缓冲区高度 (配置的预览高度) */
+    int width;              /**< 图像源填写：实际宽度 (<= max_width) */
+    int height;             /**< 图像源填写：实际高度 (<= max_height) */
+    int gray;               /**< 图像源填写：1为灰度图 (只编码亮度) */
+    uint32_t sequence;      /**< 图像源填写：采集序号 */
+} mjpeg_image_t;
+
+/**
+ * @brief 图像源：把最新帧渲染到 image->pixels (在服务器线程中调用)
+ * @param image 预览图像
+ * @param user 用户数据
+ * @return 1渲染了新帧，0没有新帧，-1失败
+ */
+typedef int (*mjpeg_source_fn)(mjpeg_image_t *image, void *user);
+
+/**
+ * @brief 服务器配置
+ */
+typedef struct {
+    int port;               /**< TCP 端口 */
+    int max_clients;        /**< 最大客户端数 (1 ~ MJPEG_SERVER_MAX_CLIENTS) */
+    int width;              /**< 预览最大宽度 (图像源按比例缩放到此范围内) */
+    int height;             /**< 预览最大高度 */
+    int fps;                /**< 帧率 (1 ~ MJPEG_SERVER_MAX_FPS) */
+    int quality;            /**< JPEG 质量 (1 ~ 100) */
+    mjpeg_source_fn source_fn; /**< 图像源 */
+    void *source_user;      /**< 图像源的用户数据 */
+} mjpeg_server_config_t;
+
+/**
+ * @brief 客户端状态
+ */
+typedef enum {
+    MJPEG_CLIENT_REQUEST,   /**< 等待请求头 */
+    MJPEG_CLIENT_STREAM,    /**< 接收 MJPEG 流 */
+    MJPEG_CLIENT_SNAPSHOT,  /**< 等待下一帧单张JPEG */
+    MJPEG_CLIENT_CLOSING,   /**< 发送完剩余数据后关闭 */
+} mjpeg_client_state_t;
+
+/**
+ * @brief 客户端连接
+ */
+typedef struct {
+    int fd;                 /**< 套接字，空闲槽位为-1 */
+    int id;                 /**< 连接编号 */
+    mjpeg_client_state_t state; /**< 状态 */
+    uint64_t accepted_ns;   /**< 连接时刻 (请求头超时判断) */
+    char request[MJPEG_REQUEST_MAX]; /**< 已收到的请求头 */
+    size_t request_len;     /**< 请求头长度 */
+    uint8_t *out;           /**< 待发送数据 (一个 multipart 部分或一个响应) */
+    size_t out_capacity;    /**< 缓冲区大小 */
+    size_t out_len;         /**< 待发送数据长度 */
+    size_t out_sent;        /**< 已发送长度 */
+    int writing;            /**< 是否在等待可写事件 */
+    uint32_t frames;        /**< 发送的帧数 */
+    uint32_t skipped;       /**< 上一帧未发完而跳过的帧数 */
+} mjpeg_client_t;
+
+/**
+ * @brief MJPEG 预览服务器
+ */
+typedef struct {
+    int listen_fd;          /**< 监听套接字，未初始化为-1 */
+    int epoll_fd;           /**< epoll 实例 */
+    int wake_fd;            /**< 停止通知 (eventfd) */
+    volatile int stop;      /**< 停止标志 */
+    mjpeg_server_config_t config; /**< 服务器配置 */
+    jpeg_encoder_t encoder; /**< JPEG 编码器 */
+    mjpeg_image_t image;    /**< 预览图像 */
+    uint8_t *jpeg;          /**< 最近一帧的JPEG */
+    size_t jpeg_capacity;   /**< JPEG 缓冲区大小 (不足时增大到编码上限) */
+    size_t jpeg_size;       /**< 最近一帧的JPEG大小 */
+    uint32_t last_sequence; /**< 最近编码的采集序号 */
+    uint64_t next_frame_ns; /**< 下一次取帧的时刻 */
+    mjpeg_client_t clients[MJPEG_SERVER_MAX_CLIENTS]; /**< 客户端槽位 */
+    int client_count;       /**< 当前客户端数 */
+    int next_id;            /**< 下一个连接编号 */
+
+    // 统计
+    uint32_t encoded;       /**< 编码的帧数 */
+    uint64_t encode_ns;     /**< 渲染和编码的累计耗时 */
+    uint64_t jpeg_bytes;    /**< 编码输出的累计字节数 */
+} mjpeg_server_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 在 config->port 上监听并初始化服务器
+ * @param server 服务器
+ * @param config 服务器配置 (帧率和质量超出范围时限制到有效区间)
+ * @return 0成功，-1失败
+ */
+int mjpeg_server_init(mjpeg_server_t *server, const mjpeg_server_config_t *config);
+
+/**
+ * @brief 运行事件循环 (在服务器线程中调用，直到 mjpeg_server_stop)
+ * @param server 服务器
+ */
+void mjpeg_server_run(mjpeg_server_t *server);
+
+/**
+ * @brief 请求事件循环退出 (可在任意线程和信号处理函数中调用)
+ * @param server 服务器
+ */
+void mjpeg_server_stop(mjpeg_server_t *server);
+
+/**
+ * @brief 断开所有客户端并释放资源 (事件循环退出后调用)
+ * @param server 服务器
+ */
+void mjpeg_server_destroy(mjpeg_server_t *server);
+
+/**
+ * @brief 按源图宽高比计算放入预览范围的最大尺寸 (供图像源使用)
+ * @param src_width 源图宽度
+ * @param src_height 源图高度
+ * @param max_width 预览最大宽度
+ * @param max_height 预览最大高度
+ * @param width 输出宽度
+ * @param height 输出高度
+ */
+void mjpeg_fit_size(int src_width, int src_height, int max_width, int max_height, int *width, int *height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MJPEG_SERVER_H
@@ -35,6 +35,18 @@
 #include "lv_drivers/display/fbdev.h"
 #include "lvgl/lvgl.h"
 #include "fbtft_lcd.h"
+#include "raw_decode.h"
+#include "raw_compand.h"
+#include "preview.h"
+#include "fb_blit.h"
+#include "frame_pool.h"
+#include "frame_queue.h"
+#include "frame_tx.h"
+#include "stream_server.h"
+#include "stream_format.h"
+#include "local_stream.h"
+#include "mjpeg_server.h"
+#include "photo_writer.h"
 
 // TCP 传输相关头文件
 #include <arpa/inet.h>
@@ -42,21 +54,6 @@
 #include <sys/socket.h>
 #include <sys/select.h>
 
-/**
- * @struct frame_header
- * @brief TCP传输数据帧头部结构
- */
-struct frame_header {
-    uint32_t magic;       /**< 魔数标识：0xDEADBEEF */
-    uint32_t frame_id;    /**< 帧序号 */
-    uint32_t width;       /**< 图像宽度 */
-    uint32_t height;      /**< 图像高度 */
-    uint32_t pixfmt;      /**< 像素格式 */
-    uint32_t size;        /**< 数据大小 */
-    uint64_t timestamp;   /**< 时间戳 */
-    uint32_t reserved[2]; /**< 保留字段 */
-} __attribute__((packed));
-
 /**
  * @struct mxcamera_config_t
  * @brief mxCamera 配置结构体
@@ -66,15 +63,66 @@ typedef struct {
     int camera_width;
     int camera_height;
     
-    // 裁剪参数
+    // 裁剪参数 (软件ROI，宽高为0表示到图像边缘)
     int crop_top;
     int crop_left;
+    int crop_width;
+    int crop_height;
+
+    // 传感器像素格式 (如 SBGGR10) 和打包排列方式 (rockchip / mipi)
+    const raw_format_t *pixel_format;
+    raw_packing_t raw_packing;
+
+    // 驱动缓冲区数量 (队列深度，帧池可同时持有其中 buffer_count-1 帧)
+    int buffer_count;
+
+    // 拍照缓冲区数量 (启动时按整帧分配，即最多同时等待保存的照片数)
+    int photo_buffers;
     
     // 控制参数
     int exposure;
     int gain;
     int exposure_step;
     int gain_step;
+
+    // 预览参数
+    int direct_blit;     // 1: 预览直接写入帧缓冲，LVGL只绘制叠加控件
+    int preview_color;   // 1: BGGR 2x2合并彩色预览，0: 灰度预览
+    int wb_red_gain;     // 白平衡增益 (256 = 1.0)
+    int wb_green_gain;
+    int wb_blue_gain;
+    int black_level;     // 黑电平 (按10位计)
+    float gamma;         // 预览伽马 (1.0为线性)
+    float contrast;      // 预览对比度 (1.0为不变)
+
+    // TCP发送队列
+    int tcp_queue_depth;                    // 队列深度 (帧)
+    frame_queue_policy_t tcp_queue_policy;  // 队列满时的策略 (drop-oldest / drop-newest / block)
+    int tcp_zerocopy;                       // 1: 内核支持时以 MSG_ZEROCOPY 发送
+    int tcp_max_clients;                    // 同时连接的最大客户端数
+    int tcp_decimation;                     // 新客户端的默认抽帧系数 (每N帧发送1帧)
+    int tcp_compress;                       // 1: 发送无损压缩的RAW数据 (帧头 reserved[0] 标记)
+    raw_compand_curve_t tcp_compand;        // 新连接的默认压扩曲线 (off / sqrt / log)，客户端可另行请求
+    int tcp_max_latency_ms;                 // 码率控制的排队延迟上限 (毫秒)，0为关闭
+    int tcp_adapt_compress;                 // 1: 码率控制可以临时启用压缩
+    int tcp_adapt_binning;                  // 1: 码率控制可以临时合并像素
+    int tcp_spool_frames;                   // 断线补发缓存的内存帧数，0为关闭
+    char tcp_spool_dir[128];                // 溢出目录，空字符串表示只用内存
+    int tcp_spool_disk_mb;                  // 溢出文件大小上限 (MB)
+    int tcp_spool_timeout_s;                // 断线后等待同一会话重连的时间 (秒)
+    int tcp_remote_control;                 // 1: 接受客户端的曝光/增益/外设控制请求
+
+    // 本机帧共享 (Unix 域套接字 + memfd)
+    char local_socket[108];                 // 套接字路径，空字符串表示关闭
+    int local_buffers;                      // 共享缓冲区数 (按需创建)
+    int local_max_held;                     // 每个消费者最多同时持有的帧数
+
+    // HTTP MJPEG 预览
+    int http_port;                          // 端口，0表示关闭
+    int http_width;                         // 预览最大宽度 (按裁剪区域比例缩放)
+    int http_height;                        // 预览最大高度
+    int http_fps;                           // 预览帧率
+    int http_quality;                       // JPEG 质量 (1 ~ 100)
 } mxcamera_config_t;
 
 // /**
@@ -177,6 +225,7 @@ typedef struct {
 
 void update_fps(void);
 void update_image_display(void);
+void invalidate_overlay_widgets(void);
 void init_lvgl_ui(void);
 void update_time_display(void);
 void show_settings_menu(void);
@@ -198,15 +247,16 @@ int parse_arguments(int argc, char* argv[]);
 
 // 图像处理和缩放
 void calculate_scaled_size(int src_width, int src_height, int* dst_width, int* dst_height);
-void unpack_sbggr10_scalar(const uint8_t raw_bytes[5], uint16_t pixels[4]);
-int unpack_sbggr10_image(const uint8_t *raw_data, size_t raw_size, 
-                               uint16_t *output_pixels, int width, int height);
 void scale_pixels(const uint16_t* src_pixels, int src_width, int src_height,
                         uint16_t* dst_pixels, int dst_width, int dst_height);
 void convert_pixels_to_rgb565(const uint16_t* pixels, uint16_t* rgb565_data,
                                     int width, int height);
-int landscape_image_fit(const uint16_t* src_buffer, int src_width, int src_height, 
-                              uint16_t* dst_buffer);
+int run_preview_benchmark(int width, int height);
+
+// RAW数据布局
+size_t query_plane_stride(const char* device);
+void get_frame_roi(const void* data, size_t size, int width, int height,
+                   raw_layout_t* roi, const uint8_t** roi_data, size_t* roi_size);
 
 // 相机控制相关函数
 void menu_exposure_event_cb(lv_event_t* e);
@@ -230,8 +280,8 @@ int parse_config_line(const char* line, char* key, char* value);
 
 // 拍照功能
 int capture_raw_photo(void);
-int create_images_directory(void);
-char* generate_photo_filename(void);
+void process_photo_results(void);
+char* generate_photo_filename(int width, int height);
 
 // 系统资源监控
 float get_cpu_usage(void);
@@ -254,8 +304,8 @@ void cleanup_image_buffers(void);
 // TCP 传输相关函数
 uint64_t get_time_ns(void);
 int create_server(int port);
-int send_frame(int fd, void* data, size_t size, uint32_t frame_id, uint64_t timestamp);
 void* tcp_sender_thread(void* arg);
+void process_remote_controls(void);
 // ============================================================================
 // I2C 模块函数声明 (i2c.c)
 // ============================================================================
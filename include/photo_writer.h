@@ -0,0 +1,145 @@
+/**
+ * @file photo_writer.h
+ * @brief 后台拍照保存模块头文件
+ * @details 界面线程拍照时只把帧引用和文件名交给后台线程 (几毫秒内返回)，
+ *          后台线程把帧解包到预先分配的16位缓冲区后立即释放引用，再写入存储卡。
+ *          写入按块进行，块之间先解包新提交的照片，帧引用最多被持有一个块的写入时间，
+ *          不会因为慢速存储长时间占用帧池描述符。每张照片占用一个缓冲区直到写完，
+ *          缓冲区全部占用时拒绝新的拍照。保存结果由界面线程轮询取出
+ */
+
+#ifndef PHOTO_WRITER_H
+#define PHOTO_WRITER_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_pool.h"
+#include "raw_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define PHOTO_WRITER_MAX_BUFFERS 8      /**< 最大缓冲区数 (即最多同时等待保存的照片数) */
+#define PHOTO_WRITER_RESULTS 8          /**< 尚未取出的保存结果数 (溢出时丢弃最早的结果) */
+#define PHOTO_WRITER_PATH_MAX 256       /**< 文件路径最大长度 */
+
+/**
+ * @brief 后台保存配置
+ */
+typedef struct {
+    char dir[128];              /**< 保存目录 (每次写入前确保存在，存储卡可能被重新挂载) */
+    int buffers;                /**< 缓冲区数 (1 ~ PHOTO_WRITER_MAX_BUFFERS) */
+    size_t buffer_size;         /**< 每个缓冲区的字节数 (整帧解包为16位的大小) */
+} photo_writer_config_t;
+
+/**
+ * @brief 一张照片的保存结果
+ */
+typedef struct {
+    char path[PHOTO_WRITER_PATH_MAX]; /**< 文件路径 */
+    int status;                 /**< 0成功，-1失败 (不完整的文件已删除) */
+    int width;                  /**< 图像宽度 */
+    int height;                 /**< 图像高度 */
+    size_t size;                /**< 写入的字节数 */
+    uint32_t sequence;          /**< 帧的采集序号 */
+    int elapsed_ms;             /**< 从提交到写完的时间 (毫秒) */
+} photo_result_t;
+
+/**
+ * @brief 一张等待保存的照片 (与缓冲区一一对应)
+ */
+typedef struct {
+    int state;                  /**< 空闲 / 等待解包 / 等待写入 / 写入中 */
+    uint32_t order;             /**< 提交顺序 (按此顺序解包和写入) */
+    frame_ref_t *ref;           /**< 帧引用 (解包后释放) */
+    raw_layout_t layout;        /**< 待保存区域的布局 */
+    const uint8_t *data;        /**< 区域首行数据 (位于帧引用内) */
+    size_t size;                /**< 区域数据大小 */
+    uint64_t submit_ns;         /**< 提交时刻 (CLOCK_MONOTONIC) */
+    uint32_t sequence;          /**< 帧的采集序号 */
+    char path[PHOTO_WRITER_PATH_MAX]; /**< 文件路径 */
+} photo_job_t;
+
+/**
+ * @brief 后台保存器
+ */
+typedef struct {
+    photo_writer_config_t config; /**< 配置 */
+    uint16_t *buffers[PHOTO_WRITER_MAX_BUFFERS]; /**< 解包缓冲区 (初始化时分配) */
+    photo_job_t jobs[PHOTO_WRITER_MAX_BUFFERS];  /**< 照片 (下标与缓冲区相同) */
+    uint32_t next_order;        /**< 下一次提交的顺序号 */
+
+    photo_result_t results[PHOTO_WRITER_RESULTS]; /**< 保存结果环形队列 */
+    int result_head;            /**< 最早结果的位置 */
+    int result_count;           /**< 结果数 */
+
+    uint32_t saved;             /**< 保存成功的照片数 */
+    uint32_t failed;            /**< 保存失败的照片数 */
+    uint32_t rejected;          /**< 缓冲区全部占用而拒绝的拍照数 */
+
+    pthread_t thread;           /**< 后台线程 */
+    int thread_started;         /**< 后台线程是否已启动 */
+    int stop;                   /**< 停止标志 (已提交的照片写完后退出) */
+    pthread_mutex_t lock;       /**< 保护以上状态 */
+    pthread_cond_t cond;        /**< 唤醒后台线程 */
+} photo_writer_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 分配缓冲区并启动后台线程
+ * @param writer 保存器
+ * @param config 配置
+ * @return 0成功，-1参数无效、内存不足或线程创建失败
+ */
+int photo_writer_init(photo_writer_t *writer, const photo_writer_config_t *config);
+
+/**
+ * @brief 写完已提交的照片，停止后台线程并释放缓冲区
+ * @param writer 保存器
+ */
+void photo_writer_destroy(photo_writer_t *writer);
+
+/**
+ * @brief 提交一张照片 (不等待解包和写入)
+ * @details 成功时帧引用归保存器所有，失败时仍归调用者所有
+ * @param writer 保存器
+ * @param ref 帧引用
+ * @param layout 待保存区域的布局 (如 get_frame_roi 截取的裁剪区域)
+ * @param data 区域首行数据 (位于帧引用内)
+ * @param size 区域数据大小
+ * @param path 文件路径
+ * @return 0成功，-1保存器未启动、区域超过缓冲区大小或缓冲区全部占用
+ */
+int photo_writer_submit(photo_writer_t *writer, frame_ref_t *ref, const raw_layout_t *layout,
+                        const uint8_t *data, size_t size, const char *path);
+
+/**
+ * @brief 取出一个保存结果 (不等待)
+ * @param writer 保存器
+ * @param result 输出的结果
+ * @return 1取出一个结果，0暂无结果
+ */
+int photo_writer_poll(photo_writer_t *writer, photo_result_t *result);
+
+/**
+ * @brief 获取等待保存的照片数
+ * @param writer 保存器
+ * @return 已提交但尚未写完的照片数
+ */
+int photo_writer_pending(photo_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PHOTO_WRITER_H
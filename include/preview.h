@@ -0,0 +1,126 @@
+/**
+ * @file preview.h
+ * @brief 预览渲染模块头文件
+ * @details 从RAW8/RAW10/RAW12数据直接生成RGB565预览图，不需要整帧解包缓冲区，
+ *          支持灰度预览和Bayer 2x2合并的彩色预览 (四种Bayer排列)，缩放采用定点面积平均
+ *          (每个输出像素覆盖的全部源像素参与平均)，
+ *          色调映射 (黑电平、伽马、对比度、白平衡) 通过10位查找表完成，
+ *          其他位深的像素在采样时换算到10位
+ */
+
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "raw_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+/**
+ * @brief 预览模式
+ */
+typedef enum {
+    PREVIEW_MODE_GRAY,      /**< 灰度预览 (覆盖区域内全部Bayer像素不分颜色取平均) */
+    PREVIEW_MODE_COLOR      /**< 彩色预览 (Bayer 2x2合并为一个RGB像素) */
+} preview_mode_t;
+
+#define PREVIEW_GAIN_UNITY 256                      /**< 白平衡增益的1.0倍 (Q8定点) */
+#define PREVIEW_GAIN_MAX (16 * PREVIEW_GAIN_UNITY)  /**< 白平衡增益上限 (16.0) */
+#define PREVIEW_LUT_SIZE 1024                       /**< 10位输入的查找表大小 */
+
+/**
+ * @brief 预览参数
+ */
+typedef struct {
+    preview_mode_t mode;    /**< 预览模式 */
+    int wb_red;             /**< 红色通道增益 (Q8，256 = 1.0) */
+    int wb_green;           /**< 绿色通道增益 (Q8，256 = 1.0) */
+    int wb_blue;            /**< 蓝色通道增益 (Q8，256 = 1.0) */
+    int black_level;        /**< 黑电平 (按10位计，0 ~ 1022，与传感器位深无关) */
+    float gamma;            /**< 伽马值 (输出 = 输入^(1/gamma)，1.0为线性) */
+    float contrast;         /**< 对比度 (以中灰为中心缩放，1.0为不变) */
+} preview_params_t;
+
+/**
+ * @brief 预览渲染上下文
+ * @details 缓存源/目标尺寸对应的面积平均区间表和行缓冲区，尺寸不变时每帧无需重新计算
+ */
+typedef struct {
+    preview_params_t params;    /**< 当前预览参数 */
+    preview_mode_t table_mode;  /**< 缓存键：采样表对应的预览模式 */
+    raw_kind_t kind;            /**< 缓存键：采样表对应的数据种类 */
+    raw_bayer_t bayer;          /**< 缓存键：采样表对应的Bayer排列 */
+    int bit_depth;              /**< 缓存键：采样表对应的位深 */
+    int red_first;              /**< 彩色模式下四元组左上角是否为红色 (否则为蓝色) */
+    int value_shift;            /**< 区间和乘以倒数后换算为10位查找表下标的右移位数 */
+    int src_width;          /**< 缓存键：源图像宽度 */
+    int src_height;         /**< 缓存键：源图像高度 */
+    int dst_width;          /**< 缓存键：输出宽度 */
+    int dst_height;         /**< 缓存键：输出高度 */
+    int span_width;         /**< 源图像的列数 (彩色模式为四元组列数) */
+    int col_count_min;      /**< 各列覆盖的源列数的最小值 (各列只相差0或1) */
+    uint32_t *col_start;    /**< 每列覆盖区间的首个源列 (彩色模式为四元组列) [dst_width] */
+    uint16_t *col_count;    /**< 每列覆盖的源列数 [dst_width] */
+    uint32_t *row_start;    /**< 每行覆盖区间的首个源行 (彩色模式为四元组首行) [dst_height] */
+    uint16_t *row_count;    /**< 每行覆盖的源行数 (彩色模式为四元组行数) [dst_height] */
+    uint16_t *line;         /**< 一个源行的解包结果 [src_width] */
+    uint32_t *line_sum;     /**< 当前输出行覆盖的源行逐列累加 (彩色模式为三个通道) [span_width * 通道数] */
+    uint16_t lut_gray[PREVIEW_LUT_SIZE];    /**< 灰度：10位值 -> RGB565 */
+    uint16_t lut_red[PREVIEW_LUT_SIZE];     /**< 彩色：10位红色 -> RGB565红色分量 (已含白平衡) */
+    uint16_t lut_green[PREVIEW_LUT_SIZE];   /**< 彩色：10位绿色 -> RGB565绿色分量 (已含白平衡) */
+    uint16_t lut_blue[PREVIEW_LUT_SIZE];    /**< 彩色：10位蓝色 -> RGB565蓝色分量 (已含白平衡) */
+} preview_context_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 初始化预览渲染上下文
+ * @param ctx 上下文指针
+ */
+void preview_context_init(preview_context_t *ctx);
+
+/**
+ * @brief 设置预览参数，超出范围的参数会被限制到有效区间
+ * @details 参数变化时重建色调映射查找表，未变化时直接返回
+ * @param ctx 上下文指针
+ * @param params 预览参数
+ */
+void preview_set_params(preview_context_t *ctx, const preview_params_t *params);
+
+/**
+ * @brief 释放预览渲染上下文中的采样表 (预览参数保留)
+ * @param ctx 上下文指针
+ */
+void preview_context_release(preview_context_t *ctx);
+
+/**
+ * @brief 融合预览内核：RAW解包 + 面积平均缩放 (+ 2x2合并) + RGB565转换一次完成
+ * @param ctx 渲染上下文
+ * @param layout 源数据布局 (尺寸、每行字节数、排列方式、位深、Bayer排列)
+ * @param raw RAW数据
+ * @param raw_size 数据大小（字节）
+ * @param dst 输出RGB565缓冲区（指向输出区域左上角）
+ * @param dst_stride 输出缓冲区每行像素数
+ * @param dst_width 输出宽度
+ * @param dst_height 输出高度
+ * @return 0成功，-1失败
+ */
+int preview_render_raw(preview_context_t *ctx, const raw_layout_t *layout,
+                       const uint8_t *raw, size_t raw_size,
+                       uint16_t *dst, int dst_stride, int dst_width, int dst_height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PREVIEW_H
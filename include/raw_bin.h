@@ -0,0 +1,100 @@
+/**
+ * @file raw_bin.h
+ * @brief Bayer RAW像素合并 (binning) 模块头文件
+ * @details 按Bayer同色像素求平均：系数为N时，每 2N x 2N 个输入像素合成一个 2x2 Bayer 单元，
+ *          输出保持原来的Bayer排列、位深和打包方式，尺寸缩小为 1/N x 1/N。
+ *          逐行解包后先在行方向累加N行同色行 (16位，位深不超过14时不会溢出)，
+ *          再在列方向合并并四舍五入，最后重新打包。累加和合并有NEON内核，
+ *          raw_decode_init 选用NEON解包内核时一并启用
+ */
+
+#ifndef RAW_BIN_H
+#define RAW_BIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "raw_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define RAW_BIN_MAX_DEPTH 14    /**< 支持的最大位深 (行方向累加使用16位) */
+
+/**
+ * @brief 行方向累加内核：sum[i] += row[i]
+ * @param sum 累加结果
+ * @param row 解包后的一行
+ * @param count 像素数
+ */
+typedef void (*raw_bin_accumulate_fn)(uint16_t *sum, const uint16_t *row, size_t count);
+
+/**
+ * @brief 列方向合并内核
+ * @param sum 已累加N行的同色行 (groups * 2N 个)
+ * @param dst 输出像素 (groups * 2 个)
+ * @param groups 输出的同色像素对数
+ */
+typedef void (*raw_bin_reduce_fn)(const uint16_t *sum, uint16_t *dst, size_t groups);
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 计算合并后的数据布局
+ * @details 宽高向下取整到 2N 的倍数后除以N；输出行无填充 (stride 为最小行字节数)
+ * @param layout 输入布局
+ * @param rows 输入行数
+ * @param factor 合并系数 (2 或 4)
+ * @param binned 输出布局
+ * @param binned_rows 输出行数
+ * @return 0成功，-1参数无效或图像小于一个合并单元
+ */
+int raw_bin_layout(const raw_layout_t *layout, int rows, int factor,
+                   raw_layout_t *binned, int *binned_rows);
+
+/**
+ * @brief 计算 raw_bin_image 需要的工作区大小
+ * @param layout 输入布局
+ * @return 字节数
+ */
+size_t raw_bin_workspace_size(const raw_layout_t *layout);
+
+/**
+ * @brief 合并一帧
+ * @param layout 输入布局 (stride 可含行尾填充)
+ * @param data 首行数据
+ * @param rows 输入行数
+ * @param factor 合并系数 (2 或 4)
+ * @param dst 输出缓冲区 (raw_bin_layout 给出的 stride * 行数)
+ * @param capacity 输出缓冲区大小
+ * @param workspace 工作区 (raw_bin_workspace_size 字节)
+ * @return 0成功，-1参数无效或缓冲区不足
+ */
+int raw_bin_image(const raw_layout_t *layout, const uint8_t *data, int rows, int factor,
+                  uint8_t *dst, size_t capacity, void *workspace);
+
+// ============================================================================
+// 内核实现 (由 raw_bin_image 分派，一般不直接调用)
+// ============================================================================
+
+void raw_bin_accumulate_portable(uint16_t *sum, const uint16_t *row, size_t count);
+void raw_bin_reduce2_portable(const uint16_t *sum, uint16_t *dst, size_t groups);
+void raw_bin_reduce4_portable(const uint16_t *sum, uint16_t *dst, size_t groups);
+#if defined(__arm__) || defined(__aarch64__)
+void raw_bin_accumulate_neon(uint16_t *sum, const uint16_t *row, size_t count);
+void raw_bin_reduce2_neon(const uint16_t *sum, uint16_t *dst, size_t groups);
+void raw_bin_reduce4_neon(const uint16_t *sum, uint16_t *dst, size_t groups);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_BIN_H
@@ -0,0 +1,109 @@
+/**
+ * @file raw_codec.h
+ * @brief RAW图像无损压缩模块头文件
+ * @details 面向TCP传输的 Bayer RAW 无损编码：每个像素用同色相邻像素 (左2、上2、
+ *          左上) 做中值边缘检测 (MED) 预测，残差映射为非负数后按16个样本一块、
+ *          以块内最大位宽定长打包。行与行连续编码，只需保留两行解包后的像素，
+ *          编码端单遍完成、无浮点和除法，写入过程没有依赖数据的分支，
+ *          适合在单核 Cortex-A7 上逐帧压缩。
+ *          压缩流自带头部 (尺寸、位深、排列方式)，设备端和主机端解码器共用本模块。
+ *          无损指像素值无损：解码后按原排列方式重新打包，RAW10/12 紧凑排列中
+ *          不属于任何像素的填充位置0
+ */
+
+#ifndef RAW_CODEC_H
+#define RAW_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "raw_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+/**
+ * @brief 压缩流标识 ("MXR1")，同时写入TCP帧头的 reserved[0] 表示负载已压缩
+ */
+#define RAW_CODEC_FOURCC 0x3152584Du
+
+#define RAW_CODEC_HEADER_SIZE 16    /**< 压缩流头部字节数 */
+
+/**
+ * @brief 压缩流头部 (小端存储)
+ */
+typedef struct {
+    uint32_t magic;         /**< RAW_CODEC_FOURCC */
+    uint16_t width;         /**< 图像宽度 */
+    uint16_t height;        /**< 图像高度 (行数) */
+    uint8_t bit_depth;      /**< 位深 (8 ~ 14) */
+    uint8_t packing;        /**< 原始数据排列方式 (raw_packing_t)，解码时按此重新打包 */
+    uint8_t version;        /**< 格式版本 (当前为1) */
+    uint8_t reserved;       /**< 保留，为0 */
+    uint32_t raw_size;      /**< 解码后的数据大小 (height 行，每行 raw_layout_min_stride 字节) */
+} raw_codec_header_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 计算解码后 (无行尾填充) 的数据大小
+ * @param layout 数据布局
+ * @param rows 行数
+ * @return 字节数
+ */
+size_t raw_codec_raw_size(const raw_layout_t *layout, int rows);
+
+/**
+ * @brief 压缩一帧
+ * @details 压缩后不小于原始数据时返回失败，调用者应直接发送原始数据，
+ *          因此输出缓冲区只需与 raw_codec_raw_size 一样大
+ * @param layout 数据布局 (stride 可含行尾填充)
+ * @param data 首行数据
+ * @param rows 压缩的行数 (不超过 layout->height)
+ * @param dst 输出缓冲区
+ * @param capacity 输出缓冲区大小
+ * @param out_size 输出的压缩数据大小
+ * @return 0成功，-1参数无效、内存不足或数据不可压缩
+ */
+int raw_codec_encode(const raw_layout_t *layout, const uint8_t *data, int rows,
+                     uint8_t *dst, size_t capacity, size_t *out_size);
+
+/**
+ * @brief 解析压缩流头部
+ * @param src 压缩数据
+ * @param size 压缩数据大小
+ * @param header 输出的头部
+ * @return 0成功，-1不是有效的压缩流
+ */
+int raw_codec_read_header(const uint8_t *src, size_t size, raw_codec_header_t *header);
+
+/**
+ * @brief 解压一帧，恢复为原排列方式的连续行 (无行尾填充)
+ * @param src 压缩数据
+ * @param size 压缩数据大小
+ * @param dst 输出缓冲区 (至少 header.raw_size 字节)
+ * @param capacity 输出缓冲区大小
+ * @return 0成功，-1数据损坏或缓冲区不足
+ */
+int raw_codec_decode(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+
+/**
+ * @brief 把一行16位像素按布局打包 (解码端使用，raw_decode_row 的逆操作)
+ * @param layout 数据布局
+ * @param pixels 输入的16位像素 (width 个)
+ * @param row 输出的行数据 (raw_layout_min_stride 字节)
+ */
+void raw_codec_pack_row(const raw_layout_t *layout, const uint16_t *pixels, uint8_t *row);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_CODEC_H
@@ -0,0 +1,136 @@
+/**
+ * @file raw_compand.h
+ * @brief RAW压扩 (companding) 模块头文件
+ * @details 把10/12位RAW像素按平方根或对数曲线映射为8位码值，每像素1字节
+ *          (相对RAW10打包数据减少20%，相对16位数据减少50%)，用于只需要感知精度的远程接收端。
+ *          曲线在暗部不超过恒等映射 (码值 = 输入值)，暗部细节保持无损。
+ *          映射由32段折线定义：每段有起点 (Q7码值) 和每单位输入的斜率 (Q7)，
+ *          查找表按同一公式生成，NEON内核用查表指令按段计算，两者逐位一致。
+ *          解码表给出每个码值对应的输入平均值，随码表消息发给接收端
+ */
+
+#ifndef RAW_COMPAND_H
+#define RAW_COMPAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "raw_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define RAW_COMPAND_FOURCC 0x3843584Du  /**< 压扩负载的编码标识 ("MXC8") */
+#define RAW_COMPAND_SEGMENTS 32         /**< 折线段数 */
+#define RAW_COMPAND_CODES 256           /**< 码值个数 (8位) */
+#define RAW_COMPAND_MAX_DEPTH 12        /**< 支持的最大输入位深 */
+
+/**
+ * @brief 压扩曲线
+ */
+typedef enum {
+    RAW_COMPAND_OFF = 0,    /**< 不压扩 */
+    RAW_COMPAND_SQRT = 1,   /**< 平方根 (与散粒噪声匹配，量化误差与噪声成比例) */
+    RAW_COMPAND_LOG = 2,    /**< 对数 (暗部分辨率更高，适合高动态范围场景) */
+    RAW_COMPAND_COUNT       /**< 曲线总数 */
+} raw_compand_curve_t;
+
+/**
+ * @brief 一条曲线在某个输入位深下的映射表
+ */
+typedef struct {
+    raw_compand_curve_t curve;                  /**< 曲线 */
+    int input_bits;                             /**< 输入位深 (10 或 12) */
+    int shift;                                  /**< 段号 = 输入值 >> shift */
+    uint8_t base_lo[RAW_COMPAND_SEGMENTS];      /**< 段起点码值 (Q7) 的低字节 */
+    uint8_t base_hi[RAW_COMPAND_SEGMENTS];      /**< 段起点码值 (Q7) 的高字节 */
+    uint8_t slope[RAW_COMPAND_SEGMENTS];        /**< 段内每单位输入的码值增量 (Q7，不超过128) */
+    uint8_t encode[1 << RAW_COMPAND_MAX_DEPTH]; /**< 输入值 -> 码值 */
+    uint16_t decode[RAW_COMPAND_CODES];         /**< 码值 -> 输入值 (映射到该码值的输入的平均值) */
+} raw_compand_t;
+
+/**
+ * @brief 映射内核：dst[i] = 码值(src[i])
+ * @param table 映射表
+ * @param src 解包后的像素
+ * @param dst 输出码值
+ * @param count 像素数
+ */
+typedef void (*raw_compand_map_fn)(const raw_compand_t *table, const uint16_t *src, uint8_t *dst, size_t count);
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 生成全部曲线和位深的映射表，并选择映射内核
+ * @details 在 raw_decode_init 之后调用：解包使用NEON内核时映射也使用NEON内核，
+ *          与查找表逐位比对不一致时回退
+ * @return 0成功
+ */
+int raw_compand_init(void);
+
+/**
+ * @brief 获取映射表
+ * @param curve 曲线
+ * @param input_bits 输入位深
+ * @return 映射表，曲线为 RAW_COMPAND_OFF、位深不支持 (如RAW8) 或尚未初始化时返回NULL
+ */
+const raw_compand_t *raw_compand_get(raw_compand_curve_t curve, int input_bits);
+
+/**
+ * @brief 获取曲线名称
+ * @param curve 曲线
+ * @return 名称字符串 ("off" / "sqrt" / "log")
+ */
+const char *raw_compand_curve_name(raw_compand_curve_t curve);
+
+/**
+ * @brief 按名称解析曲线 (用于配置文件)
+ * @param name 名称字符串
+ * @param curve 输出的曲线
+ * @return 0成功，-1名称无效
+ */
+int raw_compand_curve_from_name(const char *name, raw_compand_curve_t *curve);
+
+/**
+ * @brief 计算 raw_compand_image 需要的工作区大小
+ * @param layout 输入布局
+ * @return 字节数
+ */
+size_t raw_compand_workspace_size(const raw_layout_t *layout);
+
+/**
+ * @brief 压扩一帧
+ * @details 输出每像素1字节、行无填充 (width * rows 字节)
+ * @param table 映射表 (位深须与布局一致)
+ * @param layout 输入布局 (stride 可含行尾填充)
+ * @param data 首行数据
+ * @param rows 行数
+ * @param dst 输出缓冲区
+ * @param capacity 输出缓冲区大小
+ * @param workspace 工作区 (raw_compand_workspace_size 字节)
+ * @return 0成功，-1参数无效或缓冲区不足
+ */
+int raw_compand_image(const raw_compand_t *table, const raw_layout_t *layout, const uint8_t *data, int rows,
+                      uint8_t *dst, size_t capacity, void *workspace);
+
+// ============================================================================
+// 内核实现 (由 raw_compand_image 分派，一般不直接调用)
+// ============================================================================
+
+void raw_compand_map_portable(const raw_compand_t *table, const uint16_t *src, uint8_t *dst, size_t count);
+#if defined(__arm__) || defined(__aarch64__)
+void raw_compand_map_neon(const raw_compand_t *table, const uint16_t *src, uint8_t *dst, size_t count);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_COMPAND_H
@@ -0,0 +1,279 @@
+/**
+ * @file raw_decode.h
+ * @brief RAW图像解包模块头文件
+ * @details 提供Bayer RAW数据的解包接口。RAW10包含标量参考实现、
+ *          可自动向量化的通用实现以及ARM NEON实现，运行时自动选择；
+ *          RAW8/RAW12由宏展开出每种格式专用的内核。
+ *          支持 Rockchip 紧凑排列、MIPI CSI-2 打包和16位非打包三种布局，
+ *          四种Bayer排列，以及带行尾填充 (bytesperline) 的缓冲区。
+ *          感兴趣区域 (ROI) 以子布局 + 字节偏移表示，不复制数据
+ */
+
+#ifndef RAW_DECODE_H
+#define RAW_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+/**
+ * @brief RAW10解包内核类型
+ */
+typedef enum {
+    RAW_KERNEL_SCALAR,      /**< 标量参考实现 (逐组解包) */
+    RAW_KERNEL_PORTABLE,    /**< 通用实现 (可由编译器自动向量化) */
+    RAW_KERNEL_NEON,        /**< ARM NEON实现 (每次迭代16像素) */
+    RAW_KERNEL_COUNT        /**< 内核总数 */
+} raw_kernel_t;
+
+/**
+ * @brief RAW数据排列方式 (RAW8只有一种排列，忽略此项)
+ */
+typedef enum {
+    RAW_PACKING_ROCKCHIP,   /**< 位流小端连续排列 (Rockchip CIF)：RAW10每5字节4像素，RAW12每3字节2像素 */
+    RAW_PACKING_MIPI,       /**< MIPI CSI-2：先存各像素高8位，再存共享的低位字节 */
+    RAW_PACKING_UNPACKED16, /**< 每像素16位小端，低位对齐 */
+    RAW_PACKING_COUNT       /**< 排列方式总数 */
+} raw_packing_t;
+
+/**
+ * @brief Bayer 排列 (左上角2x2的颜色顺序)
+ */
+typedef enum {
+    RAW_BAYER_BGGR,         /**< B G / G R */
+    RAW_BAYER_GBRG,         /**< G B / R G */
+    RAW_BAYER_GRBG,         /**< G R / B G */
+    RAW_BAYER_RGGB,         /**< R G / G B */
+    RAW_BAYER_COUNT         /**< 排列总数 */
+} raw_bayer_t;
+
+/**
+ * @brief 像素格式描述
+ */
+typedef struct {
+    const char *name;       /**< 格式名称，如 "SBGGR10" */
+    uint32_t fourcc;        /**< V4L2 像素格式 */
+    int bit_depth;          /**< 位深 (8 / 10 / 12) */
+    raw_bayer_t bayer;      /**< Bayer 排列 */
+} raw_format_t;
+
+/**
+ * @brief 位深与排列方式组合后的数据种类，每种对应一套专用内核
+ */
+typedef enum {
+    RAW_KIND_RAW8,          /**< 每像素1字节 */
+    RAW_KIND_RAW10_ROCKCHIP,/**< RAW10 Rockchip 紧凑排列 */
+    RAW_KIND_RAW10_MIPI,    /**< RAW10 MIPI CSI-2 */
+    RAW_KIND_RAW12_ROCKCHIP,/**< RAW12 Rockchip 紧凑排列 */
+    RAW_KIND_RAW12_MIPI,    /**< RAW12 MIPI CSI-2 */
+    RAW_KIND_UNPACKED16,    /**< 16位非打包 (10/12位) */
+    RAW_KIND_COUNT          /**< 种类总数 */
+} raw_kind_t;
+
+/**
+ * @brief RAW缓冲区布局
+ */
+typedef struct {
+    int width;              /**< 图像宽度 */
+    int height;             /**< 图像高度 */
+    size_t stride;          /**< 每行字节数 (含行尾填充) */
+    raw_packing_t packing;  /**< 数据排列方式 */
+    int bit_depth;          /**< 位深 (8 / 10 / 12) */
+    raw_bayer_t bayer;      /**< Bayer 排列 */
+} raw_layout_t;
+
+/**
+ * @brief 批量解包函数类型
+ * @param src 输入的打包数据 (groups 个完整组)
+ * @param dst 输出的16位像素
+ * @param groups 组的数量 (RAW10为5字节4像素，RAW12为3字节2像素，RAW8为1字节1像素)
+ */
+typedef void (*raw10_unpack_fn)(const uint8_t *src, uint16_t *dst, size_t groups);
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 初始化解包模块，检测CPU特性并选择最快的内核
+ * @details 选中的内核会与标量参考实现做一次逐位比对，不一致时回退
+ * @return 0成功，-1失败
+ */
+int raw_decode_init(void);
+
+/**
+ * @brief 获取当前使用的解包内核
+ * @return 当前内核类型
+ */
+raw_kernel_t raw_decode_get_kernel(void);
+
+/**
+ * @brief 强制指定解包内核 (用于性能对比)
+ * @param kernel 内核类型
+ * @return 0成功，-1当前CPU/编译配置不支持该内核
+ */
+int raw_decode_set_kernel(raw_kernel_t kernel);
+
+/**
+ * @brief 获取解包内核名称
+ * @param kernel 内核类型
+ * @return 内核名称字符串
+ */
+const char *raw_decode_kernel_name(raw_kernel_t kernel);
+
+/**
+ * @brief 获取数据排列方式名称
+ * @param packing 排列方式
+ * @return 名称字符串 ("rockchip" / "mipi" / "unpacked16")
+ */
+const char *raw_packing_name(raw_packing_t packing);
+
+/**
+ * @brief 按名称解析数据排列方式 (用于配置文件)
+ * @param name 名称字符串
+ * @param packing 输出的排列方式
+ * @return 0成功，-1名称无效
+ */
+int raw_packing_from_name(const char *name, raw_packing_t *packing);
+
+/**
+ * @brief 按名称查找像素格式 (如 "SBGGR10"、"SRGGB12"，不区分大小写)
+ * @param name 格式名称
+ * @return 格式描述，未找到返回NULL
+ */
+const raw_format_t *raw_format_find(const char *name);
+
+/**
+ * @brief 按 V4L2 像素格式查找
+ * @param fourcc V4L2 像素格式
+ * @return 格式描述，未找到返回NULL
+ */
+const raw_format_t *raw_format_from_fourcc(uint32_t fourcc);
+
+/**
+ * @brief 计算一行数据的最小字节数 (不含填充，末尾不完整的组按完整组计算)
+ * @param width 图像宽度
+ * @param bit_depth 位深
+ * @param packing 排列方式
+ * @return 字节数
+ */
+size_t raw_layout_min_stride(int width, int bit_depth, raw_packing_t packing);
+
+/**
+ * @brief 确定缓冲区布局
+ * @details stride 非0时 (如 V4L2 bytesperline) 直接采用；为0时由缓冲区大小推算每行字节数。
+ *          RAW10/RAW12 每行不少于 width*2 字节时判定为16位非打包，否则为 packed_variant
+ *          指定的打包格式 (两种打包格式大小相同，无法从大小区分)
+ * @param layout 输出的布局
+ * @param format 像素格式
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param stride 已知的每行字节数，0表示未知
+ * @param buffer_size 缓冲区大小
+ * @param packed_variant 打包数据的排列方式 (RAW_PACKING_ROCKCHIP 或 RAW_PACKING_MIPI)
+ * @return 0成功，-1参数无效
+ */
+int raw_layout_detect(raw_layout_t *layout, const raw_format_t *format, int width, int height,
+                      size_t stride, size_t buffer_size, raw_packing_t packed_variant);
+
+/**
+ * @brief 获取布局对应的数据种类
+ * @param layout 缓冲区布局
+ * @return 数据种类
+ */
+raw_kind_t raw_layout_kind(const raw_layout_t *layout);
+
+/**
+ * @brief 在布局上截取感兴趣区域 (不复制数据)
+ * @details 左边界向下对齐到打包组和Bayer周期，上边界向下对齐到偶数行，
+ *          使区域的行首落在组边界上且Bayer排列与原图相同；区域超出图像时截断。
+ *          区域布局的 stride 与原图相同，数据从帧起始 + offset 处开始，
+ *          可直接用于 raw_decode_image 和预览渲染
+ * @param layout 原图布局
+ * @param left 区域左边界 (像素)
+ * @param top 区域上边界 (像素)
+ * @param width 区域宽度，0 表示到图像右边缘
+ * @param height 区域高度，0 表示到图像下边缘
+ * @param roi 输出的区域布局
+ * @param offset 输出的区域首字节相对帧起始的偏移
+ * @return 0成功，-1参数无效或区域为空
+ */
+int raw_layout_crop(const raw_layout_t *layout, int left, int top, int width, int height,
+                    raw_layout_t *roi, size_t *offset);
+
+/**
+ * @brief 按布局解包一行数据
+ * @param layout 缓冲区布局
+ * @param row 行起始地址 (至少 raw_layout_min_stride 字节)
+ * @param dst 输出的16位像素 (width 个)
+ */
+void raw_decode_row(const raw_layout_t *layout, const uint8_t *row, uint16_t *dst);
+
+/**
+ * @brief 按布局解包整帧为连续的16位像素 (width * height，保持原始位深)
+ * @details 缓冲区不足的行填充0
+ * @param layout 缓冲区布局
+ * @param data 帧数据
+ * @param size 帧数据大小（字节）
+ * @param dst 输出的16位像素
+ * @return 0成功，-1失败
+ */
+int raw_decode_image(const raw_layout_t *layout, const uint8_t *data, size_t size, uint16_t *dst);
+
+/**
+ * @brief 使用当前内核批量解包RAW10数据 (Rockchip 排列)
+ * @param src 输入的RAW10数据 (groups * 5 字节)
+ * @param dst 输出的16位像素 (groups * 4 个)
+ * @param groups 5字节组的数量
+ */
+void raw10_unpack_groups(const uint8_t *src, uint16_t *dst, size_t groups);
+
+/**
+ * @brief SBGGR10格式数据解包（标量版本，作为其他内核的参考实现）
+ * @param raw_bytes 5字节的RAW10数据（包含4个像素）
+ * @param pixels 输出的4个16位像素值
+ */
+void unpack_sbggr10_scalar(const uint8_t raw_bytes[5], uint16_t pixels[4]);
+
+/**
+ * @brief SBGGR10图像数据完整解包函数
+ * @param raw_data 输入的RAW10数据
+ * @param raw_size RAW10数据大小（字节）
+ * @param output_pixels 输出的16位像素数组
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @return 0成功，-1失败
+ */
+int unpack_sbggr10_image(const uint8_t *raw_data, size_t raw_size,
+                         uint16_t *output_pixels, int width, int height);
+
+// ============================================================================
+// 内核实现 (由 raw_decode_init 分派，一般不直接调用)
+// ============================================================================
+
+void raw10_unpack_groups_scalar(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw10_unpack_groups_portable(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw10_mipi_unpack_groups_scalar(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw10_mipi_unpack_groups_portable(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw8_unpack_groups(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw12_unpack_groups(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw12_mipi_unpack_groups(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw10_u16_unpack_groups(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw12_u16_unpack_groups(const uint8_t *src, uint16_t *dst, size_t groups);
+#if defined(__arm__) || defined(__aarch64__)
+void raw10_unpack_groups_neon(const uint8_t *src, uint16_t *dst, size_t groups);
+void raw10_mipi_unpack_groups_neon(const uint8_t *src, uint16_t *dst, size_t groups);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_DECODE_H
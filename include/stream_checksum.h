@@ -0,0 +1,71 @@
+/**
+ * @file stream_checksum.h
+ * @brief 帧负载校验和模块头文件
+ * @details 算法为 xxHash32 (种子0)：每次处理16字节、4路独立的乘加旋转，
+ *          没有查表，在没有CRC指令的 Cortex-A7 上也接近内存带宽。
+ *          支持分段累加，负载按 iovec 分段发送时不需要先拼接。
+ *          设备端和主机端工具共用本模块
+ */
+
+#ifndef STREAM_CHECKSUM_H
+#define STREAM_CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+/**
+ * @brief 分段计算的状态
+ */
+typedef struct {
+    uint32_t lane[4];       /**< 4路累加器 */
+    uint64_t total;         /**< 已输入的字节数 */
+    uint8_t pending[16];    /**< 不足16字节的剩余输入 */
+    size_t pending_len;     /**< pending 中的字节数 */
+} stream_checksum_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 开始计算
+ * @param state 状态
+ */
+void stream_checksum_init(stream_checksum_t *state);
+
+/**
+ * @brief 输入一段数据
+ * @param state 状态
+ * @param data 数据
+ * @param size 字节数
+ */
+void stream_checksum_update(stream_checksum_t *state, const void *data, size_t size);
+
+/**
+ * @brief 结束计算 (不修改状态)
+ * @param state 状态
+ * @return 校验和
+ */
+uint32_t stream_checksum_final(const stream_checksum_t *state);
+
+/**
+ * @brief 计算一块连续数据的校验和
+ * @param data 数据
+ * @param size 字节数
+ * @return 校验和
+ */
+uint32_t stream_checksum(const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_CHECKSUM_H
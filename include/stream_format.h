@@ -0,0 +1,56 @@
+/**
+ * @file stream_format.h
+ * @brief TCP帧流的帧格式化模块头文件
+ * @details 把帧池中的一帧按客户端的视图 (区域、合并)、压扩曲线、压缩设置和帧头版本
+ *          转换为 同步标识 + 帧头 + 负载分段，供 stream_server 发送
+ */
+
+#ifndef STREAM_FORMAT_H
+#define STREAM_FORMAT_H
+
+#include <stddef.h>
+
+#include "raw_decode.h"
+#include "stream_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+/**
+ * @brief 格式化配置 (服务器启动前填写，运行期间只读)
+ */
+typedef struct {
+    const raw_format_t *format; /**< 像素格式 */
+    size_t stride;              /**< 驱动报告的行字节数，0 表示按帧大小推算 */
+    raw_packing_t packing;      /**< 打包数据的排列方式 */
+    int crop_left;              /**< 设备裁剪区域左边界 (未请求视图的客户端使用) */
+    int crop_top;               /**< 设备裁剪区域上边界 */
+    int crop_width;             /**< 设备裁剪区域宽度，0 表示到图像右边缘 */
+    int crop_height;            /**< 设备裁剪区域高度，0 表示到图像下边缘 */
+    int compress;               /**< 1: 发送无损压缩的RAW数据 */
+} stream_format_config_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 生成发送给客户端的帧 (stream_format_fn)
+ * @param client 客户端
+ * @param ref 帧引用
+ * @param frame 输出的待发送帧
+ * @param user 格式化配置 (stream_format_config_t)
+ * @return 0成功，-1跳过该帧
+ */
+int stream_format_frame(stream_client_t *client, frame_ref_t *ref, stream_frame_t *frame, void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_FORMAT_H
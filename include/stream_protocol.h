@@ -0,0 +1,297 @@
+/**
+ * @file stream_protocol.h
+ * @brief TCP帧流协议
+ * @details 服务器发送的每一帧为 同步标识 + 帧头 + 负载。帧头默认为 v1 (struct frame_header)，
+ *          客户端发送 STREAM_REQUEST_HEADER 请求后改为 v2 (frame_header_v2_t)，两者魔数相同，
+ *          v2 在魔数之后带版本号和帧头长度，接收端据此区分并跳过将来追加的字段。
+ *          客户端可以在连接上随时发送请求消息，调整服务器发给自己的帧或修改相机和外设的设置；
+ *          控制请求的应答 (同步标识 + stream_control_ack_t，魔数与帧头不同) 插在两帧之间发送，
+ *          压扩码表 (同步标识 + stream_compand_table_t) 在第一个压扩帧之前发送。
+ *          每条消息为定长消息头加负载，所有字段小端存储；服务器按魔数重新同步，
+ *          不认识的消息类型被跳过，只发送无关数据的旧客户端不受影响。
+ *          本文件只含线上格式定义，设备端和主机端工具共用
+ */
+
+#ifndef STREAM_PROTOCOL_H
+#define STREAM_PROTOCOL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define STREAM_FRAME_SYNC "---MIXOSENSE---FRAME---"   /**< 帧同步标识 (不含结尾的 '\0') */
+#define STREAM_FRAME_SYNC_LEN (sizeof(STREAM_FRAME_SYNC) - 1) /**< 帧同步标识长度 */
+#define STREAM_FRAME_MAGIC 0xDEADBEEFu      /**< 帧头魔数 */
+
+#define STREAM_REQUEST_MAGIC 0x5152584Du    /**< 请求消息魔数 ("MXRQ") */
+#define STREAM_REQUEST_MAX_PAYLOAD 56       /**< 请求负载的最大字节数 */
+#define STREAM_CONTROL_MAGIC 0x4B43584Du    /**< 控制应答魔数 ("MXCK") */
+#define STREAM_COMPAND_MAGIC 0x4C43584Du    /**< 压扩码表魔数 ("MXCL") */
+#define STREAM_COMPAND_CODES 256            /**< 压扩码值个数 (8位) */
+
+#define STREAM_BINNING_MAX 4                /**< 最大合并系数 */
+
+/**
+ * @brief 请求消息类型
+ */
+typedef enum {
+    STREAM_REQUEST_VIEW = 1,        /**< 设置裁剪区域和合并系数 (stream_view_request_t) */
+    STREAM_REQUEST_DECIMATION = 2,  /**< 设置抽帧系数 (stream_decimation_request_t) */
+    STREAM_REQUEST_HEADER = 3,      /**< 选择帧头版本 (stream_header_request_t) */
+    STREAM_REQUEST_RATE = 4,        /**< 设置自适应码率控制 (stream_rate_request_t) */
+    STREAM_REQUEST_SESSION = 5,     /**< 声明会话，断线重连后补发缓存的帧 (stream_session_request_t) */
+    STREAM_REQUEST_CONTROL = 6,     /**< 修改曝光、增益或外设模式 (stream_control_request_t)，服务器以应答回复 */
+    STREAM_REQUEST_COMPAND = 7,     /**< 选择压扩曲线 (stream_compand_request_t)，服务器先发送码表 */
+} stream_request_type_t;
+
+/**
+ * @brief 压扩曲线 (stream_compand_request_t.curve，与 raw_compand_curve_t 取值相同)
+ */
+typedef enum {
+    STREAM_COMPAND_OFF = 0,         /**< 发送原始位深的数据 */
+    STREAM_COMPAND_SQRT = 1,        /**< 平方根曲线 */
+    STREAM_COMPAND_LOG = 2,         /**< 对数曲线 */
+} stream_compand_curve_t;
+
+/**
+ * @brief 控制项 (stream_control_request_t.control)
+ */
+typedef enum {
+    STREAM_CONTROL_EXPOSURE = 1,    /**< 曝光值 (绝对值，超出传感器范围时限幅) */
+    STREAM_CONTROL_GAIN = 2,        /**< 模拟增益 (绝对值，超出传感器范围时限幅) */
+    STREAM_CONTROL_DEVICE_MODE = 3, /**< 外设模式：target 为 stream_control_device_t，value 为 stream_control_mode_t */
+} stream_control_t;
+
+/**
+ * @brief 外设 (STREAM_CONTROL_DEVICE_MODE 的 target)
+ */
+typedef enum {
+    STREAM_DEVICE_HEATER1 = 0,      /**< 加热器1 */
+    STREAM_DEVICE_HEATER2 = 1,      /**< 加热器2 */
+    STREAM_DEVICE_PUMP = 2,         /**< 气泵 */
+    STREAM_DEVICE_LASER = 3,        /**< 激光 */
+} stream_control_device_t;
+
+/**
+ * @brief 外设模式 (与设备菜单相同)
+ */
+typedef enum {
+    STREAM_MODE_AUTO = 0,           /**< 由自动控制流程决定 */
+    STREAM_MODE_ON = 1,             /**< 强制打开 */
+    STREAM_MODE_OFF = 2,            /**< 强制关闭 */
+} stream_control_mode_t;
+
+/**
+ * @brief 控制应答状态 (stream_control_ack_t.status)
+ */
+typedef enum {
+    STREAM_CONTROL_OK = 0,          /**< 已生效 */
+    STREAM_CONTROL_CLAMPED = 1,     /**< 已生效，但值被限制在允许范围内 (value 为实际值) */
+    STREAM_CONTROL_INVALID = 2,     /**< 控制项、外设或值无效 */
+    STREAM_CONTROL_UNAVAILABLE = 3, /**< 相机控制或子系统不可用，或设备关闭了远程控制 */
+    STREAM_CONTROL_FAILED = 4,      /**< 写入硬件失败 */
+    STREAM_CONTROL_BUSY = 5,        /**< 待执行的控制请求过多，请稍后重试 */
+} stream_control_status_t;
+
+/**
+ * @brief v2 帧头选项 (stream_header_request_t.flags，同时回显在 frame_header_v2_t.flags)
+ */
+typedef enum {
+    STREAM_HEADER_CHECKSUM = 1 << 0,    /**< 计算负载校验和 (xxHash32，见 stream_checksum.h) */
+    STREAM_FRAME_CATCHUP = 1 << 15,     /**< 只出现在帧头中：断线期间缓存、重连后补发的帧 */
+} stream_header_flags_t;
+
+/**
+ * @brief 自适应码率控制允许使用的额外手段 (stream_rate_request_t.allow，抽帧总是允许)
+ */
+typedef enum {
+    STREAM_RATE_ALLOW_COMPRESS = 1 << 0,    /**< 允许临时启用无损压缩 */
+    STREAM_RATE_ALLOW_BINNING = 1 << 1,     /**< 允许临时 2x2 合并 */
+} stream_rate_allow_t;
+
+/**
+ * @brief 码率控制当前生效的调整 (frame_header_v2_t.rate_flags)
+ */
+typedef enum {
+    STREAM_RATE_DECIMATED = 1 << 0,     /**< 抽帧系数被提高 */
+    STREAM_RATE_BINNED = 1 << 1,        /**< 合并系数被提高 */
+    STREAM_RATE_COMPRESSED = 1 << 2,    /**< 被临时启用压缩 */
+} stream_rate_flags_t;
+
+/**
+ * @struct frame_header
+ * @brief v1 帧头 (默认)
+ */
+struct frame_header {
+    uint32_t magic;       /**< 魔数标识：STREAM_FRAME_MAGIC */
+    uint32_t frame_id;    /**< 帧序号 */
+    uint32_t width;       /**< 图像宽度 */
+    uint32_t height;      /**< 图像高度 */
+    uint32_t pixfmt;      /**< 像素格式 */
+    uint32_t size;        /**< 数据大小 (压缩时为压缩流大小) */
+    uint64_t timestamp;   /**< 采集时间戳 (纳秒，CLOCK_MONOTONIC) */
+    uint32_t reserved[2]; /**< [0]: 负载编码，0为原始数据，RAW_CODEC_FOURCC为无损压缩流，
+                                    RAW_COMPAND_FOURCC为压扩的8位码值；
+                               [1]: 压缩时为解压后的数据大小 */
+} __attribute__((packed));
+
+/**
+ * @brief v2 帧头
+ * @details 时间戳均为设备的 CLOCK_MONOTONIC 纳秒数 (与 V4L2 缓冲区时间戳同一时钟)；
+ *          capture_ns + realtime_offset_ns 为采集时刻的 CLOCK_REALTIME，
+ *          时钟已同步 (NTP/PTP) 的接收端可以据此计算端到端延迟。
+ *          sequence 对采集线程从驱动取出的每一帧计数，相邻两帧之差减去抽帧间隔即为丢帧数
+ */
+typedef struct {
+    uint32_t magic;             /**< STREAM_FRAME_MAGIC */
+    uint16_t version;           /**< 2 */
+    uint16_t header_size;       /**< 帧头字节数 (sizeof(frame_header_v2_t)，后续版本只在末尾追加字段) */
+    uint32_t frame_id;          /**< 该连接的帧序号 (从0连续递增) */
+    uint32_t sequence;          /**< 采集序号 */
+    uint32_t dropped;           /**< 自上一帧以来未发给该客户端的采集帧数 (不含抽帧有意跳过的帧) */
+    uint32_t width;             /**< 图像宽度 (合并后) */
+    uint32_t height;            /**< 图像高度 (合并后) */
+    uint32_t pixfmt;            /**< 像素格式 (V4L2 fourcc) */
+    uint32_t size;              /**< 负载字节数 */
+    uint32_t encoding;          /**< 负载编码：0为原始数据，RAW_CODEC_FOURCC为无损压缩流，RAW_COMPAND_FOURCC为压扩的8位码值 */
+    uint32_t raw_size;          /**< 解码后的数据大小 (原始数据和压扩码值时等于 size) */
+    uint64_t capture_ns;        /**< 采集时间戳 */
+    uint64_t send_ns;           /**< 开始发送的时间戳 */
+    int64_t realtime_offset_ns; /**< CLOCK_REALTIME 与 CLOCK_MONOTONIC 之差 (发送时) */
+    int32_t exposure;           /**< 采集时的曝光值 */
+    int32_t gain;               /**< 采集时的增益值 */
+    uint16_t roi_left;          /**< 区域左边界 (整帧坐标，合并前) */
+    uint16_t roi_top;           /**< 区域上边界 */
+    uint16_t binning;           /**< 合并系数 (1、2、4) */
+    uint16_t flags;             /**< 生效的选项 (stream_header_flags_t) */
+    uint32_t checksum;          /**< 负载校验和 (flags 含 STREAM_HEADER_CHECKSUM 时有效，否则为0) */
+    uint16_t rate_level;        /**< 码率控制级别 (0为未降级) */
+    uint16_t rate_flags;        /**< 码率控制当前生效的调整 (stream_rate_flags_t) */
+    uint32_t decimation;        /**< 生效的抽帧系数 (客户端请求值乘以码率控制的附加系数) */
+} __attribute__((packed)) frame_header_v2_t;
+
+/**
+ * @brief 请求消息头
+ */
+typedef struct {
+    uint32_t magic;     /**< STREAM_REQUEST_MAGIC */
+    uint16_t type;      /**< 消息类型 (stream_request_type_t) */
+    uint16_t length;    /**< 负载字节数 (不超过 STREAM_REQUEST_MAX_PAYLOAD) */
+} __attribute__((packed)) stream_request_header_t;
+
+/**
+ * @brief 视图请求：该客户端只接收整帧中的一块区域，并可在设备上合并像素
+ * @details 区域使用整帧 (传感器输出) 坐标；width 和 height 都为0时使用设备配置的裁剪区域。
+ *          左边界向下对齐到打包组和Bayer周期，上边界向下对齐到偶数行，超出图像的部分被截断。
+ *          合并按Bayer同色像素平均：系数为N时每 2N x 2N 个像素合成一个 2x2 Bayer 单元，
+ *          输出仍是相同排列、位深和打包方式的RAW数据，帧头的宽高和大小描述合并后的结果
+ */
+typedef struct {
+    uint32_t left;      /**< 区域左边界 (像素) */
+    uint32_t top;       /**< 区域上边界 (像素) */
+    uint32_t width;     /**< 区域宽度，0 表示到图像右边缘 */
+    uint32_t height;    /**< 区域高度，0 表示到图像下边缘 */
+    uint32_t binning;   /**< 合并系数：1 (不合并)、2 或 4 */
+} __attribute__((packed)) stream_view_request_t;
+
+/**
+ * @brief 抽帧请求
+ */
+typedef struct {
+    uint32_t decimation;    /**< 每N帧发送1帧 (>= 1) */
+} __attribute__((packed)) stream_decimation_request_t;
+
+/**
+ * @brief 自适应码率控制请求
+ * @details 服务器按该连接的有效吞吐和套接字发送队列 (SIOCOUTQ) 估计排队延迟，
+ *          超过上限时逐级提高抽帧系数 (允许时先压缩、再合并)，余量充足时逐级恢复
+ */
+typedef struct {
+    uint32_t max_latency_ms;    /**< 排队延迟上限 (毫秒)，0为关闭码率控制 */
+    uint32_t allow;             /**< 允许的额外手段 (stream_rate_allow_t) */
+} __attribute__((packed)) stream_rate_request_t;
+
+/**
+ * @brief 会话请求 (需要 v2 帧头)
+ * @details 会话标识由客户端生成 (如随机数)，重连时使用同一标识。声明了会话的客户端断线后，
+ *          设备缓存它未收到的帧 (配置文件 [network] 的 tcp_spool_frames 不为0时)；
+ *          同一会话在超时前重连并再次发送本请求，缓存的帧与实时帧交替补发 (实时队列空闲时连续补发)，
+ *          帧头 flags 带 STREAM_FRAME_CATCHUP，frame_id 与实时帧统一编号，按 sequence 排序即得采集顺序。
+ *          同一会话的旧连接仍未断开时 (如链路中断尚未超时) 旧连接被关闭
+ */
+typedef struct {
+    uint64_t session;       /**< 会话标识，0为取消会话 */
+} __attribute__((packed)) stream_session_request_t;
+
+/**
+ * @brief 控制请求
+ * @details 在设备的主循环中执行 (与菜单操作相同)，不影响正在发送的帧。
+ *          曝光和增益的远程修改在一段时间没有新请求后才写入配置文件，可以按帧率连续调整
+ */
+typedef struct {
+    uint32_t id;            /**< 请求编号 (客户端自选，原样回显在应答中) */
+    uint16_t control;       /**< 控制项 (stream_control_t) */
+    uint16_t target;        /**< 外设 (STREAM_CONTROL_DEVICE_MODE)，其他控制项为0 */
+    int32_t value;          /**< 新的值 */
+} __attribute__((packed)) stream_control_request_t;
+
+/**
+ * @brief 控制应答 (服务器在两帧之间发送 STREAM_FRAME_SYNC + 本结构体)
+ * @details sequence 与 frame_header_v2_t.sequence 对应：曝光和增益按传感器的生效延迟推算，
+ *          从该帧起帧头中的 exposure/gain 也是新值，远程调节回路据此丢弃修改前的帧
+ */
+typedef struct {
+    uint32_t magic;         /**< STREAM_CONTROL_MAGIC */
+    uint16_t size;          /**< 应答字节数 (sizeof(stream_control_ack_t)，后续版本只在末尾追加字段) */
+    uint16_t status;        /**< 结果 (stream_control_status_t) */
+    uint32_t id;            /**< 请求编号 */
+    uint16_t control;       /**< 控制项 */
+    uint16_t target;        /**< 外设 */
+    int32_t value;          /**< 生效的值 (未生效时为请求的值) */
+    uint32_t sequence;      /**< 第一帧反映该修改的采集序号，未生效时为0 */
+} __attribute__((packed)) stream_control_ack_t;
+
+/**
+ * @brief 压扩请求 (从下一帧开始生效)
+ * @details 曲线不是 STREAM_COMPAND_OFF 时，服务器把每个10/12位像素映射为一个8位码值，
+ *          负载为每像素1字节、行无填充 (width * height 字节)，帧头 encoding 为 RAW_COMPAND_FOURCC，
+ *          pixfmt 仍为传感器格式 (给出Bayer排列和原始位深)。压扩优先于无损压缩。
+ *          RAW8 传感器不支持压扩，请求被忽略。配置文件 [network] 的 tcp_compand 为新连接的默认曲线
+ */
+typedef struct {
+    uint32_t curve;         /**< 曲线 (stream_compand_curve_t) */
+} __attribute__((packed)) stream_compand_request_t;
+
+/**
+ * @brief 压扩码表 (服务器在第一个使用该曲线的帧之前发送 STREAM_FRAME_SYNC + 本结构体)
+ * @details 连接建立时 (设备配置了默认曲线) 和每次改变曲线后各发送一次。
+ *          decode[码值] 为映射到该码值的所有输入值的平均值，接收端查表即可还原原始位深的像素
+ */
+typedef struct {
+    uint32_t magic;         /**< STREAM_COMPAND_MAGIC */
+    uint16_t size;          /**< 码表消息字节数 (sizeof(stream_compand_table_t)，后续版本只在末尾追加字段) */
+    uint16_t curve;         /**< 曲线 (stream_compand_curve_t) */
+    uint16_t input_bits;    /**< 原始位深 (10 或 12) */
+    uint16_t output_bits;   /**< 码值位数 (8) */
+    uint16_t decode[STREAM_COMPAND_CODES]; /**< 码值 -> 原始像素值 */
+} __attribute__((packed)) stream_compand_table_t;
+
+/**
+ * @brief 帧头版本请求 (从下一帧开始生效)
+ */
+typedef struct {
+    uint32_t version;       /**< 1 或 2 */
+    uint32_t flags;         /**< v2 选项 (stream_header_flags_t) */
+} __attribute__((packed)) stream_header_request_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_PROTOCOL_H
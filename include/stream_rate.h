@@ -0,0 +1,88 @@
+/**
+ * @file stream_rate.h
+ * @brief TCP帧流的自适应码率控制模块头文件
+ * @details 每个连接一个控制器。服务器线程定期提供已交给内核的字节数、套接字发送队列中
+ *          尚未确认的字节数 (SIOCOUTQ) 和发送队列中的帧数，控制器据此估计链路的有效吞吐
+ *          和排队延迟：延迟超过上限时降一级 (提高抽帧系数，允许时先压缩、再合并)，
+ *          按当前发送速率推算恢复一级后仍明显低于链路吞吐时升一级。
+ *          本模块只做计算，不访问套接字
+ */
+
+#ifndef STREAM_RATE_H
+#define STREAM_RATE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define STREAM_RATE_INTERVAL_MS 100 /**< 采样间隔 (毫秒) */
+#define STREAM_RATE_MAX_STEPS 6     /**< 降级阶梯的最大级数 */
+
+/**
+ * @brief 码率控制器
+ */
+typedef struct {
+    int max_latency_ms;     /**< 排队延迟上限，0为关闭 */
+    uint32_t allow;         /**< 允许的额外手段 (stream_rate_allow_t) */
+    int level;              /**< 当前级别 (0为未降级) */
+    int max_level;          /**< 按 allow 可用的最高级别 */
+
+    // 当前级别对应的附加设置 (服务器线程读写；decimation 也被采集线程读取)
+    int decimation;         /**< 附加抽帧系数 */
+    int binning;            /**< 附加合并系数 */
+    int compress;           /**< 1: 临时启用压缩 */
+
+    // 测量
+    double capacity;        /**< 链路有效吞吐 (字节/秒，只在有积压时更新)，0为未知 */
+    double send_rate;       /**< 交给内核的速率 (字节/秒，平滑) */
+    double delay_ms;        /**< 估计的排队延迟 */
+    uint64_t last_ns;       /**< 上次采样时刻，0为尚未采样 */
+    uint64_t last_sent;     /**< 上次采样时交给内核的字节数 */
+    uint64_t last_acked;    /**< 上次采样时对端已确认的字节数 */
+    uint64_t stall_ns;      /**< 有积压但没有任何确认的起始时刻，0为未停顿 */
+    uint64_t changed_ns;    /**< 上次调整级别的时刻 */
+    uint32_t changes;       /**< 调整次数 */
+} stream_rate_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 初始化控制器 (新连接或客户端修改设置时调用，级别回到0)
+ * @param rate 控制器
+ * @param max_latency_ms 排队延迟上限 (毫秒)，0为关闭
+ * @param allow 允许的额外手段 (stream_rate_allow_t)
+ */
+void stream_rate_init(stream_rate_t *rate, int max_latency_ms, uint32_t allow);
+
+/**
+ * @brief 提供一次采样并按需调整级别 (间隔不足 STREAM_RATE_INTERVAL_MS 时忽略)
+ * @param rate 控制器
+ * @param now_ns 当前时刻 (CLOCK_MONOTONIC 纳秒)
+ * @param sent_bytes 连接建立以来交给内核的字节数
+ * @param unacked_bytes 套接字中尚未被对端确认的字节数 (SIOCOUTQ)
+ * @param backlog_bytes 尚未交给内核的待发送字节数估计 (队列中的帧和当前帧的剩余部分)
+ * @return 1级别发生变化，0未变化
+ */
+int stream_rate_update(stream_rate_t *rate, uint64_t now_ns, uint64_t sent_bytes,
+                       uint32_t unacked_bytes, uint64_t backlog_bytes);
+
+/**
+ * @brief 当前生效的调整 (stream_rate_flags_t)
+ * @param rate 控制器
+ * @return 标志位
+ */
+uint16_t stream_rate_flags(const stream_rate_t *rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_RATE_H
@@ -0,0 +1,266 @@
+/**
+ * @file stream_server.h
+ * @brief 多客户端帧流服务器模块头文件
+ * @details 单线程事件循环 (epoll + 非阻塞套接字) 同时服务多个客户端 (如录制PC和
+ *          实时分析PC)。每个客户端有独立的发送队列、抽帧系数和统计；采集线程发布
+ *          的帧只增加引用计数放入各客户端队列，所有客户端共享同一驱动缓冲区，不复制。
+ *          某个客户端发送缓慢只会让它自己的队列按策略丢帧，不影响其他客户端。
+ *          客户端可以发送请求消息 (见 stream_protocol.h) 选择自己的裁剪区域、合并系数和抽帧系数；
+ *          控制请求交给应用执行，应答在两帧之间插入该客户端的发送流；
+ *          选择了压扩曲线的客户端在第一个压扩帧之前收到码表
+ */
+
+#ifndef STREAM_SERVER_H
+#define STREAM_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "frame_pool.h"
+#include "frame_queue.h"
+#include "frame_tx.h"
+#include "stream_protocol.h"
+#include "stream_rate.h"
+#include "stream_spool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define STREAM_SERVER_MAX_CLIENTS 8 /**< 最大客户端数 */
+#define STREAM_CLIENT_SCRATCH_COUNT 4 /**< 每个客户端的私有缓冲区个数 */
+#define STREAM_CLIENT_INPUT_SIZE (sizeof(stream_request_header_t) + STREAM_REQUEST_MAX_PAYLOAD) /**< 请求接收缓冲区大小 */
+#define STREAM_CLIENT_MAX_ACKS 8    /**< 每个客户端待发送的控制应答数 */
+#define STREAM_LINGER_MS 1000       /**< 断开的连接等待零拷贝完成的最长时间 (毫秒) */
+
+/**
+ * @brief 待发送帧的描述 (由格式化回调填写)
+ */
+typedef struct {
+    uint8_t prefix[FRAME_TX_MAX_PREFIX];    /**< 前缀 (同步标识 + 帧头) */
+    size_t prefix_len;                      /**< 前缀长度 */
+    const struct iovec *segments;           /**< 数据段 (发送模块会复制段表) */
+    int segment_count;                      /**< 数据段个数 */
+    int private_data;                       /**< 1: 数据在客户端私有缓冲区中 (不使用零拷贝) */
+} stream_frame_t;
+
+/**
+ * @brief 客户端请求的视图 (含义见 stream_view_request_t)
+ */
+typedef struct {
+    int left;                   /**< 区域左边界 (整帧坐标) */
+    int top;                    /**< 区域上边界 */
+    int width;                  /**< 区域宽度，width 和 height 都为0表示使用设备的裁剪区域 */
+    int height;                 /**< 区域高度 */
+    int binning;                /**< 合并系数 (1、2、4) */
+} stream_view_t;
+
+struct stream_client;
+
+/**
+ * @brief 帧格式化回调：根据帧引用和客户端的视图生成前缀和数据段
+ * @details 数据段可以指向帧数据 (零拷贝期间帧引用保持有效)，也可以指向
+ *          stream_client_scratch 取得的私有缓冲区 (此时置 private_data，
+ *          该客户端的当前帧发送完成前服务器不会再次调用回调)
+ * @param client 客户端 (帧序号为 client->frame_id，每个客户端从0开始连续递增)
+ * @param ref 帧引用
+ * @param frame 输出的待发送帧
+ * @param user 用户数据
+ * @return 0成功，-1跳过该帧
+ */
+typedef int (*stream_format_fn)(struct stream_client *client, frame_ref_t *ref, stream_frame_t *frame, void *user);
+
+/**
+ * @brief 客户端数量变化回调 (在事件循环线程中调用)
+ * @param client_count 当前客户端数
+ * @param user 用户数据
+ */
+typedef void (*stream_clients_fn)(int client_count, void *user);
+
+/**
+ * @brief 控制请求回调 (在事件循环线程中调用，应尽快返回)
+ * @details 应用在自己的线程中执行请求，完成后调用 stream_server_control_ack 应答
+ * @param client_id 连接编号
+ * @param request 控制请求
+ * @param user 用户数据 (stream_server_config_t.control_user)
+ * @return 0已接受，-1无法接受 (服务器立即以 STREAM_CONTROL_BUSY 应答)
+ */
+typedef int (*stream_control_fn)(int client_id, const stream_control_request_t *request, void *user);
+
+/**
+ * @brief 服务器配置
+ */
+typedef struct {
+    int max_clients;                /**< 最大客户端数 (1 ~ STREAM_SERVER_MAX_CLIENTS) */
+    int queue_depth;                /**< 每个客户端的队列深度 */
+    frame_queue_policy_t policy;    /**< 队列满时的策略 */
+    int zerocopy;                   /**< 1: 尝试 MSG_ZEROCOPY */
+    int decimation;                 /**< 新客户端的默认抽帧系数 (每N帧发送1帧) */
+    int send_buffer;                /**< 套接字发送缓冲区大小（字节），0为系统默认 */
+    int max_latency_ms;             /**< 新客户端的排队延迟上限 (码率控制)，0为关闭 */
+    uint32_t rate_allow;            /**< 新客户端的码率控制可用手段 (stream_rate_allow_t) */
+    int compand;                    /**< 新客户端的默认压扩曲线 (stream_compand_curve_t) */
+    int compand_bits;               /**< 传感器位深 (生成压扩码表，RAW8 不支持压扩) */
+    stream_spool_t *spool;          /**< 断线补发缓存 (已初始化，由调用者销毁)，NULL为不缓存 */
+    stream_control_fn control_fn;   /**< 控制请求回调，NULL时控制请求以 STREAM_CONTROL_UNAVAILABLE 应答 */
+    void *control_user;             /**< 控制请求回调的用户数据 */
+} stream_server_config_t;
+
+/**
+ * @brief 客户端
+ */
+typedef struct stream_client {
+    int fd;                     /**< 套接字，空闲槽位为-1 */
+    int id;                     /**< 连接编号 (服务器启动后递增) */
+    char address[32];           /**< 对端地址 */
+    int decimation;             /**< 抽帧系数 */
+    uint32_t offered;           /**< 发布给该客户端的帧数 (用于抽帧) */
+    uint32_t frame_id;          /**< 下一帧的帧序号 */
+    frame_queue_t queue;        /**< 发送队列 */
+    frame_tx_t tx;              /**< 发送上下文 */
+    frame_ref_t *sending;       /**< 正在发送的帧 */
+    int want_write;             /**< 是否已注册可写事件 */
+    uint64_t connected_ns;      /**< 连接建立时间 */
+    stream_view_t view;         /**< 请求的视图 (只在事件循环线程中访问) */
+    int header_version;         /**< 帧头版本 (1 或 2) */
+    uint32_t header_flags;      /**< v2 帧头选项 (stream_header_flags_t) */
+    uint32_t last_sequence;     /**< 上一帧的采集序号，0表示尚未发送 (由格式化回调维护) */
+    uint8_t input[STREAM_CLIENT_INPUT_SIZE]; /**< 未处理完的请求数据 */
+    size_t input_len;           /**< input 中的字节数 */
+    void *scratch[STREAM_CLIENT_SCRATCH_COUNT]; /**< 私有缓冲区 (槽位复用，服务器销毁时释放) */
+    size_t scratch_capacity[STREAM_CLIENT_SCRATCH_COUNT]; /**< 私有缓冲区大小 */
+    stream_rate_t rate;         /**< 码率控制 (附加的抽帧、合并和压缩，格式化回调须一并考虑) */
+    uint64_t session;           /**< 会话标识，0为未声明 */
+    int catchup;                /**< 1: 正在补发缓存的帧 */
+    int sending_catchup;        /**< 1: 正在发送的是补发帧 (格式化回调据此标记帧头) */
+    uint32_t catchup_sent;      /**< 已补发的帧数 */
+    int live_since_catchup;     /**< 上次补发后发送的实时帧数 (补发按比例占用发送机会) */
+    stream_control_ack_t acks[STREAM_CLIENT_MAX_ACKS]; /**< 待发送的控制应答 (按到达顺序，应答锁保护) */
+    int ack_count;              /**< 待发送的控制应答数 */
+    int sending_ack;            /**< 1: 正在发送控制应答或压扩码表 */
+    uint32_t controls;          /**< 收到的控制请求数 */
+    int compand;                /**< 压扩曲线 (stream_compand_curve_t，格式化回调据此压扩) */
+    int compand_pending;        /**< 1: 码表尚未发送 (在下一帧之前发送) */
+    stream_compand_table_t compand_table; /**< 正在发送的码表 */
+} stream_client_t;
+
+/**
+ * @brief 等待零拷贝完成的已断开连接
+ * @details 断开的链路上完成通知可能迟迟不来，事件循环不等待：套接字和在途帧移到这里，
+ *          每轮事件循环回收一次，完成或超时后释放帧并关闭套接字
+ */
+typedef struct {
+    frame_tx_t tx;              /**< 发送上下文 (tx.fd 为-1表示空闲) */
+    uint64_t deadline_ns;       /**< 超时时刻 (CLOCK_MONOTONIC) */
+} stream_linger_t;
+
+/**
+ * @brief 帧流服务器
+ */
+typedef struct {
+    int listen_fd;              /**< 监听套接字，未初始化为-1 */
+    int epoll_fd;               /**< epoll 实例 */
+    int wake_fd;                /**< 事件通知 (eventfd)：新帧或停止 */
+    volatile int stop;          /**< 停止标志 */
+    int client_count;           /**< 当前客户端数 */
+    int next_id;                /**< 下一个连接编号 */
+    int publish_waiting;        /**< 在发布锁外等待队列空位的发布调用数 (受发布锁保护) */
+    stream_server_config_t config; /**< 服务器配置 */
+    stream_client_t clients[STREAM_SERVER_MAX_CLIENTS]; /**< 客户端槽位 */
+    stream_linger_t lingering[STREAM_SERVER_MAX_CLIENTS]; /**< 等待零拷贝完成的已断开连接 */
+    stream_format_fn format_fn; /**< 帧格式化回调 */
+    stream_clients_fn clients_fn; /**< 客户端数量变化回调 (可为NULL) */
+    void *user;                 /**< 回调用户数据 */
+} stream_server_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 初始化服务器
+ * @param server 服务器
+ * @param listen_fd 已开始监听的套接字 (所有权转移给服务器)
+ * @param config 服务器配置
+ * @param format_fn 帧格式化回调
+ * @param clients_fn 客户端数量变化回调 (可为NULL)
+ * @param user 回调用户数据
+ * @return 0成功，-1失败 (失败时关闭 listen_fd)
+ */
+int stream_server_init(stream_server_t *server, int listen_fd, const stream_server_config_t *config,
+                       stream_format_fn format_fn, stream_clients_fn clients_fn, void *user);
+
+/**
+ * @brief 运行事件循环，直到 stream_server_stop 被调用
+ * @param server 服务器
+ */
+void stream_server_run(stream_server_t *server);
+
+/**
+ * @brief 请求事件循环退出 (可在信号处理函数中调用)
+ * @param server 服务器
+ */
+void stream_server_stop(stream_server_t *server);
+
+/**
+ * @brief 断开所有客户端并释放资源 (事件循环退出后调用)
+ * @param server 服务器
+ */
+void stream_server_destroy(stream_server_t *server);
+
+/**
+ * @brief 把新帧发布给所有客户端 (采集线程调用)
+ * @details 按各客户端的抽帧系数选择帧，增加引用后放入其队列；断线补发缓存正在录入时也交给缓存。
+ *          不消耗调用者的引用
+ * @param server 服务器
+ * @param ref 帧引用
+ * @param timeout_ms 阻塞策略下每个客户端等待空位的最长时间（毫秒）
+ */
+void stream_server_publish(stream_server_t *server, frame_ref_t *ref, int timeout_ms);
+
+/**
+ * @brief 应答控制请求 (任意线程调用)
+ * @details 应答排在该客户端当前帧之后发送；客户端已断开时丢弃
+ * @param server 服务器
+ * @param client_id 连接编号
+ * @param ack 应答 (magic 和 size 由服务器填写)
+ * @return 0成功，-1客户端不存在或待发送的应答已满
+ */
+int stream_server_control_ack(stream_server_t *server, int client_id, const stream_control_ack_t *ack);
+
+/**
+ * @brief 获取当前客户端数
+ * @param server 服务器
+ * @return 客户端数
+ */
+int stream_server_client_count(stream_server_t *server);
+
+/**
+ * @brief 设置客户端的抽帧系数
+ * @param server 服务器
+ * @param client_id 连接编号
+ * @param decimation 抽帧系数 (每N帧发送1帧，>= 1)
+ * @return 0成功，-1客户端不存在或参数无效
+ */
+int stream_server_set_decimation(stream_server_t *server, int client_id, int decimation);
+
+/**
+ * @brief 获取客户端的私有缓冲区 (格式化回调中使用)
+ * @details 缓冲区不足时重新分配，原内容不保留
+ * @param client 客户端
+ * @param index 缓冲区编号 (0 ~ STREAM_CLIENT_SCRATCH_COUNT-1)
+ * @param size 需要的字节数
+ * @return 缓冲区地址，参数无效或内存不足返回NULL
+ */
+void *stream_client_scratch(stream_client_t *client, int index, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_SERVER_H
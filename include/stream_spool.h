@@ -0,0 +1,174 @@
+/**
+ * @file stream_spool.h
+ * @brief 帧流断线补发缓存模块头文件
+ * @details 声明了会话标识的客户端断线后，服务器把它队列中未发出的帧和之后采集的帧
+ *          复制到缓存中：先放在内存环形缓冲区，内存满时由后台线程把最早的帧写入
+ *          溢出文件 (如 /mnt/ums)，两者都满时丢弃最早的帧。同一会话重新连接后，
+ *          缓存中的帧按采集顺序作为补发帧取出，由服务器与实时帧交替发送；
+ *          补发长时间没有进展 (超过断线等待时间) 时丢弃缓存。
+ *          帧按驱动输出的原样保存 (打包RAW)，补发时仍经过客户端的视图、合并和压缩。
+ *          同一时刻只缓存一个会话；断线时已交给内核但对端未收到的数据无法补发
+ */
+
+#ifndef STREAM_SPOOL_H
+#define STREAM_SPOOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define STREAM_SPOOL_MAX_RAM 14         /**< 内存缓冲区最大帧数 (补发引用占用帧池描述符) */
+#define STREAM_SPOOL_MAX_ENTRIES 512    /**< 缓存的最大帧数 (内存 + 溢出文件) */
+#define STREAM_SPOOL_PENDING 4          /**< 等待后台线程复制的帧引用数 (不少于断线时队列中的帧数) */
+#define STREAM_SPOOL_FILE "mxcamera_spool.bin" /**< 溢出文件名 */
+
+/**
+ * @brief 补发帧就绪通知 (在缓存线程中调用)
+ * @param user 用户数据
+ */
+typedef void (*stream_spool_ready_fn)(void *user);
+
+/**
+ * @brief 缓存配置
+ */
+typedef struct {
+    int ram_frames;             /**< 内存缓冲区帧数 (1 ~ STREAM_SPOOL_MAX_RAM) */
+    char dir[128];              /**< 溢出文件目录，空字符串表示只用内存 */
+    int disk_mb;                /**< 溢出文件大小上限 (MB) */
+    int timeout_ms;             /**< 断线后等待重连的最长时间，以及补发无进展的最长时间，超时丢弃缓存 */
+} stream_spool_config_t;
+
+/**
+ * @brief 缓存中的一帧
+ */
+typedef struct {
+    media_frame_t frame;        /**< 帧信息 (data 在内存中时指向缓冲区，在文件中时为NULL) */
+    frame_meta_t meta;          /**< 采集时的帧信息 */
+    int slot;                   /**< 内存缓冲区编号，-1表示在文件中 */
+    int record;                 /**< 文件记录编号，-1表示在内存中 */
+} stream_spool_entry_t;
+
+/**
+ * @brief 断线补发缓存
+ */
+typedef struct stream_spool {
+    stream_spool_config_t config; /**< 配置 */
+    int state;                  /**< 空闲 / 录入 / 补发 (原子读取) */
+    uint64_t session;           /**< 当前会话标识 */
+    uint64_t deadline_ns;       /**< 录入截止时刻，补发时为下一帧须被取走的时刻 (CLOCK_MONOTONIC) */
+
+    // 内存缓冲区 (按需分配)
+    uint8_t *ram[STREAM_SPOOL_MAX_RAM];     /**< 缓冲区 */
+    size_t ram_capacity[STREAM_SPOOL_MAX_RAM]; /**< 缓冲区大小 */
+    int ram_state[STREAM_SPOOL_MAX_RAM];    /**< 空闲 / 存有帧 / 已交给发送方 / 后台读写中 */
+
+    // 溢出文件 (固定大小的记录，第一次溢出时按帧大小创建)
+    int disk_fd;                /**< 文件描述符，-1为未创建 */
+    size_t record_size;         /**< 记录大小 */
+    int record_count;           /**< 记录数 */
+    uint8_t record_used[STREAM_SPOOL_MAX_ENTRIES]; /**< 记录是否存有帧 */
+
+    stream_spool_entry_t entries[STREAM_SPOOL_MAX_ENTRIES]; /**< 缓存的帧 (无序，按采集序号取出) */
+    int entry_count;            /**< 缓存的帧数 */
+    frame_ref_t *pending[STREAM_SPOOL_PENDING]; /**< 等待复制的帧引用 */
+    int pending_count;          /**< 等待复制的帧数 */
+    uint32_t generation;        /**< 丢弃缓存时递增，后台线程据此作废进行中的读写结果 */
+
+    frame_pool_t pool;          /**< 补发帧的描述符 (释放时内存缓冲区回到空闲) */
+    stream_spool_ready_fn ready_fn; /**< 补发帧就绪通知 */
+    void *ready_user;           /**< 通知的用户数据 */
+
+    // 本次会话的统计
+    uint32_t recorded;          /**< 录入的帧数 */
+    uint32_t spilled;           /**< 写入文件的帧数 */
+    uint32_t evicted;           /**< 缓存满时丢弃的最早帧数 */
+    uint32_t dropped;           /**< 来不及复制而未录入的帧数 */
+    uint32_t replayed;          /**< 已取出补发的帧数 */
+
+    pthread_t thread;           /**< 后台线程 (复制、溢出、读回和超时) */
+    int thread_started;         /**< 后台线程是否已启动 */
+    int stop;                   /**< 停止标志 */
+    pthread_mutex_t lock;       /**< 保护以上状态 */
+    pthread_cond_t cond;        /**< 唤醒后台线程 */
+} stream_spool_t;
+
+// ============================================================================
+// 函数声明
+// ============================================================================
+
+/**
+ * @brief 初始化缓存并启动后台线程 (缓冲区在第一次录入时分配)
+ * @param spool 缓存
+ * @param config 配置
+ * @return 0成功，-1参数无效或线程创建失败
+ */
+int stream_spool_init(stream_spool_t *spool, const stream_spool_config_t *config);
+
+/**
+ * @brief 停止后台线程，丢弃缓存并释放资源 (调用前补发帧的引用应已释放)
+ * @param spool 缓存
+ */
+void stream_spool_destroy(stream_spool_t *spool);
+
+/**
+ * @brief 设置补发帧就绪通知 (读回文件中的帧后调用，发送方据此继续取帧)
+ * @param spool 缓存
+ * @param ready_fn 通知函数
+ * @param user 用户数据
+ */
+void stream_spool_set_ready(stream_spool_t *spool, stream_spool_ready_fn ready_fn, void *user);
+
+/**
+ * @brief 会话断线，开始录入
+ * @details 正在补发同一会话时保留尚未取出的帧继续录入；其他会话的缓存被丢弃
+ * @param spool 缓存
+ * @param session 会话标识 (非0)
+ */
+void stream_spool_begin(stream_spool_t *spool, uint64_t session);
+
+/**
+ * @brief 是否正在录入 (采集线程据此决定没有客户端时是否仍需发布帧)
+ * @param spool 缓存 (可为NULL)
+ * @return 1正在录入
+ */
+int stream_spool_recording(stream_spool_t *spool);
+
+/**
+ * @brief 录入一帧 (不消耗调用者的引用，后台线程复制后释放自己的引用)
+ * @details 未在录入或后台线程来不及复制时直接返回，后者计入 dropped
+ * @param spool 缓存
+ * @param ref 帧引用
+ */
+void stream_spool_put(stream_spool_t *spool, frame_ref_t *ref);
+
+/**
+ * @brief 会话重新连接，停止录入并开始补发
+ * @param spool 缓存
+ * @param session 会话标识
+ * @return 待补发的帧数，缓存中没有该会话时返回-1
+ */
+int stream_spool_attach(stream_spool_t *spool, uint64_t session);
+
+/**
+ * @brief 取出下一帧补发帧 (按采集序号)
+ * @param spool 缓存
+ * @param ref 输出的帧引用 (调用者持有，释放后缓冲区回到空闲)
+ * @return 1取得一帧，0下一帧正在从文件读回 (就绪后通知)，-1补发结束
+ */
+int stream_spool_next(stream_spool_t *spool, frame_ref_t **ref);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_SPOOL_H
@@ -0,0 +1,206 @@
+/**
+ * @file fb_blit.c
+ * @brief 帧缓冲直写模块
+ * @details 映射帧缓冲显存，按屏幕参数 (行长度、可见区域偏移) 计算像素地址，
+ *          供预览内核直接写入。只做地址计算和裁剪，不涉及LVGL
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/fb.h>
+
+#include "fb_blit.h"
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static int query_geometry(fb_blit_t *fb, int width, int height, size_t *map_size);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 打开并映射帧缓冲
+ */
+int fb_blit_open(fb_blit_t *fb, const char *path, int width, int height)
+{
+    if (!fb || !path)
+    {
+        return -1;
+    }
+
+    memset(fb, 0, sizeof(*fb));
+    fb->fd = open(path, O_RDWR);
+    if (fb->fd < 0)
+    {
+        printf("Error: Failed to open framebuffer %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    size_t map_size = 0;
+    if (query_geometry(fb, width, height, &map_size) != 0)
+    {
+        close(fb->fd);
+        fb->fd = -1;
+        return -1;
+    }
+
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fb->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        printf("Error: Failed to mmap framebuffer %s: %s\n", path, strerror(errno));
+        close(fb->fd);
+        fb->fd = -1;
+        return -1;
+    }
+
+    fb->map = (uint8_t *)map;
+    fb->map_size = map_size;
+
+    printf("Framebuffer %s mapped: %dx%d, %zu bytes/line\n",
+           path, fb->width, fb->height, fb->line_length);
+    return 0;
+}
+
+/**
+ * @brief 解除映射并关闭帧缓冲
+ */
+void fb_blit_close(fb_blit_t *fb)
+{
+    if (!fb)
+    {
+        return;
+    }
+
+    if (fb->map)
+    {
+        munmap(fb->map, fb->map_size);
+        fb->map = NULL;
+    }
+    if (fb->fd >= 0)
+    {
+        close(fb->fd);
+    }
+    fb->fd = -1;
+}
+
+/**
+ * @brief 获取屏幕矩形区域的写入地址
+ */
+uint16_t *fb_blit_region(fb_blit_t *fb, int x, int y, int width, int height, int *stride)
+{
+    if (!fb || !fb->map || !stride || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x + width > fb->width || y + height > fb->height)
+    {
+        return NULL;
+    }
+
+    *stride = (int)(fb->line_length / sizeof(uint16_t));
+    return (uint16_t *)(fb->map + (size_t)(y + fb->yoffset) * fb->line_length) + x + fb->xoffset;
+}
+
+/**
+ * @brief 用单一颜色填充屏幕矩形区域
+ */
+void fb_blit_fill(fb_blit_t *fb, int x, int y, int width, int height, uint16_t color)
+{
+    if (!fb || !fb->map)
+    {
+        return;
+    }
+
+    // 裁剪到可见区域
+    if (x < 0)
+    {
+        width += x;
+        x = 0;
+    }
+    if (y < 0)
+    {
+        height += y;
+        y = 0;
+    }
+    if (x + width > fb->width)
+        width = fb->width - x;
+    if (y + height > fb->height)
+        height = fb->height - y;
+
+    int stride;
+    uint16_t *dst = fb_blit_region(fb, x, y, width, height, &stride);
+    if (!dst)
+    {
+        return;
+    }
+
+    for (int row = 0; row < height; row++)
+    {
+        uint16_t *line = dst + (size_t)row * stride;
+        for (int col = 0; col < width; col++)
+        {
+            line[col] = color;
+        }
+    }
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 获取屏幕参数和映射大小
+ * @details 帧缓冲设备从 FBIOGET_*SCREENINFO 读取；普通文件 (ioctl 不支持)
+ *          按调用者给出的尺寸和16位紧凑排列计算
+ * @return 0成功，-1不支持或文件过小
+ */
+static int query_geometry(fb_blit_t *fb, int width, int height, size_t *map_size)
+{
+    struct fb_var_screeninfo vinfo;
+    struct fb_fix_screeninfo finfo;
+
+    if (ioctl(fb->fd, FBIOGET_FSCREENINFO, &finfo) == 0 &&
+        ioctl(fb->fd, FBIOGET_VSCREENINFO, &vinfo) == 0)
+    {
+        if (vinfo.bits_per_pixel != 16)
+        {
+            printf("Error: Framebuffer is %u bpp, direct blit requires RGB565\n", vinfo.bits_per_pixel);
+            return -1;
+        }
+
+        fb->width = (int)vinfo.xres;
+        fb->height = (int)vinfo.yres;
+        fb->xoffset = (int)vinfo.xoffset;
+        fb->yoffset = (int)vinfo.yoffset;
+        fb->line_length = finfo.line_length;
+        *map_size = finfo.smem_len;
+        return 0;
+    }
+
+    // 模拟帧缓冲 (普通文件)
+    struct stat st;
+    if (width <= 0 || height <= 0 || fstat(fb->fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        printf("Error: Failed to query framebuffer geometry\n");
+        return -1;
+    }
+
+    fb->width = width;
+    fb->height = height;
+    fb->line_length = (size_t)width * sizeof(uint16_t);
+    *map_size = fb->line_length * (size_t)height;
+
+    if ((size_t)st.st_size < *map_size)
+    {
+        printf("Error: Fake framebuffer file is %lld bytes, need %zu\n",
+               (long long)st.st_size, *map_size);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+/**
+ * @file frame_pool.c
+ * @brief 引用计数帧池模块
+ * @details 引用计数用原子操作增减，只有描述符分配、最新帧替换和最终交还
+ *          需要加锁；消费者持有引用期间帧数据不会被驱动覆盖
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "frame_pool.h"
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void release_locked(frame_ref_t *ref);
+static frame_ref_t *acquire_latest_locked(frame_pool_t *pool);
+static frame_ref_t *claim_slot_locked(frame_pool_t *pool, const media_frame_t *frame, const frame_meta_t *meta);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化帧池
+ */
+int frame_pool_init(frame_pool_t *pool, int capacity, frame_pool_release_fn release_fn, void *user)
+{
+    if (!pool || !release_fn || capacity < 1 || capacity > FRAME_POOL_MAX_SLOTS)
+    {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->capacity = capacity;
+    pool->release_fn = release_fn;
+    pool->user = user;
+    for (int i = 0; i < FRAME_POOL_MAX_SLOTS; i++)
+    {
+        pool->slots[i].pool = pool;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    return 0;
+}
+
+/**
+ * @brief 释放最新帧并销毁帧池
+ */
+void frame_pool_destroy(frame_pool_t *pool)
+{
+    if (!pool || !pool->release_fn)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->latest)
+    {
+        frame_ref_t *latest = pool->latest;
+        pool->latest = NULL;
+        if (__atomic_sub_fetch(&latest->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+        {
+            release_locked(latest);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < FRAME_POOL_MAX_SLOTS; i++)
+    {
+        free(pool->slots[i].aux);
+        pool->slots[i].aux = NULL;
+        pool->slots[i].aux_capacity = 0;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->cond);
+    pool->release_fn = NULL;
+}
+
+/**
+ * @brief 发布新采集的帧
+ */
+int frame_pool_publish(frame_pool_t *pool, const media_frame_t *frame, const frame_meta_t *meta)
+{
+    pthread_mutex_lock(&pool->lock);
+
+    // 先放下帧池对旧帧的引用，没有消费者持有时其描述符可立即复用
+    if (pool->latest)
+    {
+        frame_ref_t *old = pool->latest;
+        pool->latest = NULL;
+        if (__atomic_sub_fetch(&old->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+        {
+            release_locked(old);
+        }
+    }
+
+    frame_ref_t *slot = claim_slot_locked(pool, frame, meta);
+    if (!slot)
+    {
+        // 消费者持有全部帧：交还新帧，保证驱动有缓冲区可写
+        pool->dropped++;
+        media_frame_t dropped = *frame;
+        pool->release_fn(&dropped, pool->user);
+        pthread_mutex_unlock(&pool->lock);
+        return -1;
+    }
+
+    pool->latest = slot; // 帧池自身的引用
+
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+/**
+ * @brief 登记一帧并把唯一的引用交给调用者
+ */
+frame_ref_t *frame_pool_wrap(frame_pool_t *pool, const media_frame_t *frame, const frame_meta_t *meta)
+{
+    pthread_mutex_lock(&pool->lock);
+    frame_ref_t *ref = claim_slot_locked(pool, frame, meta);
+    pthread_mutex_unlock(&pool->lock);
+    return ref;
+}
+
+/**
+ * @brief 获取最新帧的引用
+ */
+frame_ref_t *frame_pool_acquire_latest(frame_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    frame_ref_t *ref = acquire_latest_locked(pool);
+    pthread_mutex_unlock(&pool->lock);
+    return ref;
+}
+
+/**
+ * @brief 等待比指定序号更新的帧并获取引用
+ */
+frame_ref_t *frame_pool_wait_newer(frame_pool_t *pool, uint32_t last_sequence, int timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->shutdown && (!pool->latest || pool->latest->sequence == last_sequence))
+    {
+        if (pthread_cond_timedwait(&pool->cond, &pool->lock, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    frame_ref_t *ref = NULL;
+    if (!pool->shutdown && pool->latest && pool->latest->sequence != last_sequence)
+    {
+        ref = acquire_latest_locked(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return ref;
+}
+
+/**
+ * @brief 增加引用
+ */
+void frame_pool_retain(frame_ref_t *ref)
+{
+    if (ref)
+    {
+        __atomic_add_fetch(&ref->refcount, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief 释放引用
+ */
+void frame_pool_release(frame_ref_t *ref)
+{
+    if (!ref)
+    {
+        return;
+    }
+
+    // 非最后一个引用时无需加锁
+    if (__atomic_sub_fetch(&ref->refcount, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        return;
+    }
+
+    frame_pool_t *pool = ref->pool;
+    pthread_mutex_lock(&pool->lock);
+    release_locked(ref);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief 确保帧的派生数据缓冲区不小于指定大小
+ */
+void *frame_pool_aux_reserve(frame_ref_t *ref, size_t size)
+{
+    if (!ref)
+    {
+        return NULL;
+    }
+
+    if (ref->aux_capacity < size)
+    {
+        // 旧内容无需保留，先释放再分配，避免 realloc 复制
+        free(ref->aux);
+        ref->aux = malloc(size);
+        ref->aux_capacity = ref->aux ? size : 0;
+        ref->aux_size = 0;
+    }
+    return ref->aux;
+}
+
+/**
+ * @brief 设置关闭标志并唤醒所有等待者
+ */
+void frame_pool_wake_all(frame_pool_t *pool)
+{
+    if (!pool || !pool->release_fn)
+    {
+        return; // 未初始化或已销毁
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief 获取丢帧数
+ */
+uint32_t frame_pool_dropped(frame_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    uint32_t dropped = pool->dropped;
+    pthread_mutex_unlock(&pool->lock);
+    return dropped;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 交还缓冲区并回收描述符 (调用者持有帧池锁，引用计数已为0)
+ */
+static void release_locked(frame_ref_t *ref)
+{
+    frame_pool_t *pool = ref->pool;
+    pool->release_fn(&ref->frame, pool->user);
+    memset(&ref->frame, 0, sizeof(ref->frame));
+    ref->in_use = 0;
+}
+
+/**
+ * @brief 占用一个空闲描述符登记帧，引用计数为1 (调用者持有帧池锁)
+ * @return 帧引用，描述符耗尽返回NULL
+ */
+static frame_ref_t *claim_slot_locked(frame_pool_t *pool, const media_frame_t *frame, const frame_meta_t *meta)
+{
+    frame_ref_t *slot = NULL;
+    int in_use = 0;
+    for (int i = 0; i < FRAME_POOL_MAX_SLOTS; i++)
+    {
+        if (pool->slots[i].in_use)
+        {
+            in_use++;
+        }
+        else if (!slot)
+        {
+            slot = &pool->slots[i];
+        }
+    }
+    if (!slot || in_use >= pool->capacity)
+    {
+        return NULL;
+    }
+
+    slot->frame = *frame;
+    slot->sequence = ++pool->sequence;
+    slot->meta = *meta;
+    slot->in_use = 1;
+    slot->aux_size = 0;
+    slot->aux_tag = 0;
+    __atomic_store_n(&slot->refcount, 1, __ATOMIC_RELEASE);
+    return slot;
+}
+
+/**
+ * @brief 获取最新帧的引用 (调用者持有帧池锁)
+ */
+static frame_ref_t *acquire_latest_locked(frame_pool_t *pool)
+{
+    frame_ref_t *ref = pool->latest;
+    if (ref)
+    {
+        // 帧池持有引用，计数不会在此期间降到0
+        __atomic_add_fetch(&ref->refcount, 1, __ATOMIC_RELAXED);
+    }
+    return ref;
+}
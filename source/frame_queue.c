@@ -0,0 +1,324 @@
+/**
+ * @file frame_queue.c
+ * @brief 有界帧队列模块
+ * @details 队列只保存帧引用，帧数据留在驱动缓冲区中；被丢弃的帧立即释放引用，
+ *          缓冲区随即回到帧池
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "frame_queue.h"
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void deadline_after(struct timespec *deadline, int timeout_ms);
+static frame_ref_t *take_head_locked(frame_queue_t *queue);
+
+// 策略名称 (顺序与 frame_queue_policy_t 一致)
+static const char *policy_names[] = {
+    "drop-oldest",
+    "drop-newest",
+    "block",
+};
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化帧队列
+ */
+int frame_queue_init(frame_queue_t *queue, int depth, frame_queue_policy_t policy)
+{
+    if (!queue || depth < 1 || depth > FRAME_QUEUE_MAX_DEPTH ||
+        (int)policy < 0 || policy >= FRAME_QUEUE_POLICY_COUNT)
+    {
+        return -1;
+    }
+
+    memset(queue, 0, sizeof(*queue));
+    queue->depth = depth;
+    queue->policy = policy;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return 0;
+}
+
+/**
+ * @brief 释放队列中的帧并销毁队列
+ */
+void frame_queue_destroy(frame_queue_t *queue)
+{
+    if (!queue || queue->depth == 0)
+    {
+        return;
+    }
+
+    frame_queue_close(queue, NULL);
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    queue->depth = 0;
+}
+
+/**
+ * @brief 打开队列并清零统计
+ */
+void frame_queue_open(frame_queue_t *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    memset(&queue->stats, 0, sizeof(queue->stats));
+    queue->open = 1;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * @brief 关闭队列，释放队列中的帧并唤醒等待者
+ */
+void frame_queue_close(frame_queue_t *queue, frame_queue_stats_t *stats)
+{
+    frame_ref_t *pending[FRAME_QUEUE_MAX_DEPTH];
+    int pending_count = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    queue->open = 0;
+    while (queue->count > 0)
+    {
+        pending[pending_count++] = take_head_locked(queue);
+    }
+    if (stats)
+    {
+        *stats = queue->stats;
+    }
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+
+    // 在锁外释放引用 (最后一个引用会交还驱动缓冲区)
+    for (int i = 0; i < pending_count; i++)
+    {
+        frame_pool_release(pending[i]);
+    }
+}
+
+/**
+ * @brief 帧入队
+ */
+int frame_queue_push(frame_queue_t *queue, frame_ref_t *ref, int timeout_ms)
+{
+    if (!ref)
+    {
+        return -1;
+    }
+
+    frame_ref_t *discard = NULL;
+    int result = 0;
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->open && queue->policy == FRAME_QUEUE_BLOCK && queue->count >= queue->depth)
+    {
+        struct timespec deadline;
+        deadline_after(&deadline, timeout_ms);
+        while (queue->open && queue->count >= queue->depth)
+        {
+            if (pthread_cond_timedwait(&queue->not_full, &queue->lock, &deadline) == ETIMEDOUT)
+            {
+                break;
+            }
+        }
+    }
+
+    if (!queue->open)
+    {
+        discard = ref;
+        result = -1;
+    }
+    else if (queue->count >= queue->depth)
+    {
+        queue->stats.dropped++;
+        if (queue->policy == FRAME_QUEUE_DROP_OLDEST)
+        {
+            discard = take_head_locked(queue);
+        }
+        else
+        {
+            // 丢弃新帧 (阻塞策略等待超时也按此处理)
+            discard = ref;
+            result = -1;
+        }
+    }
+
+    if (result == 0)
+    {
+        queue->items[(queue->head + queue->count) % queue->depth] = ref;
+        queue->count++;
+        queue->stats.queued++;
+        pthread_cond_signal(&queue->not_empty);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    frame_pool_release(discard);
+    return result;
+}
+
+/**
+ * @brief 判断入队是否需要等待
+ */
+int frame_queue_would_block(frame_queue_t *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    int full = queue->open && queue->policy == FRAME_QUEUE_BLOCK && queue->count >= queue->depth;
+    pthread_mutex_unlock(&queue->lock);
+    return full;
+}
+
+/**
+ * @brief 等待阻塞策略的队列出现空位
+ */
+int frame_queue_wait_space(frame_queue_t *queue, int timeout_ms)
+{
+    struct timespec deadline;
+    deadline_after(&deadline, timeout_ms);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->open && queue->policy == FRAME_QUEUE_BLOCK && queue->count >= queue->depth)
+    {
+        if (pthread_cond_timedwait(&queue->not_full, &queue->lock, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+    int space = queue->open && (queue->policy != FRAME_QUEUE_BLOCK || queue->count < queue->depth);
+    pthread_mutex_unlock(&queue->lock);
+    return space;
+}
+
+/**
+ * @brief 取出队首帧
+ */
+frame_ref_t *frame_queue_pop(frame_queue_t *queue, int timeout_ms)
+{
+    struct timespec deadline;
+    deadline_after(&deadline, timeout_ms);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->open && queue->count == 0)
+    {
+        if (pthread_cond_timedwait(&queue->not_empty, &queue->lock, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    frame_ref_t *ref = NULL;
+    if (queue->open && queue->count > 0)
+    {
+        ref = take_head_locked(queue);
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ref;
+}
+
+/**
+ * @brief 记录一帧发送完成
+ */
+void frame_queue_mark_sent(frame_queue_t *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->stats.sent++;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * @brief 获取当前连接的统计
+ */
+void frame_queue_get_stats(frame_queue_t *queue, frame_queue_stats_t *stats)
+{
+    pthread_mutex_lock(&queue->lock);
+    *stats = queue->stats;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * @brief 获取队列中的帧数
+ */
+int frame_queue_count(frame_queue_t *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    int count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+/**
+ * @brief 获取策略名称
+ */
+const char *frame_queue_policy_name(frame_queue_policy_t policy)
+{
+    if ((int)policy < 0 || policy >= FRAME_QUEUE_POLICY_COUNT)
+    {
+        return "unknown";
+    }
+    return policy_names[policy];
+}
+
+/**
+ * @brief 按名称查找策略
+ */
+int frame_queue_policy_from_name(const char *name, frame_queue_policy_t *policy)
+{
+    if (!name || !policy)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < FRAME_QUEUE_POLICY_COUNT; i++)
+    {
+        if (strcasecmp(name, policy_names[i]) == 0)
+        {
+            *policy = (frame_queue_policy_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 计算从现在起 timeout_ms 毫秒后的绝对时间 (CLOCK_REALTIME)
+ */
+static void deadline_after(struct timespec *deadline, int timeout_ms)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @brief 取出队首帧 (调用者持有队列锁且队列非空)
+ */
+static frame_ref_t *take_head_locked(frame_queue_t *queue)
+{
+    frame_ref_t *ref = queue->items[queue->head];
+    queue->items[queue->head] = NULL;
+    queue->head = (queue->head + 1) % queue->depth;
+    queue->count--;
+    return ref;
+}
@@ -0,0 +1,472 @@
+/**
+ * @file frame_tx.c
+ * @brief 帧发送模块
+ * @details 零拷贝完成通知从套接字错误队列读取：每次带 MSG_ZEROCOPY 的成功
+ *          sendmsg 占用一个递增序号，内核以 [ee_info, ee_data] 区间报告已完成的
+ *          序号。在途帧的前缀存放在固定槽位中，完成前不移动
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+#include "frame_tx.h"
+
+// 旧版C库头文件可能缺少零拷贝相关定义 (值与内核一致)
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+#define TX_IOV_BATCH (IOV_MAX < 1024 ? IOV_MAX : 1024) // 每次 sendmsg 的最大 iovec 数
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static int reap_completions(frame_tx_t *tx, int timeout_ms);
+static uint64_t monotonic_ms(void);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化发送上下文
+ */
+int frame_tx_init(frame_tx_t *tx, int fd, int want_zerocopy)
+{
+    if (!tx || fd < 0)
+    {
+        return -1;
+    }
+
+    memset(tx, 0, sizeof(*tx));
+    tx->fd = fd;
+
+    if (want_zerocopy)
+    {
+        int one = 1;
+        tx->zerocopy = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief 开始发送一帧
+ */
+int frame_tx_begin(frame_tx_t *tx, const void *prefix, size_t prefix_len,
+                   const struct iovec *segments, int segment_count, frame_ref_t *ref)
+{
+    if (!tx || tx->fd < 0 || tx->busy || prefix_len > FRAME_TX_MAX_PREFIX || segment_count < 0)
+    {
+        return -1;
+    }
+
+    // 段表副本 (非阻塞发送时调用者的段表可能在本帧发完前被复用)
+    // 和 sendmsg 的 iovec 批次 (含前缀，不放在栈上：一批最多 TX_IOV_BATCH 项)
+    if (segment_count > tx->segment_capacity)
+    {
+        struct iovec *grown = realloc(tx->segments, (size_t)segment_count * sizeof(*grown));
+        if (!grown)
+        {
+            return -1;
+        }
+        tx->segments = grown;
+
+        int batch_count = segment_count + 1 < TX_IOV_BATCH ? segment_count + 1 : TX_IOV_BATCH;
+        struct iovec *batch = realloc(tx->batch, (size_t)batch_count * sizeof(*batch));
+        if (!batch)
+        {
+            return -1;
+        }
+        tx->batch = batch;
+        tx->batch_capacity = batch_count;
+        tx->segment_capacity = segment_count;
+    }
+    if (!tx->batch)
+    {
+        // 只有前缀的帧 (如控制应答) 也需要一项
+        tx->batch = malloc(sizeof(*tx->batch));
+        if (!tx->batch)
+        {
+            return -1;
+        }
+        tx->batch_capacity = 1;
+    }
+    if (segment_count > 0)
+    {
+        memcpy(tx->segments, segments, (size_t)segment_count * sizeof(*segments));
+    }
+
+    // 零拷贝期间内核仍引用前缀，使用空闲的在途槽位存放；槽位已满时本帧改为拷贝发送
+    tx->slot = NULL;
+    if (tx->zerocopy && ref)
+    {
+        for (int i = 0; i < FRAME_TX_MAX_INFLIGHT; i++)
+        {
+            if (!tx->inflight[i].ref)
+            {
+                tx->slot = &tx->inflight[i];
+                break;
+            }
+        }
+    }
+
+    uint8_t *prefix_store = tx->slot ? tx->slot->prefix : tx->prefix;
+    memcpy(prefix_store, prefix, prefix_len);
+
+    tx->ref = ref;
+    tx->cur_prefix = prefix_store;
+    tx->prefix_len = prefix_len;
+    tx->item_count = segment_count + 1;
+    tx->item = prefix_len > 0 ? 0 : 1;
+    tx->offset = 0;
+    tx->zerocopy_calls = 0;
+    tx->busy = 1;
+    return 0;
+}
+
+/**
+ * @brief 继续发送当前帧
+ */
+int frame_tx_resume(frame_tx_t *tx)
+{
+    if (!tx || !tx->busy)
+    {
+        return -1;
+    }
+
+    int result = 1;
+    struct iovec *iov = tx->batch;
+
+    // 发送位置：item 0 为前缀，item i (i >= 1) 为 segments[i - 1]
+    while (tx->item < tx->item_count)
+    {
+        // 从当前位置起组装一批 iovec
+        int n = 0;
+        for (int i = tx->item; i < tx->item_count && n < tx->batch_capacity; i++)
+        {
+            const uint8_t *base = i == 0 ? tx->cur_prefix : (const uint8_t *)tx->segments[i - 1].iov_base;
+            size_t len = i == 0 ? tx->prefix_len : tx->segments[i - 1].iov_len;
+            size_t skip = i == tx->item ? tx->offset : 0;
+            if (len > skip)
+            {
+                iov[n].iov_base = (void *)(base + skip);
+                iov[n].iov_len = len - skip;
+                n++;
+            }
+        }
+        if (n == 0)
+        {
+            break; // 剩余段均为空
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+
+        int flags = MSG_NOSIGNAL | (tx->slot ? MSG_ZEROCOPY : 0);
+        ssize_t sent = sendmsg(tx->fd, &msg, flags);
+        if (sent < 0 && tx->slot && errno == ENOBUFS)
+        {
+            // 锁定页面配额 (optmem) 耗尽：本次改为拷贝发送
+            flags &= ~MSG_ZEROCOPY;
+            sent = sendmsg(tx->fd, &msg, flags);
+        }
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return 0; // 等待可写后继续
+            }
+            result = -1;
+            break;
+        }
+
+        tx->stats.syscalls++;
+        tx->stats.bytes += (uint64_t)sent;
+        if (flags & MSG_ZEROCOPY)
+        {
+            tx->next_id++;
+            tx->zerocopy_calls++;
+        }
+
+        // 按实际发送的字节数推进位置 (处理部分发送)
+        size_t remaining = (size_t)sent;
+        while (tx->item < tx->item_count)
+        {
+            size_t len = tx->item == 0 ? tx->prefix_len : tx->segments[tx->item - 1].iov_len;
+            size_t left = len - tx->offset;
+            if (remaining < left)
+            {
+                tx->offset += remaining;
+                break;
+            }
+            remaining -= left;
+            tx->offset = 0;
+            tx->item++;
+        }
+    }
+
+    // 有零拷贝发送时登记在途帧 (发送失败也要等内核放开页面)
+    if (tx->zerocopy_calls > 0)
+    {
+        frame_pool_retain(tx->ref);
+        tx->slot->ref = tx->ref;
+        tx->slot->end_id = tx->next_id;
+        tx->inflight_count++;
+    }
+    if (tx->slot)
+    {
+        reap_completions(tx, 0);
+    }
+
+    tx->busy = 0;
+    tx->ref = NULL;
+    tx->slot = NULL;
+    if (result == 1)
+    {
+        tx->stats.frames++;
+    }
+    return result;
+}
+
+/**
+ * @brief 处理错误队列中的零拷贝完成通知
+ */
+int frame_tx_reap(frame_tx_t *tx)
+{
+    if (!tx || tx->fd < 0)
+    {
+        return -1;
+    }
+    return reap_completions(tx, 0);
+}
+
+/**
+ * @brief 当前帧尚未交给内核的字节数
+ */
+size_t frame_tx_pending(const frame_tx_t *tx)
+{
+    if (!tx || !tx->busy)
+    {
+        return 0;
+    }
+
+    size_t pending = 0;
+    for (int i = tx->item; i < tx->item_count; i++)
+    {
+        pending += i == 0 ? tx->prefix_len : tx->segments[i - 1].iov_len;
+    }
+    return pending - tx->offset;
+}
+
+/**
+ * @brief 发送一帧，阻塞直到数据全部交给内核
+ */
+int frame_tx_send(frame_tx_t *tx, const void *prefix, size_t prefix_len,
+                  const struct iovec *segments, int segment_count, frame_ref_t *ref)
+{
+    if (frame_tx_begin(tx, prefix, prefix_len, segments, segment_count, ref) != 0)
+    {
+        return -1;
+    }
+
+    for (;;)
+    {
+        int result = frame_tx_resume(tx);
+        if (result != 0)
+        {
+            return result > 0 ? 0 : -1;
+        }
+
+        // 非阻塞套接字写满：等待可写
+        struct pollfd pfd = {.fd = tx->fd, .events = POLLOUT, .revents = 0};
+        poll(&pfd, 1, 1000);
+    }
+}
+
+/**
+ * @brief 放弃未发完的帧
+ */
+int frame_tx_abort(frame_tx_t *tx)
+{
+    if (!tx)
+    {
+        return 0;
+    }
+
+    // 未发完的帧已有零拷贝数据交给内核，同样登记为在途帧等待完成
+    if (tx->busy && tx->zerocopy_calls > 0)
+    {
+        frame_pool_retain(tx->ref);
+        tx->slot->ref = tx->ref;
+        tx->slot->end_id = tx->next_id;
+        tx->inflight_count++;
+    }
+    tx->busy = 0;
+    tx->ref = NULL;
+    tx->slot = NULL;
+    tx->zerocopy_calls = 0;
+
+    if (tx->inflight_count > 0 && tx->fd >= 0)
+    {
+        reap_completions(tx, 0);
+    }
+    return tx->inflight_count;
+}
+
+/**
+ * @brief 等待在途帧完成并释放引用
+ */
+void frame_tx_close(frame_tx_t *tx, int timeout_ms)
+{
+    if (!tx)
+    {
+        return;
+    }
+
+    frame_tx_abort(tx);
+
+    uint64_t deadline = monotonic_ms() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+    while (tx->inflight_count > 0 && monotonic_ms() < deadline)
+    {
+        if (reap_completions(tx, 100) != 0)
+        {
+            break; // 套接字已关闭，不会再有完成通知
+        }
+    }
+
+    // 超时仍未完成的帧直接释放 (连接已失效，缓冲区被复用只影响已丢弃的数据)
+    for (int i = 0; i < FRAME_TX_MAX_INFLIGHT; i++)
+    {
+        if (tx->inflight[i].ref)
+        {
+            frame_pool_release(tx->inflight[i].ref);
+            tx->inflight[i].ref = NULL;
+        }
+    }
+    tx->inflight_count = 0;
+
+    free(tx->segments);
+    tx->segments = NULL;
+    free(tx->batch);
+    tx->batch = NULL;
+    tx->batch_capacity = 0;
+    tx->segment_capacity = 0;
+    tx->busy = 0;
+    tx->ref = NULL;
+    tx->fd = -1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 读取错误队列中的零拷贝完成通知并释放已完成的帧
+ * @param timeout_ms 错误队列为空时等待的时间（毫秒），0表示不等待
+ * @return 0成功，-1套接字无效
+ */
+static int reap_completions(frame_tx_t *tx, int timeout_ms)
+{
+    if (timeout_ms > 0)
+    {
+        // POLLERR 总会被报告，错误队列非空时 poll 返回
+        struct pollfd pfd = {.fd = tx->fd, .events = 0, .revents = 0};
+        poll(&pfd, 1, timeout_ms);
+    }
+
+    for (;;)
+    {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(tx->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EBADF || errno == ENOTSOCK)
+            {
+                return -1;
+            }
+            break; // 队列已空
+        }
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+
+            struct sock_extended_err serr;
+            memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+            if (serr.ee_errno != 0 || serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            // 完成区间 [ee_info, ee_data]，序号回绕按有符号差比较
+            uint32_t end = serr.ee_data + 1;
+            if ((int32_t)(end - tx->completed_id) > 0)
+            {
+                tx->completed_id = end;
+            }
+            if (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                // 网卡不支持分散聚合 (如回环) 时内核仍会拷贝，零拷贝只剩通知开销，停用
+                tx->stats.zc_copied += serr.ee_data - serr.ee_info + 1;
+                tx->zerocopy = 0;
+            }
+        }
+    }
+
+    for (int i = 0; i < FRAME_TX_MAX_INFLIGHT; i++)
+    {
+        frame_tx_inflight_t *slot = &tx->inflight[i];
+        if (slot->ref && (int32_t)(tx->completed_id - slot->end_id) >= 0)
+        {
+            frame_pool_release(slot->ref);
+            slot->ref = NULL;
+            tx->inflight_count--;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 获取单调时钟毫秒数
+ */
+static uint64_t monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,550 @@
+/**
+ * @file jpeg_encoder.c
+ * @brief 整数基线JPEG编码器
+ * @details 每个MCU (彩色16x16、灰度8x8) 直接从RGB565读取：亮度逐像素计算，色度先对2x2
+ *          像素的RGB求和再转换一次。DCT采用AAN算法 (每个8点变换5次乘法，8位定点)，
+ *          AAN的输出缩放并入量化倒数表，量化只需一次乘法和移位。
+ *          输出空间按MCU检查 (每块的最坏情况)，位写入器内部不做边界判断
+ */
+
+#include <string.h>
+
+#include "jpeg_encoder.h"
+
+#define HEADER_MAX_BYTES 640        // 文件头 (SOI ~ SOS) 的最大长度
+#define BLOCK_WORST_BYTES 420       // 一个8x8块编码后的最大字节数 (含0xFF填充)
+#define COEFFICIENT_MAX 1023        // 基线JPEG的系数范围
+
+// AAN 定点常数 (8位小数)
+#define FIX_0_382683433 98
+#define FIX_0_541196100 139
+#define FIX_0_707106781 181
+#define FIX_1_306562965 334
+#define MULTIPLY(v, c) (((v) * (c) + 128) >> 8)
+
+/**
+ * @brief 位写入器
+ */
+typedef struct {
+    uint8_t *p;             // 下一个输出字节
+    uint32_t acc;           // 待输出的位 (低 bits 位有效)
+    int bits;               // acc 中的位数 (< 8)
+} bit_writer_t;
+
+// 之字形顺序第 k 个系数在8x8块中的位置
+static const uint8_t natural_order[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+// 标准量化表 (JPEG 附录K，自然顺序)
+static const uint8_t base_quant[2][64] = {
+    {16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+     14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+     18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+     49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99},
+    {17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+     24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+     99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+     99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99}};
+
+// AAN输出的缩放系数 (Q14)：scale[u] * scale[v]，scale[0] = 1，scale[k] = cos(k*pi/16) * sqrt(2)
+static const uint16_t aan_scales[64] = {
+    16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+    22725, 31521, 29692, 26722, 22725, 17855, 12299, 6270,
+    21407, 29692, 27969, 25172, 21407, 16819, 11585, 5906,
+    19266, 26722, 25172, 22654, 19266, 15137, 10426, 5315,
+    16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+    12873, 17855, 16819, 15137, 12873, 10114, 6967, 3552,
+    8867, 12299, 11585, 10426, 8867, 6967, 4799, 2446,
+    4520, 6270, 5906, 5315, 4520, 3552, 2446, 1247};
+
+// 标准哈夫曼表 (JPEG 附录K.3)：各码长的符号数和按码长排列的符号
+static const uint8_t dc_bits[2][16] = {
+    {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0},
+    {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0}};
+static const uint8_t dc_values[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+static const uint8_t ac_bits[2][16] = {
+    {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d},
+    {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77}};
+static const uint8_t ac_values[2][162] = {
+    {0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+     0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+     0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+     0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+     0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+     0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+     0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+     0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+     0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+     0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+     0xf9, 0xfa},
+    {0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+     0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+     0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+     0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+     0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+     0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+     0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+     0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+     0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+     0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+     0xf9, 0xfa}};
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void build_huffman(jpeg_huffman_t *table, const uint8_t *bits, const uint8_t *values);
+static uint8_t *write_headers(const jpeg_encoder_t *enc, uint8_t *p, int width, int height, int gray);
+static uint8_t *write_huffman_segment(uint8_t *p, int class_id, const uint8_t *bits, const uint8_t *values);
+static void load_mcu_color(const uint16_t *pixels, int stride, int width, int height, int x0, int y0,
+                           int32_t blocks[6][64]);
+static void load_mcu_gray(const uint16_t *pixels, int stride, int width, int height, int x0, int y0,
+                          int32_t *block);
+static void fdct_aan(int32_t *data);
+static void encode_block(bit_writer_t *w, int32_t *data, const uint32_t *recip, int *dc_pred,
+                         const jpeg_huffman_t *dc, const jpeg_huffman_t *ac);
+static inline void put_bits(bit_writer_t *w, uint32_t value, int size);
+static inline void put_coefficient(bit_writer_t *w, const jpeg_huffman_t *table, int run, int value);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 按质量建立量化表和哈夫曼表
+ */
+void jpeg_encoder_init(jpeg_encoder_t *enc, int quality)
+{
+    quality = quality < 1 ? 1 : (quality > 100 ? 100 : quality);
+    memset(enc, 0, sizeof(*enc));
+    enc->quality = quality;
+
+    // IJG 的质量标度：50为标准表，越高量化越细
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int t = 0; t < 2; t++)
+    {
+        for (int k = 0; k < 64; k++)
+        {
+            int n = natural_order[k];
+            int q = (base_quant[t][n] * scale + 50) / 100;
+            q = q < 1 ? 1 : (q > 255 ? 255 : q);
+            enc->quant[t][k] = (uint8_t)q;
+
+            // AAN输出 = 系数 * 8 * aan_scales / 2^14，量化除数 = q * aan_scales / 2^11
+            uint32_t divisor = (uint32_t)q * aan_scales[n];
+            enc->recip[t][n] = ((1u << 27) + divisor / 2) / divisor;
+        }
+
+        build_huffman(&enc->dc[t], dc_bits[t], dc_values);
+        build_huffman(&enc->ac[t], ac_bits[t], ac_values[t]);
+    }
+}
+
+/**
+ * @brief 编码结果大小的上限
+ */
+size_t jpeg_encoder_bound(int width, int height, int gray)
+{
+    int mcu = gray ? 8 : 16;
+    size_t mcus = (size_t)((width + mcu - 1) / mcu) * (size_t)((height + mcu - 1) / mcu);
+    return HEADER_MAX_BYTES + mcus * (gray ? 1 : 6) * BLOCK_WORST_BYTES + 2;
+}
+
+/**
+ * @brief 把RGB565图像编码为JPEG
+ */
+size_t jpeg_encode_rgb565(const jpeg_encoder_t *enc, const uint16_t *pixels, int stride,
+                          int width, int height, int gray, uint8_t *out, size_t capacity)
+{
+    if (!enc || !pixels || !out || width <= 0 || height <= 0 || width > 65535 || height > 65535 ||
+        stride < width || capacity < HEADER_MAX_BYTES)
+    {
+        return 0;
+    }
+
+    bit_writer_t w = {write_headers(enc, out, width, height, gray), 0, 0};
+    const uint8_t *end = out + capacity;
+    int mcu = gray ? 8 : 16;
+    size_t mcu_worst = (size_t)(gray ? 1 : 6) * BLOCK_WORST_BYTES;
+    int dc_pred[3] = {0, 0, 0};
+    int32_t blocks[6][64];
+
+    for (int y0 = 0; y0 < height; y0 += mcu)
+    {
+        for (int x0 = 0; x0 < width; x0 += mcu)
+        {
+            if ((size_t)(end - w.p) < mcu_worst + 2)
+            {
+                return 0;
+            }
+
+            if (gray)
+            {
+                load_mcu_gray(pixels, stride, width, height, x0, y0, blocks[0]);
+                encode_block(&w, blocks[0], enc->recip[0], &dc_pred[0], &enc->dc[0], &enc->ac[0]);
+                continue;
+            }
+
+            // 4个亮度块 (左上、右上、左下、右下) 后接 Cb、Cr
+            load_mcu_color(pixels, stride, width, height, x0, y0, blocks);
+            for (int b = 0; b < 4; b++)
+            {
+                encode_block(&w, blocks[b], enc->recip[0], &dc_pred[0], &enc->dc[0], &enc->ac[0]);
+            }
+            encode_block(&w, blocks[4], enc->recip[1], &dc_pred[1], &enc->dc[1], &enc->ac[1]);
+            encode_block(&w, blocks[5], enc->recip[1], &dc_pred[2], &enc->dc[1], &enc->ac[1]);
+        }
+    }
+
+    // 最后不足一字节的位用1填充，然后是 EOI
+    if (w.bits > 0)
+    {
+        put_bits(&w, 0x7F, 7);
+    }
+    *w.p++ = 0xFF;
+    *w.p++ = 0xD9;
+    return (size_t)(w.p - out);
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 按码长表生成规范哈夫曼码 (JPEG 附录C)
+ */
+static void build_huffman(jpeg_huffman_t *table, const uint8_t *bits, const uint8_t *values)
+{
+    uint16_t code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; length++)
+    {
+        for (int i = 0; i < bits[length - 1]; i++)
+        {
+            table->code[values[k]] = code++;
+            table->size[values[k]] = (uint8_t)length;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+/**
+ * @brief 写入 SOI、JFIF、量化表、帧头、哈夫曼表和扫描头
+ * @return 下一个输出位置
+ */
+static uint8_t *write_headers(const jpeg_encoder_t *enc, uint8_t *p, int width, int height, int gray)
+{
+    static const uint8_t jfif[] = {0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00,
+                                   0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00};
+    memcpy(p, jfif, sizeof(jfif));
+    p += sizeof(jfif);
+
+    int tables = gray ? 1 : 2;
+    int components = gray ? 1 : 3;
+
+    // DQT
+    int length = 2 + 65 * tables;
+    *p++ = 0xFF;
+    *p++ = 0xDB;
+    *p++ = (uint8_t)(length >> 8);
+    *p++ = (uint8_t)length;
+    for (int t = 0; t < tables; t++)
+    {
+        *p++ = (uint8_t)t;
+        memcpy(p, enc->quant[t], 64);
+        p += 64;
+    }
+
+    // SOF0：亮度 2x2 采样 (彩色) 或 1x1 (灰度)，色度 1x1
+    length = 8 + 3 * components;
+    *p++ = 0xFF;
+    *p++ = 0xC0;
+    *p++ = (uint8_t)(length >> 8);
+    *p++ = (uint8_t)length;
+    *p++ = 8;
+    *p++ = (uint8_t)(height >> 8);
+    *p++ = (uint8_t)height;
+    *p++ = (uint8_t)(width >> 8);
+    *p++ = (uint8_t)width;
+    *p++ = (uint8_t)components;
+    for (int c = 0; c < components; c++)
+    {
+        *p++ = (uint8_t)(c + 1);
+        *p++ = c == 0 && !gray ? 0x22 : 0x11;
+        *p++ = c == 0 ? 0 : 1;
+    }
+
+    // DHT
+    for (int t = 0; t < tables; t++)
+    {
+        p = write_huffman_segment(p, t, dc_bits[t], dc_values);
+        p = write_huffman_segment(p, 0x10 | t, ac_bits[t], ac_values[t]);
+    }
+
+    // SOS
+    length = 6 + 2 * components;
+    *p++ = 0xFF;
+    *p++ = 0xDA;
+    *p++ = (uint8_t)(length >> 8);
+    *p++ = (uint8_t)length;
+    *p++ = (uint8_t)components;
+    for (int c = 0; c < components; c++)
+    {
+        *p++ = (uint8_t)(c + 1);
+        *p++ = c == 0 ? 0x00 : 0x11;
+    }
+    *p++ = 0;
+    *p++ = 63;
+    *p++ = 0;
+    return p;
+}
+
+/**
+ * @brief 写入一个 DHT 段
+ * @param class_id 表类别 (高4位，0为DC，1为AC) 和表号 (低4位)
+ */
+static uint8_t *write_huffman_segment(uint8_t *p, int class_id, const uint8_t *bits, const uint8_t *values)
+{
+    int count = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        count += bits[i];
+    }
+
+    int length = 2 + 1 + 16 + count;
+    *p++ = 0xFF;
+    *p++ = 0xC4;
+    *p++ = (uint8_t)(length >> 8);
+    *p++ = (uint8_t)length;
+    *p++ = (uint8_t)class_id;
+    memcpy(p, bits, 16);
+    p += 16;
+    memcpy(p, values, (size_t)count);
+    return p + count;
+}
+
+/**
+ * @brief RGB565 展开为8位分量 (高位复制到低位)
+ */
+static inline void expand_rgb565(uint16_t pixel, int *r, int *g, int *b)
+{
+    *r = ((pixel >> 8) & 0xF8) | (pixel >> 13);
+    *g = ((pixel >> 3) & 0xFC) | ((pixel >> 9) & 0x03);
+    *b = ((pixel << 3) & 0xF8) | ((pixel >> 2) & 0x07);
+}
+
+/**
+ * @brief 亮度 (BT.601，已减去128)
+ */
+static inline int32_t luma(int r, int g, int b)
+{
+    return ((19595 * r + 38470 * g + 7471 * b + 32768) >> 16) - 128;
+}
+
+/**
+ * @brief 读取一个16x16的彩色MCU：4个亮度块，2x2平均的 Cb、Cr 块 (均已减去128)
+ * @details 超出图像的行列复制最后一行/列
+ */
+static void load_mcu_color(const uint16_t *pixels, int stride, int width, int height, int x0, int y0,
+                           int32_t blocks[6][64])
+{
+    int cols[16];
+    for (int i = 0; i < 16; i++)
+    {
+        cols[i] = x0 + i < width ? x0 + i : width - 1;
+    }
+
+    for (int j = 0; j < 16; j += 2)
+    {
+        int y = y0 + j < height ? y0 + j : height - 1;
+        int y1 = y0 + j + 1 < height ? y0 + j + 1 : height - 1;
+        const uint16_t *row0 = pixels + (size_t)y * (size_t)stride;
+        const uint16_t *row1 = pixels + (size_t)y1 * (size_t)stride;
+
+        for (int i = 0; i < 16; i += 2)
+        {
+            int r[4], g[4], b[4];
+            expand_rgb565(row0[cols[i]], &r[0], &g[0], &b[0]);
+            expand_rgb565(row0[cols[i + 1]], &r[1], &g[1], &b[1]);
+            expand_rgb565(row1[cols[i]], &r[2], &g[2], &b[2]);
+            expand_rgb565(row1[cols[i + 1]], &r[3], &g[3], &b[3]);
+
+            int32_t *block = blocks[(j >= 8 ? 2 : 0) + (i >= 8 ? 1 : 0)];
+            int pos = (j & 7) * 8 + (i & 7);
+            block[pos] = luma(r[0], g[0], b[0]);
+            block[pos + 1] = luma(r[1], g[1], b[1]);
+            block[pos + 8] = luma(r[2], g[2], b[2]);
+            block[pos + 9] = luma(r[3], g[3], b[3]);
+
+            // 四个像素的分量和 (色度结果右移2位完成平均)
+            int32_t rs = r[0] + r[1] + r[2] + r[3];
+            int32_t gs = g[0] + g[1] + g[2] + g[3];
+            int32_t bs = b[0] + b[1] + b[2] + b[3];
+            int chroma = (j / 2) * 8 + i / 2;
+            blocks[4][chroma] = (-11059 * rs - 21709 * gs + 32768 * bs + (1 << 17)) >> 18;
+            blocks[5][chroma] = (32768 * rs - 27439 * gs - 5329 * bs + (1 << 17)) >> 18;
+        }
+    }
+}
+
+/**
+ * @brief 读取一个8x8的灰度MCU (亮度，已减去128)
+ */
+static void load_mcu_gray(const uint16_t *pixels, int stride, int width, int height, int x0, int y0,
+                          int32_t *block)
+{
+    int cols[8];
+    for (int i = 0; i < 8; i++)
+    {
+        cols[i] = x0 + i < width ? x0 + i : width - 1;
+    }
+
+    for (int j = 0; j < 8; j++)
+    {
+        int y = y0 + j < height ? y0 + j : height - 1;
+        const uint16_t *row = pixels + (size_t)y * (size_t)stride;
+        for (int i = 0; i < 8; i++)
+        {
+            int r, g, b;
+            expand_rgb565(row[cols[i]], &r, &g, &b);
+            block[j * 8 + i] = luma(r, g, b);
+        }
+    }
+}
+
+/**
+ * @brief AAN 快速前向DCT (先行后列，原地)
+ * @details 输出为标准DCT系数乘以 8 * aan_scales / 2^14，该缩放在量化时一并除去
+ */
+static void fdct_aan(int32_t *data)
+{
+    for (int pass = 0; pass < 2; pass++)
+    {
+        int step = pass == 0 ? 1 : 8;   // 行变换时元素间隔1，列变换时间隔8
+        int next = pass == 0 ? 8 : 1;   // 下一行/列的起点
+        for (int line = 0; line < 8; line++)
+        {
+            int32_t *d = data + line * next;
+            int32_t tmp0 = d[0] + d[7 * step];
+            int32_t tmp7 = d[0] - d[7 * step];
+            int32_t tmp1 = d[step] + d[6 * step];
+            int32_t tmp6 = d[step] - d[6 * step];
+            int32_t tmp2 = d[2 * step] + d[5 * step];
+            int32_t tmp5 = d[2 * step] - d[5 * step];
+            int32_t tmp3 = d[3 * step] + d[4 * step];
+            int32_t tmp4 = d[3 * step] - d[4 * step];
+
+            // 偶数部分
+            int32_t tmp10 = tmp0 + tmp3;
+            int32_t tmp13 = tmp0 - tmp3;
+            int32_t tmp11 = tmp1 + tmp2;
+            int32_t tmp12 = tmp1 - tmp2;
+            d[0] = tmp10 + tmp11;
+            d[4 * step] = tmp10 - tmp11;
+            int32_t z1 = MULTIPLY(tmp12 + tmp13, FIX_0_707106781);
+            d[2 * step] = tmp13 + z1;
+            d[6 * step] = tmp13 - z1;
+
+            // 奇数部分
+            tmp10 = tmp4 + tmp5;
+            tmp11 = tmp5 + tmp6;
+            tmp12 = tmp6 + tmp7;
+            int32_t z5 = MULTIPLY(tmp10 - tmp12, FIX_0_382683433);
+            int32_t z2 = MULTIPLY(tmp10, FIX_0_541196100) + z5;
+            int32_t z4 = MULTIPLY(tmp12, FIX_1_306562965) + z5;
+            int32_t z3 = MULTIPLY(tmp11, FIX_0_707106781);
+            int32_t z11 = tmp7 + z3;
+            int32_t z13 = tmp7 - z3;
+            d[5 * step] = z13 + z2;
+            d[3 * step] = z13 - z2;
+            d[step] = z11 + z4;
+            d[7 * step] = z11 - z4;
+        }
+    }
+}
+
+/**
+ * @brief 变换、量化并用哈夫曼编码输出一个块
+ * @param data 块数据 (自然顺序，已减去128，被改写)
+ * @param dc_pred 该分量上一块的DC值 (更新)
+ */
+static void encode_block(bit_writer_t *w, int32_t *data, const uint32_t *recip, int *dc_pred,
+                         const jpeg_huffman_t *dc, const jpeg_huffman_t *ac)
+{
+    fdct_aan(data);
+
+    // 量化：|x| * 倒数 (Q16) 四舍五入，按之字形顺序排列
+    int coefficients[64];
+    for (int k = 0; k < 64; k++)
+    {
+        int n = natural_order[k];
+        int32_t value = data[n];
+        uint32_t magnitude = (uint32_t)(value < 0 ? -value : value);
+        int q = (int)((magnitude * recip[n] + 0x8000) >> 16);
+        q = q > COEFFICIENT_MAX ? COEFFICIENT_MAX : q;
+        coefficients[k] = value < 0 ? -q : q;
+    }
+
+    put_coefficient(w, dc, 0, coefficients[0] - *dc_pred);
+    *dc_pred = coefficients[0];
+
+    int run = 0;
+    for (int k = 1; k < 64; k++)
+    {
+        if (coefficients[k] == 0)
+        {
+            run++;
+            continue;
+        }
+        while (run > 15)
+        {
+            put_bits(w, ac->code[0xF0], ac->size[0xF0]); // ZRL：16个零
+            run -= 16;
+        }
+        put_coefficient(w, ac, run, coefficients[k]);
+        run = 0;
+    }
+    if (run > 0)
+    {
+        put_bits(w, ac->code[0x00], ac->size[0x00]); // EOB
+    }
+}
+
+/**
+ * @brief 输出 size 位 (size <= 16)，0xFF 字节后插入 0x00
+ */
+static inline void put_bits(bit_writer_t *w, uint32_t value, int size)
+{
+    w->acc = (w->acc << size) | (value & ((1u << size) - 1));
+    w->bits += size;
+    while (w->bits >= 8)
+    {
+        w->bits -= 8;
+        uint8_t byte = (uint8_t)(w->acc >> w->bits);
+        *w->p++ = byte;
+        if (byte == 0xFF)
+        {
+            *w->p++ = 0x00;
+        }
+    }
+}
+
+/**
+ * @brief 输出一个系数：符号 (前置零个数 << 4 | 位数) 的哈夫曼码，再输出数值位
+ * @details 负数输出 value - 1 的低位 (即绝对值的反码)
+ */
+static inline void put_coefficient(bit_writer_t *w, const jpeg_huffman_t *table, int run, int value)
+{
+    uint32_t magnitude = (uint32_t)(value < 0 ? -value : value);
+    int nbits = magnitude ? 32 - __builtin_clz(magnitude) : 0;
+    int symbol = (run << 4) | nbits;
+    put_bits(w, table->code[symbol], table->size[symbol]);
+    if (nbits)
+    {
+        put_bits(w, (uint32_t)(value < 0 ? value - 1 : value), nbits);
+    }
+}
@@ -0,0 +1,617 @@
+/**
+ * @file local_server.c
+ * @brief 本机帧共享服务器
+ * @details 采集线程只把最新帧的引用交给服务器线程；服务器线程把帧复制到一个空闲的
+ *          共享缓冲区后立即归还帧池，再向每个消费者发送帧描述。
+ *          缓冲区按需创建 (memfd，密封大小)，消费者全部释放后才被复用
+ */
+
+// 定义 GNU 扩展以支持 accept4
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+#include "local_stream.h"
+
+#define EVENT_LISTEN 0xFFFFFFF0u    // epoll 事件标识：监听套接字
+#define EVENT_WAKE 0xFFFFFFF1u      // epoll 事件标识：eventfd
+#define MAX_EVENTS 8
+
+// 旧的 C 库头文件中可能缺少 memfd 和文件密封的定义
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void accept_peers(local_server_t *server);
+static void close_peer(local_server_t *server, local_peer_t *peer, const char *reason);
+static void drain_peer_input(local_server_t *server, local_peer_t *peer);
+static void distribute_frame(local_server_t *server, frame_ref_t *ref);
+static int prepare_buffer(local_server_t *server, int index, size_t size);
+static void free_buffer(local_buffer_t *buffer);
+static int send_buffer_fd(local_peer_t *peer, int index, const local_buffer_t *buffer);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化服务器
+ */
+int local_server_init(local_server_t *server, const char *path, const local_server_config_t *config)
+{
+    if (!server || !path || !config || strlen(path) >= sizeof(server->path) ||
+        config->max_clients < 1 || config->max_clients > LOCAL_STREAM_MAX_CLIENTS ||
+        config->buffers < 2 || config->buffers > LOCAL_STREAM_MAX_BUFFERS || config->max_held < 1)
+    {
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    server->config = *config;
+    if (server->config.max_held > config->buffers - 1)
+    {
+        server->config.max_held = config->buffers - 1; // 至少留一个缓冲区给下一帧
+    }
+    strcpy(server->path, path);
+    pthread_mutex_init(&server->lock, NULL);
+
+    for (int i = 0; i < LOCAL_STREAM_MAX_BUFFERS; i++)
+    {
+        server->buffers[i].fd = -1;
+    }
+    for (int i = 0; i < LOCAL_STREAM_MAX_CLIENTS; i++)
+    {
+        server->peers[i].fd = -1;
+    }
+
+    // 数据报套接字保留消息边界，文件描述符随消息传递
+    server->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0)
+    {
+        printf("Error: Failed to create local socket: %s\n", strerror(errno));
+        local_server_destroy(server);
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path); // 上次异常退出留下的套接字文件
+
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(server->listen_fd, LOCAL_STREAM_MAX_CLIENTS) < 0)
+    {
+        printf("Error: Failed to listen on %s: %s\n", path, strerror(errno));
+        local_server_destroy(server);
+        return -1;
+    }
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server->epoll_fd < 0 || server->wake_fd < 0)
+    {
+        printf("Error: Failed to create local server events: %s\n", strerror(errno));
+        local_server_destroy(server);
+        return -1;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN};
+    ev.data.u32 = EVENT_LISTEN;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &ev);
+    ev.data.u32 = EVENT_WAKE;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &ev);
+
+    printf("Local stream server: %s, up to %d clients, %d shared buffers, %d held per client\n",
+           path, server->config.max_clients, server->config.buffers, server->config.max_held);
+    return 0;
+}
+
+/**
+ * @brief 运行事件循环
+ */
+void local_server_run(local_server_t *server)
+{
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!server->stop)
+    {
+        int n = epoll_wait(server->epoll_fd, events, MAX_EVENTS, 1000);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            printf("Error: epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n && !server->stop; i++)
+        {
+            uint32_t tag = events[i].data.u32;
+
+            if (tag == EVENT_LISTEN)
+            {
+                accept_peers(server);
+                continue;
+            }
+
+            if (tag == EVENT_WAKE)
+            {
+                uint64_t count;
+                while (read(server->wake_fd, &count, sizeof(count)) > 0)
+                {
+                }
+
+                pthread_mutex_lock(&server->lock);
+                frame_ref_t *ref = server->pending;
+                server->pending = NULL;
+                pthread_mutex_unlock(&server->lock);
+
+                if (ref)
+                {
+                    distribute_frame(server, ref);
+                }
+                continue;
+            }
+
+            if (tag < LOCAL_STREAM_MAX_CLIENTS && server->peers[tag].fd >= 0)
+            {
+                drain_peer_input(server, &server->peers[tag]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 请求事件循环退出
+ */
+void local_server_stop(local_server_t *server)
+{
+    server->stop = 1;
+    if (server->wake_fd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+/**
+ * @brief 断开所有消费者并释放资源
+ */
+void local_server_destroy(local_server_t *server)
+{
+    if (!server || server->listen_fd < 0)
+    {
+        return;
+    }
+
+    for (int i = 0; i < LOCAL_STREAM_MAX_CLIENTS; i++)
+    {
+        if (server->peers[i].fd >= 0)
+        {
+            close_peer(server, &server->peers[i], "server stopped");
+        }
+    }
+
+    pthread_mutex_lock(&server->lock);
+    if (server->pending)
+    {
+        frame_pool_release(server->pending);
+        server->pending = NULL;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    for (int i = 0; i < LOCAL_STREAM_MAX_BUFFERS; i++)
+    {
+        free_buffer(&server->buffers[i]);
+    }
+
+    if (server->epoll_fd >= 0)
+    {
+        close(server->epoll_fd);
+    }
+    if (server->wake_fd >= 0)
+    {
+        close(server->wake_fd);
+    }
+    close(server->listen_fd);
+    unlink(server->path);
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+}
+
+/**
+ * @brief 把新帧交给服务器线程
+ */
+void local_server_publish(local_server_t *server, frame_ref_t *ref)
+{
+    if (!ref || __atomic_load_n(&server->client_count, __ATOMIC_ACQUIRE) == 0)
+    {
+        return;
+    }
+
+    // 只保留最新一帧：服务器线程来不及复制时旧帧被替换
+    frame_pool_retain(ref);
+    pthread_mutex_lock(&server->lock);
+    frame_ref_t *replaced = server->pending;
+    server->pending = ref;
+    if (replaced)
+    {
+        server->skipped++;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    if (replaced)
+    {
+        frame_pool_release(replaced);
+    }
+
+    uint64_t one = 1;
+    ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+/**
+ * @brief 获取当前消费者数
+ */
+int local_server_client_count(local_server_t *server)
+{
+    return __atomic_load_n(&server->client_count, __ATOMIC_ACQUIRE);
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 接受所有排队的连接
+ */
+static void accept_peers(local_server_t *server)
+{
+    for (;;)
+    {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                printf("Error: Local accept failed: %s\n", strerror(errno));
+            }
+            return;
+        }
+
+        local_peer_t *peer = NULL;
+        int index = 0;
+        for (; index < server->config.max_clients; index++)
+        {
+            if (server->peers[index].fd < 0)
+            {
+                peer = &server->peers[index];
+                break;
+            }
+        }
+        if (!peer)
+        {
+            printf("Local client rejected: %d clients connected\n", server->client_count);
+            close(fd);
+            continue;
+        }
+
+        memset(peer, 0, sizeof(*peer));
+        peer->fd = fd;
+        peer->id = ++server->next_id;
+
+        struct epoll_event ev = {.events = EPOLLIN | EPOLLRDHUP};
+        ev.data.u32 = (uint32_t)index;
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+
+        __atomic_add_fetch(&server->client_count, 1, __ATOMIC_RELEASE);
+        printf("Local client #%d connected (%d/%d)\n", peer->id, server->client_count, server->config.max_clients);
+    }
+}
+
+/**
+ * @brief 断开消费者，它持有的缓冲区随之释放
+ */
+static void close_peer(local_server_t *server, local_peer_t *peer, const char *reason)
+{
+    for (int i = 0; i < LOCAL_STREAM_MAX_BUFFERS; i++)
+    {
+        if (peer->held & (1u << i))
+        {
+            server->buffers[i].holders--;
+        }
+    }
+
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, peer->fd, NULL);
+    close(peer->fd);
+    __atomic_store_n(&peer->fd, -1, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&server->client_count, 1, __ATOMIC_RELEASE);
+
+    printf("Local client #%d disconnected: %s\n", peer->id, reason);
+    printf("  frames: %u sent, %u skipped while holding %d\n", peer->sent, peer->dropped,
+           server->config.max_held);
+}
+
+/**
+ * @brief 读取消费者发来的释放消息
+ */
+static void drain_peer_input(local_server_t *server, local_peer_t *peer)
+{
+    for (;;)
+    {
+        local_msg_t msg;
+        ssize_t n = recv(peer->fd, &msg, sizeof(msg), MSG_DONTWAIT);
+        if (n == 0)
+        {
+            close_peer(server, peer, "closed by peer");
+            return;
+        }
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                close_peer(server, peer, strerror(errno));
+            }
+            return;
+        }
+
+        // 不完整或不认识的消息被忽略
+        if ((size_t)n < sizeof(msg) || msg.magic != LOCAL_STREAM_MAGIC || msg.type != LOCAL_MSG_RELEASE ||
+            msg.slot >= LOCAL_STREAM_MAX_BUFFERS)
+        {
+            continue;
+        }
+
+        uint32_t bit = 1u << msg.slot;
+        if (peer->held & bit)
+        {
+            peer->held &= ~bit;
+            server->buffers[msg.slot].holders--;
+        }
+    }
+}
+
+/**
+ * @brief 复制帧到空闲的共享缓冲区并通知所有消费者
+ */
+static void distribute_frame(local_server_t *server, frame_ref_t *ref)
+{
+    const media_frame_t *frame = &ref->frame;
+
+    // 所有消费者都持有满额时不必复制
+    int receivers = 0;
+    for (int i = 0; i < server->config.max_clients; i++)
+    {
+        local_peer_t *peer = &server->peers[i];
+        if (peer->fd < 0)
+        {
+            continue;
+        }
+        if (__builtin_popcount(peer->held) < server->config.max_held)
+        {
+            receivers++;
+        }
+        else
+        {
+            peer->dropped++;
+        }
+    }
+
+    // 查找所有消费者都已释放的缓冲区
+    int index = -1;
+    for (int k = 0; k < server->config.buffers; k++)
+    {
+        int candidate = (server->next_buffer + k) % server->config.buffers;
+        if (server->buffers[candidate].holders == 0)
+        {
+            index = candidate;
+            break;
+        }
+    }
+
+    if (receivers == 0 || index < 0 || prepare_buffer(server, index, frame->size) != 0)
+    {
+        server->skipped += receivers > 0;
+        frame_pool_release(ref);
+        return;
+    }
+    server->next_buffer = (index + 1) % server->config.buffers;
+
+    local_buffer_t *buffer = &server->buffers[index];
+    memcpy(buffer->map, frame->data, frame->size);
+
+    local_msg_t msg = {
+        .magic = LOCAL_STREAM_MAGIC,
+        .type = LOCAL_MSG_FRAME,
+        .slot = (uint16_t)index,
+        .sequence = ref->meta.sequence,
+        .width = (uint32_t)frame->width,
+        .height = (uint32_t)frame->height,
+        .pixfmt = frame->pixelformat,
+        .stride = (uint32_t)server->config.stride,
+        .size = (uint32_t)frame->size,
+        .capture_ns = ref->meta.timestamp,
+        .exposure = ref->meta.exposure,
+        .gain = ref->meta.gain};
+    frame_pool_release(ref); // 数据已在共享缓冲区中，驱动缓冲区尽早交还
+
+    uint32_t bit = 1u << index;
+    for (int i = 0; i < server->config.max_clients; i++)
+    {
+        local_peer_t *peer = &server->peers[i];
+        if (peer->fd < 0)
+        {
+            continue;
+        }
+
+        if (__builtin_popcount(peer->held) >= server->config.max_held)
+        {
+            continue; // 已在上面计入跳过
+        }
+
+        if (!(peer->announced & bit))
+        {
+            if (send_buffer_fd(peer, index, buffer) != 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    peer->dropped++;
+                }
+                else
+                {
+                    close_peer(server, peer, strerror(errno));
+                }
+                continue;
+            }
+            peer->announced |= bit;
+        }
+
+        msg.frame_id = peer->frame_id;
+        msg.dropped = peer->last_sequence ? msg.sequence - peer->last_sequence - 1 : 0;
+        if (send(peer->fd, &msg, sizeof(msg), MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)sizeof(msg))
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                peer->dropped++; // 消费者长时间不读取消息
+            }
+            else
+            {
+                close_peer(server, peer, strerror(errno));
+            }
+            continue;
+        }
+
+        peer->held |= bit;
+        peer->frame_id++;
+        peer->last_sequence = msg.sequence;
+        peer->sent++;
+        buffer->holders++;
+    }
+}
+
+/**
+ * @brief 保证缓冲区存在且足够大 (帧大小变化时重建，消费者会重新收到文件描述符)
+ * @return 0成功，-1失败
+ */
+static int prepare_buffer(local_server_t *server, int index, size_t size)
+{
+    local_buffer_t *buffer = &server->buffers[index];
+    if (buffer->fd >= 0 && buffer->size >= size)
+    {
+        return 0;
+    }
+
+    free_buffer(buffer);
+    for (int i = 0; i < LOCAL_STREAM_MAX_CLIENTS; i++)
+    {
+        server->peers[i].announced &= ~(1u << index);
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t capacity = (size + page - 1) / page * page;
+
+    char name[32];
+    snprintf(name, sizeof(name), "mxcamera-frame-%d", index);
+    buffer->fd = (int)syscall(__NR_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (buffer->fd < 0 || ftruncate(buffer->fd, (off_t)capacity) != 0)
+    {
+        printf("Error: Failed to create shared frame buffer: %s\n", strerror(errno));
+        free_buffer(buffer);
+        return -1;
+    }
+
+    // 密封大小：消费者无法截断缓冲区，服务器写入时不会因此收到 SIGBUS
+    fcntl(buffer->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+    buffer->map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, buffer->fd, 0);
+    if (buffer->map == MAP_FAILED)
+    {
+        printf("Error: Failed to map shared frame buffer: %s\n", strerror(errno));
+        buffer->map = NULL;
+        free_buffer(buffer);
+        return -1;
+    }
+    buffer->size = capacity;
+    return 0;
+}
+
+static void free_buffer(local_buffer_t *buffer)
+{
+    if (buffer->map)
+    {
+        munmap(buffer->map, buffer->size);
+    }
+    if (buffer->fd >= 0)
+    {
+        close(buffer->fd);
+    }
+    buffer->map = NULL;
+    buffer->fd = -1;
+    buffer->size = 0;
+    buffer->holders = 0;
+}
+
+/**
+ * @brief 把缓冲区的文件描述符发给消费者 (SCM_RIGHTS)
+ * @return 0成功，-1失败
+ */
+static int send_buffer_fd(local_peer_t *peer, int index, const local_buffer_t *buffer)
+{
+    local_msg_t msg = {
+        .magic = LOCAL_STREAM_MAGIC,
+        .type = LOCAL_MSG_BUFFER,
+        .slot = (uint16_t)index,
+        .size = (uint32_t)buffer->size};
+
+    struct iovec iov = {.iov_base = &msg, .iov_len = sizeof(msg)};
+    union {
+        struct cmsghdr align;
+        char data[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr mh = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.data,
+        .msg_controllen = sizeof(control.data)};
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &buffer->fd, sizeof(int));
+
+    return sendmsg(peer->fd, &mh, MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t)sizeof(msg) ? 0 : -1;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file local_stream.c
+ * @brief 本机帧共享的消费者接口
+ * @details 供设备上的其他进程链接使用，只依赖C库：收到缓冲区消息时映射其文件描述符，
+ *          之后的帧直接指向映射中的数据
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "local_stream.h"
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static int map_buffer(local_stream_t *stream, const local_msg_t *msg, int fd);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 连接服务器
+ */
+int local_stream_connect(local_stream_t *stream, const char *path)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = -1;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (!path || strlen(path) >= sizeof(addr.sun_path))
+    {
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    stream->fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (stream->fd < 0)
+    {
+        return -1;
+    }
+    if (connect(stream->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        close(stream->fd);
+        stream->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 等待下一帧
+ */
+int local_stream_next(local_stream_t *stream, local_frame_t *frame, int timeout_ms)
+{
+    for (;;)
+    {
+        struct pollfd pfd = {.fd = stream->fd, .events = POLLIN};
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ready <= 0)
+        {
+            return ready == 0 ? 1 : -1;
+        }
+
+        local_msg_t msg;
+        struct iovec iov = {.iov_base = &msg, .iov_len = sizeof(msg)};
+        union {
+            struct cmsghdr align;
+            char data[CMSG_SPACE(sizeof(int))];
+        } control;
+        struct msghdr mh = {
+            .msg_iov = &iov,
+            .msg_iovlen = 1,
+            .msg_control = control.data,
+            .msg_controllen = sizeof(control.data)};
+
+        ssize_t n = recvmsg(stream->fd, &mh, MSG_CMSG_CLOEXEC);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        // 取出随消息传来的文件描述符 (只有缓冲区消息携带)
+        int fd = -1;
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh);
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+
+        if ((size_t)n < sizeof(msg) || msg.magic != LOCAL_STREAM_MAGIC || msg.slot >= LOCAL_STREAM_MAX_BUFFERS)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            continue;
+        }
+
+        if (msg.type == LOCAL_MSG_BUFFER)
+        {
+            if (map_buffer(stream, &msg, fd) != 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        if (msg.type == LOCAL_MSG_FRAME)
+        {
+            if (!stream->maps[msg.slot] || msg.size > stream->sizes[msg.slot])
+            {
+                return -1; // 协议错误：帧位于未收到的缓冲区
+            }
+            frame->data = stream->maps[msg.slot];
+            frame->info = msg;
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief 释放一帧
+ */
+int local_stream_release(local_stream_t *stream, const local_frame_t *frame)
+{
+    local_msg_t msg = {
+        .magic = LOCAL_STREAM_MAGIC,
+        .type = LOCAL_MSG_RELEASE,
+        .slot = frame->info.slot,
+        .frame_id = frame->info.frame_id};
+    return send(stream->fd, &msg, sizeof(msg), MSG_NOSIGNAL) == (ssize_t)sizeof(msg) ? 0 : -1;
+}
+
+/**
+ * @brief 断开连接并解除所有映射
+ */
+void local_stream_close(local_stream_t *stream)
+{
+    for (int i = 0; i < LOCAL_STREAM_MAX_BUFFERS; i++)
+    {
+        if (stream->maps[i])
+        {
+            munmap(stream->maps[i], stream->sizes[i]);
+            stream->maps[i] = NULL;
+            stream->sizes[i] = 0;
+        }
+    }
+    if (stream->fd >= 0)
+    {
+        close(stream->fd);
+        stream->fd = -1;
+    }
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 映射新收到的缓冲区 (替换该编号原有的映射)
+ * @return 0成功，-1失败
+ */
+static int map_buffer(local_stream_t *stream, const local_msg_t *msg, int fd)
+{
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    if (stream->maps[msg->slot])
+    {
+        munmap(stream->maps[msg->slot], stream->sizes[msg->slot]);
+        stream->maps[msg->slot] = NULL;
+        stream->sizes[msg->slot] = 0;
+    }
+
+    void *map = mmap(NULL, msg->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // 映射保持缓冲区有效
+    if (map == MAP_FAILED)
+    {
+        printf("Error: Failed to map shared frame buffer %u: %s\n", msg->slot, strerror(errno));
+        return -1;
+    }
+
+    stream->maps[msg->slot] = map;
+    stream->sizes[msg->slot] = msg->size;
+    return 0;
+}
@@ -3,7 +3,7 @@
  * @brief LVGL + libMedia 摄像头实时显示系统
  *
  * 功能：
- * - 使用 libMedia 库采集摄像头 RAW10 图像
+ * - 使用 libMedia 库采集摄像头 RAW8/RAW10/RAW12 图像
  * - 通过 LVGL 将图像缩放显示到屏幕
  * - 实时显示帧率信息
  * - 通过按键控制摄像头启停
@@ -31,6 +31,7 @@
 #include <math.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <ctype.h>
@@ -63,17 +64,59 @@
 // 摄像头配置 (默认值，可通过命令行参数覆盖)
 #define DEFAULT_CAMERA_WIDTH 1920
 #define DEFAULT_CAMERA_HEIGHT 1080
-#define CAMERA_PIXELFORMAT V4L2_PIX_FMT_SBGGR10
+#define DEFAULT_PIXEL_FORMAT "SBGGR10" // 传感器像素格式 (位深 + Bayer排列)
 #define DEFAULT_CAMERA_DEVICE "/dev/video0"
-#define BUFFER_COUNT 2 // 增加缓冲区数量以减少帧丢失，提高帧率稳定性
+#define DEFAULT_BUFFER_COUNT 4 // 驱动缓冲区数量 (队列深度)
+#define MIN_BUFFER_COUNT 2
+#define MAX_BUFFER_COUNT (FRAME_POOL_MAX_SLOTS + 1)
+#define DEFAULT_PHOTO_BUFFERS 2 // 拍照缓冲区数量 (每个为整帧16位数据，1920x1080 约4MB)
+#define DEFAULT_TCP_QUEUE_DEPTH 2 // 每个TCP客户端的发送队列深度 (帧)
+#define DEFAULT_TCP_MAX_CLIENTS 4
+#define DEFAULT_TCP_MAX_LATENCY_MS 500 // 码率控制的排队延迟上限 (毫秒)
+#define DEFAULT_TCP_SPOOL_DIR "/mnt/ums"   // 断线补发缓存的溢出目录 (USB 大容量存储分区)
+#define DEFAULT_TCP_SPOOL_DISK_MB 256
+#define DEFAULT_TCP_SPOOL_TIMEOUT_S 10
+#define DEFAULT_LOCAL_SOCKET "/tmp/mxcamera.sock" // 本机消费者的 Unix 域套接字
+#define DEFAULT_LOCAL_BUFFERS 4                   // 本机共享缓冲区数
+#define DEFAULT_LOCAL_MAX_HELD 2                  // 每个本机消费者最多同时持有的帧数
+#define DEFAULT_HTTP_PORT 8080                    // MJPEG 预览的 HTTP 端口
+#define DEFAULT_HTTP_WIDTH 320                    // MJPEG 预览的最大尺寸
+#define DEFAULT_HTTP_HEIGHT 240
+#define DEFAULT_HTTP_FPS 5
 
 // 全局摄像头配置变量 (可通过命令行修改)
 static int camera_width = DEFAULT_CAMERA_WIDTH;
 static int camera_height = DEFAULT_CAMERA_HEIGHT;
 
-// 裁剪参数
+// 裁剪参数 (软件ROI，预览、拍照和TCP传输只处理该区域；宽高为0表示到图像边缘)
 static int crop_top = 0;
 static int crop_left = 0;
+static int crop_width = 0;
+static int crop_height = 0;
+
+// 预览参数 (配置文件 [display] 段)
+static preview_params_t preview_params = {
+    PREVIEW_MODE_COLOR, PREVIEW_GAIN_UNITY, PREVIEW_GAIN_UNITY, PREVIEW_GAIN_UNITY,
+    0, 2.2f, 1.0f // 与 init_default_config 一致
+};
+static preview_context_t preview_ctx; // 预览渲染上下文 (缓存采样表)
+
+// 帧缓冲直写 (配置文件 [display] direct_blit)：预览直接写入显存，LVGL只绘制叠加控件
+static int direct_blit = 0;
+static fb_blit_t preview_fb = {.fd = -1};
+
+// RAW数据布局 (每行字节数来自 V4L2 bytesperline，像素格式和打包排列方式来自配置文件)
+static const raw_format_t *camera_format = NULL;         // 像素格式，main 中按默认值初始化
+static int format_from_command_line = 0;                  // --format 指定的像素格式优先于配置文件
+static size_t camera_stride = 0;                         // 0 表示未知，按帧大小推算
+static raw_packing_t raw_packing = RAW_PACKING_ROCKCHIP; // 打包数据的排列方式
+
+// 驱动缓冲区数量 (配置文件 [camera] buffer_count)
+static int buffer_count = DEFAULT_BUFFER_COUNT;
+
+// 后台拍照保存 (配置文件 [camera] photo_buffers)
+static int photo_buffers = DEFAULT_PHOTO_BUFFERS;
+static photo_writer_t photo_writer;
 
 // 显示配置 according to "fbtft_lcd.h"
 #define DISPLAY_WIDTH FBTFT_LCD_DEFAULT_WIDTH
@@ -85,7 +128,6 @@ static int crop_left = 0;
 #define DEFAULT_PORT 8888
 #define DEFAULT_SERVER_IP "172.32.0.93"
 #define HEADER_SIZE 32
-#define CHUNK_SIZE 1048576  // 增加到1MB以减少系统调用次数，提高传输效率
 
 // 动态图像尺寸 (根据摄像头宽高比计算)
 static int current_img_width = DISPLAY_WIDTH;
@@ -153,11 +195,25 @@ static int32_t exposure_max = 1352;    // 曝光最大值
 static int32_t gain_min = 128;         // 增益最小值
 static int32_t gain_max = 99614;       // 增益最大值
 
+// 传感器设置的生效时间线：曝光/增益写入寄存器后，从出队序号再往后第 SENSOR_CONTROL_DELAY_FRAMES 帧
+// 起输出新设置 (正在曝光的帧和已锁存参数的下一帧仍是旧值)，采集线程按序号为每帧记录当时生效的值
+#define SENSOR_CONTROL_DELAY_FRAMES 2
+#define SENSOR_PENDING_MAX 4
+typedef struct {
+    uint32_t sequence;  // 从该采集序号起生效
+    int32_t exposure;
+    int32_t gain;
+} sensor_settings_t;
+static sensor_settings_t sensor_active = {0, 128, 128};       // 当前帧生效的设置
+static sensor_settings_t sensor_pending[SENSOR_PENDING_MAX]; // 尚未生效的设置 (按序号递增)
+static int sensor_pending_count = 0;
+static pthread_mutex_t sensor_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t capture_sequence = 0; // 从驱动取出的帧数 (含帧池丢弃的帧，采集线程写入)
+
 // TCP 传输状态
-static volatile int client_connected = 0;
-static int server_fd = -1;
-static int client_fd = -1;
+static volatile int client_connected = 0; // 至少有一个TCP客户端
 static pthread_t tcp_thread_id;
+static int tcp_thread_started = 0;
 
 // 子系统通信状态
 static subsys_handle_t subsys_handle = NULL; // 子系统句柄
@@ -207,13 +263,62 @@ static uint32_t frame_count = 0;
 static struct timeval last_fps_time;
 static float current_fps = 0.0f;
 
-// 线程同步
-static pthread_mutex_t frame_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t frame_ready = PTHREAD_COND_INITIALIZER;
-
-// 当前帧数据
-static media_frame_t current_frame = {0};
-static int frame_available = 0;
+// 帧池：采集线程发布帧，显示、TCP发送和拍照各自持有引用，最后一个引用释放时交还驱动
+static frame_pool_t frame_pool;
+
+// 多客户端流服务器 (配置文件 [network] 段)：采集线程发布帧，服务器线程按客户端队列发送
+static stream_server_t stream_server = {.listen_fd = -1, .epoll_fd = -1, .wake_fd = -1};
+static int tcp_max_clients = DEFAULT_TCP_MAX_CLIENTS;
+static int tcp_queue_depth = DEFAULT_TCP_QUEUE_DEPTH;
+static frame_queue_policy_t tcp_queue_policy = FRAME_QUEUE_DROP_OLDEST;
+static int tcp_zerocopy = 1;
+static int tcp_decimation = 1; // 新客户端的默认抽帧系数
+static int tcp_compress = 0;   // 1: 发送无损压缩的RAW数据
+static raw_compand_curve_t tcp_compand = RAW_COMPAND_OFF; // 新连接的默认压扩曲线
+static int tcp_max_latency_ms = DEFAULT_TCP_MAX_LATENCY_MS; // 0: 关闭码率控制
+static int tcp_adapt_compress = 0; // 1: 码率控制可以临时启用压缩
+static int tcp_adapt_binning = 0;  // 1: 码率控制可以临时合并像素
+static int tcp_spool_frames = 0;   // 断线补发缓存的内存帧数，0为关闭
+static char tcp_spool_dir[128] = DEFAULT_TCP_SPOOL_DIR; // 空字符串表示只用内存
+static int tcp_spool_disk_mb = DEFAULT_TCP_SPOOL_DISK_MB;
+static int tcp_spool_timeout_s = DEFAULT_TCP_SPOOL_TIMEOUT_S;
+static int tcp_remote_control = 1; // 1: 接受客户端的曝光/增益/外设控制请求
+
+// 远程控制：服务器线程收到的请求排队，由主循环执行 (与菜单操作同一线程)
+#define REMOTE_CONTROL_QUEUE 8                  // 待执行的控制请求数
+#define REMOTE_CONFIG_SAVE_DELAY_US 2000000     // 远程调整停止多久后写入配置文件
+typedef struct {
+    int client_id;
+    stream_control_request_t request;
+} remote_control_t;
+static remote_control_t remote_controls[REMOTE_CONTROL_QUEUE];
+static int remote_control_count = 0;
+static pthread_mutex_t remote_control_lock = PTHREAD_MUTEX_INITIALIZER;
+static int remote_config_dirty = 0;         // 远程修改了曝光/增益，尚未保存
+static struct timeval remote_config_time;   // 最近一次远程修改的时间
+static stream_spool_t stream_spool; // 声明了会话的客户端断线后缓存帧，重连后补发
+static int stream_spool_started = 0;
+static stream_format_config_t stream_format; // 服务器启动时按当前设置填写
+
+// 本机帧共享服务器 (配置文件 [local] 段)：分析进程等本机消费者经 Unix 域套接字接收共享缓冲区
+static local_server_t local_server = {.listen_fd = -1, .epoll_fd = -1, .wake_fd = -1};
+static char local_socket[108] = DEFAULT_LOCAL_SOCKET; // 空字符串表示关闭
+static int local_buffers = DEFAULT_LOCAL_BUFFERS;
+static int local_max_held = DEFAULT_LOCAL_MAX_HELD;
+static pthread_t local_thread_id;
+static int local_thread_started = 0;
+
+// HTTP MJPEG 预览服务器 (配置文件 [http] 段)：服务器线程自行取最新帧渲染为小图并编码
+static mjpeg_server_t http_server = {.listen_fd = -1, .epoll_fd = -1, .wake_fd = -1};
+static int http_port = DEFAULT_HTTP_PORT; // 0表示关闭
+static int http_width = DEFAULT_HTTP_WIDTH;
+static int http_height = DEFAULT_HTTP_HEIGHT;
+static int http_fps = DEFAULT_HTTP_FPS;
+static int http_quality = JPEG_QUALITY_DEFAULT;
+static preview_context_t http_preview_ctx; // 只在HTTP服务器线程中使用 (采样表与屏幕预览尺寸不同)
+static uint32_t http_last_sequence = 0;
+static pthread_t http_thread_id;
+static int http_thread_started = 0;
 
 // 曝光和增益控制
 static int32_t exposure_value = 0; // 曝光值
@@ -294,6 +399,8 @@ void signal_handler(int sig)
     current_config.camera_height = camera_height;
     current_config.crop_top = crop_top;
     current_config.crop_left = crop_left;
+    current_config.crop_width = crop_width;
+    current_config.crop_height = crop_height;
     current_config.exposure_step = exposure_step;
     current_config.gain_step = gain_step;
 
@@ -310,25 +417,11 @@ void signal_handler(int sig)
     fflush(stdout);
     fflush(stderr);
 
-    // 关闭TCP连接
-    if (client_connected && client_fd >= 0)
-    {
-        shutdown(client_fd, SHUT_RDWR);
-        close(client_fd);
-        client_connected = 0;
-        client_fd = -1;
-    }
-    if (server_fd >= 0)
-    {
-        shutdown(server_fd, SHUT_RDWR);
-        close(server_fd);
-        server_fd = -1;
-    }
+    // 通知流服务器退出 (由服务器线程断开客户端)
+    stream_server_stop(&stream_server);
 
-    // 通知所有等待线程
-    pthread_mutex_lock(&frame_mutex);
-    pthread_cond_broadcast(&frame_ready);
-    pthread_mutex_unlock(&frame_mutex);
+    // 通知所有等待帧的线程
+    frame_pool_wake_all(&frame_pool);
 
     // 给线程一些时间来响应退出标志
     usleep(100000); // 100ms
@@ -1538,9 +1631,11 @@ void print_usage(const char *program_name)
     printf("\nOptions:\n");
     printf("  --width WIDTH      Set camera width (default: %d)\n", DEFAULT_CAMERA_WIDTH);
     printf("  --height HEIGHT    Set camera height (default: %d)\n", DEFAULT_CAMERA_HEIGHT);
+    printf("  --format FORMAT    Set sensor pixel format, e.g. SRGGB12, overrides pixel_format in the config (default: %s)\n", DEFAULT_PIXEL_FORMAT);
     printf("  --enable-tcp       Enable TCP transmission on startup\n");
     printf("  --tcp-port PORT    Set TCP server port (default: %d)\n", DEFAULT_PORT);
     printf("  --tcp-ip IP        Set TCP server IP (default: %s)\n", DEFAULT_SERVER_IP);
+    printf("  --bench-preview    Benchmark preview scaling paths and exit\n");
     printf("  --help, -h         Show this help message\n");
     printf("\nExamples:\n");
     printf("  %s --width 1920 --height 1080\n", program_name);
@@ -1567,10 +1662,12 @@ void print_usage(const char *program_name)
  * @brief 解析命令行参数
  * @param argc 参数个数
  * @param argv 参数数组
- * @return 0 成功，-1 失败，1 显示帮助后退出
+ * @return 0 成功，-1 失败，1 显示帮助或运行性能测试后退出
  */
 int parse_arguments(int argc, char *argv[])
 {
+    int bench_preview = 0;
+
     for (int i = 1; i < argc; i++)
     {
         if (strcmp(argv[i], "--width") == 0)
@@ -1601,6 +1698,22 @@ int parse_arguments(int argc, char *argv[])
                 return -1;
             }
         }
+        else if (strcmp(argv[i], "--format") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                printf("Error: --format requires a value\n");
+                return -1;
+            }
+            const raw_format_t *format = raw_format_find(argv[++i]);
+            if (!format)
+            {
+                printf("Error: Unsupported pixel format '%s' (S{BGGR,GBRG,GRBG,RGGB}{8,10,12})\n", argv[i]);
+                return -1;
+            }
+            camera_format = format;
+            format_from_command_line = 1;
+        }
         else if (strcmp(argv[i], "--enable-tcp") == 0)
         {
             tcp_enabled = 1;
@@ -1658,6 +1771,10 @@ int parse_arguments(int argc, char *argv[])
             // Note: We'll need to modify DEFAULT_SERVER_IP usage later
             printf("TCP IP set to: %s\n", argv[++i]);
         }
+        else if (strcmp(argv[i], "--bench-preview") == 0)
+        {
+            bench_preview = 1;
+        }
         else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
         {
             print_usage(argv[0]);
@@ -1673,7 +1790,15 @@ int parse_arguments(int argc, char *argv[])
 
     printf("Camera configuration:\n");
     printf("  Resolution: %dx%d\n", camera_width, camera_height);
-    printf("  Format: SBGGR10 (RAW10)\n");
+    printf("  Format: %s (RAW%d)\n", camera_format->name, camera_format->bit_depth);
+
+    // 性能测试在解析完全部参数后运行，以便使用 --width/--height 指定的分辨率
+    if (bench_preview)
+    {
+        raw_decode_init();
+        run_preview_benchmark(camera_width, camera_height);
+        return 1;
+    }
 
     return 0;
 }
@@ -1753,7 +1878,7 @@ int create_server(int port)
         return -1;
     }
 
-    if (listen(fd, 1) < 0)
+    if (listen(fd, STREAM_SERVER_MAX_CLIENTS) < 0)
     {
         perror("listen failed");
         close(fd);
@@ -1765,188 +1890,374 @@ int create_server(int port)
 }
 
 /**
- * @brief 发送图像帧数据到客户端
+ * @brief 客户端数量变化回调：有客户端时关闭屏幕以减少系统负载，全部断开后恢复
  */
-int send_frame(int fd, void *data, size_t size, uint32_t frame_id, uint64_t timestamp)
+static void on_stream_clients_changed(int client_count, void *user)
 {
-    // 首先发送帧同步标识
-    const char *frame_sync = "---MIXOSENSE---FRAME---";
-    size_t sync_len = strlen(frame_sync);
-    
-    if (send(fd, frame_sync, sync_len, MSG_NOSIGNAL) != (ssize_t)sync_len)
+    (void)user;
+
+    int connected = client_count > 0;
+    if (connected == client_connected)
     {
-        return -1;
+        return;
+    }
+    client_connected = connected;
+
+    if (connected && screen_on)
+    {
+        printf("TCP connection established, turning off screen to optimize transmission\n");
+        turn_screen_off();
+    }
+    else if (!connected)
+    {
+        printf("All TCP clients disconnected, restoring screen display\n");
+        turn_screen_on();
     }
+}
+
+/**
+ * @brief TCP数据发送线程函数 (运行流服务器事件循环)
+ */
+void *tcp_sender_thread(void *arg)
+{
+    (void)arg; // 避免未使用参数警告
+    printf("TCP sender thread started\n");
 
-    struct frame_header header = {
-        .magic = 0xDEADBEEF,
-        .frame_id = frame_id,
-        .width = camera_width,
-        .height = camera_height,
-        .pixfmt = CAMERA_PIXELFORMAT,
-        .size = size,
-        .timestamp = timestamp,
-        .reserved = {0, 0}};
+    stream_server_run(&stream_server);
+    stream_server_destroy(&stream_server);
 
-    // 发送帧头
-    if (send(fd, &header, sizeof(header), MSG_NOSIGNAL) != sizeof(header))
+    printf("TCP sender thread terminated\n");
+    return NULL;
+}
+
+/**
+ * @brief 控制请求回调 (服务器线程)：排队等主循环执行
+ * @return 0已接受，-1队列已满
+ */
+static int queue_remote_control(int client_id, const stream_control_request_t *request, void *user)
+{
+    (void)user;
+
+    int result = -1;
+    pthread_mutex_lock(&remote_control_lock);
+    if (remote_control_count < REMOTE_CONTROL_QUEUE)
     {
-        return -1;
+        remote_controls[remote_control_count].client_id = client_id;
+        remote_controls[remote_control_count].request = *request;
+        remote_control_count++;
+        result = 0;
+    }
+    pthread_mutex_unlock(&remote_control_lock);
+    return result;
+}
+
+/**
+ * @brief 丢弃断线补发缓存并停止其后台线程
+ */
+static void stop_stream_spool(void)
+{
+    if (stream_spool_started)
+    {
+        stream_spool_destroy(&stream_spool);
+        stream_spool_started = 0;
     }
+}
 
-    // 分块发送数据
-    size_t sent = 0;
-    uint8_t *ptr = (uint8_t *)data;
+/**
+ * @brief 创建监听套接字和流服务器，并启动服务器线程 (优先使用中等的实时优先级)
+ * @return 0成功，-1失败
+ */
+static int start_stream_server(void)
+{
+    if (tcp_thread_started)
+    {
+        return 0;
+    }
 
-    while (sent < size && !exit_flag)
+    int listen_fd = create_server(DEFAULT_PORT);
+    if (listen_fd < 0)
     {
-        size_t to_send = (size - sent) > CHUNK_SIZE ? CHUNK_SIZE : (size - sent);
-        ssize_t result = send(fd, ptr + sent, to_send, MSG_NOSIGNAL);
+        printf("Failed to create TCP server socket\n");
+        return -1;
+    }
 
-        if (result <= 0)
+    // 每个客户端的队列都占用帧池，至少给显示留一帧
+    int queue_depth = tcp_queue_depth;
+    if (queue_depth > buffer_count - 2)
+    {
+        queue_depth = buffer_count - 2 > 0 ? buffer_count - 2 : 1;
+        printf("Warning: tcp_queue_depth %d exceeds frame pool, using %d\n", tcp_queue_depth, queue_depth);
+    }
+
+    stream_server_config_t server_config = {
+        .max_clients = tcp_max_clients,
+        .queue_depth = queue_depth,
+        .policy = tcp_queue_policy,
+        .zerocopy = tcp_zerocopy,
+        .decimation = tcp_decimation,
+        .send_buffer = 2 * 1024 * 1024, // 2MB 发送缓冲区
+        .max_latency_ms = tcp_max_latency_ms,
+        .rate_allow = (tcp_adapt_compress ? STREAM_RATE_ALLOW_COMPRESS : 0) |
+                      (tcp_adapt_binning ? STREAM_RATE_ALLOW_BINNING : 0),
+        .compand = tcp_compand,
+        .compand_bits = camera_format->bit_depth,
+        .control_fn = tcp_remote_control ? queue_remote_control : NULL};
+
+    // 断线补发缓存 (内存缓冲区在第一次断线时才分配)
+    if (tcp_spool_frames > 0)
+    {
+        stream_spool_config_t spool_config = {
+            .ram_frames = tcp_spool_frames,
+            .disk_mb = tcp_spool_disk_mb,
+            .timeout_ms = tcp_spool_timeout_s * 1000};
+        snprintf(spool_config.dir, sizeof(spool_config.dir), "%s", tcp_spool_dir);
+        if (stream_spool_init(&stream_spool, &spool_config) == 0)
         {
-            return -1;
+            stream_spool_started = 1;
+            server_config.spool = &stream_spool;
+        }
+        else
+        {
+            printf("Warning: Failed to start stream spool, disconnects will lose frames\n");
         }
+    }
+    stream_format = (stream_format_config_t){
+        .format = camera_format,
+        .stride = camera_stride,
+        .packing = raw_packing,
+        .crop_left = crop_left,
+        .crop_top = crop_top,
+        .crop_width = crop_width,
+        .crop_height = crop_height,
+        .compress = tcp_compress};
+
+    if (stream_server_init(&stream_server, listen_fd, &server_config,
+                           stream_format_frame, on_stream_clients_changed, &stream_format) != 0)
+    {
+        printf("Failed to initialize stream server\n");
+        stop_stream_spool();
+        return -1;
+    }
+
+    pthread_attr_t tcp_attr;
+    struct sched_param tcp_param;
+
+    // 初始化TCP线程属性
+    pthread_attr_init(&tcp_attr);
+    pthread_attr_setdetachstate(&tcp_attr, PTHREAD_CREATE_JOINABLE);
+
+    // 设置调度策略为FIFO，中等优先级
+    pthread_attr_setschedpolicy(&tcp_attr, SCHED_FIFO);
+    tcp_param.sched_priority = sched_get_priority_max(SCHED_FIFO) / 2;
+    pthread_attr_setschedparam(&tcp_attr, &tcp_param);
+    pthread_attr_setinheritsched(&tcp_attr, PTHREAD_EXPLICIT_SCHED);
 
-        sent += result;
+    printf("Setting TCP thread priority to: %d (SCHED_FIFO)\n", tcp_param.sched_priority);
+
+    int result = pthread_create(&tcp_thread_id, &tcp_attr, tcp_sender_thread, NULL);
+    if (result != 0)
+    {
+        printf("Failed to create TCP thread with priority, trying normal priority...\n");
+        // 如果优先级设置失败，尝试默认优先级
+        pthread_attr_destroy(&tcp_attr);
+        pthread_attr_init(&tcp_attr);
+        result = pthread_create(&tcp_thread_id, &tcp_attr, tcp_sender_thread, NULL);
+    }
+    pthread_attr_destroy(&tcp_attr);
+
+    if (result != 0)
+    {
+        printf("Failed to create TCP thread\n");
+        stream_server_destroy(&stream_server);
+        stop_stream_spool();
+        return -1;
     }
 
+    tcp_thread_started = 1;
+    printf("TCP server started successfully\n");
     return 0;
 }
 
 /**
- * @brief TCP数据发送线程函数
+ * @brief 停止流服务器并等待服务器线程退出 (断开所有客户端)
  */
-void *tcp_sender_thread(void *arg)
+static void stop_stream_server(void)
 {
-    (void)arg; // 避免未使用参数警告
-    printf("TCP sender thread started\n");
-    static uint32_t tcp_frame_counter = 0;
+    if (!tcp_thread_started)
+    {
+        return;
+    }
 
-    while (!exit_flag && tcp_enabled)
+    stream_server_stop(&stream_server);
+    if (pthread_join(tcp_thread_id, NULL) == 0)
     {
-        // 等待客户端连接
-        if (!client_connected && tcp_enabled && server_fd >= 0)
-        {
-            struct sockaddr_in client_addr;
-            socklen_t client_len = sizeof(client_addr);
+        printf("TCP thread exited successfully\n");
+    }
+    tcp_thread_started = 0;
+    stop_stream_spool(); // 服务器已释放所有补发帧
+}
 
-            printf("Waiting for TCP client connection...\n");
 
-            // 设置 socket 为非阻塞模式，避免 accept 无限阻塞
-            fd_set readfds;
-            struct timeval timeout;
+/**
+ * @brief 本机帧共享线程函数 (运行本机帧共享服务器事件循环)
+ */
+static void *local_server_thread(void *arg)
+{
+    (void)arg;
+    local_server_run(&local_server);
+    return NULL;
+}
 
-            FD_ZERO(&readfds);
-            FD_SET(server_fd, &readfds);
-            timeout.tv_sec = 1; // 1秒超时
-            timeout.tv_usec = 0;
+/**
+ * @brief 启动本机帧共享服务器 (配置了套接字路径时)
+ * @return 0成功或未配置，-1失败
+ */
+static int start_local_server(void)
+{
+    if (local_thread_started || local_socket[0] == '\0')
+    {
+        return 0;
+    }
 
-            int select_result = select(server_fd + 1, &readfds, NULL, NULL, &timeout);
+    local_server_config_t config = {
+        .max_clients = LOCAL_STREAM_MAX_CLIENTS,
+        .buffers = local_buffers,
+        .max_held = local_max_held,
+        .stride = camera_stride};
+    if (local_server_init(&local_server, local_socket, &config) != 0)
+    {
+        printf("Failed to start local stream server on %s\n", local_socket);
+        return -1;
+    }
 
-            if (select_result > 0 && FD_ISSET(server_fd, &readfds))
-            {
-                client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
+    if (pthread_create(&local_thread_id, NULL, local_server_thread, NULL) != 0)
+    {
+        printf("Failed to create local stream thread\n");
+        local_server_destroy(&local_server);
+        return -1;
+    }
 
-                if (client_fd >= 0)
-                {
-                    printf("TCP Client connected from %s\n", inet_ntoa(client_addr.sin_addr));
-                    
-                    // 设置更大的发送缓冲区以减少网络阻塞
-                    int send_buffer_size = 2 * 1024 * 1024; // 2MB 发送缓冲区
-                    if (setsockopt(client_fd, SOL_SOCKET, SO_SNDBUF, &send_buffer_size, sizeof(send_buffer_size)) < 0) {
-                        perror("Warning: Failed to set send buffer size");
-                    }
-                    
-                    // 设置TCP_NODELAY以减少延迟
-                    int flag = 1;
-                    if (setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) < 0) {
-                        perror("Warning: Failed to set TCP_NODELAY");
-                    }
-                    
-                    client_connected = 1;
-                    
-                    // TCP连接建立时自动关闭屏幕以减少系统负载
-                    if (screen_on) {
-                        printf("TCP connection established, turning off screen to optimize transmission\n");
-                        turn_screen_off();
-                    }
-                }
-                else
-                {
-                    if (tcp_enabled && !exit_flag)
-                    {
-                        perror("accept failed");
-                    }
-                }
-            }
-            else if (select_result < 0 && tcp_enabled && !exit_flag)
-            {
-                perror("select failed");
-                break;
-            }
+    local_thread_started = 1;
+    return 0;
+}
 
-            // 检查是否需要退出
-            if (!tcp_enabled || exit_flag)
-            {
-                break;
-            }
-            continue;
-        }
+/**
+ * @brief 停止本机帧共享服务器 (采集线程退出后调用，帧池销毁前调用)
+ */
+static void stop_local_server(void)
+{
+    if (!local_thread_started)
+    {
+        return;
+    }
 
-        // 等待新帧数据
-        pthread_mutex_lock(&frame_mutex);
-        while (current_frame.data == NULL && !exit_flag && tcp_enabled)
-        {
-            struct timespec timeout;
-            clock_gettime(CLOCK_REALTIME, &timeout);
-            timeout.tv_sec += 1; // 1秒超时
-            pthread_cond_timedwait(&frame_ready, &frame_mutex, &timeout);
-        }
+    local_server_stop(&local_server);
+    pthread_join(local_thread_id, NULL);
+    local_server_destroy(&local_server);
+    local_thread_started = 0;
+}
 
-        if (current_frame.data && !exit_flag && tcp_enabled && client_connected)
-        {
-            // 发送原始RAW10帧数据
-            uint64_t timestamp = get_time_ns();
-            if (send_frame(client_fd, current_frame.data, current_frame.size,
-                           tcp_frame_counter++, timestamp) < 0)
-            {
-                printf("TCP Client disconnected (frame %d)\n", tcp_frame_counter);
-                close(client_fd);
-                client_connected = 0;
-                
-                // TCP连接断开时恢复屏幕显示
-                printf("TCP connection lost, restoring screen display\n");
-                turn_screen_on();
-            }
-        }
+/**
+ * @brief HTTP 预览的图像源：把最新帧的裁剪区域渲染为预览小图 (在HTTP服务器线程中调用)
+ * @return 1渲染了新帧，0没有新帧，-1失败
+ */
+static int http_preview_source(mjpeg_image_t *image, void *user)
+{
+    (void)user;
+    frame_ref_t *ref = frame_pool_acquire_latest(&frame_pool);
+    if (!ref)
+    {
+        return 0;
+    }
+    if (ref->sequence == http_last_sequence)
+    {
+        frame_pool_release(ref);
+        return 0;
+    }
+    http_last_sequence = ref->sequence;
+
+    const media_frame_t *frame = &ref->frame;
+    raw_layout_t layout;
+    const uint8_t *roi_data;
+    size_t roi_size;
+    get_frame_roi(frame->data, frame->size, frame->width, frame->height, &layout, &roi_data, &roi_size);
+    mjpeg_fit_size(layout.width, layout.height, image->max_width, image->max_height,
+                   &image->width, &image->height);
+
+    // 与屏幕预览相同的色调参数 (菜单在主线程修改，读到一半更新的参数只影响这一帧)
+    preview_params_t params = preview_params;
+    preview_set_params(&http_preview_ctx, &params);
+    int ret = preview_render_raw(&http_preview_ctx, &layout, roi_data, roi_size,
+                                 image->pixels, image->max_width, image->width, image->height);
+    image->gray = params.mode == PREVIEW_MODE_GRAY;
+    image->sequence = ref->sequence;
+    frame_pool_release(ref);
+    return ret == 0 ? 1 : -1;
+}
 
-        pthread_mutex_unlock(&frame_mutex);
+/**
+ * @brief HTTP 预览线程函数 (运行 MJPEG 服务器事件循环)
+ */
+static void *http_server_thread(void *arg)
+{
+    (void)arg;
+    mjpeg_server_run(&http_server);
+    return NULL;
+}
 
-        // 如果TCP被禁用，退出循环
-        if (!tcp_enabled)
-        {
-            break;
-        }
+/**
+ * @brief 启动 HTTP MJPEG 预览服务器 (配置了端口时)
+ * @return 0成功或未配置，-1失败
+ */
+static int start_http_preview(void)
+{
+    if (http_thread_started || http_port <= 0)
+    {
+        return 0;
+    }
 
-        usleep(1000); // 减少到100微秒以提高传输效率
+    preview_context_init(&http_preview_ctx);
+    mjpeg_server_config_t config = {
+        .port = http_port,
+        .max_clients = MJPEG_SERVER_MAX_CLIENTS,
+        .width = http_width,
+        .height = http_height,
+        .fps = http_fps,
+        .quality = http_quality,
+        .source_fn = http_preview_source,
+        .source_user = NULL};
+    if (mjpeg_server_init(&http_server, &config) != 0)
+    {
+        printf("Failed to start HTTP preview server on port %d\n", http_port);
+        return -1;
     }
 
-    // 清理TCP连接
-    if (client_connected && client_fd >= 0)
+    if (pthread_create(&http_thread_id, NULL, http_server_thread, NULL) != 0)
     {
-        shutdown(client_fd, SHUT_RDWR);
-        close(client_fd);
-        client_connected = 0;
-        client_fd = -1;
-        
-        // TCP线程结束时恢复屏幕显示
-        printf("TCP sender thread ending, restoring screen display\n");
-        turn_screen_on();
+        printf("Failed to create HTTP preview thread\n");
+        mjpeg_server_destroy(&http_server);
+        return -1;
     }
 
-    printf("TCP sender thread terminated\n");
-    return NULL;
+    http_thread_started = 1;
+    return 0;
+}
+
+/**
+ * @brief 停止 HTTP 预览服务器 (帧池销毁前调用，线程退出后不再持有帧引用)
+ */
+static void stop_http_preview(void)
+{
+    if (!http_thread_started)
+    {
+        return;
+    }
+
+    mjpeg_server_stop(&http_server);
+    pthread_join(http_thread_id, NULL);
+    mjpeg_server_destroy(&http_server);
+    preview_context_release(&http_preview_ctx);
+    http_thread_started = 0;
 }
 
 /**
@@ -2234,88 +2545,6 @@ void update_system_info(void)
     }
 }
 
-/**
- * @brief SBGGR10格式数据解包（标量版本）- 参考v4l2_bench实现
- * @param raw_bytes 5字节的RAW10数据（包含4个像素）
- * @param pixels 输出的4个16位像素值
- */
-void unpack_sbggr10_scalar(const uint8_t raw_bytes[5], uint16_t pixels[4])
-{
-    // 重构40位数据
-    uint64_t combined = ((uint64_t)raw_bytes[4] << 32) |
-                        ((uint64_t)raw_bytes[3] << 24) |
-                        ((uint64_t)raw_bytes[2] << 16) |
-                        ((uint64_t)raw_bytes[1] << 8) |
-                        (uint64_t)raw_bytes[0];
-
-    // 提取4个10位像素值（小端序，从低位开始）
-    pixels[0] = (uint16_t)((combined >> 0) & 0x3FF);
-    pixels[1] = (uint16_t)((combined >> 10) & 0x3FF);
-    pixels[2] = (uint16_t)((combined >> 20) & 0x3FF);
-    pixels[3] = (uint16_t)((combined >> 30) & 0x3FF);
-}
-
-/**
- * @brief SBGGR10图像数据完整解包函数
- * @param raw_data 输入的RAW10数据
- * @param raw_size RAW10数据大小（字节）
- * @param output_pixels 输出的16位像素数组
- * @param width 图像宽度
- * @param height 图像高度
- * @return 0成功，-1失败
- */
-int unpack_sbggr10_image(const uint8_t *raw_data, size_t raw_size,
-                         uint16_t *output_pixels, int width, int height)
-{
-    if (!raw_data || !output_pixels || raw_size == 0)
-    {
-        return -1;
-    }
-
-    // 验证数据大小（必须是5的倍数）
-    if (raw_size % 5 != 0)
-    {
-        printf("Error: RAW data size (%zu) must be multiple of 5\n", raw_size);
-        return -1;
-    }
-
-    size_t expected_pixels = width * height;
-    size_t available_pixels = raw_size / 5 * 4;
-
-    if (available_pixels < expected_pixels)
-    {
-        printf("Warning: Not enough RAW data (%zu pixels available, %zu expected)\n",
-               available_pixels, expected_pixels);
-    }
-
-    // 解包RAW10数据
-    size_t raw_pos = 0;
-    size_t pixel_pos = 0;
-    size_t max_pixels = (available_pixels < expected_pixels) ? available_pixels : expected_pixels;
-
-    while (raw_pos + 5 <= raw_size && pixel_pos + 4 <= max_pixels)
-    {
-        uint16_t pixels[4];
-        unpack_sbggr10_scalar(raw_data + raw_pos, pixels);
-
-        // 复制像素数据，注意边界检查
-        for (int i = 0; i < 4 && pixel_pos < max_pixels; i++)
-        {
-            output_pixels[pixel_pos++] = pixels[i];
-        }
-
-        raw_pos += 5;
-    }
-
-    // 填充剩余像素（如果有）
-    while (pixel_pos < expected_pixels)
-    {
-        output_pixels[pixel_pos++] = 0;
-    }
-
-    return 0;
-}
-
 /**
  * @brief 16位像素数据缩放到目标尺寸
  * @param src_pixels 源16位像素数据
@@ -2376,141 +2605,224 @@ void convert_pixels_to_rgb565(const uint16_t *pixels, uint16_t *rgb565_data,
 }
 
 /**
- * @brief 横屏图像适配函数 - 将图像缩放并居中到全屏缓冲区
- * @param src_buffer 源图像缓冲区
- * @param src_width 源图像宽度
- * @param src_height 源图像高度
- * @param dst_buffer 目标全屏缓冲区 (DISPLAY_WIDTH X DISPLAY_HEIGHT)
- * @return 0 成功，-1 失败
+ * @brief 预览缩放性能对比 (--bench-preview)
+ * @details 用当前像素格式的伪随机帧对比原浮点路径 (整帧解包 + 浮点最近邻缩放 + RGB565转换)
+ *          与融合预览内核 (定点面积平均，灰度/彩色) 的单帧耗时
+ * @param width 源图像宽度
+ * @param height 源图像高度
+ * @return 0成功，-1失败
  */
-int landscape_image_fit(const uint16_t *src_buffer, int src_width, int src_height,
-                        uint16_t *dst_buffer)
+int run_preview_benchmark(int width, int height)
 {
-    if (!src_buffer || !dst_buffer || src_width <= 0 || src_height <= 0)
-    {
+    const int iterations = 50;
+    raw_layout_t layout;
+    raw_layout_detect(&layout, camera_format, width, height, 0, 0, raw_packing);
+    size_t raw_size = layout.stride * (size_t)height;
+    int scaled_width, scaled_height;
+    calculate_scaled_size(width, height, &scaled_width, &scaled_height);
+
+    uint8_t *raw = malloc(raw_size);
+    uint16_t *unpacked = malloc((size_t)width * height * sizeof(uint16_t));
+    uint16_t *scaled = malloc((size_t)scaled_width * scaled_height * sizeof(uint16_t));
+    uint16_t *rgb565 = malloc((size_t)scaled_width * scaled_height * sizeof(uint16_t));
+    if (!raw || !unpacked || !scaled || !rgb565)
+    {
+        printf("Error: Failed to allocate benchmark buffers\n");
+        free(raw);
+        free(unpacked);
+        free(scaled);
+        free(rgb565);
         return -1;
     }
 
-    // 清空目标缓冲区 (黑色背景)
-    memset(dst_buffer, 0, DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof(uint16_t));
-
-    // 计算居中位置
-    int x_offset = (DISPLAY_WIDTH - src_width) / 2;
-    int y_offset = (DISPLAY_HEIGHT - src_height) / 2;
+    uint32_t seed = 0x12345678u;
+    for (size_t i = 0; i < raw_size; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        raw[i] = (uint8_t)(seed >> 24);
+    }
 
-    // 确保不超出边界
-    if (x_offset < 0)
-        x_offset = 0;
-    if (y_offset < 0)
-        y_offset = 0;
+    printf("Preview benchmark: %dx%d %s (%s) -> %dx%d, %d iterations\n",
+           width, height, camera_format->name, raw_packing_name(layout.packing),
+           scaled_width, scaled_height, iterations);
 
-    int copy_width = (src_width > DISPLAY_WIDTH) ? DISPLAY_WIDTH : src_width;
-    int copy_height = (src_height > DISPLAY_HEIGHT) ? DISPLAY_HEIGHT : src_height;
+    // 原浮点路径
+    uint64_t start = get_time_ns();
+    for (int i = 0; i < iterations; i++)
+    {
+        raw_decode_image(&layout, raw, raw_size, unpacked);
+        scale_pixels(unpacked, width, height, scaled, scaled_width, scaled_height);
+        convert_pixels_to_rgb565(scaled, rgb565, scaled_width, scaled_height);
+    }
+    double float_ms = (double)(get_time_ns() - start) / 1e6 / iterations;
+    printf("  unpack + float nearest + rgb565: %8.3f ms/frame\n", float_ms);
 
-    // 复制图像数据到居中位置
-    for (int y = 0; y < copy_height; y++)
+    // 融合预览内核 (首帧建表不计入)
+    static const preview_mode_t modes[] = {PREVIEW_MODE_GRAY, PREVIEW_MODE_COLOR};
+    static const char *mode_names[] = {"gray", "color"};
+    for (int m = 0; m < 2; m++)
     {
-        int dst_y = y + y_offset;
-        if (dst_y >= DISPLAY_HEIGHT)
-            break;
+        static preview_context_t ctx; // 含4个查找表，不放在栈上
+        preview_params_t params = {modes[m], PREVIEW_GAIN_UNITY, PREVIEW_GAIN_UNITY, PREVIEW_GAIN_UNITY,
+                                   0, 1.0f, 1.0f};
+        preview_context_init(&ctx);
+        preview_set_params(&ctx, &params);
+        preview_render_raw(&ctx, &layout, raw, raw_size,
+                           rgb565, scaled_width, scaled_width, scaled_height);
 
-        for (int x = 0; x < copy_width; x++)
+        start = get_time_ns();
+        for (int i = 0; i < iterations; i++)
         {
-            int dst_x = x + x_offset;
-            if (dst_x >= DISPLAY_WIDTH)
-                break;
-
-            int src_idx = y * src_width + x;
-            int dst_idx = dst_y * DISPLAY_WIDTH + dst_x;
-
-            dst_buffer[dst_idx] = src_buffer[src_idx];
+            preview_render_raw(&ctx, &layout, raw, raw_size,
+                               rgb565, scaled_width, scaled_width, scaled_height);
         }
+        double fused_ms = (double)(get_time_ns() - start) / 1e6 / iterations;
+        printf("  fused area-average (%-5s)      : %8.3f ms/frame (%.1fx)\n",
+               mode_names[m], fused_ms, fused_ms > 0 ? float_ms / fused_ms : 0.0);
+
+        preview_context_release(&ctx);
     }
 
+    free(raw);
+    free(unpacked);
+    free(scaled);
+    free(rgb565);
     return 0;
 }
 
 /**
- * @brief 更新图像显示 (使用正确的SBGGR10解包和缩放，优化性能)
+ * @brief 使可见的叠加控件 (信息、时间、子系统状态标签) 失效，下次刷新时由LVGL重绘
  */
-void update_image_display(void)
+void invalidate_overlay_widgets(void)
 {
-    // 使用非阻塞锁尝试，避免阻塞按键处理
-    if (pthread_mutex_trylock(&frame_mutex) != 0)
+    lv_obj_t *overlays[] = {info_label, time_label, subsys_status_label};
+
+    for (size_t i = 0; i < sizeof(overlays) / sizeof(overlays[0]); i++)
     {
-        return; // 如果无法获取锁，跳过本次更新
+        if (overlays[i] && !lv_obj_has_flag(overlays[i], LV_OBJ_FLAG_HIDDEN))
+        {
+            lv_obj_invalidate(overlays[i]);
+        }
     }
+}
 
-    if (frame_available && current_frame.data && img_canvas)
+/**
+ * @brief 更新图像显示 (融合预览内核：解包、缩放、RGB565转换一次完成)
+ * @details 启用帧缓冲直写时预览直接写入显存，否则经LVGL图像控件显示
+ */
+void update_image_display(void)
+{
+    // 持有最新帧的引用，渲染期间驱动不会覆盖该缓冲区，也不阻塞其他消费者
+    static uint32_t last_displayed_sequence = 0;
+    frame_ref_t *ref = img_canvas ? frame_pool_acquire_latest(&frame_pool) : NULL;
+    if (!ref)
+    {
+        return;
+    }
+    if (ref->sequence == last_displayed_sequence)
     {
-        // 计算动态缩放尺寸
-        int scaled_width, scaled_height;
-        calculate_scaled_size(current_frame.width, current_frame.height,
-                              &scaled_width, &scaled_height);
+        frame_pool_release(ref); // 没有新帧
+        return;
+    }
+    last_displayed_sequence = ref->sequence;
+
+    const media_frame_t *frame = &ref->frame;
+
+    // 根据协商的行跨度和帧大小确定数据布局，只预览裁剪区域
+    raw_layout_t layout;
+    const uint8_t *roi_data;
+    size_t roi_size;
+    get_frame_roi(frame->data, frame->size, frame->width, frame->height,
+                  &layout, &roi_data, &roi_size);
 
-        // 更新当前图像尺寸
-        current_img_width = scaled_width;
-        current_img_height = scaled_height;
+    // 计算动态缩放尺寸
+    int scaled_width, scaled_height;
+    calculate_scaled_size(layout.width, layout.height, &scaled_width, &scaled_height);
 
-        // 创建图像处理缓冲区 (动态分配，支持不同分辨率)
-        static uint16_t *unpacked_buffer = NULL;                        // 原始尺寸解包缓冲区
-        static uint16_t scaled_pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];  // 缩放后的像素缓冲区
-        static uint16_t scaled_rgb565[DISPLAY_WIDTH * DISPLAY_HEIGHT];  // RGB565缓冲区
-        static uint16_t display_buffer[DISPLAY_WIDTH * DISPLAY_HEIGHT]; // 最终显示缓冲区
-        static int last_processed_width = 0, last_processed_height = 0;
-        static size_t unpacked_buffer_size = 0;
+    // 更新当前图像尺寸
+    current_img_width = scaled_width;
+    current_img_height = scaled_height;
 
-        // 动态分配解包缓冲区（根据当前摄像头分辨率）
-        size_t required_size = camera_width * camera_height;
-        if (unpacked_buffer == NULL || unpacked_buffer_size < required_size)
+    // 常驻的信箱显示缓冲区，预览内核每帧只改写其中的居中图像区域
+    static uint16_t display_buffer[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+    static lv_area_t buffer_area = {0, 0, -1, -1}; // 缓冲区当前图像区域 (空区域表示未初始化)
+    static int last_processed_width = 0, last_processed_height = 0;
+
+    // 只在尺寸变化时打印处理信息，减少日志开销
+    int size_changed = (layout.width != last_processed_width ||
+                        layout.height != last_processed_height);
+    if (size_changed)
+    {
+        printf("Processing frame: %dx%d (ROI %dx%d) -> %dx%d\n",
+               frame->width, frame->height, layout.width, layout.height,
+               scaled_width, scaled_height);
+        last_processed_width = layout.width;
+        last_processed_height = layout.height;
+    }
+
+    // 计算居中位置 (横屏适配)
+    int x_offset = (DISPLAY_WIDTH - scaled_width) / 2;
+    int y_offset = (DISPLAY_HEIGHT - scaled_height) / 2;
+    if (x_offset < 0)
+        x_offset = 0;
+    if (y_offset < 0)
+        y_offset = 0;
+
+    // 帧缓冲直写路径 (菜单打开时回到LVGL路径，避免预览覆盖菜单)
+    static int blit_active = 0;
+    if (preview_fb.map && !menu_visible)
+    {
+        if (!blit_active || size_changed)
         {
-            if (unpacked_buffer)
-            {
-                free(unpacked_buffer);
-            }
-            unpacked_buffer = malloc(required_size * sizeof(uint16_t));
-            if (!unpacked_buffer)
-            {
-                printf("Error: Failed to allocate unpacked buffer (%zu bytes)\n",
-                       required_size * sizeof(uint16_t));
-                pthread_mutex_unlock(&frame_mutex);
-                return;
-            }
-            unpacked_buffer_size = required_size;
-            printf("Allocated unpacked buffer: %dx%d (%zu pixels)\n",
-                   camera_width, camera_height, required_size);
+            // 图像控件隐藏后由LVGL重绘为背景，之后不再参与刷新；信箱区域只需清一次
+            lv_obj_add_flag(img_canvas, LV_OBJ_FLAG_HIDDEN);
+            fb_blit_fill(&preview_fb, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
+            blit_active = 1;
         }
 
-        // 只在尺寸变化时打印处理信息，减少日志开销
-        if (current_frame.width != last_processed_width || current_frame.height != last_processed_height)
+        int fb_stride;
+        uint16_t *fb_dst = fb_blit_region(&preview_fb, x_offset, y_offset, scaled_width, scaled_height,
+                                          &fb_stride);
+        if (fb_dst && preview_render_raw(&preview_ctx, &layout, roi_data, roi_size,
+                                         fb_dst, fb_stride, scaled_width, scaled_height) == 0)
         {
-            printf("Processing frame: %dx%d -> %dx%d\n",
-                   current_frame.width, current_frame.height, scaled_width, scaled_height);
-            last_processed_width = current_frame.width;
-            last_processed_height = current_frame.height;
+            // 预览覆盖了叠加控件所在区域，让LVGL只重绘这些控件的矩形
+            invalidate_overlay_widgets();
         }
-
-        // 第一步：SBGGR10 解包到原始尺寸的16位像素数据
-        if (unpack_sbggr10_image((const uint8_t *)current_frame.data, current_frame.size,
-                                 unpacked_buffer, current_frame.width, current_frame.height) != 0)
+        else if (size_changed)
         {
-            printf("Error: Failed to unpack SBGGR10 data\n");
-            pthread_mutex_unlock(&frame_mutex);
-            return;
+            printf("Error: Failed to render preview to framebuffer\n");
         }
 
-        // 第二步：缩放到目标尺寸
-        scale_pixels(unpacked_buffer, current_frame.width, current_frame.height,
-                     scaled_pixels, scaled_width, scaled_height);
+        frame_pool_release(ref);
+        return;
+    }
+
+    if (blit_active)
+    {
+        lv_obj_clear_flag(img_canvas, LV_OBJ_FLAG_HIDDEN);
+        blit_active = 0;
+    }
 
-        // 第三步：转换为RGB565格式
-        convert_pixels_to_rgb565(scaled_pixels, scaled_rgb565, scaled_width, scaled_height);
+    // 图像区域变化时才重新填充黑边 (首帧、分辨率或裁剪区域变化)
+    lv_area_t image_area = {x_offset, y_offset,
+                            x_offset + scaled_width - 1, y_offset + scaled_height - 1};
+    int geometry_changed = memcmp(&image_area, &buffer_area, sizeof(image_area)) != 0;
+    if (geometry_changed)
+    {
+        memset(display_buffer, 0, sizeof(display_buffer));
+        buffer_area = image_area;
+    }
 
-        // 第四步：横屏适配 (居中显示到全屏缓冲区)
-        if (landscape_image_fit(scaled_rgb565, scaled_width, scaled_height, display_buffer) == 0)
+    // 融合预览：只解包显示所需的源像素，缩放(彩色模式按Bayer四元组合并)并转换为RGB565后直接写入显示缓冲区
+    if (preview_render_raw(&preview_ctx, &layout, roi_data, roi_size,
+                           display_buffer + y_offset * DISPLAY_WIDTH + x_offset, DISPLAY_WIDTH,
+                           scaled_width, scaled_height) == 0)
+    {
+        // LVGL 图像描述符始终指向同一个全屏缓冲区，只需设置一次
+        static lv_img_dsc_t img_dsc;
+        if (!img_dsc.data)
         {
-            // 创建 LVGL 图像描述符
-            static lv_img_dsc_t img_dsc;
             img_dsc.header.always_zero = 0;
             img_dsc.header.w = DISPLAY_WIDTH;  // 使用全屏宽度
             img_dsc.header.h = DISPLAY_HEIGHT; // 使用全屏高度
@@ -2518,33 +2830,167 @@ void update_image_display(void)
             img_dsc.header.cf = LV_IMG_CF_TRUE_COLOR;
             img_dsc.data = (uint8_t *)display_buffer;
 
-            // 更新图像 (使用全屏显示)
             lv_img_set_src(img_canvas, &img_dsc);
             lv_obj_set_size(img_canvas, DISPLAY_WIDTH, DISPLAY_HEIGHT);
             lv_obj_set_pos(img_canvas, 0, 0); // 左上角对齐
+        }
 
-            // 只在尺寸变化时打印成功信息
-            if (current_frame.width != last_processed_width || current_frame.height != last_processed_height)
-            {
-                printf("Image updated: %dx%d -> %dx%d (SBGGR10 properly unpacked)\n",
-                       current_frame.width, current_frame.height, scaled_width, scaled_height);
-            }
+        // 数据原地更新：黑边变化时重绘整屏，否则只重绘图像区域
+        if (geometry_changed)
+        {
+            lv_obj_invalidate(img_canvas);
         }
         else
         {
-            printf("Error: Failed to fit image for landscape display\n");
+            lv_obj_invalidate_area(img_canvas, &image_area);
         }
 
-        frame_available = 0;
+        // 只在尺寸变化时打印成功信息
+        if (size_changed)
+        {
+            printf("Image updated: %dx%d -> %dx%d (fused %s preview, %s, stride %zu)\n",
+                   layout.width, layout.height, scaled_width, scaled_height,
+                   camera_format->name, raw_packing_name(layout.packing), layout.stride);
+        }
+    }
+    else
+    {
+        printf("Error: Failed to render RAW preview\n");
     }
 
-    pthread_mutex_unlock(&frame_mutex);
+    frame_pool_release(ref);
+}
+
+/**
+ * @brief 查询摄像头当前格式的行跨度 (V4L2 bytesperline)
+ * @details libmedia 不对外提供协商后的格式，这里另开一个句柄做只读的 G_FMT 查询
+ * @param device 设备路径
+ * @return 每行字节数，查询失败返回0
+ */
+size_t query_plane_stride(const char *device)
+{
+    int fd = open(device, O_RDWR | O_NONBLOCK);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+
+    size_t stride = 0;
+    if (ioctl(fd, VIDIOC_G_FMT, &fmt) == 0)
+    {
+        stride = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+    }
+    else
+    {
+        // 单平面驱动
+        memset(&fmt, 0, sizeof(fmt));
+        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        if (ioctl(fd, VIDIOC_G_FMT, &fmt) == 0)
+        {
+            stride = fmt.fmt.pix.bytesperline;
+        }
+    }
+
+    close(fd);
+    return stride;
+}
+
+/**
+ * @brief 确定一帧的数据布局并截取配置的裁剪区域 (不复制数据)
+ * @details 裁剪区域无效 (如超出图像) 时使用整帧
+ * @param data 帧数据
+ * @param size 帧数据大小（字节）
+ * @param width 帧宽度
+ * @param height 帧高度
+ * @param roi 输出的区域布局
+ * @param roi_data 输出的区域首字节地址
+ * @param roi_size 输出的从区域首字节到帧末尾的字节数
+ */
+void get_frame_roi(const void *data, size_t size, int width, int height,
+                   raw_layout_t *roi, const uint8_t **roi_data, size_t *roi_size)
+{
+    raw_layout_t layout;
+    raw_layout_detect(&layout, camera_format, width, height, camera_stride, size, raw_packing);
+
+    size_t offset = 0;
+    if (raw_layout_crop(&layout, crop_left, crop_top, crop_width, crop_height, roi, &offset) != 0 ||
+        offset > size)
+    {
+        *roi = layout;
+        offset = 0;
+    }
+
+    *roi_data = (const uint8_t *)data + offset;
+    *roi_size = size - offset;
 }
 
 // ============================================================================
 // 摄像头采集线程
 // ============================================================================
 
+/**
+ * @brief 查询某一采集序号生效的曝光和增益 (采集线程按序号递增调用，已生效的设置移出待生效列表)
+ */
+static void sensor_settings_at(uint32_t sequence, int32_t *exposure, int32_t *gain)
+{
+    pthread_mutex_lock(&sensor_lock);
+    int applied = 0;
+    while (applied < sensor_pending_count && sensor_pending[applied].sequence <= sequence)
+    {
+        sensor_active = sensor_pending[applied++];
+    }
+    if (applied > 0)
+    {
+        sensor_pending_count -= applied;
+        memmove(sensor_pending, sensor_pending + applied, (size_t)sensor_pending_count * sizeof(sensor_pending[0]));
+    }
+    *exposure = sensor_active.exposure;
+    *gain = sensor_active.gain;
+    pthread_mutex_unlock(&sensor_lock);
+}
+
+/**
+ * @brief 记录刚写入传感器的曝光和增益
+ * @return 第一帧使用新设置的采集序号
+ */
+static uint32_t record_sensor_settings(void)
+{
+    uint32_t sequence = __atomic_load_n(&capture_sequence, __ATOMIC_RELAXED) + 1 + SENSOR_CONTROL_DELAY_FRAMES;
+
+    pthread_mutex_lock(&sensor_lock);
+    sensor_settings_t *entry = sensor_pending_count > 0 ? &sensor_pending[sensor_pending_count - 1] : NULL;
+    if (!entry || entry->sequence != sequence)
+    {
+        // 同一帧内的多次修改合并；列表已满时最早的一项提前生效
+        if (sensor_pending_count == SENSOR_PENDING_MAX)
+        {
+            sensor_active = sensor_pending[0];
+            sensor_pending_count--;
+            memmove(sensor_pending, sensor_pending + 1, (size_t)sensor_pending_count * sizeof(sensor_pending[0]));
+        }
+        entry = &sensor_pending[sensor_pending_count++];
+    }
+    *entry = (sensor_settings_t){sequence, current_exposure, current_gain};
+    pthread_mutex_unlock(&sensor_lock);
+    return sequence;
+}
+
+/**
+ * @brief 帧池的缓冲区交还函数 (最后一个引用释放时把缓冲区交还驱动)
+ */
+static void release_camera_frame(media_frame_t *frame, void *user)
+{
+    (void)user;
+    if (media_session)
+    {
+        libmedia_session_release_frame(media_session, frame);
+    }
+}
+
 /**
  * @brief 摄像头采集线程函数 (始终运行，不受显示状态影响)
  */
@@ -2587,21 +3033,31 @@ void *camera_thread(void *arg)
                 break;
             }
 
-            pthread_mutex_lock(&frame_mutex);
+            // 出队后立即记录采集信息，曝光和增益为该帧生效的值
+            frame_meta_t meta = {
+                .timestamp = get_time_ns(),
+                .sequence = __atomic_add_fetch(&capture_sequence, 1, __ATOMIC_RELAXED)};
+            sensor_settings_at(meta.sequence, &meta.exposure, &meta.gain);
 
-            // 更新当前帧
-            if (current_frame.data)
+            // 发布为最新帧并通知消费者；消费者占满帧池时该帧直接交还驱动
+            if (frame_pool_publish(&frame_pool, &frame, &meta) == 0)
             {
-                libmedia_session_release_frame(media_session, &current_frame);
-            }
-
-            current_frame = frame;
-            frame_available = 1;
-            frame_count++;
+                frame_count++;
 
-            // 通知显示更新和TCP发送线程
-            pthread_cond_broadcast(&frame_ready);
-            pthread_mutex_unlock(&frame_mutex);
+                // 有客户端时放入各客户端的发送队列 (队列满时按策略丢帧，仅阻塞策略会等待)，
+                // 有本机消费者时交给本机帧共享线程复制
+                int spooling = stream_spool_recording(&stream_spool); // 会话客户端断线期间仍需发布
+                if (client_connected || spooling || local_server_client_count(&local_server) > 0)
+                {
+                    frame_ref_t *ref = frame_pool_acquire_latest(&frame_pool);
+                    if (client_connected || spooling)
+                    {
+                        stream_server_publish(&stream_server, ref, 1000);
+                    }
+                    local_server_publish(&local_server, ref);
+                    frame_pool_release(ref);
+                }
+            }
 
             // 更新采集帧率统计
             update_fps();
@@ -2932,7 +3388,7 @@ void handle_keys(void)
                     int result = capture_raw_photo();
                     if (result == 0)
                     {
-                        printf("Photo captured successfully\n");
+                        printf("Photo queued for saving\n");
                     }
                     else
                     {
@@ -3284,11 +3740,14 @@ int main(int argc, char *argv[])
 {
     printf("LVGL Camera Display System Starting...\n");
 
+    // 默认像素格式 (可由配置文件覆盖，--format 优先于配置文件)
+    camera_format = raw_format_find(DEFAULT_PIXEL_FORMAT);
+
     // 解析命令行参数
     int parse_result = parse_arguments(argc, argv);
     if (parse_result == 1)
     {
-        // 显示帮助后正常退出
+        // 显示帮助或运行性能测试后正常退出
         return 0;
     }
     else if (parse_result == -1)
@@ -3319,6 +3778,14 @@ int main(int argc, char *argv[])
         config_loaded = 0;
     }
 
+    // 选择RAW10解包内核 (NEON / 通用 / 标量，自检通过后才启用；RAW8/RAW12使用专用内核)
+    raw_decode_init();
+    raw_compand_init(); // 压扩映射表 (跟随解包内核选择NEON)
+
+    // 初始化预览渲染上下文
+    preview_context_init(&preview_ctx);
+    preview_set_params(&preview_ctx, &preview_params);
+
     // 初始化 LVGL
     lv_init();
 
@@ -3344,6 +3811,22 @@ int main(int argc, char *argv[])
         lcd_initialized = 0;
     }
 
+    // 帧缓冲直写 (失败时回退到LVGL图像控件)
+    if (direct_blit)
+    {
+        if (fb_blit_open(&preview_fb, "/dev/fb0", DISPLAY_WIDTH, DISPLAY_HEIGHT) == 0 &&
+            (preview_fb.width < DISPLAY_WIDTH || preview_fb.height < DISPLAY_HEIGHT))
+        {
+            printf("Warning: Framebuffer smaller than %dx%d, direct blit disabled\n",
+                   DISPLAY_WIDTH, DISPLAY_HEIGHT);
+            fb_blit_close(&preview_fb);
+        }
+        if (!preview_fb.map)
+        {
+            printf("Warning: Direct framebuffer blit unavailable, using LVGL image widget\n");
+        }
+    }
+
     // 创建 LVGL 显示缓冲区
     static lv_color_t buf[DISP_BUF_SIZE];
     static lv_disp_draw_buf_t disp_buf;
@@ -3423,11 +3906,12 @@ int main(int argc, char *argv[])
         .format = {
             .width = camera_width,
             .height = camera_height,
-            .pixelformat = CAMERA_PIXELFORMAT,
+            .pixelformat = camera_format->fourcc,
             .num_planes = 1,
-            .plane_size = {camera_width * camera_height * 5 / 4} // RAW10: 10位/像素 = 1.25字节/像素
+            // 紧凑排列的帧大小 (RAW8 1字节/像素，RAW10 1.25字节/像素，RAW12 1.5字节/像素)
+            .plane_size = {camera_height * raw_layout_min_stride(camera_width, camera_format->bit_depth, raw_packing)}
         },
-        .buffer_count = BUFFER_COUNT,
+        .buffer_count = buffer_count,
         .use_multiplanar = 1, // 多平面模式
         .nonblocking = 0};
 
@@ -3450,22 +3934,54 @@ int main(int argc, char *argv[])
 
     printf("Camera session started successfully\n");
 
+    // 帧池比驱动缓冲区少一个，保证驱动始终有可写的缓冲区
+    frame_pool_init(&frame_pool, buffer_count - 1, release_camera_frame, NULL);
+    printf("Frame pool: %d driver buffers, up to %d frames held by consumers\n",
+           buffer_count, buffer_count - 1);
+
+    // 拍照缓冲区按整帧预先分配，拍照时只提交帧引用，解包和写入在后台线程中进行
+    photo_writer_config_t photo_config = {
+        .dir = CONFIG_IMAGE_PATH,
+        .buffers = photo_buffers,
+        .buffer_size = (size_t)camera_width * (size_t)camera_height * sizeof(uint16_t)};
+    if (photo_writer_init(&photo_writer, &photo_config) != 0)
+    {
+        printf("Warning: Photo writer unavailable, photo capture disabled\n");
+    }
+
+    // 查询驱动实际协商的行跨度 (可能包含行尾对齐填充)
+    camera_stride = query_plane_stride(DEFAULT_CAMERA_DEVICE);
+    if (camera_stride > 0)
+    {
+        printf("Camera plane stride: %zu bytes/line (packing: %s)\n",
+               camera_stride, raw_packing_name(raw_packing));
+    }
+    else
+    {
+        printf("Camera plane stride unknown, deriving from frame size (packing: %s)\n",
+               raw_packing_name(raw_packing));
+    }
+
     // ========================================================================
     // 裁剪功能实现说明
     // ========================================================================
     // 由于Rockchip CSI驱动的特殊性，标准的V4L2 S_SELECTION不能直接使用
     // 错误: "csi size err, intstat:0x1000200, size:0xc80500"
-    // 
-    // 替代方案：
-    // 1. 使用软件裁剪：在图像处理阶段进行裁剪
-    // 2. 调研Rockchip专用的裁剪API
-    // 3. 或者使用RGA（Rockchip Graphics Accelerator）进行硬件裁剪
     //
-    // 当前状态：配置文件中的crop_top和crop_left会被加载但不应用
-    if (crop_top > 0 || crop_left > 0) {
-        printf("Note: Crop configuration loaded (top=%d, left=%d) but not applied\n", crop_top, crop_left);
-        printf("      Hardware crop is disabled due to Rockchip CSI driver limitations\n");
-        printf("      Consider implementing software crop or RGA-based crop in the future\n");
+    // 因此采用软件裁剪：传感器仍输出整帧，预览、拍照和TCP传输通过
+    // get_frame_roi 在打包数据上截取区域 (只计算字节偏移，不复制)，
+    // 只解包/发送区域内的数据
+    if (crop_top > 0 || crop_left > 0 || crop_width > 0 || crop_height > 0) {
+        raw_layout_t full, roi;
+        size_t offset;
+        raw_layout_detect(&full, camera_format, camera_width, camera_height, camera_stride, 0, raw_packing);
+        if (raw_layout_crop(&full, crop_left, crop_top, crop_width, crop_height, &roi, &offset) == 0) {
+            printf("Software crop: %dx%d -> %dx%d at byte offset %zu (requested top=%d, left=%d)\n",
+                   camera_width, camera_height, roi.width, roi.height, offset, crop_top, crop_left);
+        } else {
+            printf("Warning: Crop window (top=%d, left=%d) is outside the %dx%d frame, using full frame\n",
+                   crop_top, crop_left, camera_width, camera_height);
+        }
     }
 
     // 初始化 LVGL 界面
@@ -3536,58 +4052,17 @@ int main(int argc, char *argv[])
     
     pthread_attr_destroy(&camera_attr);
 
+    // 本机帧共享和HTTP预览与TCP开关无关，配置了套接字路径/端口就启动
+    start_local_server();
+    start_http_preview();
+
     // 如果命令行启用了TCP，启动TCP服务器线程
     if (tcp_enabled)
     {
         printf("Starting TCP server thread as enabled via command line...\n");
         
-        // 先创建TCP服务器
-        server_fd = create_server(DEFAULT_PORT);
-        if (server_fd >= 0)
+        if (start_stream_server() != 0)
         {
-            pthread_attr_t tcp_attr;
-            struct sched_param tcp_param;
-            
-            // 初始化TCP线程属性
-            pthread_attr_init(&tcp_attr);
-            pthread_attr_setdetachstate(&tcp_attr, PTHREAD_CREATE_JOINABLE);
-            
-            // 设置调度策略为FIFO，中等优先级
-            pthread_attr_setschedpolicy(&tcp_attr, SCHED_FIFO);
-            tcp_param.sched_priority = sched_get_priority_max(SCHED_FIFO) / 2;
-            pthread_attr_setschedparam(&tcp_attr, &tcp_param);
-            pthread_attr_setinheritsched(&tcp_attr, PTHREAD_EXPLICIT_SCHED);
-            
-            printf("Setting TCP thread priority to: %d (SCHED_FIFO)\n", tcp_param.sched_priority);
-            
-            if (pthread_create(&tcp_thread_id, &tcp_attr, tcp_sender_thread, NULL) == 0)
-            {
-                printf("TCP server started successfully with priority %d\n", tcp_param.sched_priority);
-            }
-            else
-            {
-                printf("Failed to create TCP thread with priority, trying normal priority...\n");
-                // 如果优先级设置失败，尝试默认优先级
-                pthread_attr_destroy(&tcp_attr);
-                pthread_attr_init(&tcp_attr);
-                if (pthread_create(&tcp_thread_id, &tcp_attr, tcp_sender_thread, NULL) == 0)
-                {
-                    printf("TCP server started successfully with normal priority\n");
-                }
-                else
-                {
-                    printf("Failed to create TCP thread\n");
-                    close(server_fd);
-                    server_fd = -1;
-                    tcp_enabled = 0;
-                }
-            }
-            
-            pthread_attr_destroy(&tcp_attr);
-        }
-        else
-        {
-            printf("Failed to create TCP server socket\n");
             tcp_enabled = 0;
         }
     }
@@ -3607,13 +4082,14 @@ int main(int argc, char *argv[])
     }
     
     printf("Display: %dx%d (forced landscape mode)\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
-    printf("Camera: %dx%d (RAW10) on %s\n", camera_width, camera_height, DEFAULT_CAMERA_DEVICE);
+    printf("Camera: %dx%d (%s) on %s\n", camera_width, camera_height, camera_format->name, DEFAULT_CAMERA_DEVICE);
     printf("Scaling: Width-aligned to %d px, maintaining aspect ratio\n", DISPLAY_WIDTH);
     printf("Performance optimizations enabled:\n");
     printf("  - Display update rate limited to 30 FPS\n");
-    printf("  - Non-blocking frame mutex for better key response\n");
+    printf("  - Reference-counted frame pool (display never blocks capture)\n");
     printf("  - Optimized key debouncing (3 samples)\n");
     printf("  - Dynamic buffer allocation for different resolutions\n");
+    printf("  - Vectorized RAW10 unpack (%s kernel)\n", raw_decode_kernel_name(raw_decode_get_kernel()));
     printf("  - Reduced debug output for better performance\n");
     printf("Controls:\n");
     printf("  当菜单隐藏时:\n");
@@ -3661,6 +4137,12 @@ int main(int argc, char *argv[])
         // 处理按键 (高优先级，每次循环都执行)
         handle_keys();
 
+        // 执行TCP客户端的控制请求
+        process_remote_controls();
+
+        // 显示后台保存完成的照片
+        process_photo_results();
+
         // 再次检查退出标志
         if (exit_flag)
             break;
@@ -3728,18 +4210,9 @@ int main(int argc, char *argv[])
 
     printf("Main loop exited, shutting down...\n");
 
-    // 停止TCP传输
+    // 停止TCP传输 (断开所有客户端)
     tcp_enabled = 0;
-    if (client_connected && client_fd >= 0)
-    {
-        close(client_fd);
-        client_connected = 0;
-    }
-    if (server_fd >= 0)
-    {
-        close(server_fd);
-        server_fd = -1;
-    }
+    stop_stream_server();
 
     // 清理相机控制
     cleanup_camera_controls();
@@ -3793,49 +4266,32 @@ cleanup:
     cleanup_subsystem();
 
     // 等待TCP线程结束
-    if (tcp_enabled)
+    if (tcp_thread_started)
     {
         printf("Waiting for TCP thread to exit...\n");
         tcp_enabled = 0;
-        pthread_cond_broadcast(&frame_ready);
-        void *tcp_ret;
-        if (pthread_join(tcp_thread_id, &tcp_ret) == 0)
-        {
-            printf("TCP thread exited successfully\n");
-        }
+        stop_stream_server();
     }
 
-    // 清理TCP资源
-    if (client_connected && client_fd >= 0)
-    {
-        close(client_fd);
-        client_connected = 0;
-    }
-    if (server_fd >= 0)
-    {
-        close(server_fd);
-        server_fd = -1;
-    }
+    // 断开本机消费者和HTTP预览客户端 (释放其持有的帧引用)
+    stop_local_server();
+    stop_http_preview();
+
+    // 写完已提交的照片 (释放其持有的帧引用)
+    photo_writer_destroy(&photo_writer);
 
     // 清理动态分配的图像缓冲区
     printf("Cleaning up image buffers...\n");
     cleanup_image_buffers();
 
-    // 清理当前帧数据
+    // 交还帧池中的最新帧 (消费者线程均已退出)
     printf("Cleaning up frame data...\n");
-    pthread_mutex_lock(&frame_mutex);
-    if (current_frame.data && media_session)  // 确保 media_session 不为 NULL
-    {
-        libmedia_session_release_frame(media_session, &current_frame);
-        current_frame.data = NULL;
-    }
-    else if (current_frame.data)
+    if (frame_pool.release_fn)
     {
-        // 如果 media_session 为 NULL 但有帧数据，只清空指针
-        printf("Warning: Clearing frame data without media session\n");
-        current_frame.data = NULL;
+        printf("Frame pool: %u frames dropped (all %d buffers held by consumers)\n",
+               frame_pool_dropped(&frame_pool), frame_pool.capacity);
     }
-    pthread_mutex_unlock(&frame_mutex);
+    frame_pool_destroy(&frame_pool);
 
     // 清理媒体会话
     printf("Cleaning up media session...\n");
@@ -3850,6 +4306,9 @@ cleanup:
     printf("Deinitializing libMedia...\n");
     libmedia_deinit();
 
+    // 解除帧缓冲映射
+    fb_blit_close(&preview_fb);
+
     // 清理LCD设备
     if (lcd_initialized)
     {
@@ -3871,11 +4330,6 @@ cleanup:
     printf("Cleaning up GPIO...\n");
     DEV_ModuleExit();
 
-    // 清理互斥锁和条件变量
-    printf("Cleaning up synchronization objects...\n");
-    pthread_mutex_destroy(&frame_mutex);
-    pthread_cond_destroy(&frame_ready);
-
     printf("System shutdown complete\n");
     fflush(stdout);
     return 0;
@@ -4318,76 +4772,17 @@ void menu_confirm_selection(void)
         if (tcp_enabled)
         {
             // 启动TCP传输 (中等优先级)
-            if (server_fd < 0)
+            if (start_stream_server() != 0)
             {
-                server_fd = create_server(DEFAULT_PORT);
-                if (server_fd >= 0)
-                {
-                    pthread_attr_t tcp_attr;
-                    struct sched_param tcp_param;
-                    
-                    pthread_attr_init(&tcp_attr);
-                    pthread_attr_setdetachstate(&tcp_attr, PTHREAD_CREATE_JOINABLE);
-                    
-                    // 设置调度策略为FIFO，中等优先级
-                    pthread_attr_setschedpolicy(&tcp_attr, SCHED_FIFO);
-                    tcp_param.sched_priority = sched_get_priority_max(SCHED_FIFO) / 2;
-                    pthread_attr_setschedparam(&tcp_attr, &tcp_param);
-                    pthread_attr_setinheritsched(&tcp_attr, PTHREAD_EXPLICIT_SCHED);
-                    
-                    if (pthread_create(&tcp_thread_id, &tcp_attr, tcp_sender_thread, NULL) == 0)
-                    {
-                        printf("Menu: TCP server started successfully with priority %d\n", tcp_param.sched_priority);
-                    }
-                    else
-                    {
-                        printf("Menu: Failed to create TCP thread with priority, trying normal...\n");
-                        // 如果优先级设置失败，尝试默认优先级
-                        pthread_attr_destroy(&tcp_attr);
-                        pthread_attr_init(&tcp_attr);
-                        if (pthread_create(&tcp_thread_id, &tcp_attr, tcp_sender_thread, NULL) == 0)
-                        {
-                            printf("Menu: TCP server started successfully with normal priority\n");
-                        }
-                        else
-                        {
-                            printf("Menu: Failed to create TCP thread\n");
-                            close(server_fd);
-                            server_fd = -1;
-                            tcp_enabled = 0;
-                        }
-                    }
-                    
-                    pthread_attr_destroy(&tcp_attr);
-                }
-                else
-                {
-                    printf("Menu: Failed to create TCP server\n");
-                    tcp_enabled = 0;
-                }
+                printf("Menu: Failed to start TCP server\n");
+                tcp_enabled = 0;
             }
         }
         else
         {
-            // 停止TCP传输
+            // 停止TCP传输 (断开所有客户端)
             printf("Menu: Stopping TCP transmission...\n");
-
-            // 关闭客户端连接
-            if (client_connected)
-            {
-                shutdown(client_fd, SHUT_RDWR);
-                close(client_fd);
-                client_connected = 0;
-                client_fd = -1;
-            }
-
-            // 关闭服务器socket
-            if (server_fd >= 0)
-            {
-                shutdown(server_fd, SHUT_RDWR);
-                close(server_fd);
-                server_fd = -1;
-            }
+            stop_stream_server();
         }
         break;
 
@@ -4488,6 +4883,7 @@ void menu_confirm_selection(void)
             if (!is_tcp_available() && tcp_enabled)
             {
                 tcp_enabled = 0;
+                stop_stream_server();
                 printf("Menu: TCP disabled due to USB mode change (TCP only available in RNDIS mode)\n");
             }
         }
@@ -4623,44 +5019,73 @@ void adjust_gain_down(void)
 }
 
 /**
- * @brief 更新曝光值并应用到相机
+ * @brief 把曝光或增益写入传感器 (超出范围时限幅) 并记录生效时间
+ * @param control STREAM_CONTROL_EXPOSURE 或 STREAM_CONTROL_GAIN
+ * @param new_value 新的值
+ * @param sequence 输出第一帧使用新值的采集序号 (可为NULL)
+ * @return stream_control_status_t
  */
-void update_exposure_value(int32_t new_value)
+static int apply_sensor_control(int control, int32_t new_value, uint32_t *sequence)
 {
+    int exposure = (control == STREAM_CONTROL_EXPOSURE);
     if (subdev_handle < 0)
     {
-        printf("Warning: Camera controls not initialized, cannot set exposure\n");
-        return;
+        printf("Warning: Camera controls not initialized, cannot set %s\n", exposure ? "exposure" : "gain");
+        return STREAM_CONTROL_UNAVAILABLE;
     }
 
     // 限制范围
-    if (new_value < exposure_min)
-        new_value = exposure_min;
-    if (new_value > exposure_max)
-        new_value = exposure_max;
+    int32_t min = exposure ? exposure_min : gain_min;
+    int32_t max = exposure ? exposure_max : gain_max;
+    int status = (new_value < min || new_value > max) ? STREAM_CONTROL_CLAMPED : STREAM_CONTROL_OK;
+    if (new_value < min)
+        new_value = min;
+    if (new_value > max)
+        new_value = max;
 
     // 设置到硬件
-    if (libmedia_set_exposure(subdev_handle, new_value) == 0)
+    int result = exposure ? libmedia_set_exposure(subdev_handle, new_value)
+                          : libmedia_set_gain(subdev_handle, new_value);
+    if (result != 0)
     {
+        printf("Error: Failed to set %s to %d\n", exposure ? "exposure" : "gain", new_value);
+        return STREAM_CONTROL_FAILED;
+    }
+
+    if (exposure)
         current_exposure = new_value;
-        printf("Exposure set to: %d\n", current_exposure);
+    else
+        current_gain = new_value;
+    uint32_t first = record_sensor_settings();
+    if (sequence)
+    {
+        *sequence = first;
+    }
+    return status;
+}
 
-        // 更新配置并保存到文件
-        current_config.exposure = current_exposure;
-        if (save_config_file(&current_config) == 0)
-        {
-            printf("Exposure value saved to config\n");
-        }
+/**
+ * @brief 更新曝光值并应用到相机
+ */
+void update_exposure_value(int32_t new_value)
+{
+    if (apply_sensor_control(STREAM_CONTROL_EXPOSURE, new_value, NULL) > STREAM_CONTROL_CLAMPED)
+    {
+        return;
+    }
+    printf("Exposure set to: %d\n", current_exposure);
 
-        // 更新菜单显示
-        if (menu_visible)
-        {
-            update_menu_selection();
-        }
+    // 更新配置并保存到文件
+    current_config.exposure = current_exposure;
+    if (save_config_file(&current_config) == 0)
+    {
+        printf("Exposure value saved to config\n");
     }
-    else
+
+    // 更新菜单显示
+    if (menu_visible)
     {
-        printf("Error: Failed to set exposure to %d\n", new_value);
+        update_menu_selection();
     }
 }
 
@@ -4669,40 +5094,122 @@ void update_exposure_value(int32_t new_value)
  */
 void update_gain_value(int32_t new_value)
 {
-    if (subdev_handle < 0)
+    if (apply_sensor_control(STREAM_CONTROL_GAIN, new_value, NULL) > STREAM_CONTROL_CLAMPED)
     {
-        printf("Warning: Camera controls not initialized, cannot set gain\n");
         return;
     }
+    printf("Gain set to: %d\n", current_gain);
 
-    // 限制范围
-    if (new_value < gain_min)
-        new_value = gain_min;
-    if (new_value > gain_max)
-        new_value = gain_max;
+    // 更新配置并保存到文件
+    current_config.gain = current_gain;
+    if (save_config_file(&current_config) == 0)
+    {
+        printf("Gain value saved to config\n");
+    }
 
-    // 设置到硬件
-    if (libmedia_set_gain(subdev_handle, new_value) == 0)
+    // 更新菜单显示
+    if (menu_visible)
     {
-        current_gain = new_value;
-        printf("Gain set to: %d\n", current_gain);
+        update_menu_selection();
+    }
+}
 
-        // 更新配置并保存到文件
-        current_config.gain = current_gain;
-        if (save_config_file(&current_config) == 0)
-        {
-            printf("Gain value saved to config\n");
-        }
+/**
+ * @brief 执行TCP客户端排队的控制请求并应答 (主循环调用)
+ * @details 远程调节回路可能按帧率修改曝光/增益，停止调整 REMOTE_CONFIG_SAVE_DELAY_US 后才写入配置文件。
+ *          外设和模式的编号与 device_control_t、device_mode_t 相同
+ */
+void process_remote_controls(void)
+{
+    if (__atomic_load_n(&remote_control_count, __ATOMIC_RELAXED) == 0 && !remote_config_dirty)
+    {
+        return;
+    }
+
+    remote_control_t pending[REMOTE_CONTROL_QUEUE];
+    pthread_mutex_lock(&remote_control_lock);
+    int count = remote_control_count;
+    memcpy(pending, remote_controls, (size_t)count * sizeof(pending[0]));
+    remote_control_count = 0;
+    pthread_mutex_unlock(&remote_control_lock);
 
-        // 更新菜单显示
-        if (menu_visible)
+    int changed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const stream_control_request_t *request = &pending[i].request;
+        stream_control_ack_t ack = {
+            .id = request->id,
+            .control = request->control,
+            .target = request->target,
+            .value = request->value};
+        int status;
+        uint32_t sequence = 0;
+
+        switch (request->control)
         {
-            update_menu_selection();
+        case STREAM_CONTROL_EXPOSURE:
+        case STREAM_CONTROL_GAIN:
+            status = apply_sensor_control(request->control, request->value, &sequence);
+            if (status <= STREAM_CONTROL_CLAMPED)
+            {
+                ack.value = (request->control == STREAM_CONTROL_EXPOSURE) ? current_exposure : current_gain;
+                ack.sequence = sequence;
+                remote_config_dirty = 1;
+                gettimeofday(&remote_config_time, NULL);
+                changed = 1;
+            }
+            break;
+
+        case STREAM_CONTROL_DEVICE_MODE:
+            if (request->target >= DEVICE_CTRL_COUNT || request->value < 0 || request->value >= DEVICE_MODE_COUNT)
+            {
+                status = STREAM_CONTROL_INVALID;
+            }
+            else if (!subsys_handle)
+            {
+                status = STREAM_CONTROL_UNAVAILABLE;
+            }
+            else
+            {
+                // 外设开关立即执行，下一帧起生效
+                set_device_mode((device_control_t)request->target, (device_mode_t)request->value);
+                status = STREAM_CONTROL_OK;
+                ack.sequence = __atomic_load_n(&capture_sequence, __ATOMIC_RELAXED) + 1;
+                changed = 1;
+            }
+            break;
+
+        default:
+            status = STREAM_CONTROL_INVALID;
+            break;
         }
+
+        ack.status = (uint16_t)status;
+        stream_server_control_ack(&stream_server, pending[i].client_id, &ack);
     }
-    else
+
+    if (changed && menu_visible)
+    {
+        update_menu_selection();
+    }
+
+    // 远程调整停止一段时间后保存一次，避免按帧率写闪存
+    if (remote_config_dirty)
     {
-        printf("Error: Failed to set gain to %d\n", new_value);
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        long elapsed = (now.tv_sec - remote_config_time.tv_sec) * 1000000 +
+                       (now.tv_usec - remote_config_time.tv_usec);
+        if (elapsed >= REMOTE_CONFIG_SAVE_DELAY_US)
+        {
+            current_config.exposure = current_exposure;
+            current_config.gain = current_gain;
+            if (save_config_file(&current_config) == 0)
+            {
+                printf("Remote exposure %d and gain %d saved to config\n", current_exposure, current_gain);
+            }
+            remote_config_dirty = 0;
+        }
     }
 }
 
@@ -4750,6 +5257,9 @@ int init_camera_controls(void)
         printf("Warning: Failed to get gain control info\n");
     }
 
+    // 采集线程尚未启动，此前的帧按读回的值记录
+    sensor_active = (sensor_settings_t){0, current_exposure, current_gain};
+
     printf("Camera controls initialized successfully\n");
     return 0;
 }
@@ -4767,26 +5277,17 @@ void cleanup_camera_controls(void)
     }
 }
 
-/**
- * @brief 创建图片保存目录
- */
-int create_images_directory(void)
-{
-    // 创建根目录
-    if (mkdir(CONFIG_IMAGE_PATH, 0755) != 0 && errno != EEXIST)
-    {
-        printf("Error: Failed to create %s directory: %s\n", CONFIG_IMAGE_PATH, strerror(errno));
-        return -1;
-    }
-
-    return 0;
-}
-
 /**
  * @brief 生成照片文件名
+ * @details 同一秒内连续拍照时追加序号 (_2、_3 ...)，避免覆盖尚未写完或刚写完的照片
+ * @param width 保存的图像宽度 (配置裁剪时为裁剪区域宽度)
+ * @param height 保存的图像高度
  */
-char *generate_photo_filename(void)
+char *generate_photo_filename(int width, int height)
 {
+    static time_t last_second = 0;
+    static int same_second_count = 0;
+
     time_t now = time(NULL);
     struct tm *tm_info = localtime(&now);
 
@@ -4795,19 +5296,38 @@ char *generate_photo_filename(void)
     char timestamp[64];
     strftime(timestamp, sizeof(timestamp), "%H-%M-%S", tm_info);
 
+    same_second_count = (now == last_second) ? same_second_count + 1 : 1;
+    last_second = now;
+    char suffix[16] = "";
+    if (same_second_count > 1)
+    {
+        snprintf(suffix, sizeof(suffix), "_%d", same_second_count);
+    }
+
     // 构建包含分辨率的文件名，使用 .bin 扩展名表示16位解包数据
-    snprintf(filename, sizeof(filename), "%s/%04d-%02d-%02d_%s_%dx%d_16bit.bin",
+    snprintf(filename, sizeof(filename), "%s/%04d-%02d-%02d_%s%s_%dx%d_16bit.bin",
              CONFIG_IMAGE_PATH,
              tm_info->tm_year + CONFIG_TIME_BASE_YEAR,
              tm_info->tm_mon + CONFIG_TIME_BASE_MONTH,
              tm_info->tm_mday + CONFIG_TIME_BASE_DAY,
-             timestamp, camera_width, camera_height);
+             timestamp, suffix, width, height);
 
     return filename;
 }
 
+/**
+ * @brief 获取路径中的文件名部分
+ */
+static const char *photo_basename(const char *path)
+{
+    const char *basename = strrchr(path, '/');
+    return basename ? basename + 1 : path;
+}
+
 /**
  * @brief 捕获RAW格式照片
+ * @details 只取最新帧的引用并提交给后台保存线程，几毫秒内返回；
+ *          解包和写入在后台进行，完成后由 process_photo_results 显示结果
  */
 int capture_raw_photo(void)
 {
@@ -4817,188 +5337,89 @@ int capture_raw_photo(void)
         return -1;
     }
 
-    // 创建保存目录
-    if (create_images_directory() != 0)
+    // 从帧池取最新帧的引用：与显示、TCP发送共享同一缓冲区，不复制也不与采集线程竞争
+    frame_ref_t *ref = frame_pool_wait_newer(&frame_pool, 0, 5000); // 5秒超时
+    if (!ref)
     {
+        printf("Error: Failed to capture frame for photo\n");
         return -1;
     }
+    const media_frame_t frame = ref->frame;
 
-    // 生成文件名
-    char *filename = generate_photo_filename();
-
-    printf("Capturing photo to: %s\n", filename);
-    printf("Target resolution: %dx%d (RAW10 format)\n", camera_width, camera_height);
+    // 根据行跨度和帧大小确定数据布局并截取裁剪区域 (与预览、传输使用同一套规则)
+    raw_layout_t layout;
+    const uint8_t *roi_data;
+    size_t roi_size;
+    get_frame_roi(frame.data, frame.size, frame.width, frame.height, &layout, &roi_data, &roi_size);
 
-    // 捕获一帧
-    media_frame_t frame;
-    int result = -1;
-    bool is_frame_copy = false; // 标记是否为副本
-    
-    // 当TCP启用时，使用当前帧数据而不是重新捕获，避免与camera线程竞争
-    if (tcp_enabled)
+    size_t expected_size = layout.stride * (size_t)(layout.height - 1) +
+                           raw_layout_min_stride(layout.width, layout.bit_depth, layout.packing);
+    if (roi_size < expected_size)
     {
-        printf("TCP enabled - using current frame data to avoid resource conflict...\n");
-        
-        // 获取当前帧的副本，避免在TCP传输过程中被修改
-        pthread_mutex_lock(&frame_mutex);
-        if (current_frame.data && frame_available)
-        {
-            // 创建当前帧的副本
-            frame.data = malloc(current_frame.size);
-            if (frame.data)
-            {
-                memcpy(frame.data, current_frame.data, current_frame.size);
-                frame.size = current_frame.size;
-                frame.width = current_frame.width;
-                frame.height = current_frame.height;
-                frame.pixelformat = current_frame.pixelformat;
-                result = 0;
-                is_frame_copy = true; // 标记为副本
-                printf("Using current frame: %zu bytes (%dx%d)\n", 
-                       frame.size, frame.width, frame.height);
-            }
-            else
-            {
-                printf("Error: Failed to allocate memory for frame copy\n");
-                result = -1;
-            }
-        }
-        else
-        {
-            printf("Error: No current frame available\n");
-            result = -1;
-        }
-        pthread_mutex_unlock(&frame_mutex);
-    }
-    else
-    {
-        // TCP未启用时，直接捕获新帧
-        result = libmedia_session_capture_frame(media_session, &frame, 5000); // 5秒超时
-    }
-
-    if (result != 0)
-    {
-        printf("Error: Failed to capture frame for photo\n");
-        return -1;
-    }
-    // 验证帧数据尺寸是否与设置的分辨率匹配
-    size_t expected_size = camera_width * camera_height * 2; // RAW10 约2字节/像素
-    if (frame.size != expected_size)
-    {
-        printf("Warning: Frame size mismatch - expected %zu bytes (%dx%d*2), got %zu bytes\n",
-               expected_size, camera_width, camera_height, frame.size);
+        printf("Warning: Frame size mismatch - expected at least %zu bytes (%dx%d, stride %zu), got %zu bytes\n",
+               expected_size, layout.width, layout.height, layout.stride, roi_size);
         printf("Continuing with actual frame size...\n");
     }
-    else
-    {
-        printf("Frame size verified: %zu bytes (%dx%d RAW10)\n",
-               frame.size, camera_width, camera_height);
-    }
 
-    // 分配缓冲区用于解包的像素数据
-    size_t pixel_count = camera_width * camera_height;
-    uint16_t *unpacked_pixels = malloc(pixel_count * sizeof(uint16_t));
-    if (!unpacked_pixels)
+    // 生成文件名并提交 (成功后帧引用归后台线程所有，解包后即释放)；
+    // 文件名中的尺寸为实际保存的裁剪区域
+    char *filename = generate_photo_filename(layout.width, layout.height);
+    if (photo_writer_submit(&photo_writer, ref, &layout, roi_data, roi_size, filename) != 0)
     {
-        printf("Error: Failed to allocate memory for unpacked pixels\n");
-        if (is_frame_copy)
+        printf("Error: Photo not taken (photo writer unavailable or %d photos pending)\n",
+               photo_writer_pending(&photo_writer));
+        frame_pool_release(ref);
+        if (info_label)
         {
-            free(frame.data); // 释放副本内存
-        }
-        else
-        {
-            libmedia_session_release_frame(media_session, &frame);
+            lv_label_set_text(info_label, "Photo: busy, try again");
         }
         return -1;
     }
 
-    // 通过 unpack_sbggr10_image 解包RAW10数据
-    printf("Unpacking RAW10 data (%zu bytes) to 16-bit pixels...\n", frame.size);
-    int unpack_result = unpack_sbggr10_image((const uint8_t *)frame.data, frame.size,
-                                             unpacked_pixels, camera_width, camera_height);
+    printf("Capturing photo to: %s (%dx%d of %dx%d %s, %s, stride %zu)\n", filename, layout.width, layout.height,
+           frame.width, frame.height, camera_format->name, raw_packing_name(layout.packing), layout.stride);
 
-    if (unpack_result != 0)
+    // 显示简短的保存中提示，写完后由 process_photo_results 更新
+    if (info_label)
     {
-        printf("Error: Failed to unpack RAW10 data\n");
-        free(unpacked_pixels);
-        if (is_frame_copy)
-        {
-            free(frame.data); // 释放副本内存
-        }
-        else
-        {
-            libmedia_session_release_frame(media_session, &frame);
-        }
-        return -1;
+        static char photo_msg[128];
+        snprintf(photo_msg, sizeof(photo_msg), "Saving: %s", photo_basename(filename));
+        lv_label_set_text(info_label, photo_msg);
     }
 
-    printf("RAW10 data unpacked successfully to %zu 16-bit pixels\n", pixel_count);
+    return 0;
+}
 
-    // 保存解包后的16位像素数据到文件
-    FILE *file = fopen(filename, "wb");
-    if (!file)
+/**
+ * @brief 显示后台保存完成的照片 (主循环调用)
+ */
+void process_photo_results(void)
+{
+    photo_result_t result;
+    while (photo_writer_poll(&photo_writer, &result))
     {
-        printf("Error: Failed to create file %s: %s\n", filename, strerror(errno));
-        free(unpacked_pixels);
-        if (is_frame_copy)
+        if (result.status != 0)
         {
-            free(frame.data); // 释放副本内存
+            printf("Photo save failed: %s\n", result.path);
         }
-        else
-        {
-            libmedia_session_release_frame(media_session, &frame);
-        }
-        return -1;
-    }
 
-    // 写入解包后的像素数据
-    size_t data_size = pixel_count * sizeof(uint16_t);
-    size_t written = fwrite(unpacked_pixels, 1, data_size, file);
-    fclose(file);
-
-    // 释放缓冲区和帧
-    free(unpacked_pixels);
-    if (is_frame_copy)
-    {
-        free(frame.data); // 释放副本内存
-    }
-    else
-    {
-        libmedia_session_release_frame(media_session, &frame);
-    }
-
-    if (written != data_size)
-    {
-        printf("Error: Incomplete write to %s (wrote %zu of %zu bytes)\n",
-               filename, written, data_size);
-        unlink(filename); // 删除不完整的文件
-        return -1;
-    }
-
-    printf("Photo saved successfully: %s (%zu bytes, %dx%d 16-bit unpacked)\n",
-           filename, written, camera_width, camera_height);
-
-    // 显示简短的拍照成功提示
-    if (info_label)
-    {
-        static char photo_msg[128];
-        char *basename = strrchr(filename, '/');
-        if (basename)
-        {
-            basename++; // 跳过 '/'
-        }
-        else
+        if (info_label)
         {
-            basename = filename;
+            // 注意：这里简化处理，不使用定时器恢复信息显示
+            // 用户可以通过其他操作来刷新信息显示
+            static char photo_msg[128];
+            if (result.status == 0)
+            {
+                snprintf(photo_msg, sizeof(photo_msg), "Saved: %s (%dx%d)", photo_basename(result.path),
+                         result.width, result.height);
+            }
+            else
+            {
+                snprintf(photo_msg, sizeof(photo_msg), "Save failed: %s", photo_basename(result.path));
+            }
+            lv_label_set_text(info_label, photo_msg);
         }
-        snprintf(photo_msg, sizeof(photo_msg), "Photo: %s (%dx%d)", basename, camera_width, camera_height);
-        lv_label_set_text(info_label, photo_msg);
-
-        // 注意：这里简化处理，不使用定时器恢复信息显示
-        // 用户可以通过其他操作来刷新信息显示
     }
-
-    return 0;
 }
 
 /**
@@ -5053,6 +5474,198 @@ int load_config_file(mxcamera_config_t *config)
             {
                 config->crop_left = atoi(value);
             }
+            else if (strcmp(key, "crop_width") == 0)
+            {
+                config->crop_width = atoi(value);
+            }
+            else if (strcmp(key, "crop_height") == 0)
+            {
+                config->crop_height = atoi(value);
+            }
+            else if (strcmp(key, "pixel_format") == 0)
+            {
+                const raw_format_t *format = raw_format_find(value);
+                if (format)
+                {
+                    config->pixel_format = format;
+                }
+                else
+                {
+                    printf("Warning: Invalid pixel_format '%s', using %s\n", value, DEFAULT_PIXEL_FORMAT);
+                    config->pixel_format = raw_format_find(DEFAULT_PIXEL_FORMAT);
+                }
+            }
+            else if (strcmp(key, "raw_packing") == 0)
+            {
+                if (raw_packing_from_name(value, &config->raw_packing) != 0 ||
+                    config->raw_packing == RAW_PACKING_UNPACKED16)
+                {
+                    printf("Warning: Invalid raw_packing '%s', using rockchip\n", value);
+                    config->raw_packing = RAW_PACKING_ROCKCHIP;
+                }
+            }
+            else if (strcmp(key, "buffer_count") == 0)
+            {
+                config->buffer_count = atoi(value);
+                if (config->buffer_count < MIN_BUFFER_COUNT || config->buffer_count > MAX_BUFFER_COUNT)
+                {
+                    printf("Warning: buffer_count %d out of range [%d, %d], using %d\n",
+                           config->buffer_count, MIN_BUFFER_COUNT, MAX_BUFFER_COUNT, DEFAULT_BUFFER_COUNT);
+                    config->buffer_count = DEFAULT_BUFFER_COUNT;
+                }
+            }
+            else if (strcmp(key, "photo_buffers") == 0)
+            {
+                config->photo_buffers = atoi(value);
+                if (config->photo_buffers < 1 || config->photo_buffers > PHOTO_WRITER_MAX_BUFFERS)
+                {
+                    printf("Warning: photo_buffers %d out of range [1, %d], using %d\n",
+                           config->photo_buffers, PHOTO_WRITER_MAX_BUFFERS, DEFAULT_PHOTO_BUFFERS);
+                    config->photo_buffers = DEFAULT_PHOTO_BUFFERS;
+                }
+            }
+            else if (strcmp(key, "tcp_queue_depth") == 0)
+            {
+                config->tcp_queue_depth = atoi(value);
+                if (config->tcp_queue_depth < 1 || config->tcp_queue_depth > FRAME_QUEUE_MAX_DEPTH)
+                {
+                    printf("Warning: tcp_queue_depth %d out of range [1, %d], using %d\n",
+                           config->tcp_queue_depth, FRAME_QUEUE_MAX_DEPTH, DEFAULT_TCP_QUEUE_DEPTH);
+                    config->tcp_queue_depth = DEFAULT_TCP_QUEUE_DEPTH;
+                }
+            }
+            else if (strcmp(key, "tcp_queue_policy") == 0)
+            {
+                if (frame_queue_policy_from_name(value, &config->tcp_queue_policy) != 0)
+                {
+                    printf("Warning: Invalid tcp_queue_policy '%s', using drop-oldest\n", value);
+                    config->tcp_queue_policy = FRAME_QUEUE_DROP_OLDEST;
+                }
+            }
+            else if (strcmp(key, "tcp_zerocopy") == 0)
+            {
+                config->tcp_zerocopy = atoi(value);
+            }
+            else if (strcmp(key, "tcp_max_clients") == 0)
+            {
+                config->tcp_max_clients = atoi(value);
+                if (config->tcp_max_clients < 1 || config->tcp_max_clients > STREAM_SERVER_MAX_CLIENTS)
+                {
+                    printf("Warning: tcp_max_clients %d out of range [1, %d], using %d\n",
+                           config->tcp_max_clients, STREAM_SERVER_MAX_CLIENTS, DEFAULT_TCP_MAX_CLIENTS);
+                    config->tcp_max_clients = DEFAULT_TCP_MAX_CLIENTS;
+                }
+            }
+            else if (strcmp(key, "tcp_decimation") == 0)
+            {
+                config->tcp_decimation = atoi(value) > 0 ? atoi(value) : 1;
+            }
+            else if (strcmp(key, "tcp_compress") == 0)
+            {
+                config->tcp_compress = atoi(value);
+            }
+            else if (strcmp(key, "tcp_compand") == 0)
+            {
+                if (raw_compand_curve_from_name(value, &config->tcp_compand) != 0)
+                {
+                    printf("Warning: Invalid tcp_compand '%s', using off\n", value);
+                    config->tcp_compand = RAW_COMPAND_OFF;
+                }
+            }
+            else if (strcmp(key, "tcp_max_latency_ms") == 0)
+            {
+                config->tcp_max_latency_ms = atoi(value) > 0 ? atoi(value) : 0;
+            }
+            else if (strcmp(key, "tcp_adapt_compress") == 0)
+            {
+                config->tcp_adapt_compress = atoi(value);
+            }
+            else if (strcmp(key, "tcp_adapt_binning") == 0)
+            {
+                config->tcp_adapt_binning = atoi(value);
+            }
+            else if (strcmp(key, "tcp_spool_frames") == 0)
+            {
+                config->tcp_spool_frames = atoi(value);
+                if (config->tcp_spool_frames < 0 || config->tcp_spool_frames > STREAM_SPOOL_MAX_RAM)
+                {
+                    printf("Warning: tcp_spool_frames %d out of range [0, %d], spool disabled\n",
+                           config->tcp_spool_frames, STREAM_SPOOL_MAX_RAM);
+                    config->tcp_spool_frames = 0;
+                }
+            }
+            else if (strcmp(key, "tcp_spool_dir") == 0)
+            {
+                snprintf(config->tcp_spool_dir, sizeof(config->tcp_spool_dir), "%s", value);
+            }
+            else if (strcmp(key, "tcp_spool_disk_mb") == 0)
+            {
+                config->tcp_spool_disk_mb = atoi(value) > 0 ? atoi(value) : 0;
+            }
+            else if (strcmp(key, "tcp_spool_timeout_s") == 0)
+            {
+                config->tcp_spool_timeout_s = atoi(value) > 0 ? atoi(value) : DEFAULT_TCP_SPOOL_TIMEOUT_S;
+            }
+            else if (strcmp(key, "tcp_remote_control") == 0)
+            {
+                config->tcp_remote_control = atoi(value) ? 1 : 0;
+            }
+            else if (strcmp(key, "local_socket") == 0)
+            {
+                snprintf(config->local_socket, sizeof(config->local_socket), "%s", value);
+            }
+            else if (strcmp(key, "local_buffers") == 0)
+            {
+                config->local_buffers = atoi(value);
+                if (config->local_buffers < 2 || config->local_buffers > LOCAL_STREAM_MAX_BUFFERS)
+                {
+                    printf("Warning: local_buffers %d out of range [2, %d], using %d\n",
+                           config->local_buffers, LOCAL_STREAM_MAX_BUFFERS, DEFAULT_LOCAL_BUFFERS);
+                    config->local_buffers = DEFAULT_LOCAL_BUFFERS;
+                }
+            }
+            else if (strcmp(key, "local_max_held") == 0)
+            {
+                config->local_max_held = atoi(value) > 0 ? atoi(value) : DEFAULT_LOCAL_MAX_HELD;
+            }
+            else if (strcmp(key, "http_port") == 0)
+            {
+                config->http_port = atoi(value);
+                if (config->http_port < 0 || config->http_port > 65535)
+                {
+                    printf("Warning: http_port %d out of range [0, 65535], HTTP preview disabled\n",
+                           config->http_port);
+                    config->http_port = 0;
+                }
+            }
+            else if (strcmp(key, "http_width") == 0)
+            {
+                config->http_width = atoi(value) >= 16 ? atoi(value) : DEFAULT_HTTP_WIDTH;
+            }
+            else if (strcmp(key, "http_height") == 0)
+            {
+                config->http_height = atoi(value) >= 16 ? atoi(value) : DEFAULT_HTTP_HEIGHT;
+            }
+            else if (strcmp(key, "http_fps") == 0)
+            {
+                config->http_fps = atoi(value);
+                if (config->http_fps < 1 || config->http_fps > MJPEG_SERVER_MAX_FPS)
+                {
+                    printf("Warning: http_fps %d out of range [1, %d], using %d\n",
+                           config->http_fps, MJPEG_SERVER_MAX_FPS, DEFAULT_HTTP_FPS);
+                    config->http_fps = DEFAULT_HTTP_FPS;
+                }
+            }
+            else if (strcmp(key, "http_quality") == 0)
+            {
+                config->http_quality = atoi(value);
+                if (config->http_quality < 1 || config->http_quality > 100)
+                {
+                    printf("Warning: http_quality %d out of range [1, 100], using %d\n",
+                           config->http_quality, JPEG_QUALITY_DEFAULT);
+                    config->http_quality = JPEG_QUALITY_DEFAULT;
+                }
+            }
             else if (strcmp(key, "exposure") == 0)
             {
                 config->exposure = atoi(value);
@@ -5069,6 +5682,38 @@ int load_config_file(mxcamera_config_t *config)
             {
                 config->gain_step = atoi(value);
             }
+            else if (strcmp(key, "direct_blit") == 0)
+            {
+                config->direct_blit = atoi(value);
+            }
+            else if (strcmp(key, "preview_color") == 0)
+            {
+                config->preview_color = atoi(value);
+            }
+            else if (strcmp(key, "wb_red_gain") == 0)
+            {
+                config->wb_red_gain = atoi(value);
+            }
+            else if (strcmp(key, "wb_green_gain") == 0)
+            {
+                config->wb_green_gain = atoi(value);
+            }
+            else if (strcmp(key, "wb_blue_gain") == 0)
+            {
+                config->wb_blue_gain = atoi(value);
+            }
+            else if (strcmp(key, "black_level") == 0)
+            {
+                config->black_level = atoi(value);
+            }
+            else if (strcmp(key, "gamma") == 0)
+            {
+                config->gamma = strtof(value, NULL);
+            }
+            else if (strcmp(key, "contrast") == 0)
+            {
+                config->contrast = strtof(value, NULL);
+            }
         }
     }
 
@@ -5106,12 +5751,57 @@ int save_config_file(const mxcamera_config_t *config)
     fprintf(file, "camera_height = %d\n", config->camera_height);
     fprintf(file, "crop_top = %d\n", config->crop_top);
     fprintf(file, "crop_left = %d\n", config->crop_left);
+    fprintf(file, "crop_width = %d\n", config->crop_width);
+    fprintf(file, "crop_height = %d\n", config->crop_height);
+    fprintf(file, "pixel_format = \"%s\"\n", config->pixel_format->name);
+    fprintf(file, "raw_packing = \"%s\"\n", raw_packing_name(config->raw_packing));
+    fprintf(file, "buffer_count = %d\n", config->buffer_count);
+    fprintf(file, "photo_buffers = %d\n", config->photo_buffers);
     fprintf(file, "\n");
     fprintf(file, "[controls]\n");
     fprintf(file, "exposure = %d\n", config->exposure);
     fprintf(file, "gain = %d\n", config->gain);
     fprintf(file, "exposure_step = %d\n", config->exposure_step);
     fprintf(file, "gain_step = %d\n", config->gain_step);
+    fprintf(file, "\n");
+    fprintf(file, "[display]\n");
+    fprintf(file, "direct_blit = %d\n", config->direct_blit);
+    fprintf(file, "preview_color = %d\n", config->preview_color);
+    fprintf(file, "wb_red_gain = %d\n", config->wb_red_gain);
+    fprintf(file, "wb_green_gain = %d\n", config->wb_green_gain);
+    fprintf(file, "wb_blue_gain = %d\n", config->wb_blue_gain);
+    fprintf(file, "black_level = %d\n", config->black_level);
+    fprintf(file, "gamma = %.2f\n", (double)config->gamma);
+    fprintf(file, "contrast = %.2f\n", (double)config->contrast);
+    fprintf(file, "\n");
+    fprintf(file, "[network]\n");
+    fprintf(file, "tcp_queue_depth = %d\n", config->tcp_queue_depth);
+    fprintf(file, "tcp_queue_policy = \"%s\"\n", frame_queue_policy_name(config->tcp_queue_policy));
+    fprintf(file, "tcp_zerocopy = %d\n", config->tcp_zerocopy);
+    fprintf(file, "tcp_max_clients = %d\n", config->tcp_max_clients);
+    fprintf(file, "tcp_decimation = %d\n", config->tcp_decimation);
+    fprintf(file, "tcp_compress = %d\n", config->tcp_compress);
+    fprintf(file, "tcp_compand = \"%s\"\n", raw_compand_curve_name(config->tcp_compand));
+    fprintf(file, "tcp_max_latency_ms = %d\n", config->tcp_max_latency_ms);
+    fprintf(file, "tcp_adapt_compress = %d\n", config->tcp_adapt_compress);
+    fprintf(file, "tcp_adapt_binning = %d\n", config->tcp_adapt_binning);
+    fprintf(file, "tcp_spool_frames = %d\n", config->tcp_spool_frames);
+    fprintf(file, "tcp_spool_dir = \"%s\"\n", config->tcp_spool_dir);
+    fprintf(file, "tcp_spool_disk_mb = %d\n", config->tcp_spool_disk_mb);
+    fprintf(file, "tcp_spool_timeout_s = %d\n", config->tcp_spool_timeout_s);
+    fprintf(file, "tcp_remote_control = %d\n", config->tcp_remote_control);
+    fprintf(file, "\n");
+    fprintf(file, "[local]\n");
+    fprintf(file, "local_socket = \"%s\"\n", config->local_socket);
+    fprintf(file, "local_buffers = %d\n", config->local_buffers);
+    fprintf(file, "local_max_held = %d\n", config->local_max_held);
+    fprintf(file, "\n");
+    fprintf(file, "[http]\n");
+    fprintf(file, "http_port = %d\n", config->http_port);
+    fprintf(file, "http_width = %d\n", config->http_width);
+    fprintf(file, "http_height = %d\n", config->http_height);
+    fprintf(file, "http_fps = %d\n", config->http_fps);
+    fprintf(file, "http_quality = %d\n", config->http_quality);
 
     fclose(file);
     printf("Configuration saved to %s\n", CONFIG_FILE_PATH);
@@ -5133,6 +5823,47 @@ void apply_config(const mxcamera_config_t *config)
     // 应用裁剪参数
     crop_top = config->crop_top;
     crop_left = config->crop_left;
+    crop_width = config->crop_width;
+    crop_height = config->crop_height;
+
+    // 像素格式和打包数据排列方式 (16位非打包由帧大小自动识别)；
+    // 命令行 --format 只作用于本次运行，不被配置文件覆盖，也不写回配置文件
+    if (!format_from_command_line)
+    {
+        camera_format = config->pixel_format;
+    }
+    raw_packing = config->raw_packing;
+
+    // 缓冲区数量和发送队列在创建媒体会话时生效
+    buffer_count = config->buffer_count;
+    photo_buffers = config->photo_buffers;
+    tcp_queue_depth = config->tcp_queue_depth;
+    tcp_queue_policy = config->tcp_queue_policy;
+    tcp_zerocopy = config->tcp_zerocopy;
+    tcp_max_clients = config->tcp_max_clients;
+    tcp_decimation = config->tcp_decimation;
+    tcp_compress = config->tcp_compress;
+    tcp_compand = config->tcp_compand;
+    tcp_max_latency_ms = config->tcp_max_latency_ms;
+    tcp_adapt_compress = config->tcp_adapt_compress;
+    tcp_adapt_binning = config->tcp_adapt_binning;
+    tcp_spool_frames = config->tcp_spool_frames;
+    snprintf(tcp_spool_dir, sizeof(tcp_spool_dir), "%s", config->tcp_spool_dir);
+    tcp_spool_disk_mb = config->tcp_spool_disk_mb;
+    tcp_spool_timeout_s = config->tcp_spool_timeout_s;
+    tcp_remote_control = config->tcp_remote_control;
+
+    // 本机帧共享在启动时生效
+    snprintf(local_socket, sizeof(local_socket), "%s", config->local_socket);
+    local_buffers = config->local_buffers;
+    local_max_held = config->local_max_held;
+
+    // HTTP 预览在启动时生效
+    http_port = config->http_port;
+    http_width = config->http_width;
+    http_height = config->http_height;
+    http_fps = config->http_fps;
+    http_quality = config->http_quality;
 
     // 应用曝光和增益
     current_exposure = config->exposure;
@@ -5140,6 +5871,19 @@ void apply_config(const mxcamera_config_t *config)
     exposure_step = config->exposure_step;
     gain_step = config->gain_step;
 
+    // 帧缓冲直写在启动时生效
+    direct_blit = config->direct_blit;
+
+    // 应用预览参数 (增益范围由预览模块限制)
+    preview_params.mode = config->preview_color ? PREVIEW_MODE_COLOR : PREVIEW_MODE_GRAY;
+    preview_params.wb_red = config->wb_red_gain;
+    preview_params.wb_green = config->wb_green_gain;
+    preview_params.wb_blue = config->wb_blue_gain;
+    preview_params.black_level = config->black_level;
+    preview_params.gamma = config->gamma;
+    preview_params.contrast = config->contrast;
+    preview_set_params(&preview_ctx, &preview_params);
+
     // 更新菜单显示
     if (menu_visible)
     {
@@ -5163,10 +5907,47 @@ void init_default_config(mxcamera_config_t *config)
     config->camera_height = DEFAULT_CAMERA_HEIGHT;
     config->crop_top = 0;        // 默认不裁剪
     config->crop_left = 0;       // 默认不裁剪
+    config->crop_width = 0;      // 0: 到图像边缘
+    config->crop_height = 0;
+    config->pixel_format = raw_format_find(DEFAULT_PIXEL_FORMAT);
+    config->raw_packing = RAW_PACKING_ROCKCHIP;
+    config->buffer_count = DEFAULT_BUFFER_COUNT;
+    config->photo_buffers = DEFAULT_PHOTO_BUFFERS;
     config->exposure = 128;
     config->gain = 128;
     config->exposure_step = 16;
     config->gain_step = 32;
+    config->direct_blit = 0;     // 默认经LVGL图像控件显示
+    config->preview_color = 1;   // 默认彩色预览
+    config->wb_red_gain = PREVIEW_GAIN_UNITY;
+    config->wb_green_gain = PREVIEW_GAIN_UNITY;
+    config->wb_blue_gain = PREVIEW_GAIN_UNITY;
+    config->black_level = 0;
+    config->gamma = 2.2f;        // 线性RAW数据按显示伽马编码，提亮暗部
+    config->contrast = 1.0f;
+    config->tcp_queue_depth = DEFAULT_TCP_QUEUE_DEPTH;
+    config->tcp_queue_policy = FRAME_QUEUE_DROP_OLDEST; // 优先发送最新画面
+    config->tcp_zerocopy = 1;                           // 内核支持时零拷贝发送
+    config->tcp_max_clients = DEFAULT_TCP_MAX_CLIENTS;
+    config->tcp_decimation = 1;                         // 默认每帧都发送
+    config->tcp_compress = 0;                           // 默认发送原始数据
+    config->tcp_compand = RAW_COMPAND_OFF;              // 默认发送原始位深
+    config->tcp_max_latency_ms = DEFAULT_TCP_MAX_LATENCY_MS;
+    config->tcp_adapt_compress = 0;                     // 默认只靠抽帧降低码率
+    config->tcp_adapt_binning = 0;
+    config->tcp_spool_frames = 0;                       // 默认断线不缓存 (内存有限)
+    snprintf(config->tcp_spool_dir, sizeof(config->tcp_spool_dir), "%s", DEFAULT_TCP_SPOOL_DIR);
+    config->tcp_spool_disk_mb = DEFAULT_TCP_SPOOL_DISK_MB;
+    config->tcp_spool_timeout_s = DEFAULT_TCP_SPOOL_TIMEOUT_S;
+    config->tcp_remote_control = 1;
+    snprintf(config->local_socket, sizeof(config->local_socket), "%s", DEFAULT_LOCAL_SOCKET);
+    config->local_buffers = DEFAULT_LOCAL_BUFFERS;
+    config->local_max_held = DEFAULT_LOCAL_MAX_HELD;
+    config->http_port = DEFAULT_HTTP_PORT;
+    config->http_width = DEFAULT_HTTP_WIDTH;
+    config->http_height = DEFAULT_HTTP_HEIGHT;
+    config->http_fps = DEFAULT_HTTP_FPS;
+    config->http_quality = JPEG_QUALITY_DEFAULT;
 }
 
 /**
@@ -0,0 +1,725 @@
+/**
+ * @file mjpeg_server.c
+ * @brief HTTP MJPEG 预览服务器
+ * @details 单线程 epoll 事件循环：有流客户端或等待快照的客户端时按帧率定时取帧，
+ *          渲染和编码各一次后把同一份JPEG复制到每个客户端的发送缓冲区。
+ *          每个客户端同时只有一个待发部分，上一部分未发完时跳过新帧，
+ *          慢速链路上的客户端自动降低帧率而不增加延迟
+ */
+
+// 定义 GNU 扩展以支持 accept4
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#include "mjpeg_server.h"
+
+#define EVENT_LISTEN 0xFFFFFFF0u    // epoll 事件标识：监听套接字
+#define EVENT_WAKE 0xFFFFFFF1u      // epoll 事件标识：eventfd
+#define MAX_EVENTS 8
+#define REQUEST_TIMEOUT_MS 5000     // 连接后等待请求头的最长时间
+#define PART_HEADER_MAX 160         // multipart 部分头或响应头的最大长度
+#define SEND_BUFFER_BYTES 32768     // 客户端套接字发送缓冲区 (限制内核中排队的帧数)
+
+static const char stream_response[] =
+    "HTTP/1.0 200 OK\r\n"
+    "Content-Type: multipart/x-mixed-replace; boundary=" MJPEG_BOUNDARY "\r\n"
+    "Cache-Control: no-cache, no-store\r\n"
+    "Pragma: no-cache\r\n"
+    "Connection: close\r\n\r\n";
+
+static const char index_page[] =
+    "<!DOCTYPE html><html><head><title>mxCamera</title></head>"
+    "<body style=\"margin:0;background:#000\">"
+    "<img src=\"/stream\" style=\"display:block;margin:auto;max-width:100%\">"
+    "</body></html>\n";
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static uint64_t monotonic_ns(void);
+static void accept_clients(mjpeg_server_t *server);
+static void close_client(mjpeg_server_t *server, mjpeg_client_t *client, const char *reason);
+static void read_client(mjpeg_server_t *server, mjpeg_client_t *client);
+static void handle_request(mjpeg_server_t *server, mjpeg_client_t *client);
+static void respond(mjpeg_server_t *server, mjpeg_client_t *client, const char *status,
+                    const char *content_type, const void *body, size_t body_len);
+static int queue_output(mjpeg_client_t *client, const char *header, size_t header_len,
+                        const void *body, size_t body_len, const char *trailer);
+static void flush_client(mjpeg_server_t *server, mjpeg_client_t *client);
+static void set_writing(mjpeg_server_t *server, mjpeg_client_t *client, int writing);
+static int next_timeout_ms(const mjpeg_server_t *server, uint64_t now_ns);
+static void produce_frame(mjpeg_server_t *server);
+static void distribute_frame(mjpeg_server_t *server);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化服务器
+ */
+int mjpeg_server_init(mjpeg_server_t *server, const mjpeg_server_config_t *config)
+{
+    if (!server || !config || !config->source_fn || config->port <= 0 || config->port > 65535 ||
+        config->max_clients < 1 || config->max_clients > MJPEG_SERVER_MAX_CLIENTS ||
+        config->width < 16 || config->height < 16 || config->width > 65535 || config->height > 65535)
+    {
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    server->config = *config;
+    server->config.fps = config->fps < 1 ? 1 : (config->fps > MJPEG_SERVER_MAX_FPS ? MJPEG_SERVER_MAX_FPS : config->fps);
+    for (int i = 0; i < MJPEG_SERVER_MAX_CLIENTS; i++)
+    {
+        server->clients[i].fd = -1;
+    }
+    jpeg_encoder_init(&server->encoder, config->quality);
+
+    // 预览图和JPEG缓冲区一次分配；JPEG先按每像素一字节 (质量90以下的常见上限)，不足时再增大
+    server->image.max_width = config->width;
+    server->image.max_height = config->height;
+    server->image.pixels = malloc((size_t)config->width * (size_t)config->height * sizeof(uint16_t));
+    server->jpeg_capacity = (size_t)config->width * (size_t)config->height + 1024;
+    server->jpeg = malloc(server->jpeg_capacity);
+    if (!server->image.pixels || !server->jpeg)
+    {
+        printf("Error: Out of memory for HTTP preview buffers\n");
+        mjpeg_server_destroy(server);
+        return -1;
+    }
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0)
+    {
+        printf("Error: Failed to create HTTP socket: %s\n", strerror(errno));
+        mjpeg_server_destroy(server);
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)config->port);
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(server->listen_fd, MJPEG_SERVER_MAX_CLIENTS) < 0)
+    {
+        printf("Error: Failed to listen on HTTP port %d: %s\n", config->port, strerror(errno));
+        mjpeg_server_destroy(server);
+        return -1;
+    }
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server->epoll_fd < 0 || server->wake_fd < 0)
+    {
+        printf("Error: Failed to create HTTP server events: %s\n", strerror(errno));
+        mjpeg_server_destroy(server);
+        return -1;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN};
+    ev.data.u32 = EVENT_LISTEN;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &ev);
+    ev.data.u32 = EVENT_WAKE;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &ev);
+
+    printf("HTTP preview server: port %d, up to %dx%d at %d fps, JPEG quality %d\n",
+           config->port, config->width, config->height, server->config.fps, server->encoder.quality);
+    return 0;
+}
+
+/**
+ * @brief 运行事件循环
+ */
+void mjpeg_server_run(mjpeg_server_t *server)
+{
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t period_ns = 1000000000ULL / (uint64_t)server->config.fps;
+
+    while (!server->stop)
+    {
+        int n = epoll_wait(server->epoll_fd, events, MAX_EVENTS, next_timeout_ms(server, monotonic_ns()));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            printf("Error: epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n && !server->stop; i++)
+        {
+            uint32_t tag = events[i].data.u32;
+
+            if (tag == EVENT_LISTEN)
+            {
+                accept_clients(server);
+                continue;
+            }
+
+            if (tag == EVENT_WAKE)
+            {
+                uint64_t count;
+                while (read(server->wake_fd, &count, sizeof(count)) > 0)
+                {
+                }
+                continue;
+            }
+
+            if (tag >= MJPEG_SERVER_MAX_CLIENTS || server->clients[tag].fd < 0)
+            {
+                continue;
+            }
+
+            mjpeg_client_t *client = &server->clients[tag];
+            // 断开和错误也由读取发现 (recv 返回0或错误码)
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            {
+                read_client(server, client);
+            }
+            if (client->fd >= 0 && (events[i].events & EPOLLOUT))
+            {
+                flush_client(server, client);
+            }
+        }
+
+        // 按帧率取帧 (没有等待图像的客户端时 next_timeout_ms 不会唤醒这里)
+        uint64_t now = monotonic_ns();
+        for (int i = 0; i < MJPEG_SERVER_MAX_CLIENTS; i++)
+        {
+            mjpeg_client_t *client = &server->clients[i];
+            if (client->fd >= 0 && client->state == MJPEG_CLIENT_REQUEST &&
+                now - client->accepted_ns > REQUEST_TIMEOUT_MS * 1000000ULL)
+            {
+                close_client(server, client, "request timeout");
+            }
+        }
+        if (next_timeout_ms(server, now) == 0 && !server->stop)
+        {
+            produce_frame(server);
+            server->next_frame_ns += period_ns;
+            if (server->next_frame_ns <= now)
+            {
+                server->next_frame_ns = now + period_ns; // 空闲后或渲染超时后重新对齐
+            }
+        }
+    }
+}
+
+/**
+ * @brief 请求事件循环退出
+ */
+void mjpeg_server_stop(mjpeg_server_t *server)
+{
+    server->stop = 1;
+    if (server->wake_fd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+/**
+ * @brief 断开所有客户端并释放资源
+ */
+void mjpeg_server_destroy(mjpeg_server_t *server)
+{
+    if (!server)
+    {
+        return;
+    }
+
+    for (int i = 0; i < MJPEG_SERVER_MAX_CLIENTS; i++)
+    {
+        if (server->clients[i].fd >= 0)
+        {
+            close_client(server, &server->clients[i], "server stopped");
+        }
+        free(server->clients[i].out);
+        server->clients[i].out = NULL;
+    }
+
+    if (server->encoded > 0)
+    {
+        printf("HTTP preview: %u frames encoded, average %.2f ms and %.1f KB per frame\n", server->encoded,
+               (double)server->encode_ns / server->encoded / 1e6,
+               (double)server->jpeg_bytes / server->encoded / 1024.0);
+    }
+
+    if (server->epoll_fd >= 0)
+    {
+        close(server->epoll_fd);
+    }
+    if (server->wake_fd >= 0)
+    {
+        close(server->wake_fd);
+    }
+    if (server->listen_fd >= 0)
+    {
+        close(server->listen_fd);
+    }
+    free(server->image.pixels);
+    free(server->jpeg);
+    server->image.pixels = NULL;
+    server->jpeg = NULL;
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+}
+
+/**
+ * @brief 按源图宽高比计算放入预览范围的最大尺寸
+ */
+void mjpeg_fit_size(int src_width, int src_height, int max_width, int max_height, int *width, int *height)
+{
+    if (src_width <= 0 || src_height <= 0)
+    {
+        *width = max_width;
+        *height = max_height;
+        return;
+    }
+
+    if ((int64_t)src_width * max_height > (int64_t)src_height * max_width)
+    {
+        *width = max_width;
+        *height = (int)((int64_t)src_height * max_width / src_width);
+    }
+    else
+    {
+        *height = max_height;
+        *width = (int)((int64_t)src_width * max_height / src_height);
+    }
+    *width = *width < 1 ? 1 : *width;
+    *height = *height < 1 ? 1 : *height;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 接受所有排队的连接
+ */
+static void accept_clients(mjpeg_server_t *server)
+{
+    for (;;)
+    {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(server->listen_fd, (struct sockaddr *)&addr, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                printf("Error: HTTP accept failed: %s\n", strerror(errno));
+            }
+            return;
+        }
+
+        int index = 0;
+        while (index < server->config.max_clients && server->clients[index].fd >= 0)
+        {
+            index++;
+        }
+        if (index == server->config.max_clients)
+        {
+            printf("HTTP preview client rejected: %d clients connected\n", server->client_count);
+            close(fd);
+            continue;
+        }
+
+        // 每个部分一次写完，不等待合并；发送缓冲区较小时慢速客户端在服务器侧跳帧，
+        // 而不是在内核中积压几秒的图像
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        int sndbuf = SEND_BUFFER_BYTES;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+        mjpeg_client_t *client = &server->clients[index];
+        client->fd = fd;
+        client->id = ++server->next_id;
+        client->state = MJPEG_CLIENT_REQUEST;
+        client->accepted_ns = monotonic_ns();
+        client->request_len = 0;
+        client->out_len = 0;
+        client->out_sent = 0;
+        client->writing = 0;
+        client->frames = 0;
+        client->skipped = 0;
+        server->client_count++;
+
+        struct epoll_event ev = {.events = EPOLLIN};
+        ev.data.u32 = (uint32_t)index;
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+/**
+ * @brief 关闭客户端 (保留发送缓冲区供下一个连接使用)
+ */
+static void close_client(mjpeg_server_t *server, mjpeg_client_t *client, const char *reason)
+{
+    if (client->state == MJPEG_CLIENT_STREAM)
+    {
+        printf("HTTP preview client %d closed (%s): %u frames sent, %u skipped\n",
+               client->id, reason, client->frames, client->skipped);
+    }
+
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    server->client_count--;
+}
+
+/**
+ * @brief 读取客户端数据：请求阶段累积请求头，之后的输入丢弃 (只检测断开)
+ */
+static void read_client(mjpeg_server_t *server, mjpeg_client_t *client)
+{
+    for (;;)
+    {
+        char discard[256];
+        char *dst = discard;
+        size_t room = sizeof(discard);
+        if (client->state == MJPEG_CLIENT_REQUEST)
+        {
+            dst = client->request + client->request_len;
+            room = sizeof(client->request) - 1 - client->request_len;
+            if (room == 0)
+            {
+                respond(server, client, "400 Bad Request", "text/plain", "Request too large\n", 18);
+                return;
+            }
+        }
+
+        ssize_t n = recv(client->fd, dst, room, 0);
+        if (n == 0)
+        {
+            close_client(server, client, "closed by peer");
+            return;
+        }
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                close_client(server, client, strerror(errno));
+            }
+            return;
+        }
+
+        if (client->state == MJPEG_CLIENT_REQUEST)
+        {
+            client->request_len += (size_t)n;
+            client->request[client->request_len] = '\0';
+            if (strstr(client->request, "\r\n\r\n") || strstr(client->request, "\n\n"))
+            {
+                handle_request(server, client);
+                if (client->fd < 0)
+                {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief 解析请求行并按路径响应
+ */
+static void handle_request(mjpeg_server_t *server, mjpeg_client_t *client)
+{
+    char method[8];
+    char path[128];
+    if (sscanf(client->request, "%7s %127s", method, path) != 2)
+    {
+        respond(server, client, "400 Bad Request", "text/plain", "Bad request\n", 12);
+        return;
+    }
+    char *query = strchr(path, '?');
+    if (query)
+    {
+        *query = '\0';
+    }
+
+    if (strcmp(method, "GET") != 0)
+    {
+        respond(server, client, "405 Method Not Allowed", "text/plain", "Only GET is supported\n", 22);
+        return;
+    }
+
+    if (strcmp(path, "/stream") == 0 || strcmp(path, "/stream.mjpg") == 0)
+    {
+        client->state = MJPEG_CLIENT_STREAM;
+        printf("HTTP preview client %d streaming\n", client->id);
+        queue_output(client, stream_response, sizeof(stream_response) - 1, NULL, 0, NULL);
+        flush_client(server, client);
+    }
+    else if (strcmp(path, "/snapshot") == 0 || strcmp(path, "/snapshot.jpg") == 0)
+    {
+        client->state = MJPEG_CLIENT_SNAPSHOT; // 下一次取帧时响应
+    }
+    else if (strcmp(path, "/") == 0 || strcmp(path, "/index.html") == 0)
+    {
+        respond(server, client, "200 OK", "text/html", index_page, sizeof(index_page) - 1);
+    }
+    else
+    {
+        respond(server, client, "404 Not Found", "text/plain", "Not found\n", 10);
+    }
+}
+
+/**
+ * @brief 发送完整响应后关闭连接
+ */
+static void respond(mjpeg_server_t *server, mjpeg_client_t *client, const char *status,
+                    const char *content_type, const void *body, size_t body_len)
+{
+    char header[PART_HEADER_MAX];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                              "Cache-Control: no-cache\r\nConnection: close\r\n\r\n",
+                              status, content_type, body_len);
+
+    client->state = MJPEG_CLIENT_CLOSING;
+    if (queue_output(client, header, (size_t)header_len, body, body_len, NULL) != 0)
+    {
+        close_client(server, client, "out of memory");
+        return;
+    }
+    flush_client(server, client);
+}
+
+/**
+ * @brief 把头部、正文和结尾拼接到客户端的发送缓冲区 (此前的数据应已发完)
+ * @return 0成功，-1内存不足
+ */
+static int queue_output(mjpeg_client_t *client, const char *header, size_t header_len,
+                        const void *body, size_t body_len, const char *trailer)
+{
+    size_t trailer_len = trailer ? strlen(trailer) : 0;
+    size_t total = header_len + body_len + trailer_len;
+    if (total > client->out_capacity)
+    {
+        uint8_t *grown = realloc(client->out, total);
+        if (!grown)
+        {
+            return -1;
+        }
+        client->out = grown;
+        client->out_capacity = total;
+    }
+
+    memcpy(client->out, header, header_len);
+    if (body_len)
+    {
+        memcpy(client->out + header_len, body, body_len);
+    }
+    if (trailer_len)
+    {
+        memcpy(client->out + header_len + body_len, trailer, trailer_len);
+    }
+    client->out_len = total;
+    client->out_sent = 0;
+    return 0;
+}
+
+/**
+ * @brief 尽量发送待发数据；套接字满时等待可写事件，发完后按状态关闭连接
+ */
+static void flush_client(mjpeg_server_t *server, mjpeg_client_t *client)
+{
+    while (client->out_sent < client->out_len)
+    {
+        ssize_t n = send(client->fd, client->out + client->out_sent, client->out_len - client->out_sent,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                set_writing(server, client, 1);
+                return;
+            }
+            close_client(server, client, strerror(errno));
+            return;
+        }
+        client->out_sent += (size_t)n;
+    }
+
+    client->out_len = 0;
+    client->out_sent = 0;
+    set_writing(server, client, 0);
+    if (client->state == MJPEG_CLIENT_CLOSING)
+    {
+        shutdown(client->fd, SHUT_WR);
+        close_client(server, client, "response sent");
+    }
+}
+
+/**
+ * @brief 开启或关闭可写事件
+ */
+static void set_writing(mjpeg_server_t *server, mjpeg_client_t *client, int writing)
+{
+    if (client->writing == writing)
+    {
+        return;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN | (writing ? EPOLLOUT : 0)};
+    ev.data.u32 = (uint32_t)(client - server->clients);
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+    client->writing = writing;
+}
+
+/**
+ * @brief 距下一次取帧的等待时间
+ * @return 毫秒数；有客户端在等待请求头时最多1秒 (检查超时)，没有任何客户端时为-1
+ */
+static int next_timeout_ms(const mjpeg_server_t *server, uint64_t now_ns)
+{
+    int waiting = 0;
+    int requests = 0;
+    for (int i = 0; i < MJPEG_SERVER_MAX_CLIENTS; i++)
+    {
+        const mjpeg_client_t *client = &server->clients[i];
+        if (client->fd < 0)
+        {
+            continue;
+        }
+        waiting |= client->state == MJPEG_CLIENT_STREAM || client->state == MJPEG_CLIENT_SNAPSHOT;
+        requests |= client->state == MJPEG_CLIENT_REQUEST;
+    }
+
+    if (waiting)
+    {
+        if (server->next_frame_ns <= now_ns)
+        {
+            return 0;
+        }
+        return (int)((server->next_frame_ns - now_ns + 999999) / 1000000);
+    }
+    return requests ? 1000 : -1;
+}
+
+/**
+ * @brief 取最新帧，渲染并编码一次后发给各客户端
+ */
+static void produce_frame(mjpeg_server_t *server)
+{
+    uint64_t start = monotonic_ns();
+    mjpeg_image_t *image = &server->image;
+    image->width = 0;
+    image->height = 0;
+    image->gray = 0;
+    if (server->config.source_fn(image, server->config.source_user) <= 0 || image->width <= 0 ||
+        image->height <= 0 || image->width > image->max_width || image->height > image->max_height)
+    {
+        return;
+    }
+
+    size_t size = jpeg_encode_rgb565(&server->encoder, image->pixels, image->max_width, image->width,
+                                     image->height, image->gray, server->jpeg, server->jpeg_capacity);
+    if (size == 0)
+    {
+        // 高质量或噪声大的图像超出初始缓冲区：增大到最坏情况后重新编码
+        size_t bound = jpeg_encoder_bound(image->width, image->height, image->gray);
+        uint8_t *grown = bound > server->jpeg_capacity ? realloc(server->jpeg, bound) : NULL;
+        if (grown)
+        {
+            server->jpeg = grown;
+            server->jpeg_capacity = bound;
+            size = jpeg_encode_rgb565(&server->encoder, image->pixels, image->max_width, image->width,
+                                      image->height, image->gray, server->jpeg, server->jpeg_capacity);
+        }
+        if (size == 0)
+        {
+            printf("Error: Failed to encode HTTP preview frame\n");
+            return;
+        }
+    }
+
+    server->jpeg_size = size;
+    server->last_sequence = image->sequence;
+    server->encoded++;
+    server->encode_ns += monotonic_ns() - start;
+    server->jpeg_bytes += size;
+    distribute_frame(server);
+}
+
+/**
+ * @brief 把最近一帧JPEG发给空闲的流客户端和等待快照的客户端
+ */
+static void distribute_frame(mjpeg_server_t *server)
+{
+    for (int i = 0; i < MJPEG_SERVER_MAX_CLIENTS; i++)
+    {
+        mjpeg_client_t *client = &server->clients[i];
+        if (client->fd < 0)
+        {
+            continue;
+        }
+
+        char header[PART_HEADER_MAX];
+        int header_len;
+        if (client->state == MJPEG_CLIENT_STREAM)
+        {
+            if (client->out_sent < client->out_len)
+            {
+                client->skipped++; // 上一部分还在发送，只发最新的图像
+                continue;
+            }
+            header_len = snprintf(header, sizeof(header),
+                                  "--" MJPEG_BOUNDARY "\r\nContent-Type: image/jpeg\r\n"
+                                  "Content-Length: %zu\r\nX-Frame-Sequence: %u\r\n\r\n",
+                                  server->jpeg_size, server->last_sequence);
+            if (queue_output(client, header, (size_t)header_len, server->jpeg, server->jpeg_size, "\r\n") != 0)
+            {
+                close_client(server, client, "out of memory");
+                continue;
+            }
+            client->frames++;
+            flush_client(server, client);
+        }
+        else if (client->state == MJPEG_CLIENT_SNAPSHOT)
+        {
+            respond(server, client, "200 OK", "image/jpeg", server->jpeg, server->jpeg_size);
+        }
+    }
+}
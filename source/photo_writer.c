@@ -0,0 +1,444 @@
+/**
+ * @file photo_writer.c
+ * @brief 后台拍照保存模块
+ * @details 界面线程只在锁内登记照片；解包和写入都在后台线程中进行。
+ *          照片状态只有后台线程会从等待解包推进到之后的状态，提交只占用空闲的照片，
+ *          因此解包和写入期间不持有锁。照片数很少，按提交顺序线性查找最早的一张
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "photo_writer.h"
+
+#define NS_PER_MS 1000000ULL
+#define WRITE_CHUNK_BYTES (1024 * 1024) // 每次写入的字节数 (块之间解包新提交的照片)
+
+/**
+ * @brief 照片状态
+ */
+typedef enum {
+    JOB_FREE = 0,           // 空闲 (缓冲区可用)
+    JOB_QUEUED,             // 持有帧引用，等待解包
+    JOB_READY,              // 已解包到缓冲区，等待写入
+    JOB_WRITING,            // 写入中
+} job_state_t;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void *writer_thread_main(void *arg);
+static int oldest_job_locked(photo_writer_t *writer, int state);
+static void unpack_queued(photo_writer_t *writer);
+static void write_job(photo_writer_t *writer, int index);
+static int write_file(photo_writer_t *writer, const char *path, const void *data, size_t size);
+static void finish_job_locked(photo_writer_t *writer, int index, int status, size_t size);
+static uint64_t monotonic_ns(void);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 分配缓冲区并启动后台线程
+ */
+int photo_writer_init(photo_writer_t *writer, const photo_writer_config_t *config)
+{
+    if (!writer || !config || config->buffers < 1 || config->buffers > PHOTO_WRITER_MAX_BUFFERS ||
+        config->buffer_size == 0)
+    {
+        return -1;
+    }
+
+    memset(writer, 0, sizeof(*writer));
+    writer->config = *config;
+    writer->config.dir[sizeof(writer->config.dir) - 1] = '\0';
+
+    // 缓冲区一次分配好，拍照时不再申请大块内存
+    for (int i = 0; i < config->buffers; i++)
+    {
+        writer->buffers[i] = malloc(config->buffer_size);
+        if (!writer->buffers[i])
+        {
+            printf("Error: Failed to allocate %zu bytes for photo buffer %d\n", config->buffer_size, i);
+            for (int j = 0; j < i; j++)
+            {
+                free(writer->buffers[j]);
+                writer->buffers[j] = NULL;
+            }
+            return -1;
+        }
+    }
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+
+    if (pthread_create(&writer->thread, NULL, writer_thread_main, writer) != 0)
+    {
+        printf("Error: Failed to create photo writer thread\n");
+        for (int i = 0; i < config->buffers; i++)
+        {
+            free(writer->buffers[i]);
+            writer->buffers[i] = NULL;
+        }
+        pthread_cond_destroy(&writer->cond);
+        pthread_mutex_destroy(&writer->lock);
+        return -1;
+    }
+    writer->thread_started = 1;
+
+    printf("Photo writer: %d buffers of %zu KB, saving to %s\n", config->buffers, config->buffer_size / 1024,
+           config->dir);
+    return 0;
+}
+
+/**
+ * @brief 写完已提交的照片，停止后台线程并释放缓冲区
+ */
+void photo_writer_destroy(photo_writer_t *writer)
+{
+    if (!writer || !writer->thread_started)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    int pending = 0;
+    for (int i = 0; i < writer->config.buffers; i++)
+    {
+        pending += writer->jobs[i].state != JOB_FREE;
+    }
+    if (pending > 0)
+    {
+        printf("Photo writer: finishing %d pending photos...\n", pending);
+    }
+    writer->stop = 1;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+    writer->thread_started = 0;
+
+    printf("Photo writer: %u saved, %u failed, %u rejected (all buffers busy)\n", writer->saved, writer->failed,
+           writer->rejected);
+
+    for (int i = 0; i < PHOTO_WRITER_MAX_BUFFERS; i++)
+    {
+        free(writer->buffers[i]);
+        writer->buffers[i] = NULL;
+    }
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+}
+
+/**
+ * @brief 提交一张照片
+ */
+int photo_writer_submit(photo_writer_t *writer, frame_ref_t *ref, const raw_layout_t *layout,
+                        const uint8_t *data, size_t size, const char *path)
+{
+    if (!writer || !writer->thread_started || !ref || !layout || !data || !path)
+    {
+        return -1;
+    }
+    if ((size_t)layout->width * (size_t)layout->height * sizeof(uint16_t) > writer->config.buffer_size)
+    {
+        printf("Error: Photo %dx%d exceeds the %zu byte photo buffer\n", layout->width, layout->height,
+               writer->config.buffer_size);
+        return -1;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    int index = -1;
+    for (int i = 0; i < writer->config.buffers; i++)
+    {
+        if (writer->jobs[i].state == JOB_FREE)
+        {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0 || writer->stop)
+    {
+        writer->rejected++;
+        pthread_mutex_unlock(&writer->lock);
+        return -1;
+    }
+
+    photo_job_t *job = &writer->jobs[index];
+    job->state = JOB_QUEUED;
+    job->order = writer->next_order++;
+    job->ref = ref;
+    job->layout = *layout;
+    job->data = data;
+    job->size = size;
+    job->submit_ns = monotonic_ns();
+    job->sequence = ref->meta.sequence;
+    snprintf(job->path, sizeof(job->path), "%s", path);
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+    return 0;
+}
+
+/**
+ * @brief 取出一个保存结果
+ */
+int photo_writer_poll(photo_writer_t *writer, photo_result_t *result)
+{
+    if (!writer || !writer->thread_started || __atomic_load_n(&writer->result_count, __ATOMIC_RELAXED) == 0)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    int found = writer->result_count > 0;
+    if (found)
+    {
+        *result = writer->results[writer->result_head];
+        writer->result_head = (writer->result_head + 1) % PHOTO_WRITER_RESULTS;
+        writer->result_count--;
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return found;
+}
+
+/**
+ * @brief 获取等待保存的照片数
+ */
+int photo_writer_pending(photo_writer_t *writer)
+{
+    if (!writer || !writer->thread_started)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    int pending = 0;
+    for (int i = 0; i < writer->config.buffers; i++)
+    {
+        pending += writer->jobs[i].state != JOB_FREE;
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return pending;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 后台线程：先解包全部等待的照片 (尽快释放帧引用)，再按提交顺序写入
+ */
+static void *writer_thread_main(void *arg)
+{
+    photo_writer_t *writer = arg;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;)
+    {
+        if (oldest_job_locked(writer, JOB_QUEUED) >= 0)
+        {
+            pthread_mutex_unlock(&writer->lock);
+            unpack_queued(writer);
+            pthread_mutex_lock(&writer->lock);
+            continue;
+        }
+
+        int index = oldest_job_locked(writer, JOB_READY);
+        if (index >= 0)
+        {
+            writer->jobs[index].state = JOB_WRITING;
+            pthread_mutex_unlock(&writer->lock);
+            write_job(writer, index);
+            pthread_mutex_lock(&writer->lock);
+            continue;
+        }
+
+        // 停止时已提交的照片都已写完
+        if (writer->stop)
+        {
+            break;
+        }
+        pthread_cond_wait(&writer->cond, &writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+/**
+ * @brief 查找指定状态下最早提交的照片
+ * @return 照片下标，没有时返回-1
+ */
+static int oldest_job_locked(photo_writer_t *writer, int state)
+{
+    int oldest = -1;
+    for (int i = 0; i < writer->config.buffers; i++)
+    {
+        if (writer->jobs[i].state == state &&
+            (oldest < 0 || (int32_t)(writer->jobs[i].order - writer->jobs[oldest].order) < 0))
+        {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief 解包全部等待解包的照片并释放其帧引用 (后台线程调用，不持有锁)
+ */
+static void unpack_queued(photo_writer_t *writer)
+{
+    for (;;)
+    {
+        pthread_mutex_lock(&writer->lock);
+        int index = oldest_job_locked(writer, JOB_QUEUED);
+        pthread_mutex_unlock(&writer->lock);
+        if (index < 0)
+        {
+            return;
+        }
+
+        // 提交只占用空闲的照片，状态为等待解包时内容不会被修改
+        photo_job_t *job = &writer->jobs[index];
+        int result = raw_decode_image(&job->layout, job->data, job->size, writer->buffers[index]);
+        frame_pool_release(job->ref);
+
+        pthread_mutex_lock(&writer->lock);
+        job->ref = NULL;
+        job->data = NULL;
+        if (result == 0)
+        {
+            job->state = JOB_READY;
+        }
+        else
+        {
+            printf("Error: Failed to unpack RAW data for %s\n", job->path);
+            finish_job_locked(writer, index, -1, 0);
+        }
+        pthread_mutex_unlock(&writer->lock);
+    }
+}
+
+/**
+ * @brief 把一张已解包的照片写入文件 (后台线程调用，不持有锁)
+ */
+static void write_job(photo_writer_t *writer, int index)
+{
+    photo_job_t *job = &writer->jobs[index];
+    size_t size = (size_t)job->layout.width * (size_t)job->layout.height * sizeof(uint16_t);
+
+    // 存储卡可能在USB配置切换时被重新挂载，每次写入前确保目录存在
+    int status = 0;
+    if (mkdir(writer->config.dir, 0755) != 0 && errno != EEXIST)
+    {
+        printf("Error: Failed to create %s directory: %s\n", writer->config.dir, strerror(errno));
+        status = -1;
+    }
+    else
+    {
+        status = write_file(writer, job->path, writer->buffers[index], size);
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    finish_job_locked(writer, index, status, status == 0 ? size : 0);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+/**
+ * @brief 分块写入文件并落盘，块之间解包新提交的照片
+ * @return 0成功，-1失败 (不完整的文件已删除)
+ */
+static int write_file(photo_writer_t *writer, const char *path, const void *data, size_t size)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        printf("Error: Failed to create file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    const uint8_t *p = data;
+    size_t written = 0;
+    while (written < size)
+    {
+        size_t chunk = size - written < WRITE_CHUNK_BYTES ? size - written : WRITE_CHUNK_BYTES;
+        ssize_t n = write(fd, p + written, chunk);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        written += (size_t)n;
+
+        // 慢速存储上一次写入可能持续数百毫秒，期间新提交的帧不应一直占用帧池
+        unpack_queued(writer);
+    }
+
+    // 提示"已保存"前确保数据已写入存储 (USB大容量存储模式下主机直接读取分区)
+    int synced = written == size && fsync(fd) == 0;
+    close(fd);
+
+    if (written != size || !synced)
+    {
+        printf("Error: Incomplete write to %s (wrote %zu of %zu bytes): %s\n", path, written, size,
+               strerror(errno));
+        unlink(path); // 删除不完整的文件
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 记录保存结果并释放照片的缓冲区
+ */
+static void finish_job_locked(photo_writer_t *writer, int index, int status, size_t size)
+{
+    photo_job_t *job = &writer->jobs[index];
+
+    // 界面线程长时间不取结果时丢弃最早的结果
+    if (writer->result_count == PHOTO_WRITER_RESULTS)
+    {
+        writer->result_head = (writer->result_head + 1) % PHOTO_WRITER_RESULTS;
+        writer->result_count--;
+    }
+    photo_result_t *result = &writer->results[(writer->result_head + writer->result_count) % PHOTO_WRITER_RESULTS];
+    memcpy(result->path, job->path, sizeof(result->path));
+    result->status = status;
+    result->width = job->layout.width;
+    result->height = job->layout.height;
+    result->size = size;
+    result->sequence = job->sequence;
+    result->elapsed_ms = (int)((monotonic_ns() - job->submit_ns) / NS_PER_MS);
+    __atomic_store_n(&writer->result_count, writer->result_count + 1, __ATOMIC_RELAXED);
+
+    if (status == 0)
+    {
+        writer->saved++;
+        printf("Photo saved successfully: %s (%zu bytes, %dx%d 16-bit unpacked, %d ms)\n", job->path, size,
+               job->layout.width, job->layout.height, result->elapsed_ms);
+    }
+    else
+    {
+        writer->failed++;
+    }
+    job->state = JOB_FREE;
+}
+
+/**
+ * @brief 获取单调时钟 (纳秒)
+ */
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
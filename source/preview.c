@@ -0,0 +1,588 @@
+/**
+ * @file preview.c
+ * @brief 预览渲染模块
+ * @details 融合预览内核：逐行解包源数据并直接写出RGB565，
+ *          不再需要整帧解包缓冲区和中间缩放/转换缓冲区。
+ *          缩放为可分离的定点面积平均：每个输出行覆盖的源行用 raw_decode_row
+ *          解包 (使用当前的NEON/标量内核) 后逐列累加到行缓冲区，
+ *          再按每个输出列覆盖的源列区间求和，乘以面积的定点倒数归一化。
+ *          每个源行只解包一次，区间表在尺寸变化时预先计算。
+ *          彩色模式下以Bayer四元组为单位累加三个通道，
+ *          GBRG/GRBG 从奇数行开始取四元组，转换为 RGGB/BGGR，
+ *          RGGB 与 BGGR 只是红蓝查找表互换，累加循环与Bayer排列无关。
+ *          RAW8/RAW12 在归一化时换算到10位，与RAW10共用查找表。
+ *          黑电平/伽马/对比度/白平衡折算进每通道1024项查找表，
+ *          参数变化时才重建，每个输出像素每通道只需一次查表。
+ *          行地址按布局中的 stride 计算，行尾填充不影响解包
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "preview.h"
+
+// ============================================================================
+// 常量定义
+// ============================================================================
+
+#define RAW10_MAX_VALUE 1023  // 10位像素最大值
+
+// 色调参数有效范围
+#define GAMMA_MIN 0.1f
+#define GAMMA_MAX 10.0f
+#define CONTRAST_MIN 0.0f
+#define CONTRAST_MAX 10.0f
+
+#define RECIP_SHIFT 31        // 归一化倒数的定点位数 (面积为1时倒数仍可用32位表示)
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static int prepare_tables(preview_context_t *ctx, const raw_layout_t *layout,
+                          int dst_width, int dst_height);
+static void free_tables(preview_context_t *ctx);
+static int clamp_gain(int gain);
+static void sanitize_params(preview_params_t *params);
+static void build_luts(preview_context_t *ctx);
+static float tone_curve(const preview_params_t *params, int value, int gain);
+static void compute_span(int index, int src_size, int dst_size, uint32_t *start, uint16_t *count);
+static uint32_t area_recip(uint32_t area);
+static void accumulate_gray(const preview_context_t *ctx, const raw_layout_t *layout,
+                            const uint8_t *row, int first);
+static void accumulate_color(const preview_context_t *ctx, const raw_layout_t *layout,
+                             const uint8_t *row_top, int first);
+static void render_gray(const preview_context_t *ctx, const raw_layout_t *layout, const uint8_t *raw,
+                        size_t available_rows, uint16_t *dst, int dst_stride);
+static void render_color(const preview_context_t *ctx, const raw_layout_t *layout, const uint8_t *raw,
+                         size_t available_rows, uint16_t *dst, int dst_stride);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化预览渲染上下文
+ */
+void preview_context_init(preview_context_t *ctx)
+{
+    if (!ctx)
+        return;
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->params.mode = PREVIEW_MODE_GRAY;
+    ctx->params.wb_red = PREVIEW_GAIN_UNITY;
+    ctx->params.wb_green = PREVIEW_GAIN_UNITY;
+    ctx->params.wb_blue = PREVIEW_GAIN_UNITY;
+    ctx->params.black_level = 0;
+    ctx->params.gamma = 1.0f;
+    ctx->params.contrast = 1.0f;
+    build_luts(ctx);
+}
+
+/**
+ * @brief 设置预览参数
+ */
+void preview_set_params(preview_context_t *ctx, const preview_params_t *params)
+{
+    if (!ctx || !params)
+        return;
+
+    preview_params_t sanitized = *params;
+    sanitize_params(&sanitized);
+
+    // 色调参数变化时重建查找表；模式变化时采样表在下一帧渲染时重建
+    int tone_changed = (sanitized.wb_red != ctx->params.wb_red ||
+                        sanitized.wb_green != ctx->params.wb_green ||
+                        sanitized.wb_blue != ctx->params.wb_blue ||
+                        sanitized.black_level != ctx->params.black_level ||
+                        sanitized.gamma != ctx->params.gamma ||
+                        sanitized.contrast != ctx->params.contrast);
+
+    ctx->params = sanitized;
+    if (tone_changed)
+    {
+        build_luts(ctx);
+    }
+}
+
+/**
+ * @brief 释放预览渲染上下文中的采样表
+ */
+void preview_context_release(preview_context_t *ctx)
+{
+    if (!ctx)
+        return;
+
+    free_tables(ctx);
+}
+
+/**
+ * @brief 融合预览内核：RAW解包 + 面积平均缩放 (+ 2x2合并) + RGB565转换一次完成
+ */
+int preview_render_raw(preview_context_t *ctx, const raw_layout_t *layout,
+                       const uint8_t *raw, size_t raw_size,
+                       uint16_t *dst, int dst_stride, int dst_width, int dst_height)
+{
+    if (!ctx || !layout || !raw || !dst || layout->width <= 0 || layout->height <= 0 ||
+        dst_width <= 0 || dst_height <= 0 || dst_stride < dst_width)
+    {
+        return -1;
+    }
+
+    size_t row_bytes = raw_layout_min_stride(layout->width, layout->bit_depth, layout->packing);
+    if (layout->stride < row_bytes)
+    {
+        return -1;
+    }
+
+    if (prepare_tables(ctx, layout, dst_width, dst_height) != 0)
+    {
+        return -1;
+    }
+
+    // 完整可读的行数 (最后一行不要求包含填充字节)
+    size_t available_rows = (raw_size >= row_bytes) ? (raw_size - row_bytes) / layout->stride + 1 : 0;
+
+    if (ctx->table_mode == PREVIEW_MODE_COLOR)
+    {
+        render_color(ctx, layout, raw, available_rows, dst, dst_stride);
+    }
+    else
+    {
+        render_gray(ctx, layout, raw, available_rows, dst, dst_stride);
+    }
+
+    return 0;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 尺寸或模式变化时重建面积平均区间表和行缓冲区
+ * @return 0成功，-1内存分配失败
+ */
+static int prepare_tables(preview_context_t *ctx, const raw_layout_t *layout,
+                          int dst_width, int dst_height)
+{
+    int src_width = layout->width;
+    int src_height = layout->height;
+    raw_kind_t kind = raw_layout_kind(layout);
+    raw_bayer_t bayer = layout->bayer;
+    preview_mode_t mode = ctx->params.mode;
+
+    // G 开头的排列从第1行开始取四元组 (GBRG -> RGGB，GRBG -> BGGR)
+    int row_phase = (bayer == RAW_BAYER_GBRG || bayer == RAW_BAYER_GRBG) ? 1 : 0;
+
+    // 彩色模式需要完整的2x2四元组
+    if (mode == PREVIEW_MODE_COLOR && (src_width < 2 || src_height < 2 + row_phase))
+    {
+        mode = PREVIEW_MODE_GRAY;
+    }
+
+    if (ctx->col_start && ctx->table_mode == mode && ctx->kind == kind &&
+        ctx->bayer == bayer && ctx->bit_depth == layout->bit_depth &&
+        ctx->src_width == src_width && ctx->src_height == src_height &&
+        ctx->dst_width == dst_width && ctx->dst_height == dst_height)
+    {
+        return 0;
+    }
+
+    free_tables(ctx);
+
+    // 彩色模式按四元组坐标计算区间，源列取偶数，源行取偶数加行相位
+    int is_color = (mode == PREVIEW_MODE_COLOR);
+    int span_width = is_color ? src_width / 2 : src_width;
+    int span_height = is_color ? (src_height - row_phase) / 2 : src_height;
+    int channels = is_color ? 3 : 1;
+
+    ctx->col_start = malloc((size_t)dst_width * sizeof(uint32_t));
+    ctx->col_count = malloc((size_t)dst_width * sizeof(uint16_t));
+    ctx->row_start = malloc((size_t)dst_height * sizeof(uint32_t));
+    ctx->row_count = malloc((size_t)dst_height * sizeof(uint16_t));
+    ctx->line = malloc((size_t)src_width * sizeof(uint16_t));
+    ctx->line_sum = malloc((size_t)span_width * channels * sizeof(uint32_t));
+    if (!ctx->col_start || !ctx->col_count || !ctx->row_start || !ctx->row_count ||
+        !ctx->line || !ctx->line_sum)
+    {
+        printf("Error: Failed to allocate preview sampling tables\n");
+        free_tables(ctx);
+        return -1;
+    }
+
+    int col_count_min = span_width;
+    for (int x = 0; x < dst_width; x++)
+    {
+        compute_span(x, span_width, dst_width, &ctx->col_start[x], &ctx->col_count[x]);
+        if (ctx->col_count[x] < col_count_min)
+        {
+            col_count_min = ctx->col_count[x];
+        }
+    }
+
+    for (int y = 0; y < dst_height; y++)
+    {
+        uint32_t start;
+        compute_span(y, span_height, dst_height, &start, &ctx->row_count[y]);
+        ctx->row_start[y] = is_color ? 2 * start + row_phase : start;
+    }
+
+    ctx->table_mode = mode;
+    ctx->kind = kind;
+    ctx->bayer = bayer;
+    ctx->bit_depth = layout->bit_depth;
+    // RGGB/GBRG 四元组左上角为红色
+    ctx->red_first = (bayer == RAW_BAYER_RGGB || bayer == RAW_BAYER_GBRG);
+    // raw_decode_row 保持原始位深，归一化时一并换算到10位 (RAW8 左移2位即少右移2位)
+    ctx->value_shift = RECIP_SHIFT + layout->bit_depth - 10;
+    ctx->src_width = src_width;
+    ctx->src_height = src_height;
+    ctx->dst_width = dst_width;
+    ctx->dst_height = dst_height;
+    ctx->span_width = span_width;
+    ctx->col_count_min = col_count_min;
+
+    return 0;
+}
+
+/**
+ * @brief 释放区间表和行缓冲区 (保留预览参数)
+ */
+static void free_tables(preview_context_t *ctx)
+{
+    free(ctx->col_start);
+    free(ctx->col_count);
+    free(ctx->row_start);
+    free(ctx->row_count);
+    free(ctx->line);
+    free(ctx->line_sum);
+    ctx->col_start = NULL;
+    ctx->col_count = NULL;
+    ctx->row_start = NULL;
+    ctx->row_count = NULL;
+    ctx->line = NULL;
+    ctx->line_sum = NULL;
+}
+
+/**
+ * @brief 限制白平衡增益范围
+ */
+static int clamp_gain(int gain)
+{
+    if (gain < 1)
+        return 1;
+    if (gain > PREVIEW_GAIN_MAX)
+        return PREVIEW_GAIN_MAX;
+    return gain;
+}
+
+/**
+ * @brief 将色调参数限制到有效区间
+ */
+static void sanitize_params(preview_params_t *params)
+{
+    params->wb_red = clamp_gain(params->wb_red);
+    params->wb_green = clamp_gain(params->wb_green);
+    params->wb_blue = clamp_gain(params->wb_blue);
+
+    if (params->black_level < 0)
+        params->black_level = 0;
+    if (params->black_level > RAW10_MAX_VALUE - 1)
+        params->black_level = RAW10_MAX_VALUE - 1;
+
+    // NaN 也回退到默认值
+    if (!(params->gamma >= GAMMA_MIN && params->gamma <= GAMMA_MAX))
+        params->gamma = 1.0f;
+    if (!(params->contrast >= CONTRAST_MIN && params->contrast <= CONTRAST_MAX))
+        params->contrast = 1.0f;
+}
+
+/**
+ * @brief 计算色调曲线：黑电平 -> 白平衡增益 -> 伽马 -> 对比度
+ * @param params 预览参数
+ * @param value 10位输入值
+ * @param gain 通道增益 (Q8)
+ * @return 归一化输出 (0.0 ~ 1.0)
+ */
+static float tone_curve(const preview_params_t *params, int value, int gain)
+{
+    float x = (float)(value - params->black_level) / (float)(RAW10_MAX_VALUE - params->black_level);
+    x = x * (float)gain / (float)PREVIEW_GAIN_UNITY;
+
+    if (x <= 0.0f)
+        x = 0.0f;
+    if (x >= 1.0f)
+        x = 1.0f;
+
+    if (params->gamma != 1.0f && x > 0.0f)
+    {
+        x = powf(x, 1.0f / params->gamma);
+    }
+
+    x = (x - 0.5f) * params->contrast + 0.5f;
+
+    if (x <= 0.0f)
+        return 0.0f;
+    if (x >= 1.0f)
+        return 1.0f;
+    return x;
+}
+
+/**
+ * @brief 重建灰度和各彩色通道的查找表
+ */
+static void build_luts(preview_context_t *ctx)
+{
+    const preview_params_t *params = &ctx->params;
+
+    for (int v = 0; v < PREVIEW_LUT_SIZE; v++)
+    {
+        float gray = tone_curve(params, v, PREVIEW_GAIN_UNITY);
+        uint16_t gray5 = (uint16_t)(gray * 31.0f + 0.5f);
+        uint16_t gray6 = (uint16_t)(gray * 63.0f + 0.5f);
+        ctx->lut_gray[v] = (uint16_t)((gray5 << 11) | (gray6 << 5) | gray5);
+
+        ctx->lut_red[v] = (uint16_t)((uint16_t)(tone_curve(params, v, params->wb_red) * 31.0f + 0.5f) << 11);
+        ctx->lut_green[v] = (uint16_t)((uint16_t)(tone_curve(params, v, params->wb_green) * 63.0f + 0.5f) << 5);
+        ctx->lut_blue[v] = (uint16_t)(tone_curve(params, v, params->wb_blue) * 31.0f + 0.5f);
+    }
+}
+
+/**
+ * @brief 计算一个输出坐标覆盖的源区间
+ * @details 相邻输出坐标的区间首尾相接，区间长度只有 src_size/dst_size 向下或向上取整两种
+ * @param index 输出坐标
+ * @param src_size 源尺寸
+ * @param dst_size 输出尺寸
+ * @param start 输出的区间起点
+ * @param count 输出的区间长度 (至少为1)
+ */
+static void compute_span(int index, int src_size, int dst_size, uint32_t *start, uint16_t *count)
+{
+    uint32_t first = (uint32_t)((uint64_t)index * src_size / dst_size);
+    uint32_t end = (uint32_t)((uint64_t)(index + 1) * src_size / dst_size);
+
+    // 放大时区间可能为空，退化为最近邻
+    *start = first;
+    *count = (uint16_t)((end > first) ? end - first : 1);
+}
+
+/**
+ * @brief 计算面积的定点倒数
+ * @details 向上取整，保证区间内像素值全部相同时平均值不被截断
+ * @param area 区间内的像素数 (或四元组数)
+ * @return 倒数 (Q31)
+ */
+static uint32_t area_recip(uint32_t area)
+{
+    return (uint32_t)(((1ull << RECIP_SHIFT) + area - 1) / area);
+}
+
+/**
+ * @brief 解包一个源行并逐列累加到行缓冲区
+ * @param first 是否为输出行覆盖的第一个源行 (直接写入，无需先清零)
+ */
+static void accumulate_gray(const preview_context_t *ctx, const raw_layout_t *layout,
+                            const uint8_t *row, int first)
+{
+    const uint16_t *line = ctx->line;
+    uint32_t *sum = ctx->line_sum;
+    int width = ctx->span_width;
+
+    raw_decode_row(layout, row, ctx->line);
+
+    if (first)
+    {
+        for (int c = 0; c < width; c++)
+            sum[c] = line[c];
+    }
+    else
+    {
+        for (int c = 0; c < width; c++)
+            sum[c] += line[c];
+    }
+}
+
+/**
+ * @brief 解包一行四元组 (两个源行) 并按通道逐列累加到行缓冲区
+ * @details 行缓冲区依次为左上、绿色 (两个像素之和)、右下三个通道，每个通道 span_width 项
+ * @param row_top 四元组首行 (B G 或 R G，第二行为 G R 或 G B)
+ * @param first 是否为输出行覆盖的第一行四元组 (直接写入，无需先清零)
+ */
+static void accumulate_color(const preview_context_t *ctx, const raw_layout_t *layout,
+                             const uint8_t *row_top, int first)
+{
+    const uint16_t *line = ctx->line;
+    int width = ctx->span_width;
+    uint32_t *sum_first = ctx->line_sum;
+    uint32_t *sum_g = sum_first + width;
+    uint32_t *sum_last = sum_g + width;
+
+    raw_decode_row(layout, row_top, ctx->line);
+    if (first)
+    {
+        for (int c = 0; c < width; c++)
+        {
+            sum_first[c] = line[2 * c];
+            sum_g[c] = line[2 * c + 1];
+        }
+    }
+    else
+    {
+        for (int c = 0; c < width; c++)
+        {
+            sum_first[c] += line[2 * c];
+            sum_g[c] += line[2 * c + 1];
+        }
+    }
+
+    raw_decode_row(layout, row_top + layout->stride, ctx->line);
+    if (first)
+    {
+        for (int c = 0; c < width; c++)
+        {
+            sum_g[c] += line[2 * c];
+            sum_last[c] = line[2 * c + 1];
+        }
+    }
+    else
+    {
+        for (int c = 0; c < width; c++)
+        {
+            sum_g[c] += line[2 * c];
+            sum_last[c] += line[2 * c + 1];
+        }
+    }
+}
+
+/**
+ * @brief 灰度预览：每个输出像素取其覆盖区间内全部源像素的平均值，查表得到RGB565
+ */
+static void render_gray(const preview_context_t *ctx, const raw_layout_t *layout, const uint8_t *raw,
+                        size_t available_rows, uint16_t *dst, int dst_stride)
+{
+    const uint32_t *col_start = ctx->col_start;
+    const uint16_t *col_count = ctx->col_count;
+    const uint32_t *sum = ctx->line_sum;
+    const uint16_t *lut_gray = ctx->lut_gray;
+    int dst_width = ctx->dst_width;
+    int col_count_min = ctx->col_count_min;
+    int value_shift = ctx->value_shift;
+    uint32_t cached_row = UINT32_MAX; // 放大时相邻输出行共用同一源行，无需重复解包
+
+    for (int y = 0; y < ctx->dst_height; y++)
+    {
+        uint16_t *out = dst + (size_t)y * dst_stride;
+        uint32_t row_start = ctx->row_start[y];
+        uint32_t row_count = ctx->row_count[y];
+
+        // 数据不足的行填充黑色
+        if (row_start + row_count > available_rows)
+        {
+            memset(out, 0, dst_width * sizeof(uint16_t));
+            continue;
+        }
+
+        if (row_start != cached_row)
+        {
+            for (uint32_t r = 0; r < row_count; r++)
+            {
+                accumulate_gray(ctx, layout, raw + (row_start + r) * layout->stride, r == 0);
+            }
+            cached_row = row_start;
+        }
+
+        // 各列覆盖的源列数只有两种，每行预先求出两种面积的倒数
+        uint32_t recip[2] = {area_recip(row_count * col_count_min),
+                             area_recip(row_count * (col_count_min + 1))};
+
+        for (int x = 0; x < dst_width; x++)
+        {
+            const uint32_t *span = sum + col_start[x];
+            int count = col_count[x];
+            uint32_t total = 0;
+
+            for (int c = 0; c < count; c++)
+            {
+                total += span[c];
+            }
+
+            // 平均后的10位值经查找表直接得到 RGB565
+            uint32_t r = recip[count - col_count_min];
+            out[x] = lut_gray[((uint64_t)total * r) >> value_shift];
+        }
+    }
+}
+
+/**
+ * @brief 彩色预览：每个输出像素对覆盖区间内的全部Bayer四元组分通道平均，查表完成白平衡和色调映射
+ * @details 行相位已使四元组为 BGGR 或 RGGB，两者只需交换对角像素所用的查找表
+ */
+static void render_color(const preview_context_t *ctx, const raw_layout_t *layout, const uint8_t *raw,
+                         size_t available_rows, uint16_t *dst, int dst_stride)
+{
+    const uint32_t *col_start = ctx->col_start;
+    const uint16_t *col_count = ctx->col_count;
+    const uint32_t *sum_first = ctx->line_sum;
+    const uint32_t *sum_g = sum_first + ctx->span_width;
+    const uint32_t *sum_last = sum_g + ctx->span_width;
+    int dst_width = ctx->dst_width;
+    int col_count_min = ctx->col_count_min;
+    int value_shift = ctx->value_shift;
+    uint32_t cached_row = UINT32_MAX;
+
+    // 四元组左上 / 右下像素对应的查找表
+    const uint16_t *lut_first = ctx->red_first ? ctx->lut_red : ctx->lut_blue;
+    const uint16_t *lut_green = ctx->lut_green;
+    const uint16_t *lut_last = ctx->red_first ? ctx->lut_blue : ctx->lut_red;
+
+    for (int y = 0; y < ctx->dst_height; y++)
+    {
+        uint16_t *out = dst + (size_t)y * dst_stride;
+        uint32_t row_start = ctx->row_start[y];
+        uint32_t row_count = ctx->row_count[y];
+
+        // 最后一个四元组的第二行也必须在数据范围内
+        if (row_start + 2 * row_count > available_rows)
+        {
+            memset(out, 0, dst_width * sizeof(uint16_t));
+            continue;
+        }
+
+        if (row_start != cached_row)
+        {
+            for (uint32_t r = 0; r < row_count; r++)
+            {
+                accumulate_color(ctx, layout, raw + (row_start + 2 * r) * layout->stride, r == 0);
+            }
+            cached_row = row_start;
+        }
+
+        uint32_t recip[2] = {area_recip(row_count * col_count_min),
+                             area_recip(row_count * (col_count_min + 1))};
+
+        for (int x = 0; x < dst_width; x++)
+        {
+            uint32_t start = col_start[x];
+            int count = col_count[x];
+            uint32_t total_first = 0, total_g = 0, total_last = 0;
+
+            for (int c = 0; c < count; c++)
+            {
+                total_first += sum_first[start + c];
+                total_g += sum_g[start + c];
+                total_last += sum_last[start + c];
+            }
+
+            // 归一化后每通道查表 (白平衡已折算进表中)，绿色为两个像素之和需多右移1位
+            uint64_t r = recip[count - col_count_min];
+            out[x] = (uint16_t)(lut_first[(total_first * r) >> value_shift] |
+                                lut_green[(total_g * r) >> (value_shift + 1)] |
+                                lut_last[(total_last * r) >> value_shift]);
+        }
+    }
+}
@@ -0,0 +1,175 @@
+/**
+ * @file raw_bin.c
+ * @brief Bayer RAW像素合并 (binning) 模块
+ * @details 输出第 y 行 (奇偶性 p = y & 1) 来自输入第 y/2 个 2N 行块中与之同奇偶的N行，
+ *          输出第 x 列同理。同色像素在行内相隔2列，因此列方向合并是
+ *          "每 2N 个累加值交错地归并成2个输出"，NEON 用 vld4 去交错后逐通道相加
+ */
+
+#include <string.h>
+
+#include "raw_bin.h"
+#include "raw_codec.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define RAW_BIN_ROW_PAD 32      // 每行工作区的余量 (像素)，容纳解包内核按组写出的尾部
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static raw_bin_accumulate_fn accumulate_function(void);
+static raw_bin_reduce_fn reduce_function(int factor);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 计算合并后的数据布局
+ */
+int raw_bin_layout(const raw_layout_t *layout, int rows, int factor,
+                   raw_layout_t *binned, int *binned_rows)
+{
+    if (!layout || !binned || !binned_rows || (factor != 2 && factor != 4) ||
+        layout->bit_depth > RAW_BIN_MAX_DEPTH || rows > layout->height)
+    {
+        return -1;
+    }
+
+    int cell = 2 * factor;
+    int width = layout->width / cell * 2;
+    int height = rows / cell * 2;
+    if (width == 0 || height == 0)
+    {
+        return -1;
+    }
+
+    *binned = *layout;
+    binned->width = width;
+    binned->height = height;
+    binned->stride = raw_layout_min_stride(width, layout->bit_depth, layout->packing);
+    *binned_rows = height;
+    return 0;
+}
+
+/**
+ * @brief 计算工作区大小
+ */
+size_t raw_bin_workspace_size(const raw_layout_t *layout)
+{
+    // 解包行、累加行、输出行
+    return 3 * ((size_t)layout->width + RAW_BIN_ROW_PAD) * sizeof(uint16_t);
+}
+
+/**
+ * @brief 合并一帧
+ */
+int raw_bin_image(const raw_layout_t *layout, const uint8_t *data, int rows, int factor,
+                  uint8_t *dst, size_t capacity, void *workspace)
+{
+    raw_layout_t binned;
+    int binned_rows;
+    if (!data || !dst || !workspace || raw_bin_layout(layout, rows, factor, &binned, &binned_rows) != 0 ||
+        (size_t)binned_rows * binned.stride > capacity)
+    {
+        return -1;
+    }
+
+    size_t lane = (size_t)layout->width + RAW_BIN_ROW_PAD;
+    uint16_t *row = workspace;
+    uint16_t *sum = row + lane;
+    uint16_t *out = sum + lane;
+    size_t span = (size_t)binned.width * factor; // 参与合并的输入列数
+
+    raw_bin_accumulate_fn accumulate = accumulate_function();
+    raw_bin_reduce_fn reduce = reduce_function(factor);
+
+    for (int y = 0; y < binned_rows; y++)
+    {
+        int first = (y >> 1) * 2 * factor + (y & 1);
+        raw_decode_row(layout, data + (size_t)first * layout->stride, sum);
+        for (int k = 1; k < factor; k++)
+        {
+            raw_decode_row(layout, data + (size_t)(first + 2 * k) * layout->stride, row);
+            accumulate(sum, row, span);
+        }
+
+        reduce(sum, out, (size_t)binned.width / 2);
+        raw_codec_pack_row(&binned, out, dst + (size_t)y * binned.stride);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 通用内核：行方向累加
+ */
+void raw_bin_accumulate_portable(uint16_t *sum, const uint16_t *row, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        sum[i] = (uint16_t)(sum[i] + row[i]);
+    }
+}
+
+/**
+ * @brief 通用内核：2x2合并 (每4个累加值得到2个输出，共4个样本求平均)
+ */
+void raw_bin_reduce2_portable(const uint16_t *sum, uint16_t *dst, size_t groups)
+{
+    for (size_t g = 0; g < groups; g++)
+    {
+        const uint16_t *s = sum + 4 * g;
+        dst[2 * g] = (uint16_t)(((uint32_t)s[0] + s[2] + 2) >> 2);
+        dst[2 * g + 1] = (uint16_t)(((uint32_t)s[1] + s[3] + 2) >> 2);
+    }
+}
+
+/**
+ * @brief 通用内核：4x4合并 (每8个累加值得到2个输出，共16个样本求平均)
+ */
+void raw_bin_reduce4_portable(const uint16_t *sum, uint16_t *dst, size_t groups)
+{
+    for (size_t g = 0; g < groups; g++)
+    {
+        const uint16_t *s = sum + 8 * g;
+        dst[2 * g] = (uint16_t)(((uint32_t)s[0] + s[2] + s[4] + s[6] + 8) >> 4);
+        dst[2 * g + 1] = (uint16_t)(((uint32_t)s[1] + s[3] + s[5] + s[7] + 8) >> 4);
+    }
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 选择行方向累加内核 (跟随 raw_decode_init 的NEON检测结果)
+ */
+static raw_bin_accumulate_fn accumulate_function(void)
+{
+#if defined(__arm__) || defined(__aarch64__)
+    if (raw_decode_get_kernel() == RAW_KERNEL_NEON)
+    {
+        return raw_bin_accumulate_neon;
+    }
+#endif
+    return raw_bin_accumulate_portable;
+}
+
+/**
+ * @brief 选择列方向合并内核
+ */
+static raw_bin_reduce_fn reduce_function(int factor)
+{
+#if defined(__arm__) || defined(__aarch64__)
+    if (raw_decode_get_kernel() == RAW_KERNEL_NEON)
+    {
+        return (factor == 2) ? raw_bin_reduce2_neon : raw_bin_reduce4_neon;
+    }
+#endif
+    return (factor == 2) ? raw_bin_reduce2_portable : raw_bin_reduce4_portable;
+}
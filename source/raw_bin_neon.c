@@ -0,0 +1,98 @@
+/**
+ * @file raw_bin_neon.c
+ * @brief Bayer RAW像素合并NEON内核
+ * @details 本文件单独以 -mfpu=neon 编译 (见 CMakeLists.txt)，
+ *          仅在 raw_decode_init 检测到 HWCAP_NEON 后才会被调用
+ */
+
+#include "raw_bin.h"
+
+#if defined(__arm__) || defined(__aarch64__)
+
+#include <arm_neon.h>
+
+/**
+ * @brief NEON内核：行方向累加，每次迭代16像素
+ */
+void raw_bin_accumulate_neon(uint16_t *sum, const uint16_t *row, size_t count)
+{
+    while (count >= 16)
+    {
+        vst1q_u16(sum, vaddq_u16(vld1q_u16(sum), vld1q_u16(row)));
+        vst1q_u16(sum + 8, vaddq_u16(vld1q_u16(sum + 8), vld1q_u16(row + 8)));
+        sum += 16;
+        row += 16;
+        count -= 16;
+    }
+
+    if (count)
+    {
+        raw_bin_accumulate_portable(sum, row, count);
+    }
+}
+
+/*
+ * vld4 按4去交错：val[k][i] = sum[4i + k]。
+ * 2x2合并时每组4个累加值 (两种颜色交替)，val[0]+val[2] 和 val[1]+val[3]
+ * 就是两种颜色各自的4样本和 (不超过 4 x 16383，16位不溢出)，
+ * 带舍入右移后用 vst2 交错写回。一次处理8组 (32个累加值 -> 16个输出)。
+ */
+
+/**
+ * @brief NEON内核：2x2合并
+ */
+void raw_bin_reduce2_neon(const uint16_t *sum, uint16_t *dst, size_t groups)
+{
+    while (groups >= 8)
+    {
+        uint16x8x4_t v = vld4q_u16(sum);
+        uint16x8x2_t out;
+        out.val[0] = vrshrq_n_u16(vaddq_u16(v.val[0], v.val[2]), 2);
+        out.val[1] = vrshrq_n_u16(vaddq_u16(v.val[1], v.val[3]), 2);
+        vst2q_u16(dst, out);
+
+        sum += 32;
+        dst += 16;
+        groups -= 8;
+    }
+
+    if (groups)
+    {
+        raw_bin_reduce2_portable(sum, dst, groups);
+    }
+}
+
+/*
+ * 4x4合并时每组8个累加值，去交错后一组占相邻两个通道，
+ * 用成对相加扩展到32位 (vpaddl/vpadal) 得到16样本和，再带舍入右移4位并收窄。
+ * 一次处理4组 (32个累加值 -> 8个输出)。
+ */
+
+/**
+ * @brief NEON内核：4x4合并
+ */
+void raw_bin_reduce4_neon(const uint16_t *sum, uint16_t *dst, size_t groups)
+{
+    while (groups >= 4)
+    {
+        uint16x8x4_t v = vld4q_u16(sum);
+        uint32x4_t even = vpadalq_u16(vpaddlq_u16(v.val[0]), v.val[2]);
+        uint32x4_t odd = vpadalq_u16(vpaddlq_u16(v.val[1]), v.val[3]);
+
+        uint16x4x2_t out;
+        out.val[0] = vrshrn_n_u32(even, 4);
+        out.val[1] = vrshrn_n_u32(odd, 4);
+        vst2_u16(dst, out);
+
+        sum += 32;
+        dst += 8;
+        groups -= 4;
+    }
+
+    if (groups)
+    {
+        raw_bin_reduce4_portable(sum, dst, groups);
+    }
+}
+
+#endif /* __arm__ || __aarch64__ */
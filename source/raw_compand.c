@@ -0,0 +1,282 @@
+/**
+ * @file raw_compand.c
+ * @brief RAW压扩 (companding) 模块
+ * @details 曲线 f(x) = min(x, c(x))，c 为按满量程归一化的平方根或对数曲线 (输出 0 ~ 255)。
+ *          c 是凹函数且 c(0) = 0，与恒等映射相交后斜率不超过1，因此 f 单调、每单位输入
+ *          最多增加一个码值，所有码值都能用上。32个等宽段连续相接，每段的斜率 (Q7)
+ *          使段终点最接近 f 在该处的值，折线单调；最后一段的终点可能略超过255，码值限制到255
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "raw_compand.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define COMPAND_FRAC_BITS 7         // 段起点和斜率的小数位数
+#define COMPAND_ROW_PAD 32          // 每行工作区的余量 (像素)，容纳解包内核按组写出的尾部
+#define COMPAND_MIN_DEPTH 10        // 支持的最小输入位深 (RAW8 无需压扩)
+#define COMPAND_DEPTHS ((RAW_COMPAND_MAX_DEPTH - COMPAND_MIN_DEPTH) / 2 + 1) // 支持的位深个数 (10、12)
+#define COMPAND_LOG_KNEE_BITS 6     // 对数曲线的拐点：满量程的 1/64
+
+// ============================================================================
+// 全局变量
+// ============================================================================
+
+static raw_compand_t tables[RAW_COMPAND_COUNT - 1][COMPAND_DEPTHS]; // [曲线 - 1][(位深 - 10) / 2]
+static int tables_ready = 0;
+static raw_compand_map_fn current_map = raw_compand_map_portable;
+
+static const char *const curve_names[RAW_COMPAND_COUNT] = {"off", "sqrt", "log"};
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void build_table(raw_compand_t *table, raw_compand_curve_t curve, int input_bits);
+static double curve_value(raw_compand_curve_t curve, double x, int max);
+#if defined(__arm__) || defined(__aarch64__)
+static int map_selftest(raw_compand_map_fn fn);
+#endif
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 生成映射表并选择映射内核
+ */
+int raw_compand_init(void)
+{
+    for (int c = RAW_COMPAND_SQRT; c < RAW_COMPAND_COUNT; c++)
+    {
+        for (int d = 0; d < COMPAND_DEPTHS; d++)
+        {
+            build_table(&tables[c - 1][d], (raw_compand_curve_t)c, COMPAND_MIN_DEPTH + 2 * d);
+        }
+    }
+    tables_ready = 1;
+
+    current_map = raw_compand_map_portable;
+#if defined(__arm__) || defined(__aarch64__)
+    if (raw_decode_get_kernel() == RAW_KERNEL_NEON)
+    {
+        if (map_selftest(raw_compand_map_neon) == 0)
+        {
+            current_map = raw_compand_map_neon;
+        }
+        else
+        {
+            printf("Warning: Compand NEON kernel failed self-test, falling back\n");
+        }
+    }
+#endif
+    printf("Compand kernel: %s\n", current_map == raw_compand_map_portable ? "portable" : "neon");
+    return 0;
+}
+
+/**
+ * @brief 获取映射表
+ */
+const raw_compand_t *raw_compand_get(raw_compand_curve_t curve, int input_bits)
+{
+    if (!tables_ready || curve <= RAW_COMPAND_OFF || curve >= RAW_COMPAND_COUNT ||
+        input_bits < COMPAND_MIN_DEPTH || input_bits > RAW_COMPAND_MAX_DEPTH || (input_bits & 1))
+    {
+        return NULL;
+    }
+    return &tables[curve - 1][(input_bits - COMPAND_MIN_DEPTH) / 2];
+}
+
+/**
+ * @brief 获取曲线名称
+ */
+const char *raw_compand_curve_name(raw_compand_curve_t curve)
+{
+    return (curve >= RAW_COMPAND_OFF && curve < RAW_COMPAND_COUNT) ? curve_names[curve] : "unknown";
+}
+
+/**
+ * @brief 按名称解析曲线
+ */
+int raw_compand_curve_from_name(const char *name, raw_compand_curve_t *curve)
+{
+    for (int c = 0; c < RAW_COMPAND_COUNT; c++)
+    {
+        if (strcmp(name, curve_names[c]) == 0)
+        {
+            *curve = (raw_compand_curve_t)c;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 计算工作区大小
+ */
+size_t raw_compand_workspace_size(const raw_layout_t *layout)
+{
+    return ((size_t)layout->width + COMPAND_ROW_PAD) * sizeof(uint16_t);
+}
+
+/**
+ * @brief 压扩一帧
+ */
+int raw_compand_image(const raw_compand_t *table, const raw_layout_t *layout, const uint8_t *data, int rows,
+                      uint8_t *dst, size_t capacity, void *workspace)
+{
+    if (!table || !layout || !data || !dst || !workspace || layout->bit_depth != table->input_bits ||
+        rows <= 0 || rows > layout->height || (size_t)layout->width * (size_t)rows > capacity)
+    {
+        return -1;
+    }
+
+    uint16_t *row = workspace;
+    size_t width = (size_t)layout->width;
+    for (int y = 0; y < rows; y++)
+    {
+        raw_decode_row(layout, data + (size_t)y * layout->stride, row);
+        current_map(table, row, dst + (size_t)y * width, width);
+    }
+    return 0;
+}
+
+/**
+ * @brief 通用内核：查找表映射
+ */
+void raw_compand_map_portable(const raw_compand_t *table, const uint16_t *src, uint8_t *dst, size_t count)
+{
+    const uint8_t *encode = table->encode;
+    uint16_t mask = (uint16_t)((1u << table->input_bits) - 1);
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i] = encode[src[i] & mask];
+    }
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 生成一条曲线在某个位深下的折线、查找表和解码表
+ */
+static void build_table(raw_compand_t *table, raw_compand_curve_t curve, int input_bits)
+{
+    memset(table, 0, sizeof(*table));
+    table->curve = curve;
+    table->input_bits = input_bits;
+    table->shift = input_bits - 5; // 32段
+
+    // 折线端点的目标值 (最后一个端点在满量程之外一个单位，限制到 255)
+    int max = (1 << input_bits) - 1;
+    long limit = (long)(RAW_COMPAND_CODES - 1) << COMPAND_FRAC_BITS;
+    long node[RAW_COMPAND_SEGMENTS + 1];
+    for (int k = 0; k <= RAW_COMPAND_SEGMENTS; k++)
+    {
+        double x = (double)(k << table->shift);
+        double y = curve_value(curve, x, max);
+        long q = lround((y < x ? y : x) * (1 << COMPAND_FRAC_BITS));
+        node[k] = q < limit ? q : limit;
+    }
+
+    // 段起点取上一段的终点 (折线连续)，斜率按舍入选取使终点最接近下一个端点，误差不累积
+    long base = 0;
+    long width = 1L << table->shift;
+    for (int k = 0; k < RAW_COMPAND_SEGMENTS; k++)
+    {
+        long slope = (node[k + 1] - base + width / 2) >> table->shift;
+        slope = slope < 0 ? 0 : (slope > (1 << COMPAND_FRAC_BITS) ? (1 << COMPAND_FRAC_BITS) : slope);
+        table->base_lo[k] = (uint8_t)(base & 0xFF);
+        table->base_hi[k] = (uint8_t)(base >> 8);
+        table->slope[k] = (uint8_t)slope;
+        base += slope * width;
+    }
+
+    // 查找表与NEON内核使用同一公式：(起点 + 斜率 * 段内偏移 + 0.5) >> 7
+    // 解码表的累加数组较大，不放在栈上 (只在 raw_compand_init 中调用)
+    static uint32_t sums[RAW_COMPAND_CODES];
+    static uint32_t counts[RAW_COMPAND_CODES];
+    memset(sums, 0, sizeof(sums));
+    memset(counts, 0, sizeof(counts));
+    int offset_mask = (1 << table->shift) - 1;
+    for (int x = 0; x <= max; x++)
+    {
+        int s = x >> table->shift;
+        unsigned value = ((unsigned)table->base_lo[s] | (unsigned)table->base_hi[s] << 8) +
+                         (unsigned)table->slope[s] * (unsigned)(x & offset_mask);
+        unsigned code = (value + (1u << (COMPAND_FRAC_BITS - 1))) >> COMPAND_FRAC_BITS;
+        table->encode[x] = (uint8_t)(code > RAW_COMPAND_CODES - 1 ? RAW_COMPAND_CODES - 1 : code);
+        sums[table->encode[x]] += (uint32_t)x;
+        counts[table->encode[x]]++;
+    }
+
+    // 没有输入映射到的码值 (段边界处偶尔跳过一个) 沿用前一个码值的解码结果
+    for (int c = 0; c < RAW_COMPAND_CODES; c++)
+    {
+        if (counts[c] > 0)
+        {
+            table->decode[c] = (uint16_t)((sums[c] + counts[c] / 2) / counts[c]);
+        }
+        else
+        {
+            table->decode[c] = c > 0 ? table->decode[c - 1] : 0;
+        }
+    }
+}
+
+/**
+ * @brief 曲线在输入 x 处的值 (码值，未与恒等映射取较小值)
+ * @param curve 曲线
+ * @param x 输入值
+ * @param max 满量程
+ */
+static double curve_value(raw_compand_curve_t curve, double x, int max)
+{
+    double full = RAW_COMPAND_CODES - 1;
+    if (curve == RAW_COMPAND_LOG)
+    {
+        double knee = (double)((max + 1) >> COMPAND_LOG_KNEE_BITS);
+        return full * log1p(x / knee) / log1p(max / knee);
+    }
+    return full * sqrt(x / max);
+}
+
+#if defined(__arm__) || defined(__aarch64__)
+/**
+ * @brief 用全部输入值比对内核与查找表的输出
+ * @return 0一致，-1不一致
+ */
+static int map_selftest(raw_compand_map_fn fn)
+{
+    static uint16_t input[1 << RAW_COMPAND_MAX_DEPTH];
+    static uint8_t output[1 << RAW_COMPAND_MAX_DEPTH];
+
+    for (int c = RAW_COMPAND_SQRT; c < RAW_COMPAND_COUNT; c++)
+    {
+        for (int d = 0; d < COMPAND_DEPTHS; d++)
+        {
+            const raw_compand_t *table = &tables[c - 1][d];
+            size_t count = (size_t)1 << table->input_bits;
+            for (size_t x = 0; x < count; x++)
+            {
+                input[x] = (uint16_t)x;
+            }
+
+            // 长度减3：覆盖向量主循环和尾部处理
+            memset(output, 0, sizeof(output));
+            fn(table, input, output, count - 3);
+            if (memcmp(output, table->encode, count - 3) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+#endif /* __arm__ || __aarch64__ */
@@ -0,0 +1,79 @@
+/**
+ * @file raw_compand_neon.c
+ * @brief RAW压扩NEON内核
+ * @details 本文件单独以 -mfpu=neon 编译 (见 CMakeLists.txt)，
+ *          仅在 raw_decode_init 检测到 HWCAP_NEON 后才会被调用
+ */
+
+#include "raw_compand.h"
+
+#if defined(__arm__) || defined(__aarch64__)
+
+#include <arm_neon.h>
+
+/*
+ * 折线共32段，段号 = x >> shift 正好是 vtbl4 (32字节表) 的下标范围，
+ * 段起点的低/高字节和斜率各查一次表；段内偏移不超过127，斜率不超过128，
+ * 用 vmlal_u8 在16位中累加 起点 + 斜率 * 偏移 (约 255 << 7，远小于16位上限)，
+ * 再带舍入右移7位并饱和收窄为码值 (与查找表一样限制到255)。一次处理16像素。
+ */
+
+/**
+ * @brief 按段查表计算8个像素的码值
+ */
+static inline uint8x8_t map8(uint16x8_t x, int16x8_t shift, uint16x8_t offset_mask,
+                             uint8x8x4_t base_lo, uint8x8x4_t base_hi, uint8x8x4_t slope)
+{
+    uint8x8_t segment = vmovn_u16(vshlq_u16(x, shift));
+    uint8x8_t offset = vmovn_u16(vandq_u16(x, offset_mask));
+
+    uint8x8x2_t base = vzip_u8(vtbl4_u8(base_lo, segment), vtbl4_u8(base_hi, segment));
+    uint16x8_t value = vreinterpretq_u16_u8(vcombine_u8(base.val[0], base.val[1]));
+    value = vmlal_u8(value, vtbl4_u8(slope, segment), offset);
+    return vqrshrn_n_u16(value, 7);
+}
+
+/**
+ * @brief 加载32字节的查找表
+ */
+static inline uint8x8x4_t load_table(const uint8_t *table)
+{
+    uint8x8x4_t t;
+    t.val[0] = vld1_u8(table);
+    t.val[1] = vld1_u8(table + 8);
+    t.val[2] = vld1_u8(table + 16);
+    t.val[3] = vld1_u8(table + 24);
+    return t;
+}
+
+/**
+ * @brief NEON内核：按折线计算码值，每次迭代16像素
+ */
+void raw_compand_map_neon(const raw_compand_t *table, const uint16_t *src, uint8_t *dst, size_t count)
+{
+    const uint8x8x4_t base_lo = load_table(table->base_lo);
+    const uint8x8x4_t base_hi = load_table(table->base_hi);
+    const uint8x8x4_t slope = load_table(table->slope);
+    const int16x8_t shift = vdupq_n_s16((int16_t)-table->shift);
+    const uint16x8_t offset_mask = vdupq_n_u16((uint16_t)((1u << table->shift) - 1));
+    const uint16x8_t mask = vdupq_n_u16((uint16_t)((1u << table->input_bits) - 1));
+
+    while (count >= 16)
+    {
+        uint16x8_t a = vandq_u16(vld1q_u16(src), mask);
+        uint16x8_t b = vandq_u16(vld1q_u16(src + 8), mask);
+        vst1q_u8(dst, vcombine_u8(map8(a, shift, offset_mask, base_lo, base_hi, slope),
+                                  map8(b, shift, offset_mask, base_lo, base_hi, slope)));
+
+        src += 16;
+        dst += 16;
+        count -= 16;
+    }
+
+    if (count)
+    {
+        raw_compand_map_portable(table, src, dst, count);
+    }
+}
+
+#endif /* __arm__ || __aarch64__ */
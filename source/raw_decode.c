@@ -0,0 +1,834 @@
+/**
+ * @file raw_decode.c
+ * @brief RAW图像解包模块
+ * @details SBGGR10 (每5字节4像素，40位小端) 解包内核及运行时分派：
+ *          - 标量参考实现：保留原有逐组解包逻辑，作为正确性基准
+ *          - 通用实现：无分支、固定步长，便于编译器在x86主机上自动向量化
+ *          - NEON实现：位于 raw_decode_neon.c，单独以 -mfpu=neon 编译
+ *          Rockchip 紧凑排列和 MIPI CSI-2 打包各有一套内核，选择同一级别；
+ *          16位非打包数据只需掩码复制。按行解包时使用布局中的 stride，
+ *          行尾填充字节被跳过。
+ *          RAW8/RAW12 及16位非打包数据的内核由 DEFINE_GROUP_KERNEL 宏按格式展开，
+ *          每行只选择一次内核，像素循环内没有格式判断
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include "raw_decode.h"
+
+// ============================================================================
+// 常量定义
+// ============================================================================
+
+#define RAW10_GROUP_BYTES 5   // 每组字节数
+#define RAW10_GROUP_PIXELS 4  // 每组像素数
+#define RAW12_GROUP_BYTES 3   // RAW12 每组字节数
+#define RAW12_GROUP_PIXELS 2  // RAW12 每组像素数
+
+#define RAW_SELFTEST_GROUPS 64 // 内核自检使用的组数 (320字节)
+
+// ARM HWCAP (避免依赖 <sys/auxv.h>，uClibc 不一定提供 getauxval)
+#define AUXV_AT_NULL 0
+#define AUXV_AT_HWCAP 16
+#define AUXV_HWCAP_ARM_NEON (1UL << 12)
+
+// ============================================================================
+// 全局变量
+// ============================================================================
+
+static raw_kernel_t current_kernel = RAW_KERNEL_SCALAR;
+static raw10_unpack_fn current_unpack = raw10_unpack_groups_scalar;           // Rockchip 排列
+static raw10_unpack_fn current_mipi_unpack = raw10_mipi_unpack_groups_scalar; // MIPI 排列
+
+static const char *raw_kernel_names[] = {
+    "scalar",   // RAW_KERNEL_SCALAR
+    "portable", // RAW_KERNEL_PORTABLE
+    "neon"      // RAW_KERNEL_NEON
+};
+
+static const char *raw_packing_names[] = {
+    "rockchip",   // RAW_PACKING_ROCKCHIP
+    "mipi",       // RAW_PACKING_MIPI
+    "unpacked16"  // RAW_PACKING_UNPACKED16
+};
+
+// 支持的像素格式 (V4L2 非打包格式名，实际排列由 raw_packing 决定)
+static const raw_format_t raw_formats[] = {
+    {"SBGGR8", V4L2_PIX_FMT_SBGGR8, 8, RAW_BAYER_BGGR},
+    {"SGBRG8", V4L2_PIX_FMT_SGBRG8, 8, RAW_BAYER_GBRG},
+    {"SGRBG8", V4L2_PIX_FMT_SGRBG8, 8, RAW_BAYER_GRBG},
+    {"SRGGB8", V4L2_PIX_FMT_SRGGB8, 8, RAW_BAYER_RGGB},
+    {"SBGGR10", V4L2_PIX_FMT_SBGGR10, 10, RAW_BAYER_BGGR},
+    {"SGBRG10", V4L2_PIX_FMT_SGBRG10, 10, RAW_BAYER_GBRG},
+    {"SGRBG10", V4L2_PIX_FMT_SGRBG10, 10, RAW_BAYER_GRBG},
+    {"SRGGB10", V4L2_PIX_FMT_SRGGB10, 10, RAW_BAYER_RGGB},
+    {"SBGGR12", V4L2_PIX_FMT_SBGGR12, 12, RAW_BAYER_BGGR},
+    {"SGBRG12", V4L2_PIX_FMT_SGBRG12, 12, RAW_BAYER_GBRG},
+    {"SGRBG12", V4L2_PIX_FMT_SGRBG12, 12, RAW_BAYER_GRBG},
+    {"SRGGB12", V4L2_PIX_FMT_SRGGB12, 12, RAW_BAYER_RGGB},
+};
+
+#define RAW_FORMAT_COUNT (sizeof(raw_formats) / sizeof(raw_formats[0]))
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static int cpu_has_neon(void);
+static raw10_unpack_fn kernel_function(raw_kernel_t kernel);
+static raw10_unpack_fn mipi_kernel_function(raw_kernel_t kernel);
+static int kernel_selftest(raw10_unpack_fn fn, raw10_unpack_fn reference);
+static void unpack_tail(raw10_unpack_fn scalar, const uint8_t *group, uint16_t *dst, int count);
+static void kind_geometry(raw_kind_t kind, int *group_bytes, int *group_pixels);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化解包模块
+ */
+int raw_decode_init(void)
+{
+    raw_kernel_t preferred = cpu_has_neon() ? RAW_KERNEL_NEON : RAW_KERNEL_PORTABLE;
+
+    // 按优先级依次尝试，自检失败则回退到下一级
+    for (int k = preferred; k > RAW_KERNEL_SCALAR; k--)
+    {
+        if (raw_decode_set_kernel((raw_kernel_t)k) != 0)
+        {
+            continue;
+        }
+
+        if (kernel_selftest(current_unpack, raw10_unpack_groups_scalar) == 0 &&
+            kernel_selftest(current_mipi_unpack, raw10_mipi_unpack_groups_scalar) == 0)
+        {
+            printf("RAW10 unpack kernel: %s\n", raw_decode_kernel_name(current_kernel));
+            return 0;
+        }
+
+        printf("Warning: RAW10 %s kernel failed self-test, falling back\n",
+               raw_decode_kernel_name((raw_kernel_t)k));
+    }
+
+    raw_decode_set_kernel(RAW_KERNEL_SCALAR);
+    printf("RAW10 unpack kernel: %s\n", raw_decode_kernel_name(current_kernel));
+    return 0;
+}
+
+/**
+ * @brief 获取当前使用的解包内核
+ */
+raw_kernel_t raw_decode_get_kernel(void)
+{
+    return current_kernel;
+}
+
+/**
+ * @brief 强制指定解包内核
+ */
+int raw_decode_set_kernel(raw_kernel_t kernel)
+{
+    if (kernel == RAW_KERNEL_NEON && !cpu_has_neon())
+    {
+        return -1;
+    }
+
+    raw10_unpack_fn fn = kernel_function(kernel);
+    raw10_unpack_fn mipi_fn = mipi_kernel_function(kernel);
+    if (!fn || !mipi_fn)
+    {
+        return -1;
+    }
+
+    current_kernel = kernel;
+    current_unpack = fn;
+    current_mipi_unpack = mipi_fn;
+    return 0;
+}
+
+/**
+ * @brief 获取解包内核名称
+ */
+const char *raw_decode_kernel_name(raw_kernel_t kernel)
+{
+    if ((int)kernel < 0 || kernel >= RAW_KERNEL_COUNT)
+    {
+        return "unknown";
+    }
+    return raw_kernel_names[kernel];
+}
+
+/**
+ * @brief 获取数据排列方式名称
+ */
+const char *raw_packing_name(raw_packing_t packing)
+{
+    if ((int)packing < 0 || packing >= RAW_PACKING_COUNT)
+    {
+        return "unknown";
+    }
+    return raw_packing_names[packing];
+}
+
+/**
+ * @brief 按名称解析数据排列方式
+ */
+int raw_packing_from_name(const char *name, raw_packing_t *packing)
+{
+    if (!name || !packing)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < RAW_PACKING_COUNT; i++)
+    {
+        if (strcmp(name, raw_packing_names[i]) == 0)
+        {
+            *packing = (raw_packing_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 按名称查找像素格式
+ */
+const raw_format_t *raw_format_find(const char *name)
+{
+    if (!name)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < RAW_FORMAT_COUNT; i++)
+    {
+        if (strcasecmp(name, raw_formats[i].name) == 0)
+        {
+            return &raw_formats[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 按 V4L2 像素格式查找
+ */
+const raw_format_t *raw_format_from_fourcc(uint32_t fourcc)
+{
+    for (size_t i = 0; i < RAW_FORMAT_COUNT; i++)
+    {
+        if (raw_formats[i].fourcc == fourcc)
+        {
+            return &raw_formats[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 计算一行数据的最小字节数
+ */
+size_t raw_layout_min_stride(int width, int bit_depth, raw_packing_t packing)
+{
+    if (width <= 0)
+    {
+        return 0;
+    }
+
+    if (bit_depth <= 8)
+    {
+        return (size_t)width;
+    }
+
+    if (packing == RAW_PACKING_UNPACKED16)
+    {
+        return (size_t)width * sizeof(uint16_t);
+    }
+
+    // 末尾不完整的组仍占用完整的组字节数
+    if (bit_depth == 12)
+    {
+        return ((size_t)width + RAW12_GROUP_PIXELS - 1) / RAW12_GROUP_PIXELS * RAW12_GROUP_BYTES;
+    }
+    return ((size_t)width + RAW10_GROUP_PIXELS - 1) / RAW10_GROUP_PIXELS * RAW10_GROUP_BYTES;
+}
+
+/**
+ * @brief 确定缓冲区布局
+ */
+int raw_layout_detect(raw_layout_t *layout, const raw_format_t *format, int width, int height,
+                      size_t stride, size_t buffer_size, raw_packing_t packed_variant)
+{
+    if (!layout || !format || width <= 0 || height <= 0)
+    {
+        return -1;
+    }
+
+    if (packed_variant != RAW_PACKING_MIPI)
+    {
+        packed_variant = RAW_PACKING_ROCKCHIP;
+    }
+
+    size_t packed_min = raw_layout_min_stride(width, format->bit_depth, packed_variant);
+    size_t unpacked_min = raw_layout_min_stride(width, format->bit_depth, RAW_PACKING_UNPACKED16);
+
+    // 未知或无效的 stride 由缓冲区大小推算
+    if (stride < packed_min)
+    {
+        stride = buffer_size / (size_t)height;
+        if (stride < packed_min)
+        {
+            stride = packed_min; // 缓冲区不足一帧，按紧凑排列解包可用的行
+        }
+    }
+
+    layout->width = width;
+    layout->height = height;
+    layout->stride = stride;
+    layout->bit_depth = format->bit_depth;
+    layout->bayer = format->bayer;
+
+    // RAW8 没有非打包形式，行尾填充再多也按每像素1字节处理
+    if (format->bit_depth > 8 && stride >= unpacked_min)
+    {
+        layout->packing = RAW_PACKING_UNPACKED16;
+    }
+    else
+    {
+        layout->packing = packed_variant;
+    }
+    return 0;
+}
+
+/**
+ * @brief 获取布局对应的数据种类
+ */
+raw_kind_t raw_layout_kind(const raw_layout_t *layout)
+{
+    if (layout->bit_depth <= 8)
+    {
+        return RAW_KIND_RAW8;
+    }
+    if (layout->packing == RAW_PACKING_UNPACKED16)
+    {
+        return RAW_KIND_UNPACKED16;
+    }
+    if (layout->bit_depth == 12)
+    {
+        return (layout->packing == RAW_PACKING_MIPI) ? RAW_KIND_RAW12_MIPI : RAW_KIND_RAW12_ROCKCHIP;
+    }
+    return (layout->packing == RAW_PACKING_MIPI) ? RAW_KIND_RAW10_MIPI : RAW_KIND_RAW10_ROCKCHIP;
+}
+
+/**
+ * @brief 在布局上截取感兴趣区域
+ */
+int raw_layout_crop(const raw_layout_t *layout, int left, int top, int width, int height,
+                    raw_layout_t *roi, size_t *offset)
+{
+    if (!layout || !roi || !offset || left < 0 || top < 0 || width < 0 || height < 0)
+    {
+        return -1;
+    }
+
+    int group_bytes, group_pixels;
+    kind_geometry(raw_layout_kind(layout), &group_bytes, &group_pixels);
+
+    // 对齐到打包组和2x2 Bayer周期 (组像素数为1或偶数)
+    int align = (group_pixels < 2) ? 2 : group_pixels;
+    left -= left % align;
+    top &= ~1;
+
+    if (left >= layout->width || top >= layout->height)
+    {
+        return -1;
+    }
+
+    int max_width = layout->width - left;
+    int max_height = layout->height - top;
+
+    *roi = *layout;
+    roi->width = (width == 0 || width > max_width) ? max_width : width;
+    roi->height = (height == 0 || height > max_height) ? max_height : height;
+
+    *offset = (size_t)top * layout->stride + (size_t)(left / group_pixels) * group_bytes;
+    return 0;
+}
+
+/**
+ * @brief 按布局解包一行数据
+ */
+void raw_decode_row(const raw_layout_t *layout, const uint8_t *row, uint16_t *dst)
+{
+    raw_kind_t kind = raw_layout_kind(layout);
+    raw10_unpack_fn fn;
+    raw10_unpack_fn tail_fn;
+
+    // 每行选择一次内核
+    switch (kind)
+    {
+    case RAW_KIND_RAW8:
+        fn = tail_fn = raw8_unpack_groups;
+        break;
+    case RAW_KIND_RAW10_MIPI:
+        fn = current_mipi_unpack;
+        tail_fn = raw10_mipi_unpack_groups_scalar;
+        break;
+    case RAW_KIND_RAW12_ROCKCHIP:
+        fn = tail_fn = raw12_unpack_groups;
+        break;
+    case RAW_KIND_RAW12_MIPI:
+        fn = tail_fn = raw12_mipi_unpack_groups;
+        break;
+    case RAW_KIND_UNPACKED16:
+        fn = tail_fn = (layout->bit_depth == 12) ? raw12_u16_unpack_groups : raw10_u16_unpack_groups;
+        break;
+    case RAW_KIND_RAW10_ROCKCHIP:
+    default:
+        fn = current_unpack;
+        tail_fn = raw10_unpack_groups_scalar;
+        break;
+    }
+
+    int group_bytes, group_pixels;
+    kind_geometry(kind, &group_bytes, &group_pixels);
+
+    size_t groups = (size_t)layout->width / group_pixels;
+    int tail = layout->width % group_pixels;
+
+    fn(row, dst, groups);
+    unpack_tail(tail_fn, row + groups * group_bytes, dst + groups * group_pixels, tail);
+}
+
+/**
+ * @brief 按布局解包整帧为连续的16位像素
+ */
+int raw_decode_image(const raw_layout_t *layout, const uint8_t *data, size_t size, uint16_t *dst)
+{
+    if (!layout || !data || !dst || layout->width <= 0 || layout->height <= 0)
+    {
+        return -1;
+    }
+
+    size_t row_bytes = raw_layout_min_stride(layout->width, layout->bit_depth, layout->packing);
+    if (layout->stride < row_bytes)
+    {
+        return -1;
+    }
+
+    for (int y = 0; y < layout->height; y++)
+    {
+        size_t offset = (size_t)y * layout->stride;
+        uint16_t *out = dst + (size_t)y * layout->width;
+
+        if (offset + row_bytes > size)
+        {
+            // 数据不足的行填充0
+            memset(out, 0, (size_t)(layout->height - y) * layout->width * sizeof(uint16_t));
+            printf("Warning: RAW buffer holds only %d of %d rows\n", y, layout->height);
+            break;
+        }
+
+        raw_decode_row(layout, data + offset, out);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 使用当前内核批量解包RAW10数据 (Rockchip 排列)
+ */
+void raw10_unpack_groups(const uint8_t *src, uint16_t *dst, size_t groups)
+{
+    current_unpack(src, dst, groups);
+}
+
+/**
+ * @brief SBGGR10格式数据解包（标量版本）- 参考v4l2_bench实现
+ * @param raw_bytes 5字节的RAW10数据（包含4个像素）
+ * @param pixels 输出的4个16位像素值
+ */
+void unpack_sbggr10_scalar(const uint8_t raw_bytes[5], uint16_t pixels[4])
+{
+    // 重构40位数据
+    uint64_t combined = ((uint64_t)raw_bytes[4] << 32) |
+                        ((uint64_t)raw_bytes[3] << 24) |
+                        ((uint64_t)raw_bytes[2] << 16) |
+                        ((uint64_t)raw_bytes[1] << 8) |
+                        (uint64_t)raw_bytes[0];
+
+    // 提取4个10位像素值（小端序，从低位开始）
+    pixels[0] = (uint16_t)((combined >> 0) & 0x3FF);
+    pixels[1] = (uint16_t)((combined >> 10) & 0x3FF);
+    pixels[2] = (uint16_t)((combined >> 20) & 0x3FF);
+    pixels[3] = (uint16_t)((combined >> 30) & 0x3FF);
+}
+
+/**
+ * @brief SBGGR10图像数据完整解包函数
+ */
+int unpack_sbggr10_image(const uint8_t *raw_data, size_t raw_size,
+                         uint16_t *output_pixels, int width, int height)
+{
+    if (!raw_data || !output_pixels || raw_size == 0)
+    {
+        return -1;
+    }
+
+    // 验证数据大小（必须是5的倍数）
+    if (raw_size % RAW10_GROUP_BYTES != 0)
+    {
+        printf("Error: RAW data size (%zu) must be multiple of 5\n", raw_size);
+        return -1;
+    }
+
+    size_t expected_pixels = (size_t)width * height;
+    size_t available_pixels = raw_size / RAW10_GROUP_BYTES * RAW10_GROUP_PIXELS;
+
+    if (available_pixels < expected_pixels)
+    {
+        printf("Warning: Not enough RAW data (%zu pixels available, %zu expected)\n",
+               available_pixels, expected_pixels);
+    }
+
+    size_t max_pixels = (available_pixels < expected_pixels) ? available_pixels : expected_pixels;
+
+    // 整组批量解包，不再逐像素做边界检查
+    size_t groups = max_pixels / RAW10_GROUP_PIXELS;
+    current_unpack(raw_data, output_pixels, groups);
+
+    size_t pixel_pos = groups * RAW10_GROUP_PIXELS;
+
+    // 末尾不足一组的像素 (宽高乘积不是4的倍数时)
+    if (pixel_pos < max_pixels)
+    {
+        uint16_t pixels[RAW10_GROUP_PIXELS];
+        unpack_sbggr10_scalar(raw_data + groups * RAW10_GROUP_BYTES, pixels);
+        for (int i = 0; pixel_pos < max_pixels; i++)
+        {
+            output_pixels[pixel_pos++] = pixels[i];
+        }
+    }
+
+    // 填充剩余像素（如果有）
+    if (pixel_pos < expected_pixels)
+    {
+        memset(output_pixels + pixel_pos, 0, (expected_pixels - pixel_pos) * sizeof(uint16_t));
+    }
+
+    return 0;
+}
+
+// ============================================================================
+// 内核实现
+// ============================================================================
+
+/**
+ * @brief 标量参考内核：逐组调用 unpack_sbggr10_scalar
+ */
+void raw10_unpack_groups_scalar(const uint8_t *src, uint16_t *dst, size_t groups)
+{
+    for (size_t g = 0; g < groups; g++)
+    {
+        unpack_sbggr10_scalar(src + g * RAW10_GROUP_BYTES, dst + g * RAW10_GROUP_PIXELS);
+    }
+}
+
+/**
+ * @brief 通用内核：每组一次32位加载加少量移位/掩码，无分支，便于编译器做SLP向量化
+ */
+void raw10_unpack_groups_portable(const uint8_t *src, uint16_t *dst, size_t groups)
+{
+    const uint8_t *__restrict s = src;
+    uint16_t *__restrict d = dst;
+
+    for (size_t g = 0; g < groups; g++)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // 前4字节按小端一次读入，低30位即像素0-2
+        uint32_t v;
+        memcpy(&v, s, sizeof(v));
+#else
+        uint32_t v = (uint32_t)s[0] | ((uint32_t)s[1] << 8) |
+                     ((uint32_t)s[2] << 16) | ((uint32_t)s[3] << 24);
+#endif
+        uint32_t b4 = s[4];
+
+        d[0] = (uint16_t)(v & 0x3FF);
+        d[1] = (uint16_t)((v >> 10) & 0x3FF);
+        d[2] = (uint16_t)((v >> 20) & 0x3FF);
+        d[3] = (uint16_t)((v >> 30) | (b4 << 2));
+
+        s += RAW10_GROUP_BYTES;
+        d += RAW10_GROUP_PIXELS;
+    }
+}
+
+/**
+ * @brief MIPI CSI-2 标量参考内核：字节0-3为像素高8位，字节4依次存放4个像素的低2位
+ */
+void raw10_mipi_unpack_groups_scalar(const uint8_t *src, uint16_t *dst, size_t groups)
+{
+    for (size_t g = 0; g < groups; g++)
+    {
+        const uint8_t *s = src + g * RAW10_GROUP_BYTES;
+        uint16_t *d = dst + g * RAW10_GROUP_PIXELS;
+
+        for (int i = 0; i < RAW10_GROUP_PIXELS; i++)
+        {
+            d[i] = (uint16_t)(((uint16_t)s[i] << 2) | ((s[4] >> (2 * i)) & 0x3));
+        }
+    }
+}
+
+/**
+ * @brief MIPI CSI-2 通用内核：展开的无分支版本
+ */
+void raw10_mipi_unpack_groups_portable(const uint8_t *src, uint16_t *dst, size_t groups)
+{
+    const uint8_t *__restrict s = src;
+    uint16_t *__restrict d = dst;
+
+    for (size_t g = 0; g < groups; g++)
+    {
+        uint32_t lsb = s[4];
+
+        d[0] = (uint16_t)(((uint32_t)s[0] << 2) | (lsb & 0x3));
+        d[1] = (uint16_t)(((uint32_t)s[1] << 2) | ((lsb >> 2) & 0x3));
+        d[2] = (uint16_t)(((uint32_t)s[2] << 2) | ((lsb >> 4) & 0x3));
+        d[3] = (uint16_t)(((uint32_t)s[3] << 2) | (lsb >> 6));
+
+        s += RAW10_GROUP_BYTES;
+        d += RAW10_GROUP_PIXELS;
+    }
+}
+
+/*
+ * 其余格式的单组解包，由 DEFINE_GROUP_KERNEL 展开为各自独立的批量内核。
+ * s 指向组起始字节，d 指向输出像素
+ */
+#define UNPACK_RAW8(s, d) \
+    do { (d)[0] = (s)[0]; } while (0)
+
+// Rockchip RAW12：24位小端，低12位为像素0
+#define UNPACK_RAW12_ROCKCHIP(s, d) \
+    do { \
+        (d)[0] = (uint16_t)((s)[0] | (((s)[1] & 0x0F) << 8)); \
+        (d)[1] = (uint16_t)(((s)[1] >> 4) | ((s)[2] << 4)); \
+    } while (0)
+
+// MIPI RAW12：字节0/1为两个像素的高8位，字节2依次为两者的低4位
+#define UNPACK_RAW12_MIPI(s, d) \
+    do { \
+        (d)[0] = (uint16_t)(((s)[0] << 4) | ((s)[2] & 0x0F)); \
+        (d)[1] = (uint16_t)(((s)[1] << 4) | ((s)[2] >> 4)); \
+    } while (0)
+
+#define UNPACK_U16_10(s, d) \
+    do { (d)[0] = (uint16_t)(((s)[0] | ((s)[1] << 8)) & 0x3FF); } while (0)
+
+#define UNPACK_U16_12(s, d) \
+    do { (d)[0] = (uint16_t)(((s)[0] | ((s)[1] << 8)) & 0xFFF); } while (0)
+
+#define DEFINE_GROUP_KERNEL(name, group_bytes, group_pixels, UNPACK)          \
+    void name(const uint8_t *src, uint16_t *dst, size_t groups)               \
+    {                                                                         \
+        const uint8_t *__restrict s = src;                                    \
+        uint16_t *__restrict d = dst;                                         \
+        for (size_t g = 0; g < groups; g++)                                   \
+        {                                                                     \
+            UNPACK(s, d);                                                     \
+            s += (group_bytes);                                               \
+            d += (group_pixels);                                              \
+        }                                                                     \
+    }
+
+DEFINE_GROUP_KERNEL(raw8_unpack_groups, 1, 1, UNPACK_RAW8)
+DEFINE_GROUP_KERNEL(raw12_unpack_groups, RAW12_GROUP_BYTES, RAW12_GROUP_PIXELS, UNPACK_RAW12_ROCKCHIP)
+DEFINE_GROUP_KERNEL(raw12_mipi_unpack_groups, RAW12_GROUP_BYTES, RAW12_GROUP_PIXELS, UNPACK_RAW12_MIPI)
+DEFINE_GROUP_KERNEL(raw10_u16_unpack_groups, 2, 1, UNPACK_U16_10)
+DEFINE_GROUP_KERNEL(raw12_u16_unpack_groups, 2, 1, UNPACK_U16_12)
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 检测CPU是否支持NEON
+ * @return 1支持，0不支持
+ */
+static int cpu_has_neon(void)
+{
+#if defined(__aarch64__)
+    return 1; // ARMv8 的 AdvSIMD 为必选特性
+#elif defined(__arm__)
+    static int cached = -1;
+    if (cached >= 0)
+    {
+        return cached;
+    }
+
+    cached = 0;
+    int fd = open("/proc/self/auxv", O_RDONLY);
+    if (fd < 0)
+    {
+        return cached;
+    }
+
+    unsigned long entry[2];
+    while (read(fd, entry, sizeof(entry)) == sizeof(entry) && entry[0] != AUXV_AT_NULL)
+    {
+        if (entry[0] == AUXV_AT_HWCAP)
+        {
+            cached = (entry[1] & AUXV_HWCAP_ARM_NEON) ? 1 : 0;
+            break;
+        }
+    }
+    close(fd);
+    return cached;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief 获取内核对应的函数指针
+ * @return 函数指针，当前编译配置不支持时返回NULL
+ */
+static raw10_unpack_fn kernel_function(raw_kernel_t kernel)
+{
+    switch (kernel)
+    {
+    case RAW_KERNEL_SCALAR:
+        return raw10_unpack_groups_scalar;
+    case RAW_KERNEL_PORTABLE:
+        return raw10_unpack_groups_portable;
+    case RAW_KERNEL_NEON:
+#if defined(__arm__) || defined(__aarch64__)
+        return raw10_unpack_groups_neon;
+#else
+        return NULL;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * @brief 获取MIPI排列内核对应的函数指针
+ * @return 函数指针，当前编译配置不支持时返回NULL
+ */
+static raw10_unpack_fn mipi_kernel_function(raw_kernel_t kernel)
+{
+    switch (kernel)
+    {
+    case RAW_KERNEL_SCALAR:
+        return raw10_mipi_unpack_groups_scalar;
+    case RAW_KERNEL_PORTABLE:
+        return raw10_mipi_unpack_groups_portable;
+    case RAW_KERNEL_NEON:
+#if defined(__arm__) || defined(__aarch64__)
+        return raw10_mipi_unpack_groups_neon;
+#else
+        return NULL;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * @brief 获取数据种类的组大小
+ * @param kind 数据种类
+ * @param group_bytes 输出每组字节数
+ * @param group_pixels 输出每组像素数
+ */
+static void kind_geometry(raw_kind_t kind, int *group_bytes, int *group_pixels)
+{
+    switch (kind)
+    {
+    case RAW_KIND_RAW8:
+        *group_bytes = 1;
+        *group_pixels = 1;
+        break;
+    case RAW_KIND_RAW12_ROCKCHIP:
+    case RAW_KIND_RAW12_MIPI:
+        *group_bytes = RAW12_GROUP_BYTES;
+        *group_pixels = RAW12_GROUP_PIXELS;
+        break;
+    case RAW_KIND_UNPACKED16:
+        *group_bytes = 2;
+        *group_pixels = 1;
+        break;
+    case RAW_KIND_RAW10_ROCKCHIP:
+    case RAW_KIND_RAW10_MIPI:
+    default:
+        *group_bytes = RAW10_GROUP_BYTES;
+        *group_pixels = RAW10_GROUP_PIXELS;
+        break;
+    }
+}
+
+/**
+ * @brief 解包行尾不足一组的像素
+ * @param scalar 对应格式的标量内核
+ * @param group 最后一个 (不完整的) 组
+ * @param dst 输出位置
+ * @param count 像素数 (小于每组像素数)
+ */
+static void unpack_tail(raw10_unpack_fn scalar, const uint8_t *group, uint16_t *dst, int count)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    uint16_t pixels[RAW10_GROUP_PIXELS];
+    scalar(group, pixels, 1);
+    memcpy(dst, pixels, count * sizeof(uint16_t));
+}
+
+/**
+ * @brief 用伪随机数据比对内核与标量参考实现的输出
+ * @return 0一致，-1不一致
+ */
+static int kernel_selftest(raw10_unpack_fn fn, raw10_unpack_fn reference)
+{
+    uint8_t raw[RAW_SELFTEST_GROUPS * RAW10_GROUP_BYTES];
+    uint16_t expected[RAW_SELFTEST_GROUPS * RAW10_GROUP_PIXELS];
+    uint16_t actual[RAW_SELFTEST_GROUPS * RAW10_GROUP_PIXELS];
+
+    uint32_t seed = 0x12345678u;
+    for (size_t i = 0; i < sizeof(raw); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        raw[i] = (uint8_t)(seed >> 24);
+    }
+
+    reference(raw, expected, RAW_SELFTEST_GROUPS);
+
+    // 分别测试整批和非16像素对齐的长度，覆盖向量主循环和尾部处理
+    memset(actual, 0, sizeof(actual));
+    fn(raw, actual, RAW_SELFTEST_GROUPS);
+    if (memcmp(actual, expected, sizeof(actual)) != 0)
+    {
+        return -1;
+    }
+
+    memset(actual, 0, sizeof(actual));
+    fn(raw, actual, RAW_SELFTEST_GROUPS - 3);
+    if (memcmp(actual, expected, (RAW_SELFTEST_GROUPS - 3) * RAW10_GROUP_PIXELS * sizeof(uint16_t)) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file raw_decode_neon.c
+ * @brief RAW10解包NEON内核 (Rockchip / MIPI CSI-2 排列)
+ * @details 本文件单独以 -mfpu=neon 编译 (见 CMakeLists.txt)，
+ *          仅在 raw_decode_init 检测到 HWCAP_NEON 后才会被调用
+ */
+
+#include "raw_decode.h"
+
+#if defined(__arm__) || defined(__aarch64__)
+
+#include <arm_neon.h>
+
+/*
+ * 每个5字节组内第 i 个像素 = (字节[i] | 字节[i+1] << 8) >> (2*i) & 0x3FF
+ * 因此先用查表指令把每个像素的低/高字节搬到各自的通道，
+ * 拼成16位后再做逐通道移位和掩码。一次处理4组 (20字节 -> 16像素)。
+ */
+
+// 两组 (10字节) 内8个像素对应的低字节/高字节下标
+static const uint8_t lo_index[16] = {0, 1, 2, 3, 5, 6, 7, 8,
+                                     6, 7, 8, 9, 11, 12, 13, 14};
+static const uint8_t hi_index[16] = {1, 2, 3, 4, 6, 7, 8, 9,
+                                     7, 8, 9, 10, 12, 13, 14, 15};
+static const int16_t lane_shift[8] = {0, -2, -4, -6, 0, -2, -4, -6};
+
+/**
+ * @brief NEON内核：每次迭代解包16像素
+ */
+void raw10_unpack_groups_neon(const uint8_t *src, uint16_t *dst, size_t groups)
+{
+    const uint8x8_t lo_a = vld1_u8(lo_index);
+    const uint8x8_t hi_a = vld1_u8(hi_index);
+    const uint8x8_t lo_b = vld1_u8(lo_index + 8);
+    const uint8x8_t hi_b = vld1_u8(hi_index + 8);
+    const int16x8_t shift = vld1q_s16(lane_shift);
+    const uint16x8_t mask = vdupq_n_u16(0x3FF);
+
+    while (groups >= 4)
+    {
+        // a: 字节0-15 (第0、1组)；b: 字节4-19 (第2、3组位于其中的6-15)
+        // 两次加载都不会越过本次迭代的20字节
+        uint8x16_t a = vld1q_u8(src);
+        uint8x16_t b = vld1q_u8(src + 4);
+        uint8x8x2_t ta = {{vget_low_u8(a), vget_high_u8(a)}};
+        uint8x8x2_t tb = {{vget_low_u8(b), vget_high_u8(b)}};
+
+        uint16x8_t w0 = vorrq_u16(vmovl_u8(vtbl2_u8(ta, lo_a)), vshll_n_u8(vtbl2_u8(ta, hi_a), 8));
+        uint16x8_t w1 = vorrq_u16(vmovl_u8(vtbl2_u8(tb, lo_b)), vshll_n_u8(vtbl2_u8(tb, hi_b), 8));
+
+        vst1q_u16(dst, vandq_u16(vshlq_u16(w0, shift), mask));
+        vst1q_u16(dst + 8, vandq_u16(vshlq_u16(w1, shift), mask));
+
+        src += 20;
+        dst += 16;
+        groups -= 4;
+    }
+
+    // 剩余不足4组的部分交给通用实现
+    if (groups)
+    {
+        raw10_unpack_groups_portable(src, dst, groups);
+    }
+}
+
+/*
+ * MIPI CSI-2 排列：每组字节0-3为像素高8位，字节4为4个像素的低2位。
+ * 高8位字节和共享的低位字节分别查表搬到各通道，高位左移2位，
+ * 低位逐通道右移 0/2/4/6 后取低2位。加载方式与上面相同。
+ */
+
+// 两组 (10字节) 内8个像素对应的高8位字节/低2位字节下标
+static const uint8_t mipi_msb_index[16] = {0, 1, 2, 3, 5, 6, 7, 8,
+                                           6, 7, 8, 9, 11, 12, 13, 14};
+static const uint8_t mipi_lsb_index[16] = {4, 4, 4, 4, 9, 9, 9, 9,
+                                           10, 10, 10, 10, 15, 15, 15, 15};
+
+/**
+ * @brief MIPI CSI-2 NEON内核：每次迭代解包16像素
+ */
+void raw10_mipi_unpack_groups_neon(const uint8_t *src, uint16_t *dst, size_t groups)
+{
+    const uint8x8_t msb_a = vld1_u8(mipi_msb_index);
+    const uint8x8_t lsb_a = vld1_u8(mipi_lsb_index);
+    const uint8x8_t msb_b = vld1_u8(mipi_msb_index + 8);
+    const uint8x8_t lsb_b = vld1_u8(mipi_lsb_index + 8);
+    const int16x8_t shift = vld1q_s16(lane_shift);
+    const uint16x8_t mask = vdupq_n_u16(0x3);
+
+    while (groups >= 4)
+    {
+        uint8x16_t a = vld1q_u8(src);
+        uint8x16_t b = vld1q_u8(src + 4);
+        uint8x8x2_t ta = {{vget_low_u8(a), vget_high_u8(a)}};
+        uint8x8x2_t tb = {{vget_low_u8(b), vget_high_u8(b)}};
+
+        uint16x8_t l0 = vandq_u16(vshlq_u16(vmovl_u8(vtbl2_u8(ta, lsb_a)), shift), mask);
+        uint16x8_t l1 = vandq_u16(vshlq_u16(vmovl_u8(vtbl2_u8(tb, lsb_b)), shift), mask);
+
+        vst1q_u16(dst, vorrq_u16(vshll_n_u8(vtbl2_u8(ta, msb_a), 2), l0));
+        vst1q_u16(dst + 8, vorrq_u16(vshll_n_u8(vtbl2_u8(tb, msb_b), 2), l1));
+
+        src += 20;
+        dst += 16;
+        groups -= 4;
+    }
+
+    if (groups)
+    {
+        raw10_mipi_unpack_groups_portable(src, dst, groups);
+    }
+}
+
+#endif /* __arm__ || __aarch64__ */
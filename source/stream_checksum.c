@@ -0,0 +1,166 @@
+/**
+ * @file stream_checksum.c
+ * @brief 帧负载校验和模块 (xxHash32)
+ * @details 与参考实现 XXH32(data, size, 0) 的结果相同，数据按小端读取
+ */
+
+#include <string.h>
+
+#include "stream_checksum.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define PRIME1 0x9E3779B1u
+#define PRIME2 0x85EBCA77u
+#define PRIME3 0xC2B2AE3Du
+#define PRIME4 0x27D4EB2Fu
+#define PRIME5 0x165667B1u
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static inline uint32_t rotl32(uint32_t x, int r);
+static inline uint32_t read32(const uint8_t *p);
+static inline uint32_t round32(uint32_t acc, uint32_t input);
+static const uint8_t *consume_stripes(uint32_t lane[4], const uint8_t *p, const uint8_t *end);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 开始计算
+ */
+void stream_checksum_init(stream_checksum_t *state)
+{
+    memset(state, 0, sizeof(*state));
+    state->lane[0] = PRIME1 + PRIME2;
+    state->lane[1] = PRIME2;
+    state->lane[2] = 0;
+    state->lane[3] = 0u - PRIME1;
+}
+
+/**
+ * @brief 输入一段数据
+ */
+void stream_checksum_update(stream_checksum_t *state, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = p + size;
+    state->total += size;
+
+    // 先补齐上次剩下的不足16字节
+    if (state->pending_len > 0)
+    {
+        size_t fill = sizeof(state->pending) - state->pending_len;
+        if (size < fill)
+        {
+            memcpy(state->pending + state->pending_len, p, size);
+            state->pending_len += size;
+            return;
+        }
+        memcpy(state->pending + state->pending_len, p, fill);
+        consume_stripes(state->lane, state->pending, state->pending + sizeof(state->pending));
+        p += fill;
+        state->pending_len = 0;
+    }
+
+    p = consume_stripes(state->lane, p, end);
+
+    state->pending_len = (size_t)(end - p);
+    memcpy(state->pending, p, state->pending_len);
+}
+
+/**
+ * @brief 结束计算
+ */
+uint32_t stream_checksum_final(const stream_checksum_t *state)
+{
+    uint32_t h;
+    if (state->total >= 16)
+    {
+        h = rotl32(state->lane[0], 1) + rotl32(state->lane[1], 7) +
+            rotl32(state->lane[2], 12) + rotl32(state->lane[3], 18);
+    }
+    else
+    {
+        h = state->lane[2] + PRIME5; // lane[2] 仍为种子
+    }
+    h += (uint32_t)state->total;
+
+    const uint8_t *p = state->pending;
+    const uint8_t *end = p + state->pending_len;
+    while (end - p >= 4)
+    {
+        h = rotl32(h + read32(p) * PRIME3, 17) * PRIME4;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h = rotl32(h + (*p++) * PRIME5, 11) * PRIME1;
+    }
+
+    h ^= h >> 15;
+    h *= PRIME2;
+    h ^= h >> 13;
+    h *= PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief 计算一块连续数据的校验和
+ */
+uint32_t stream_checksum(const void *data, size_t size)
+{
+    stream_checksum_t state;
+    stream_checksum_init(&state);
+    stream_checksum_update(&state, data, size);
+    return stream_checksum_final(&state);
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+static inline uint32_t rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v)); // 设备和主机均为小端
+    return v;
+}
+
+static inline uint32_t round32(uint32_t acc, uint32_t input)
+{
+    return rotl32(acc + input * PRIME2, 13) * PRIME1;
+}
+
+/**
+ * @brief 处理所有完整的16字节块
+ * @return 第一个未处理的字节
+ */
+static const uint8_t *consume_stripes(uint32_t lane[4], const uint8_t *p, const uint8_t *end)
+{
+    uint32_t v0 = lane[0], v1 = lane[1], v2 = lane[2], v3 = lane[3];
+    while (end - p >= 16)
+    {
+        v0 = round32(v0, read32(p));
+        v1 = round32(v1, read32(p + 4));
+        v2 = round32(v2, read32(p + 8));
+        v3 = round32(v3, read32(p + 12));
+        p += 16;
+    }
+    lane[0] = v0;
+    lane[1] = v1;
+    lane[2] = v2;
+    lane[3] = v3;
+    return p;
+}
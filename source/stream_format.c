@@ -0,0 +1,442 @@
+/**
+ * @file stream_format.c
+ * @brief TCP帧流的帧格式化模块
+ * @details 作为流服务器的格式化回调，在服务器线程中为每个客户端生成同步标识、帧头和负载分段。
+ *          负载尽量直接指向驱动缓冲区 (零拷贝)；合并、压扩和按客户端视图压缩的结果写入客户端私有缓冲区。
+ *          本模块不依赖显示和采集代码，主机端工具用它在回环测试中复现设备的发送路径
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "raw_bin.h"
+#include "raw_codec.h"
+#include "raw_compand.h"
+#include "stream_checksum.h"
+#include "stream_format.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+// 客户端私有缓冲区编号 (stream_client_scratch)
+#define SCRATCH_BINNED 0    // 合并后的数据
+#define SCRATCH_BIN_WORK 1  // 合并工作区 (合并完成后也用作压扩的解包行)
+#define SCRATCH_CODED 2     // 按客户端视图压缩的数据
+#define SCRATCH_COMPANDED 3 // 压扩后的8位码值
+
+// ============================================================================
+// 全局变量
+// ============================================================================
+
+// 压缩统计 (只在服务器线程中更新)
+static struct {
+    uint32_t frames;           // 本统计周期内压缩的帧数
+    uint64_t raw_bytes;        // 原始数据字节数
+    uint64_t coded_bytes;      // 压缩后字节数 (不可压缩的帧按原始大小计)
+    uint64_t encode_ns;        // 压缩耗时
+} codec_stats;
+
+// 压扩统计 (只在服务器线程中更新)
+static struct {
+    uint32_t frames;           // 本统计周期内压扩的帧数
+    uint64_t raw_bytes;        // 压扩前的数据字节数
+    uint64_t companded_bytes;  // 压扩后字节数
+    uint64_t map_ns;           // 压扩耗时
+} compand_stats;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static size_t encode_stream_roi(const raw_layout_t *roi, const uint8_t *data, size_t rows,
+                                uint8_t *dst, size_t capacity);
+static int compress_stream_frame(frame_ref_t *ref, const raw_layout_t *roi, const uint8_t *data, size_t rows);
+static uint8_t *compand_stream_roi(stream_client_t *client, const raw_compand_t *table, const raw_layout_t *roi,
+                                   const uint8_t *data, size_t rows);
+static void get_stream_roi(const stream_format_config_t *config, frame_ref_t *ref, const stream_view_t *view,
+                           raw_layout_t *roi, const uint8_t **roi_data, size_t *roi_size);
+static void get_roi_origin(const raw_layout_t *roi, size_t offset, int *left, int *top);
+static uint64_t monotonic_ns(void);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 生成发送给客户端的帧
+ * @details 只发送裁剪区域 (ROI)，每行去掉区域外的字节和行尾填充。区域默认为设备配置的
+ *          裁剪区域，客户端可以请求自己的区域和合并系数 (stream_view_request_t)。
+ *          同步标识、帧头和数据组成 iovec 一次提交 (区域行连续时数据为一段，
+ *          否则每行一段)，启用零拷贝时数据直接从驱动缓冲区发出；
+ *          合并后的数据写入客户端私有缓冲区，按普通方式发送。
+ *          启用压缩时发送 raw_codec 压缩流，帧头 reserved[0] 为 RAW_CODEC_FOURCC、
+ *          reserved[1] 为解压后的大小；默认视图的压缩结果保存在帧描述符的派生数据中，
+ *          同一帧发给多个客户端只压缩一次。不可压缩的帧照常发送原始数据。
+ *          选择了压扩曲线的客户端得到每像素1字节的码值 (在合并之后、代替压缩)，
+ *          编码为 RAW_COMPAND_FOURCC，解码后大小等于负载大小。
+ *          选择了 v2 帧头的客户端另外得到采集序号、丢帧数、曝光增益、区域位置和可选的负载校验和，
+ *          以及码率控制的级别和生效的调整
+ */
+int stream_format_frame(stream_client_t *client, frame_ref_t *ref, stream_frame_t *frame, void *user)
+{
+    const stream_format_config_t *config = user;
+
+    // 码率控制可以在客户端的设置之上附加合并和压缩
+    const stream_view_t *view = &client->view;
+    int bin_factor = (view->binning > 1 ? view->binning : 1) * client->rate.binning;
+    if (bin_factor > STREAM_BINNING_MAX)
+    {
+        bin_factor = STREAM_BINNING_MAX;
+    }
+    int compress = config->compress || client->rate.compress;
+    int shared_view = (view->width == 0 && view->height == 0 && bin_factor <= 1);
+
+    raw_layout_t roi;
+    const uint8_t *data;
+    size_t size;
+    get_stream_roi(config, ref, view, &roi, &data, &size);
+
+    // 合并前的区域布局和偏移 (v2 帧头中的区域位置)
+    raw_layout_t roi_source = roi;
+    size_t roi_offset = (size_t)(data - (const uint8_t *)ref->frame.data);
+
+    size_t row_bytes = raw_layout_min_stride(roi.width, roi.bit_depth, roi.packing);
+    size_t rows = (size >= row_bytes) ? (size - row_bytes) / roi.stride + 1 : 0;
+    if (rows > (size_t)roi.height)
+    {
+        rows = roi.height;
+    }
+
+    // 合并到私有缓冲区 (区域小于一个合并单元时按原样发送)
+    int binning = 1;
+    raw_layout_t binned;
+    int binned_rows;
+    if (bin_factor > 1 && rows > 0 &&
+        raw_bin_layout(&roi, (int)rows, bin_factor, &binned, &binned_rows) == 0)
+    {
+        size_t binned_size = binned.stride * (size_t)binned_rows;
+        void *workspace = stream_client_scratch(client, SCRATCH_BIN_WORK, raw_bin_workspace_size(&roi));
+        uint8_t *binned_data = stream_client_scratch(client, SCRATCH_BINNED, binned_size);
+        if (!workspace || !binned_data ||
+            raw_bin_image(&roi, data, (int)rows, bin_factor, binned_data, binned_size, workspace) != 0)
+        {
+            printf("Error: Failed to bin frame for stream client #%d\n", client->id);
+            return -1;
+        }
+
+        roi = binned;
+        data = binned_data;
+        rows = (size_t)binned_rows;
+        row_bytes = binned.stride;
+        binning = bin_factor;
+        frame->private_data = 1;
+    }
+
+    // 压扩到私有缓冲区 (RAW8 等不支持的位深照常发送)
+    size_t raw_size = row_bytes * rows;
+    uint32_t encoding = 0;
+    static struct iovec coded;
+    coded.iov_len = 0;
+    const raw_compand_t *compand = raw_compand_get((raw_compand_curve_t)client->compand, roi.bit_depth);
+    if (compand && rows > 0)
+    {
+        uint8_t *companded = compand_stream_roi(client, compand, &roi, data, rows);
+        if (!companded)
+        {
+            return -1;
+        }
+
+        raw_size = (size_t)roi.width * rows;
+        coded.iov_base = companded;
+        coded.iov_len = raw_size;
+        encoding = RAW_COMPAND_FOURCC;
+        frame->private_data = 1;
+        compress = 0;
+    }
+
+    // 默认视图共用帧描述符中的压缩结果，自定义视图压缩到私有缓冲区
+    if (compress && rows > 0)
+    {
+        if (shared_view)
+        {
+            if (compress_stream_frame(ref, &roi, data, rows) == 0)
+            {
+                coded.iov_base = ref->aux;
+                coded.iov_len = ref->aux_size;
+            }
+        }
+        else
+        {
+            uint8_t *buffer = stream_client_scratch(client, SCRATCH_CODED, raw_size);
+            if (buffer)
+            {
+                coded.iov_base = buffer;
+                coded.iov_len = encode_stream_roi(&roi, data, rows, buffer, raw_size);
+                frame->private_data |= (coded.iov_len > 0);
+            }
+        }
+    }
+
+    if (compress && coded.iov_len > 0)
+    {
+        encoding = RAW_CODEC_FOURCC;
+    }
+
+    static struct iovec whole;
+    if (coded.iov_len > 0)
+    {
+        frame->segments = &coded;
+        frame->segment_count = 1;
+    }
+    else if (row_bytes == roi.stride || rows <= 1)
+    {
+        // 行间无间隙时整块发送
+        whole.iov_base = (void *)data;
+        whole.iov_len = raw_size;
+        frame->segments = &whole;
+        frame->segment_count = 1;
+    }
+    else
+    {
+        // 逐行分段 (段表随区域行数增长，只在服务器线程中使用，发送模块会复制)
+        static struct iovec *row_iov = NULL;
+        static size_t row_iov_capacity = 0;
+        if (rows > row_iov_capacity)
+        {
+            struct iovec *grown = realloc(row_iov, rows * sizeof(*row_iov));
+            if (!grown)
+            {
+                printf("Error: Failed to allocate %zu row segments\n", rows);
+                return -1;
+            }
+            row_iov = grown;
+            row_iov_capacity = rows;
+        }
+
+        for (size_t y = 0; y < rows; y++)
+        {
+            row_iov[y].iov_base = (void *)(data + y * roi.stride);
+            row_iov[y].iov_len = row_bytes;
+        }
+        frame->segments = row_iov;
+        frame->segment_count = (int)rows;
+    }
+
+    // 帧前缀：同步标识 + 帧头 (v1 或客户端选择的 v2)
+    uint32_t payload_size = coded.iov_len > 0 ? (uint32_t)coded.iov_len : (uint32_t)raw_size;
+    memcpy(frame->prefix, STREAM_FRAME_SYNC, STREAM_FRAME_SYNC_LEN);
+    if (client->header_version < 2)
+    {
+        struct frame_header header = {
+            .magic = STREAM_FRAME_MAGIC,
+            .frame_id = client->frame_id,
+            .width = roi.width,
+            .height = rows,
+            .pixfmt = config->format->fourcc,
+            .size = payload_size,
+            .timestamp = ref->meta.timestamp,
+            .reserved = {encoding, encoding ? (uint32_t)raw_size : 0}};
+        memcpy(frame->prefix + STREAM_FRAME_SYNC_LEN, &header, sizeof(header));
+        frame->prefix_len = STREAM_FRAME_SYNC_LEN + sizeof(header);
+        return 0;
+    }
+
+    // 丢帧数：采集序号的间隔减去抽帧有意跳过的帧 (码率控制刚调整时可能少算或多算一次)；
+    // 补发帧穿插在实时帧之间，不参与计算
+    int decimation = client->decimation * client->rate.decimation;
+    uint32_t dropped = 0;
+    if (!client->sending_catchup)
+    {
+        if (client->last_sequence != 0)
+        {
+            uint32_t gap = ref->meta.sequence - client->last_sequence - 1;
+            uint32_t skipped = (uint32_t)(decimation > 1 ? decimation - 1 : 0);
+            dropped = gap > skipped ? gap - skipped : 0;
+        }
+        client->last_sequence = ref->meta.sequence;
+    }
+
+    int roi_left, roi_top;
+    get_roi_origin(&roi_source, roi_offset, &roi_left, &roi_top);
+
+    struct timespec realtime;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    uint64_t send_ns = monotonic_ns();
+
+    frame_header_v2_t header = {
+        .magic = STREAM_FRAME_MAGIC,
+        .version = 2,
+        .header_size = sizeof(frame_header_v2_t),
+        .frame_id = client->frame_id,
+        .sequence = ref->meta.sequence,
+        .dropped = dropped,
+        .width = roi.width,
+        .height = rows,
+        .pixfmt = config->format->fourcc,
+        .size = payload_size,
+        .encoding = encoding,
+        .raw_size = raw_size,
+        .capture_ns = ref->meta.timestamp,
+        .send_ns = send_ns,
+        .realtime_offset_ns = (int64_t)realtime.tv_sec * 1000000000LL + realtime.tv_nsec - (int64_t)send_ns,
+        .exposure = ref->meta.exposure,
+        .gain = ref->meta.gain,
+        .roi_left = roi_left,
+        .roi_top = roi_top,
+        .binning = binning,
+        .flags = (uint16_t)(client->header_flags | (client->sending_catchup ? STREAM_FRAME_CATCHUP : 0)),
+        .checksum = 0,
+        .rate_level = (uint16_t)client->rate.level,
+        .rate_flags = stream_rate_flags(&client->rate),
+        .decimation = (uint32_t)(decimation > 0 ? decimation : 1)};
+
+    if (client->header_flags & STREAM_HEADER_CHECKSUM)
+    {
+        stream_checksum_t checksum;
+        stream_checksum_init(&checksum);
+        for (int i = 0; i < frame->segment_count; i++)
+        {
+            stream_checksum_update(&checksum, frame->segments[i].iov_base, frame->segments[i].iov_len);
+        }
+        header.checksum = stream_checksum_final(&checksum);
+    }
+
+    memcpy(frame->prefix + STREAM_FRAME_SYNC_LEN, &header, sizeof(header));
+    frame->prefix_len = STREAM_FRAME_SYNC_LEN + sizeof(header);
+    return 0;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 压缩一块区域并更新压缩统计
+ * @return 压缩数据大小，0表示不可压缩 (应发送原始数据)
+ */
+static size_t encode_stream_roi(const raw_layout_t *roi, const uint8_t *data, size_t rows,
+                                uint8_t *dst, size_t capacity)
+{
+    uint64_t start_ns = monotonic_ns();
+    size_t raw_size = raw_codec_raw_size(roi, (int)rows);
+    size_t coded_size = 0;
+    if (raw_codec_encode(roi, data, (int)rows, dst, capacity, &coded_size) != 0)
+    {
+        coded_size = 0;
+    }
+
+    codec_stats.frames++;
+    codec_stats.raw_bytes += raw_size;
+    codec_stats.coded_bytes += coded_size ? coded_size : raw_size;
+    codec_stats.encode_ns += monotonic_ns() - start_ns;
+    if (codec_stats.frames >= 100)
+    {
+        printf("Stream codec: ratio %.2f, %.1f ms/frame over %u frames\n",
+               (double)codec_stats.raw_bytes / codec_stats.coded_bytes,
+               codec_stats.encode_ns / 1e6 / codec_stats.frames, codec_stats.frames);
+        memset(&codec_stats, 0, sizeof(codec_stats));
+    }
+
+    return coded_size;
+}
+
+/**
+ * @brief 压缩一帧的裁剪区域，结果保存在帧描述符的派生数据中 (已压缩过则直接复用)
+ * @return 0成功 (ref->aux 中为压缩流)，-1不可压缩或内存不足 (应发送原始数据)
+ */
+static int compress_stream_frame(frame_ref_t *ref, const raw_layout_t *roi, const uint8_t *data, size_t rows)
+{
+    if (ref->aux_tag == RAW_CODEC_FOURCC)
+    {
+        return ref->aux_size > 0 ? 0 : -1;
+    }
+
+    size_t raw_size = raw_codec_raw_size(roi, (int)rows);
+    uint8_t *buffer = frame_pool_aux_reserve(ref, raw_size);
+    ref->aux_tag = RAW_CODEC_FOURCC;
+    ref->aux_size = buffer ? encode_stream_roi(roi, data, rows, buffer, raw_size) : 0;
+    return ref->aux_size > 0 ? 0 : -1;
+}
+
+/**
+ * @brief 把一块区域压扩到客户端私有缓冲区并更新压扩统计
+ * @return 码值 (roi->width * rows 字节)，失败返回NULL
+ */
+static uint8_t *compand_stream_roi(stream_client_t *client, const raw_compand_t *table, const raw_layout_t *roi,
+                                   const uint8_t *data, size_t rows)
+{
+    uint64_t start_ns = monotonic_ns();
+    size_t size = (size_t)roi->width * rows;
+    void *workspace = stream_client_scratch(client, SCRATCH_BIN_WORK, raw_compand_workspace_size(roi));
+    uint8_t *buffer = stream_client_scratch(client, SCRATCH_COMPANDED, size);
+    if (!workspace || !buffer || raw_compand_image(table, roi, data, (int)rows, buffer, size, workspace) != 0)
+    {
+        printf("Error: Failed to compand frame for stream client #%d\n", client->id);
+        return NULL;
+    }
+
+    compand_stats.frames++;
+    compand_stats.raw_bytes += raw_layout_min_stride(roi->width, roi->bit_depth, roi->packing) * rows;
+    compand_stats.companded_bytes += size;
+    compand_stats.map_ns += monotonic_ns() - start_ns;
+    if (compand_stats.frames >= 100)
+    {
+        printf("Stream compand: %.0f%% of RAW size, %.1f ms/frame over %u frames\n",
+               100.0 * compand_stats.companded_bytes / compand_stats.raw_bytes,
+               compand_stats.map_ns / 1e6 / compand_stats.frames, compand_stats.frames);
+        memset(&compand_stats, 0, sizeof(compand_stats));
+    }
+
+    return buffer;
+}
+
+/**
+ * @brief 按客户端请求的视图截取区域 (不复制数据)
+ * @details 视图未指定区域时使用设备的裁剪区域，区域无效 (如超出图像) 时使用整帧
+ */
+static void get_stream_roi(const stream_format_config_t *config, frame_ref_t *ref, const stream_view_t *view,
+                           raw_layout_t *roi, const uint8_t **roi_data, size_t *roi_size)
+{
+    const media_frame_t *frame = &ref->frame;
+    raw_layout_t layout;
+    raw_layout_detect(&layout, config->format, frame->width, frame->height, config->stride,
+                      frame->size, config->packing);
+
+    int custom = (view->width > 0 || view->height > 0);
+    size_t offset = 0;
+    if (raw_layout_crop(&layout, custom ? view->left : config->crop_left, custom ? view->top : config->crop_top,
+                        custom ? view->width : config->crop_width, custom ? view->height : config->crop_height,
+                        roi, &offset) != 0 ||
+        offset >= frame->size)
+    {
+        *roi = layout;
+        offset = 0;
+    }
+
+    *roi_data = (const uint8_t *)frame->data + offset;
+    *roi_size = frame->size - offset;
+}
+
+/**
+ * @brief 由区域首字节在帧内的偏移计算区域左上角 (整帧坐标)
+ * @details 区域左边界总是对齐到打包组，组内字节数与像素数成正比
+ */
+static void get_roi_origin(const raw_layout_t *roi, size_t offset, int *left, int *top)
+{
+    size_t bits = (raw_layout_kind(roi) == RAW_KIND_UNPACKED16) ? 16 : (size_t)roi->bit_depth;
+    *top = (int)(offset / roi->stride);
+    *left = (int)((offset % roi->stride) * 8 / bits);
+}
+
+/**
+ * @brief 获取单调时钟纳秒数 (与采集时间戳同一时钟)
+ */
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file stream_rate.c
+ * @brief TCP帧流的自适应码率控制
+ * @details 链路吞吐只在发送端有积压 (数据来不及交给内核) 时测量，此时对端确认的速率
+ *          就是链路能提供的速率；排队延迟 = (未确认字节 + 积压字节) / 链路吞吐。
+ *          降级间隔短 (尽快止住延迟增长)，升级间隔长，并且要求按当前发送速率推算
+ *          恢复后的速率仍低于链路吞吐的七成，避免在两级之间来回切换。
+ *          链路吞吐可能在降级期间变好而无法测到，因此长时间没有积压时也试探升一级
+ */
+
+#include <string.h>
+
+#include "stream_protocol.h"
+#include "stream_rate.h"
+
+#define NS_PER_MS 1000000ULL
+#define DEGRADE_HOLD_MS 500         // 两次降级的最小间隔
+#define UPGRADE_HOLD_MS 2000        // 调整后到升级的最小间隔
+#define PROBE_HOLD_MS 10000         // 无积压时试探升级的间隔
+#define UPGRADE_HEADROOM 0.7        // 推算速率须低于链路吞吐的比例
+#define SMOOTHING 0.3               // 指数平滑系数
+
+/**
+ * @brief 降级阶梯的一级
+ */
+typedef struct {
+    int decimation;         // 该级设置的附加抽帧系数 (0为不改变)
+    int binning;            // 该级设置的附加合并系数 (0为不改变)
+    int compress;           // 该级是否启用压缩
+    uint32_t requires;      // 需要的许可 (stream_rate_allow_t)，0为总是可用
+    double reduction;       // 该级使发送速率降低的倍数 (用于推算升级后的速率)
+} rate_step_t;
+
+// 先用无损手段，再丢帧；合并只降低分辨率，放在第一次抽帧之后
+static const rate_step_t rate_ladder[STREAM_RATE_MAX_STEPS] = {
+    {0, 0, 1, STREAM_RATE_ALLOW_COMPRESS, 2.0},
+    {2, 0, 0, 0, 2.0},
+    {0, 2, 0, STREAM_RATE_ALLOW_BINNING, 4.0},
+    {4, 0, 0, 0, 2.0},
+    {8, 0, 0, 0, 2.0},
+    {16, 0, 0, 0, 2.0},
+};
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static const rate_step_t *level_step(const stream_rate_t *rate, int level);
+static void apply_level(stream_rate_t *rate, int level, uint64_t now_ns);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化控制器
+ */
+void stream_rate_init(stream_rate_t *rate, int max_latency_ms, uint32_t allow)
+{
+    memset(rate, 0, sizeof(*rate));
+    rate->max_latency_ms = max_latency_ms > 0 ? max_latency_ms : 0;
+    rate->allow = allow;
+    while (level_step(rate, rate->max_level + 1))
+    {
+        rate->max_level++;
+    }
+    apply_level(rate, 0, 0);
+    rate->changes = 0;
+}
+
+/**
+ * @brief 提供一次采样并按需调整级别
+ */
+int stream_rate_update(stream_rate_t *rate, uint64_t now_ns, uint64_t sent_bytes,
+                       uint32_t unacked_bytes, uint64_t backlog_bytes)
+{
+    if (rate->max_latency_ms <= 0)
+    {
+        return 0;
+    }
+
+    uint64_t acked = sent_bytes > unacked_bytes ? sent_bytes - unacked_bytes : 0;
+    if (rate->last_ns == 0)
+    {
+        rate->last_ns = now_ns;
+        rate->last_sent = sent_bytes;
+        rate->last_acked = acked;
+        rate->changed_ns = now_ns;
+        return 0;
+    }
+    if (now_ns - rate->last_ns < STREAM_RATE_INTERVAL_MS * NS_PER_MS)
+    {
+        return 0;
+    }
+
+    double seconds = (double)(now_ns - rate->last_ns) / 1e9;
+    double sent_rate = (double)(sent_bytes - rate->last_sent) / seconds;
+    double acked_rate = (double)(acked - rate->last_acked) / seconds;
+    rate->send_rate += SMOOTHING * (sent_rate - rate->send_rate);
+
+    // 有积压时的确认速率即链路吞吐
+    uint64_t queued = (uint64_t)unacked_bytes + backlog_bytes;
+    if (backlog_bytes > 0 && acked_rate > 0)
+    {
+        rate->capacity = rate->capacity > 0 ? rate->capacity + SMOOTHING * (acked_rate - rate->capacity) : acked_rate;
+    }
+
+    // 排队延迟；有积压却没有任何确认时按停顿时长计
+    if (queued > 0 && acked == rate->last_acked)
+    {
+        if (rate->stall_ns == 0)
+        {
+            rate->stall_ns = rate->last_ns;
+        }
+    }
+    else
+    {
+        rate->stall_ns = 0;
+    }
+    rate->delay_ms = rate->capacity > 0 ? (double)queued * 1000.0 / rate->capacity : 0.0;
+    if (rate->stall_ns)
+    {
+        rate->delay_ms += (double)(now_ns - rate->stall_ns) / 1e6;
+    }
+
+    rate->last_ns = now_ns;
+    rate->last_sent = sent_bytes;
+    rate->last_acked = acked;
+
+    uint64_t since_ms = (now_ns - rate->changed_ns) / NS_PER_MS;
+    if (rate->delay_ms > rate->max_latency_ms)
+    {
+        if (rate->level < rate->max_level && since_ms >= DEGRADE_HOLD_MS)
+        {
+            apply_level(rate, rate->level + 1, now_ns);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (rate->level > 0 && rate->delay_ms < rate->max_latency_ms / 2.0 && since_ms >= UPGRADE_HOLD_MS)
+    {
+        double projected = rate->send_rate * level_step(rate, rate->level)->reduction;
+        int fits = rate->capacity > 0 && projected < rate->capacity * UPGRADE_HEADROOM;
+        int probe = backlog_bytes == 0 && since_ms >= PROBE_HOLD_MS;
+        if (fits || probe)
+        {
+            apply_level(rate, rate->level - 1, now_ns);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 当前生效的调整
+ */
+uint16_t stream_rate_flags(const stream_rate_t *rate)
+{
+    uint16_t flags = 0;
+    if (rate->decimation > 1)
+    {
+        flags |= STREAM_RATE_DECIMATED;
+    }
+    if (rate->binning > 1)
+    {
+        flags |= STREAM_RATE_BINNED;
+    }
+    if (rate->compress)
+    {
+        flags |= STREAM_RATE_COMPRESSED;
+    }
+    return flags;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 第 level 级 (从1开始) 对应的阶梯项，跳过未许可的手段
+ * @return 阶梯项，超出可用级数返回NULL
+ */
+static const rate_step_t *level_step(const stream_rate_t *rate, int level)
+{
+    int count = 0;
+    for (int i = 0; i < STREAM_RATE_MAX_STEPS; i++)
+    {
+        const rate_step_t *step = &rate_ladder[i];
+        if (step->requires && !(rate->allow & step->requires))
+        {
+            continue;
+        }
+        if (++count == level)
+        {
+            return step;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 按级别设置附加的抽帧、合并和压缩
+ */
+static void apply_level(stream_rate_t *rate, int level, uint64_t now_ns)
+{
+    int decimation = 1;
+    int binning = 1;
+    int compress = 0;
+    for (int l = 1; l <= level; l++)
+    {
+        const rate_step_t *step = level_step(rate, l);
+        decimation = step->decimation ? step->decimation : decimation;
+        binning = step->binning ? step->binning : binning;
+        compress |= step->compress;
+    }
+
+    rate->level = level;
+    __atomic_store_n(&rate->decimation, decimation, __ATOMIC_RELAXED); // 采集线程读取
+    rate->binning = binning;
+    rate->compress = compress;
+    rate->changed_ns = now_ns;
+    rate->changes++;
+}
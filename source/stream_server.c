@@ -0,0 +1,1218 @@
+/**
+ * @file stream_server.c
+ * @brief 多客户端帧流服务器模块
+ * @details 事件循环线程独占客户端的建立、发送和关闭；采集线程只通过各客户端的
+ *          帧队列和 eventfd 与之交互。客户端槽位的队列在服务器初始化时创建，
+ *          连接断开只关闭队列，发布线程看到的队列始终有效。
+ *          客户端发来的数据按请求消息解析，魔数不匹配的字节被丢弃。
+ *          控制应答可能来自应用的任意线程，先放入客户端的应答队列，由事件循环在帧之间发出；
+ *          压扩码表同样在帧之间发出，总是先于使用该曲线的第一帧
+ */
+
+// 定义 GNU 扩展以支持 accept4
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/sockios.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include "raw_compand.h"
+#include "stream_server.h"
+
+#define EVENT_LISTEN 0xFFFFFFF0u    // epoll 事件标识：监听套接字
+#define EVENT_WAKE 0xFFFFFFF1u      // epoll 事件标识：eventfd
+#define MAX_EVENTS 16
+#define CATCHUP_LIVE_FRAMES 1       // 补发期间实时队列有积压时，每发送N个实时帧补发一帧
+
+// 发布与销毁互斥：销毁服务器时不会有采集线程仍在向客户端队列入队。
+// 阻塞策略下等待队列空位时不持有该锁 (事件循环关闭客户端时需要它)，
+// 等待者返回后由 publish_idle 通知销毁流程
+static pthread_mutex_t publish_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t publish_idle = PTHREAD_COND_INITIALIZER;
+
+// 保护各客户端的控制应答队列 (应用线程写入，事件循环取出)
+static pthread_mutex_t control_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void accept_clients(stream_server_t *server);
+static void close_client(stream_server_t *server, stream_client_t *client, const char *reason);
+static int linger_client(stream_server_t *server, stream_client_t *client);
+static void reap_lingering(stream_server_t *server, int wait);
+static void pump_client(stream_server_t *server, stream_client_t *client);
+static void drain_client_input(stream_server_t *server, stream_client_t *client);
+static void parse_requests(stream_server_t *server, stream_client_t *client);
+static void handle_request(stream_server_t *server, stream_client_t *client,
+                           const stream_request_header_t *header, const uint8_t *payload);
+static void set_want_write(stream_server_t *server, stream_client_t *client, int want_write);
+static int begin_control_ack(stream_client_t *client);
+static int begin_compand_table(stream_server_t *server, stream_client_t *client);
+static void take_catchup_frame(stream_server_t *server, stream_client_t *client);
+static void update_client_rate(stream_client_t *client, uint64_t now_ns);
+static void wake_server(void *user);
+static uint64_t monotonic_ns(void);
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化服务器
+ */
+int stream_server_init(stream_server_t *server, int listen_fd, const stream_server_config_t *config,
+                       stream_format_fn format_fn, stream_clients_fn clients_fn, void *user)
+{
+    if (!server || listen_fd < 0 || !config || !format_fn ||
+        config->max_clients < 1 || config->max_clients > STREAM_SERVER_MAX_CLIENTS)
+    {
+        if (listen_fd >= 0)
+        {
+            close(listen_fd);
+        }
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = listen_fd;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    server->config = *config;
+    if (server->config.decimation < 1)
+    {
+        server->config.decimation = 1;
+    }
+    server->format_fn = format_fn;
+    server->clients_fn = clients_fn;
+    server->user = user;
+
+    for (int i = 0; i < STREAM_SERVER_MAX_CLIENTS; i++)
+    {
+        server->clients[i].fd = -1;
+        server->clients[i].tx.fd = -1;
+        server->lingering[i].tx.fd = -1;
+        frame_queue_init(&server->clients[i].queue, config->queue_depth, config->policy);
+    }
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server->epoll_fd < 0 || server->wake_fd < 0)
+    {
+        printf("Error: Failed to create stream server events: %s\n", strerror(errno));
+        stream_server_destroy(server);
+        return -1;
+    }
+
+    // 监听套接字改为非阻塞，一次可读事件中接受所有排队的连接
+    int flags = fcntl(listen_fd, F_GETFL, 0);
+    fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK);
+
+    struct epoll_event ev = {.events = EPOLLIN};
+    ev.data.u32 = EVENT_LISTEN;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.data.u32 = EVENT_WAKE;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &ev);
+
+    // 从文件读回的补发帧就绪时唤醒事件循环
+    if (config->spool)
+    {
+        stream_spool_set_ready(config->spool, wake_server, server);
+    }
+
+    printf("Stream server: up to %d clients, queue depth %d (%s), decimation %d, zerocopy %s\n",
+           config->max_clients, config->queue_depth, frame_queue_policy_name(config->policy),
+           server->config.decimation, config->zerocopy ? "requested" : "off");
+    if (config->max_latency_ms > 0)
+    {
+        printf("Stream rate control: latency bound %d ms%s%s\n", config->max_latency_ms,
+               (config->rate_allow & STREAM_RATE_ALLOW_COMPRESS) ? ", may compress" : "",
+               (config->rate_allow & STREAM_RATE_ALLOW_BINNING) ? ", may bin" : "");
+    }
+    return 0;
+}
+
+/**
+ * @brief 运行事件循环
+ */
+void stream_server_run(stream_server_t *server)
+{
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!server->stop)
+    {
+        // 码率控制按固定间隔采样，空闲时也要醒来
+        int n = epoll_wait(server->epoll_fd, events, MAX_EVENTS, STREAM_RATE_INTERVAL_MS);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            printf("Error: epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n && !server->stop; i++)
+        {
+            uint32_t tag = events[i].data.u32;
+            uint32_t mask = events[i].events;
+
+            if (tag == EVENT_LISTEN)
+            {
+                accept_clients(server);
+                continue;
+            }
+
+            if (tag == EVENT_WAKE)
+            {
+                // 有新帧入队或补发帧就绪：让空闲的客户端开始发送
+                uint64_t count;
+                while (read(server->wake_fd, &count, sizeof(count)) > 0)
+                {
+                }
+                for (int c = 0; c < STREAM_SERVER_MAX_CLIENTS; c++)
+                {
+                    if (server->clients[c].fd >= 0 && !server->clients[c].sending && !server->clients[c].sending_ack)
+                    {
+                        pump_client(server, &server->clients[c]);
+                    }
+                }
+                continue;
+            }
+
+            if (tag >= STREAM_SERVER_MAX_CLIENTS)
+            {
+                continue;
+            }
+            stream_client_t *client = &server->clients[tag];
+            if (client->fd < 0)
+            {
+                continue; // 本轮中已关闭
+            }
+
+            if (mask & EPOLLERR)
+            {
+                // 错误队列中的零拷贝完成通知也以 EPOLLERR 报告，先区分真正的套接字错误
+                int error = 0;
+                socklen_t len = sizeof(error);
+                getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &len);
+                if (error != 0)
+                {
+                    close_client(server, client, strerror(error));
+                    continue;
+                }
+                frame_tx_reap(&client->tx);
+            }
+            if (mask & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+            {
+                drain_client_input(server, client);
+                if (client->fd < 0)
+                {
+                    continue;
+                }
+            }
+            if (mask & EPOLLOUT)
+            {
+                pump_client(server, client);
+            }
+        }
+
+        reap_lingering(server, 0);
+
+        uint64_t now_ns = monotonic_ns();
+        for (int c = 0; c < STREAM_SERVER_MAX_CLIENTS && !server->stop; c++)
+        {
+            if (server->clients[c].fd >= 0)
+            {
+                update_client_rate(&server->clients[c], now_ns);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 请求事件循环退出
+ */
+void stream_server_stop(stream_server_t *server)
+{
+    server->stop = 1;
+    wake_server(server);
+}
+
+/**
+ * @brief 断开所有客户端并释放资源
+ */
+void stream_server_destroy(stream_server_t *server)
+{
+    if (!server || server->listen_fd < 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&publish_lock);
+    server->stop = 1; // 关闭的客户端不再转入补发缓存
+    if (server->config.spool)
+    {
+        stream_spool_set_ready(server->config.spool, NULL, NULL);
+    }
+    for (int i = 0; i < STREAM_SERVER_MAX_CLIENTS; i++)
+    {
+        if (server->clients[i].fd >= 0)
+        {
+            close_client(server, &server->clients[i], "server stopped");
+        }
+    }
+
+    // 队列已关闭，在锁外等待空位的发布调用随即返回，之后才能销毁队列
+    while (server->publish_waiting > 0)
+    {
+        pthread_cond_wait(&publish_idle, &publish_lock);
+    }
+
+    for (int i = 0; i < STREAM_SERVER_MAX_CLIENTS; i++)
+    {
+        frame_queue_destroy(&server->clients[i].queue);
+        for (int k = 0; k < STREAM_CLIENT_SCRATCH_COUNT; k++)
+        {
+            free(server->clients[i].scratch[k]);
+            server->clients[i].scratch[k] = NULL;
+            server->clients[i].scratch_capacity[k] = 0;
+        }
+    }
+    reap_lingering(server, 1); // 事件循环已停止，在此等待 (最多 STREAM_LINGER_MS)
+
+    if (server->epoll_fd >= 0)
+    {
+        close(server->epoll_fd);
+    }
+    if (server->wake_fd >= 0)
+    {
+        close(server->wake_fd);
+    }
+    close(server->listen_fd);
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+    pthread_mutex_unlock(&publish_lock);
+}
+
+/**
+ * @brief 把新帧发布给所有客户端
+ */
+void stream_server_publish(stream_server_t *server, frame_ref_t *ref, int timeout_ms)
+{
+    if (!ref || (__atomic_load_n(&server->client_count, __ATOMIC_ACQUIRE) == 0 &&
+                 !stream_spool_recording(server->config.spool)))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&publish_lock);
+    if (server->listen_fd < 0)
+    {
+        pthread_mutex_unlock(&publish_lock); // 已销毁
+        return;
+    }
+
+    int queued = 0;
+    for (int i = 0; i < server->config.max_clients; i++)
+    {
+        stream_client_t *client = &server->clients[i];
+        if (__atomic_load_n(&client->fd, __ATOMIC_ACQUIRE) < 0)
+        {
+            continue;
+        }
+
+        // 抽帧：每 decimation 帧取第1帧 (客户端请求的系数乘以码率控制的附加系数)
+        int decimation = __atomic_load_n(&client->decimation, __ATOMIC_RELAXED) *
+                         __atomic_load_n(&client->rate.decimation, __ATOMIC_RELAXED);
+        if (client->offered++ % (uint32_t)(decimation > 0 ? decimation : 1) != 0)
+        {
+            continue;
+        }
+
+        // 阻塞策略下队列已满：在发布锁外等待空位，事件循环可以照常服务其他客户端，
+        // 并能随时关闭这个客户端 (关闭队列会立即唤醒这里)
+        if (timeout_ms > 0 && frame_queue_would_block(&client->queue))
+        {
+            server->publish_waiting++;
+            pthread_mutex_unlock(&publish_lock);
+            frame_queue_wait_space(&client->queue, timeout_ms);
+            pthread_mutex_lock(&publish_lock);
+            server->publish_waiting--;
+
+            if (server->stop)
+            {
+                // 正在销毁，不再入队也不再写入补发缓存
+                pthread_cond_broadcast(&publish_idle);
+                pthread_mutex_unlock(&publish_lock);
+                return;
+            }
+            if (__atomic_load_n(&client->fd, __ATOMIC_ACQUIRE) < 0)
+            {
+                // 等待期间断开：队列中的帧已转入补发缓存，本帧随后由 stream_spool_put 接上
+                continue;
+            }
+        }
+
+        // 队列持有自己的引用 (被丢弃或队列已关闭时由队列释放)；
+        // 仍然没有空位时按超时丢弃
+        frame_pool_retain(ref);
+        if (frame_queue_push(&client->queue, ref, 0) == 0)
+        {
+            queued = 1;
+        }
+    }
+    stream_spool_put(server->config.spool, ref);
+
+    if (queued)
+    {
+        wake_server(server);
+    }
+    pthread_mutex_unlock(&publish_lock);
+}
+
+/**
+ * @brief 应答控制请求
+ */
+int stream_server_control_ack(stream_server_t *server, int client_id, const stream_control_ack_t *ack)
+{
+    if (!server || !ack)
+    {
+        return -1;
+    }
+
+    int result = -1;
+    pthread_mutex_lock(&control_lock);
+    for (int i = 0; i < STREAM_SERVER_MAX_CLIENTS; i++)
+    {
+        stream_client_t *client = &server->clients[i];
+        if (__atomic_load_n(&client->fd, __ATOMIC_ACQUIRE) < 0 || client->id != client_id)
+        {
+            continue;
+        }
+        if (client->ack_count < STREAM_CLIENT_MAX_ACKS)
+        {
+            stream_control_ack_t *slot = &client->acks[client->ack_count++];
+            *slot = *ack;
+            slot->magic = STREAM_CONTROL_MAGIC;
+            slot->size = sizeof(*slot);
+            result = 0;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&control_lock);
+
+    if (result == 0)
+    {
+        wake_server(server);
+    }
+    return result;
+}
+
+/**
+ * @brief 获取当前客户端数
+ */
+int stream_server_client_count(stream_server_t *server)
+{
+    return __atomic_load_n(&server->client_count, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief 设置客户端的抽帧系数
+ */
+int stream_server_set_decimation(stream_server_t *server, int client_id, int decimation)
+{
+    if (!server || decimation < 1)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < STREAM_SERVER_MAX_CLIENTS; i++)
+    {
+        stream_client_t *client = &server->clients[i];
+        if (client->fd >= 0 && client->id == client_id)
+        {
+            __atomic_store_n(&client->decimation, decimation, __ATOMIC_RELAXED);
+            printf("Stream client #%d: decimation set to 1/%d\n", client_id, decimation);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 获取客户端的私有缓冲区
+ */
+void *stream_client_scratch(stream_client_t *client, int index, size_t size)
+{
+    if (!client || index < 0 || index >= STREAM_CLIENT_SCRATCH_COUNT)
+    {
+        return NULL;
+    }
+
+    if (size > client->scratch_capacity[index])
+    {
+        free(client->scratch[index]);
+        client->scratch[index] = malloc(size);
+        client->scratch_capacity[index] = client->scratch[index] ? size : 0;
+    }
+    return client->scratch[index];
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 接受所有排队的连接
+ */
+static void accept_clients(stream_server_t *server)
+{
+    for (;;)
+    {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(server->listen_fd, (struct sockaddr *)&addr, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                printf("Warning: accept failed: %s\n", strerror(errno));
+            }
+            return;
+        }
+
+        stream_client_t *client = NULL;
+        int slot = -1;
+        for (int i = 0; i < server->config.max_clients; i++)
+        {
+            if (server->clients[i].fd < 0)
+            {
+                client = &server->clients[i];
+                slot = i;
+                break;
+            }
+        }
+        if (!client)
+        {
+            printf("Stream server full (%d clients), rejecting %s\n",
+                   server->config.max_clients, inet_ntoa(addr.sin_addr));
+            close(fd);
+            continue;
+        }
+
+        // 较大的发送缓冲区减少阻塞，TCP_NODELAY 减少延迟
+        if (server->config.send_buffer > 0 &&
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &server->config.send_buffer, sizeof(server->config.send_buffer)) < 0)
+        {
+            perror("Warning: Failed to set send buffer size");
+        }
+        int flag = 1;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) < 0)
+        {
+            perror("Warning: Failed to set TCP_NODELAY");
+        }
+
+        client->id = ++server->next_id;
+        snprintf(client->address, sizeof(client->address), "%s:%u",
+                 inet_ntoa(addr.sin_addr), (unsigned)ntohs(addr.sin_port));
+        client->decimation = server->config.decimation;
+        client->offered = 0;
+        client->frame_id = 0;
+        client->sending = NULL;
+        client->want_write = 0;
+        client->connected_ns = monotonic_ns();
+        client->view = (stream_view_t){.binning = 1};
+        client->header_version = 1;
+        client->header_flags = 0;
+        client->last_sequence = 0;
+        client->input_len = 0;
+        client->session = 0;
+        client->catchup = 0;
+        client->sending_catchup = 0;
+        client->catchup_sent = 0;
+        client->live_since_catchup = 0;
+        client->sending_ack = 0;
+        client->controls = 0;
+        client->compand = raw_compand_get((raw_compand_curve_t)server->config.compand, server->config.compand_bits)
+                              ? server->config.compand
+                              : STREAM_COMPAND_OFF;
+        client->compand_pending = (client->compand != STREAM_COMPAND_OFF);
+        pthread_mutex_lock(&control_lock);
+        client->ack_count = 0;
+        pthread_mutex_unlock(&control_lock);
+        stream_rate_init(&client->rate, server->config.max_latency_ms, server->config.rate_allow);
+        frame_tx_init(&client->tx, fd, server->config.zerocopy);
+        frame_queue_open(&client->queue);
+
+        struct epoll_event ev = {.events = EPOLLIN | EPOLLRDHUP};
+        ev.data.u32 = (uint32_t)slot;
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            printf("Warning: Failed to watch client %s: %s\n", client->address, strerror(errno));
+            frame_queue_close(&client->queue, NULL);
+            frame_tx_close(&client->tx, 0);
+            close(fd);
+            continue;
+        }
+
+        // 最后发布套接字，采集线程看到 fd 时队列已打开
+        __atomic_store_n(&client->fd, fd, __ATOMIC_RELEASE);
+        int count = __atomic_add_fetch(&server->client_count, 1, __ATOMIC_ACQ_REL);
+
+        printf("Stream client #%d connected from %s (%d/%d, zerocopy %s)\n",
+               client->id, client->address, count, server->config.max_clients,
+               client->tx.zerocopy ? "on" : "off");
+        if (server->clients_fn)
+        {
+            server->clients_fn(count, server->user);
+        }
+    }
+}
+
+/**
+ * @brief 关闭客户端并打印本次连接的统计
+ */
+static void close_client(stream_server_t *server, stream_client_t *client, const char *reason)
+{
+    int fd = client->fd;
+    stream_spool_t *spool = server->config.spool;
+    int spool_frames = spool && client->session != 0 && !server->stop;
+    if (spool_frames)
+    {
+        // 在发布锁内交接：采集线程发布的每一帧要么已在队列中，要么之后直接进入缓存
+        pthread_mutex_lock(&publish_lock);
+    }
+    __atomic_store_n(&client->fd, -1, __ATOMIC_RELEASE); // 采集线程停止向其入队
+    if (spool_frames)
+    {
+        // 未发完的帧和队列中的帧转入补发缓存 (缓存复制后释放自己的引用)
+        stream_spool_begin(spool, client->session);
+        stream_spool_put(spool, client->sending);
+        frame_ref_t *ref;
+        while ((ref = frame_queue_pop(&client->queue, 0)) != NULL)
+        {
+            stream_spool_put(spool, ref);
+            frame_pool_release(ref);
+        }
+        pthread_mutex_unlock(&publish_lock);
+    }
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+    frame_queue_stats_t stats;
+    frame_queue_close(&client->queue, &stats);
+
+    // 零拷贝在途帧须等内核报告完成后再释放、再关闭套接字：不在事件循环中等待，
+    // 转入延迟回收列表 (断开的链路上可能很久都等不到完成通知，会拖住其他客户端)
+    int inflight = frame_tx_abort(&client->tx);
+    frame_pool_release(client->sending);
+    client->sending = NULL;
+
+    shutdown(fd, SHUT_RDWR);
+    if (inflight == 0 || linger_client(server, client) != 0)
+    {
+        frame_tx_close(&client->tx, 0);
+        close(fd);
+    }
+
+    int count = __atomic_sub_fetch(&server->client_count, 1, __ATOMIC_ACQ_REL);
+    double seconds = (double)(monotonic_ns() - client->connected_ns) / 1e9;
+    const frame_tx_stats_t *tx = &client->tx.stats;
+    printf("Stream client #%d (%s) disconnected: %s\n", client->id, client->address, reason);
+    printf("  frames: %u queued, %u sent, %u dropped (1/%d decimation)\n",
+           stats.queued, stats.sent, stats.dropped, client->decimation);
+    if (client->rate.max_latency_ms > 0)
+    {
+        printf("  rate control: level %d/%d at close, %u changes, link %.1f MB/s\n", client->rate.level,
+               client->rate.max_level, client->rate.changes, client->rate.capacity / 1e6);
+    }
+    if (client->session != 0)
+    {
+        printf("  session %016llx: %u catch-up frames sent%s\n", (unsigned long long)client->session,
+               client->catchup_sent, spool_frames ? ", spooling until it reconnects" : "");
+    }
+    if (client->controls > 0)
+    {
+        printf("  control: %u requests\n", client->controls);
+    }
+    printf("  transmit: %.1f MB in %.1fs (%.1f MB/s), %.1f syscalls/frame, %llu zerocopy sends copied\n",
+           (double)tx->bytes / 1e6, seconds, seconds > 0 ? (double)tx->bytes / 1e6 / seconds : 0.0,
+           tx->frames ? (double)tx->syscalls / (double)tx->frames : 0.0,
+           (unsigned long long)tx->zc_copied);
+
+    if (server->clients_fn)
+    {
+        server->clients_fn(count, server->user);
+    }
+}
+
+/**
+ * @brief 把断开连接的套接字和在途帧移到延迟回收列表
+ * @return 0成功 (套接字由列表关闭)，-1列表已满
+ */
+static int linger_client(stream_server_t *server, stream_client_t *client)
+{
+    for (int i = 0; i < STREAM_SERVER_MAX_CLIENTS; i++)
+    {
+        stream_linger_t *linger = &server->lingering[i];
+        if (linger->tx.fd < 0)
+        {
+            // 发送上下文 (含在途帧和段表) 整体移交，客户端槽位可以立即复用
+            linger->tx = client->tx;
+            linger->deadline_ns = monotonic_ns() + (uint64_t)STREAM_LINGER_MS * 1000000ULL;
+            memset(&client->tx, 0, sizeof(client->tx));
+            client->tx.fd = -1;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 回收已断开连接的零拷贝完成通知，完成或超时后释放帧并关闭套接字
+ * @param wait 1: 等待到各自的超时时刻 (服务器销毁时)，0: 不等待
+ */
+static void reap_lingering(stream_server_t *server, int wait)
+{
+    uint64_t now_ns = monotonic_ns();
+    for (int i = 0; i < STREAM_SERVER_MAX_CLIENTS; i++)
+    {
+        stream_linger_t *linger = &server->lingering[i];
+        int fd = linger->tx.fd;
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        int timeout_ms = 0;
+        if (wait && linger->deadline_ns > now_ns)
+        {
+            timeout_ms = (int)((linger->deadline_ns - now_ns) / 1000000ULL);
+        }
+        else if (!wait && frame_tx_reap(&linger->tx) == 0 && linger->tx.inflight_count > 0 &&
+                 now_ns < linger->deadline_ns)
+        {
+            continue; // 仍在等待
+        }
+
+        if (linger->tx.inflight_count > 0 && !wait)
+        {
+            printf("Stream server: %d zerocopy frames of a closed connection not completed after %d ms, releasing\n",
+                   linger->tx.inflight_count, STREAM_LINGER_MS);
+        }
+        frame_tx_close(&linger->tx, timeout_ms);
+        close(fd);
+    }
+}
+
+/**
+ * @brief 发送客户端队列中的帧，直到队列为空或套接字写满
+ */
+static void pump_client(stream_server_t *server, stream_client_t *client)
+{
+    for (;;)
+    {
+        if (!client->sending && !client->sending_ack &&
+            (begin_compand_table(server, client) || begin_control_ack(client)))
+        {
+            client->sending_ack = 1; // 码表和控制应答先于队列中的下一帧发送
+        }
+        if (!client->sending && !client->sending_ack)
+        {
+            // 实时帧优先，但链路比采集慢时队列永远不空：补发帧按比例占用发送机会，保证补发有进展
+            client->sending_catchup = 0;
+            int catchup_turn = client->catchup && client->live_since_catchup >= CATCHUP_LIVE_FRAMES;
+            if (catchup_turn)
+            {
+                take_catchup_frame(server, client);
+            }
+            if (!client->sending)
+            {
+                client->sending = frame_queue_pop(&client->queue, 0);
+                client->live_since_catchup += client->sending != NULL;
+            }
+            if (!client->sending && client->catchup && !catchup_turn)
+            {
+                take_catchup_frame(server, client); // 队列空闲时补发
+            }
+            if (!client->sending)
+            {
+                set_want_write(server, client, 0); // 补发帧读回后由缓存唤醒
+                return;
+            }
+
+            // 私有缓冲区中的数据不登记零拷贝，下一帧格式化时可以直接覆盖
+            stream_frame_t frame;
+            frame.private_data = 0;
+            if (server->format_fn(client, client->sending, &frame, server->user) != 0 ||
+                frame_tx_begin(&client->tx, frame.prefix, frame.prefix_len, frame.segments,
+                               frame.segment_count, frame.private_data ? NULL : client->sending) != 0)
+            {
+                frame_pool_release(client->sending);
+                client->sending = NULL;
+                continue;
+            }
+            client->frame_id++;
+        }
+
+        int result = frame_tx_resume(&client->tx);
+        if (result == 0)
+        {
+            set_want_write(server, client, 1); // 套接字写满，可写后继续
+            return;
+        }
+        if (result < 0)
+        {
+            close_client(server, client, "send failed");
+            return;
+        }
+
+        if (client->sending_ack)
+        {
+            client->sending_ack = 0;
+            continue;
+        }
+        if (client->sending_catchup)
+        {
+            client->catchup_sent++;
+        }
+        else
+        {
+            frame_queue_mark_sent(&client->queue);
+        }
+        frame_pool_release(client->sending);
+        client->sending = NULL;
+    }
+}
+
+/**
+ * @brief 从补发缓存取一帧作为下一帧发送
+ * @details 补发帧正在从溢出文件读回时不取 (读回后由缓存唤醒)；缓存已取完或被丢弃时结束补发
+ */
+static void take_catchup_frame(stream_server_t *server, stream_client_t *client)
+{
+    int result = stream_spool_next(server->config.spool, &client->sending);
+    if (result < 0)
+    {
+        printf("Stream client #%d: catch-up complete, %u frames\n", client->id, client->catchup_sent);
+        client->catchup = 0;
+    }
+    else if (result > 0)
+    {
+        client->sending_catchup = 1;
+        client->live_since_catchup = 0;
+    }
+}
+
+/**
+ * @brief 读取客户端发来的请求，检测连接关闭
+ */
+static void drain_client_input(stream_server_t *server, stream_client_t *client)
+{
+    for (;;)
+    {
+        ssize_t n = recv(client->fd, client->input + client->input_len,
+                         sizeof(client->input) - client->input_len, 0);
+        if (n > 0)
+        {
+            client->input_len += (size_t)n;
+            parse_requests(server, client);
+            continue;
+        }
+        if (n == 0)
+        {
+            close_client(server, client, "closed by peer");
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            close_client(server, client, strerror(errno));
+        }
+        return;
+    }
+}
+
+/**
+ * @brief 处理接收缓冲区中所有完整的请求消息
+ * @details 返回时缓冲区一定留有空间：消息头无效或负载过长时丢弃数据重新同步
+ */
+static void parse_requests(stream_server_t *server, stream_client_t *client)
+{
+    size_t pos = 0;
+    while (client->input_len - pos >= sizeof(stream_request_header_t))
+    {
+        stream_request_header_t header;
+        memcpy(&header, client->input + pos, sizeof(header));
+        if (header.magic != STREAM_REQUEST_MAGIC || header.length > STREAM_REQUEST_MAX_PAYLOAD)
+        {
+            pos++; // 逐字节寻找下一个魔数
+            continue;
+        }
+
+        size_t total = sizeof(header) + header.length;
+        if (client->input_len - pos < total)
+        {
+            break; // 等待剩余负载
+        }
+
+        handle_request(server, client, &header, client->input + pos + sizeof(header));
+        pos += total;
+    }
+
+    client->input_len -= pos;
+    memmove(client->input, client->input + pos, client->input_len);
+}
+
+/**
+ * @brief 执行一条请求
+ */
+static void handle_request(stream_server_t *server, stream_client_t *client,
+                           const stream_request_header_t *header, const uint8_t *payload)
+{
+    switch (header->type)
+    {
+    case STREAM_REQUEST_VIEW:
+    {
+        stream_view_request_t request;
+        if (header->length < sizeof(request))
+        {
+            break;
+        }
+        memcpy(&request, payload, sizeof(request));
+
+        if ((request.binning != 1 && request.binning != 2 && request.binning != STREAM_BINNING_MAX) ||
+            request.left > INT16_MAX || request.top > INT16_MAX ||
+            request.width > INT16_MAX || request.height > INT16_MAX)
+        {
+            printf("Stream client #%d: invalid view request ignored\n", client->id);
+            break;
+        }
+
+        client->view.left = (int)request.left;
+        client->view.top = (int)request.top;
+        client->view.width = (int)request.width;
+        client->view.height = (int)request.height;
+        client->view.binning = (int)request.binning;
+        if (request.width == 0 && request.height == 0)
+        {
+            printf("Stream client #%d: view set to device crop, binning %dx%d\n",
+                   client->id, client->view.binning, client->view.binning);
+        }
+        else
+        {
+            printf("Stream client #%d: view set to %dx%d at (%d,%d), binning %dx%d\n",
+                   client->id, client->view.width, client->view.height, client->view.left,
+                   client->view.top, client->view.binning, client->view.binning);
+        }
+        break;
+    }
+    case STREAM_REQUEST_DECIMATION:
+    {
+        stream_decimation_request_t request;
+        if (header->length >= sizeof(request))
+        {
+            memcpy(&request, payload, sizeof(request));
+            if (request.decimation >= 1 && request.decimation <= INT16_MAX)
+            {
+                stream_server_set_decimation(server, client->id, (int)request.decimation);
+            }
+        }
+        break;
+    }
+    case STREAM_REQUEST_HEADER:
+    {
+        stream_header_request_t request;
+        if (header->length < sizeof(request))
+        {
+            break;
+        }
+        memcpy(&request, payload, sizeof(request));
+        if (request.version != 1 && request.version != 2)
+        {
+            printf("Stream client #%d: unsupported header version %u ignored\n", client->id, request.version);
+            break;
+        }
+
+        client->header_version = (int)request.version;
+        client->header_flags = (request.version == 2) ? (request.flags & STREAM_HEADER_CHECKSUM) : 0;
+        printf("Stream client #%d: frame header v%d%s\n", client->id, client->header_version,
+               (client->header_flags & STREAM_HEADER_CHECKSUM) ? " with checksum" : "");
+        break;
+    }
+    case STREAM_REQUEST_RATE:
+    {
+        stream_rate_request_t request;
+        if (header->length < sizeof(request))
+        {
+            break;
+        }
+        memcpy(&request, payload, sizeof(request));
+        if (request.max_latency_ms > 60000)
+        {
+            printf("Stream client #%d: invalid latency bound %u ms ignored\n", client->id, request.max_latency_ms);
+            break;
+        }
+
+        stream_rate_init(&client->rate, (int)request.max_latency_ms, request.allow);
+        if (request.max_latency_ms == 0)
+        {
+            printf("Stream client #%d: rate control off\n", client->id);
+        }
+        else
+        {
+            printf("Stream client #%d: rate control at %u ms, %d levels\n", client->id,
+                   request.max_latency_ms, client->rate.max_level);
+        }
+        break;
+    }
+    case STREAM_REQUEST_SESSION:
+    {
+        stream_session_request_t request;
+        if (header->length < sizeof(request))
+        {
+            break;
+        }
+        memcpy(&request, payload, sizeof(request));
+        if (request.session != 0 && client->header_version < 2)
+        {
+            printf("Stream client #%d: session needs frame header v2, ignored\n", client->id);
+            break;
+        }
+
+        client->session = request.session;
+        if (request.session == 0 || !server->config.spool)
+        {
+            printf("Stream client #%d: session %016llx%s\n", client->id, (unsigned long long)request.session,
+                   server->config.spool ? "" : " (spool disabled, frames are not kept across disconnects)");
+            break;
+        }
+
+        // 同一会话的旧连接 (链路中断后尚未检测到断开) 让位给新连接，未发出的帧转入缓存
+        for (int i = 0; i < STREAM_SERVER_MAX_CLIENTS; i++)
+        {
+            stream_client_t *other = &server->clients[i];
+            if (other != client && other->fd >= 0 && other->session == request.session)
+            {
+                close_client(server, other, "session reconnected");
+            }
+        }
+
+        int count = stream_spool_attach(server->config.spool, request.session);
+        if (count >= 0)
+        {
+            client->catchup = 1;
+            client->catchup_sent = 0;
+            client->live_since_catchup = 0;
+            wake_server(server); // 空闲时在下一轮事件中开始补发
+        }
+        printf("Stream client #%d: session %016llx%s\n", client->id, (unsigned long long)request.session,
+               count >= 0 ? ", catching up" : "");
+        break;
+    }
+    case STREAM_REQUEST_CONTROL:
+    {
+        stream_control_request_t request;
+        if (header->length < sizeof(request))
+        {
+            break;
+        }
+        memcpy(&request, payload, sizeof(request));
+        client->controls++;
+
+        // 交给应用执行，由它应答；不能接受时立即应答
+        int status;
+        if (!server->config.control_fn)
+        {
+            status = STREAM_CONTROL_UNAVAILABLE;
+        }
+        else if (server->config.control_fn(client->id, &request, server->config.control_user) != 0)
+        {
+            status = STREAM_CONTROL_BUSY;
+        }
+        else
+        {
+            break;
+        }
+
+        stream_control_ack_t ack = {
+            .status = (uint16_t)status,
+            .id = request.id,
+            .control = request.control,
+            .target = request.target,
+            .value = request.value};
+        stream_server_control_ack(server, client->id, &ack);
+        break;
+    }
+    case STREAM_REQUEST_COMPAND:
+    {
+        stream_compand_request_t request;
+        if (header->length < sizeof(request))
+        {
+            break;
+        }
+        memcpy(&request, payload, sizeof(request));
+        if (request.curve != STREAM_COMPAND_OFF &&
+            (request.curve >= RAW_COMPAND_COUNT ||
+             !raw_compand_get((raw_compand_curve_t)request.curve, server->config.compand_bits)))
+        {
+            printf("Stream client #%d: compand curve %u unsupported for %d-bit data, ignored\n", client->id,
+                   request.curve, server->config.compand_bits);
+            break;
+        }
+
+        // 码表在下一帧之前发出，格式化回调从下一帧起压扩
+        client->compand = (int)request.curve;
+        client->compand_pending = (request.curve != STREAM_COMPAND_OFF);
+        printf("Stream client #%d: compand %s\n", client->id,
+               raw_compand_curve_name((raw_compand_curve_t)request.curve));
+        break;
+    }
+    default:
+        printf("Stream client #%d: unknown request type %u ignored\n", client->id, (unsigned)header->type);
+        break;
+    }
+}
+
+/**
+ * @brief 注册或取消客户端的可写事件
+ */
+static void set_want_write(stream_server_t *server, stream_client_t *client, int want_write)
+{
+    if (client->want_write == want_write)
+    {
+        return;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN | EPOLLRDHUP | (want_write ? EPOLLOUT : 0)};
+    ev.data.u32 = (uint32_t)(client - server->clients);
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+    client->want_write = want_write;
+}
+
+/**
+ * @brief 取出最早的控制应答并开始发送
+ * @return 1已开始发送，0没有待发送的应答
+ */
+static int begin_control_ack(stream_client_t *client)
+{
+    stream_control_ack_t ack;
+    pthread_mutex_lock(&control_lock);
+    int count = client->ack_count;
+    if (count > 0)
+    {
+        ack = client->acks[0];
+        memmove(&client->acks[0], &client->acks[1], (size_t)(count - 1) * sizeof(ack));
+        client->ack_count = count - 1;
+    }
+    pthread_mutex_unlock(&control_lock);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint8_t message[STREAM_FRAME_SYNC_LEN + sizeof(ack)];
+    memcpy(message, STREAM_FRAME_SYNC, STREAM_FRAME_SYNC_LEN);
+    memcpy(message + STREAM_FRAME_SYNC_LEN, &ack, sizeof(ack));
+    return frame_tx_begin(&client->tx, message, sizeof(message), NULL, 0, NULL) == 0;
+}
+
+/**
+ * @brief 开始发送待发送的压扩码表
+ * @details 码表在开始发送时才填写，发送期间收到的新请求只置待发送标志，不会改写正在发送的内容
+ * @return 1已开始发送，0没有待发送的码表
+ */
+static int begin_compand_table(stream_server_t *server, stream_client_t *client)
+{
+    if (!client->compand_pending)
+    {
+        return 0;
+    }
+    client->compand_pending = 0;
+
+    const raw_compand_t *table = raw_compand_get((raw_compand_curve_t)client->compand, server->config.compand_bits);
+    if (!table)
+    {
+        return 0;
+    }
+
+    stream_compand_table_t *message = &client->compand_table;
+    message->magic = STREAM_COMPAND_MAGIC;
+    message->size = sizeof(*message);
+    message->curve = (uint16_t)client->compand;
+    message->input_bits = (uint16_t)table->input_bits;
+    message->output_bits = 8;
+    memcpy(message->decode, table->decode, sizeof(message->decode));
+
+    struct iovec segment = {.iov_base = message, .iov_len = sizeof(*message)};
+    return frame_tx_begin(&client->tx, STREAM_FRAME_SYNC, STREAM_FRAME_SYNC_LEN, &segment, 1, NULL) == 0;
+}
+
+/**
+ * @brief 为客户端的码率控制采样 (SIOCOUTQ 为发送队列中尚未被对端确认的字节数)
+ */
+static void update_client_rate(stream_client_t *client, uint64_t now_ns)
+{
+    if (client->rate.max_latency_ms <= 0)
+    {
+        return;
+    }
+
+    int unacked = 0;
+    if (ioctl(client->fd, SIOCOUTQ, &unacked) != 0 || unacked < 0)
+    {
+        unacked = 0;
+    }
+
+    // 积压：当前帧未交给内核的部分 + 队列中的帧 (按平均帧大小估计)
+    const frame_tx_stats_t *stats = &client->tx.stats;
+    uint64_t average = stats->frames ? stats->bytes / stats->frames : 0;
+    uint64_t backlog = frame_tx_pending(&client->tx) + (uint64_t)frame_queue_count(&client->queue) * average;
+
+    if (stream_rate_update(&client->rate, now_ns, stats->bytes, (uint32_t)unacked, backlog))
+    {
+        printf("Stream client #%d: rate level %d (1/%d decimation, binning %d, %s), delay %.0f ms, link %.1f MB/s\n",
+               client->id, client->rate.level, client->decimation * client->rate.decimation,
+               client->rate.binning, client->rate.compress ? "compressed" : "raw",
+               client->rate.delay_ms, client->rate.capacity / 1e6);
+    }
+}
+
+/**
+ * @brief 唤醒事件循环 (新帧、补发帧就绪或停止)
+ */
+static void wake_server(void *user)
+{
+    stream_server_t *server = user;
+    if (server->wake_fd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,896 @@
+/**
+ * @file stream_spool.c
+ * @brief 帧流断线补发缓存模块
+ * @details 采集线程和服务器线程只在锁内登记帧引用或取走内存中的帧；复制、写入和
+ *          读回溢出文件都在后台线程中进行，进行期间对应的内存缓冲区标记为读写中，
+ *          不会被取走或丢弃。缓存被丢弃时 generation 递增，读写完成后发现不一致就作废结果。
+ *          缓存中的帧不按顺序存放，每次按采集序号取最早的一帧 (帧数很少，线性查找)
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stream_spool.h"
+
+#define NS_PER_MS 1000000ULL
+#define WORKER_IDLE_MS 100          // 后台线程空闲时检查超时的间隔
+#define SPILL_LOW_WATER 2           // 录入时保持的空闲内存缓冲区数 (低于此值开始写入文件)
+
+/**
+ * @brief 缓存状态
+ */
+typedef enum {
+    SPOOL_IDLE = 0,         // 没有缓存的会话
+    SPOOL_RECORDING,        // 会话断线，录入中
+    SPOOL_REPLAYING,        // 会话已重连，补发中
+} spool_state_t;
+
+/**
+ * @brief 内存缓冲区状态
+ */
+typedef enum {
+    RAM_FREE = 0,           // 空闲
+    RAM_HELD,               // 存有缓存的帧
+    RAM_OUT,                // 已作为补发帧交给发送方
+    RAM_BUSY,               // 后台线程读写中
+} ram_state_t;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void *spool_thread_main(void *arg);
+static int copy_pending_locked(stream_spool_t *spool);
+static int spill_locked(stream_spool_t *spool, int force);
+static int load_locked(stream_spool_t *spool);
+static int expire_locked(stream_spool_t *spool);
+static void trim_idle_locked(stream_spool_t *spool);
+static int open_spill_file_locked(stream_spool_t *spool, size_t frame_size);
+static void close_spill_file(stream_spool_t *spool);
+static int discard_locked(stream_spool_t *spool, frame_ref_t **released);
+static int free_slot_locked(stream_spool_t *spool);
+static int oldest_entry_locked(stream_spool_t *spool, int where);
+static int find_entry_locked(stream_spool_t *spool, uint32_t sequence);
+static void remove_entry_locked(stream_spool_t *spool, int index);
+static int evict_oldest_locked(stream_spool_t *spool, int where);
+static int ensure_capacity(stream_spool_t *spool, int slot, size_t size);
+static void release_replay_frame(media_frame_t *frame, void *user);
+static uint64_t monotonic_ns(void);
+
+// oldest_entry_locked / evict_oldest_locked 的查找范围
+#define IN_ANY 0
+#define IN_RAM 1
+#define ON_DISK 2
+
+// ============================================================================
+// 公共函数实现
+// ============================================================================
+
+/**
+ * @brief 初始化缓存并启动后台线程
+ */
+int stream_spool_init(stream_spool_t *spool, const stream_spool_config_t *config)
+{
+    if (!spool || !config || config->ram_frames < 1 || config->ram_frames > STREAM_SPOOL_MAX_RAM)
+    {
+        return -1;
+    }
+
+    memset(spool, 0, sizeof(*spool));
+    spool->config = *config;
+    spool->config.dir[sizeof(spool->config.dir) - 1] = '\0';
+    spool->disk_fd = -1;
+    pthread_mutex_init(&spool->lock, NULL);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&spool->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    // 补发帧的描述符：每个内存缓冲区最多对应一个
+    frame_pool_init(&spool->pool, config->ram_frames, release_replay_frame, spool);
+
+    if (pthread_create(&spool->thread, NULL, spool_thread_main, spool) != 0)
+    {
+        printf("Error: Failed to create stream spool thread\n");
+        frame_pool_destroy(&spool->pool);
+        pthread_cond_destroy(&spool->cond);
+        pthread_mutex_destroy(&spool->lock);
+        return -1;
+    }
+    spool->thread_started = 1;
+
+    printf("Stream spool: %d frames in memory, %s, reconnect within %d s\n", config->ram_frames,
+           config->dir[0] && config->disk_mb > 0 ? "spills to disk" : "no spill file", config->timeout_ms / 1000);
+    if (config->dir[0] && config->disk_mb > 0)
+    {
+        printf("Stream spool: spill file %s/%s, up to %d MB\n", config->dir, STREAM_SPOOL_FILE, config->disk_mb);
+    }
+    return 0;
+}
+
+/**
+ * @brief 停止后台线程并释放资源
+ */
+void stream_spool_destroy(stream_spool_t *spool)
+{
+    if (!spool || !spool->thread_started)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spool->lock);
+    spool->stop = 1;
+    __atomic_store_n(&spool->state, SPOOL_IDLE, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&spool->cond);
+    pthread_mutex_unlock(&spool->lock);
+    pthread_join(spool->thread, NULL);
+    spool->thread_started = 0;
+
+    frame_ref_t *released[STREAM_SPOOL_PENDING];
+    pthread_mutex_lock(&spool->lock);
+    int count = discard_locked(spool, released);
+    pthread_mutex_unlock(&spool->lock);
+    for (int i = 0; i < count; i++)
+    {
+        frame_pool_release(released[i]);
+    }
+
+    close_spill_file(spool);
+    frame_pool_destroy(&spool->pool);
+    for (int i = 0; i < STREAM_SPOOL_MAX_RAM; i++)
+    {
+        free(spool->ram[i]);
+        spool->ram[i] = NULL;
+        spool->ram_capacity[i] = 0;
+    }
+    pthread_cond_destroy(&spool->cond);
+    pthread_mutex_destroy(&spool->lock);
+}
+
+/**
+ * @brief 设置补发帧就绪通知
+ */
+void stream_spool_set_ready(stream_spool_t *spool, stream_spool_ready_fn ready_fn, void *user)
+{
+    pthread_mutex_lock(&spool->lock);
+    spool->ready_fn = ready_fn;
+    spool->ready_user = user;
+    pthread_mutex_unlock(&spool->lock);
+}
+
+/**
+ * @brief 会话断线，开始录入
+ */
+void stream_spool_begin(stream_spool_t *spool, uint64_t session)
+{
+    frame_ref_t *released[STREAM_SPOOL_PENDING];
+    int count = 0;
+
+    pthread_mutex_lock(&spool->lock);
+    if (spool->state != SPOOL_IDLE && spool->session == session)
+    {
+        // 补发途中再次断线：未取出的帧保留，新帧接在后面
+        printf("Stream spool: session %016llx lost again, %d frames still spooled\n",
+               (unsigned long long)session, spool->entry_count);
+    }
+    else
+    {
+        if (spool->state != SPOOL_IDLE)
+        {
+            printf("Stream spool: dropping %d frames of session %016llx for session %016llx\n",
+                   spool->entry_count, (unsigned long long)spool->session, (unsigned long long)session);
+        }
+        count = discard_locked(spool, released);
+        spool->session = session;
+        spool->recorded = 0;
+        spool->spilled = 0;
+        spool->evicted = 0;
+        spool->dropped = 0;
+        spool->replayed = 0;
+        printf("Stream spool: recording session %016llx for up to %d s\n", (unsigned long long)session,
+               spool->config.timeout_ms / 1000);
+    }
+    spool->deadline_ns = monotonic_ns() + (uint64_t)spool->config.timeout_ms * NS_PER_MS;
+    __atomic_store_n(&spool->state, SPOOL_RECORDING, __ATOMIC_RELEASE);
+    pthread_cond_signal(&spool->cond);
+    pthread_mutex_unlock(&spool->lock);
+
+    for (int i = 0; i < count; i++)
+    {
+        frame_pool_release(released[i]);
+    }
+}
+
+/**
+ * @brief 是否正在录入
+ */
+int stream_spool_recording(stream_spool_t *spool)
+{
+    return spool && __atomic_load_n(&spool->state, __ATOMIC_ACQUIRE) == SPOOL_RECORDING;
+}
+
+/**
+ * @brief 录入一帧
+ */
+void stream_spool_put(stream_spool_t *spool, frame_ref_t *ref)
+{
+    if (!ref || !stream_spool_recording(spool))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spool->lock);
+    if (spool->state == SPOOL_RECORDING)
+    {
+        if (spool->pending_count < STREAM_SPOOL_PENDING)
+        {
+            frame_pool_retain(ref);
+            spool->pending[spool->pending_count++] = ref;
+            pthread_cond_signal(&spool->cond);
+        }
+        else
+        {
+            spool->dropped++; // 后台线程还在复制前面的帧 (通常是溢出文件写得太慢)
+        }
+    }
+    pthread_mutex_unlock(&spool->lock);
+}
+
+/**
+ * @brief 会话重新连接，开始补发
+ */
+int stream_spool_attach(stream_spool_t *spool, uint64_t session)
+{
+    pthread_mutex_lock(&spool->lock);
+    if (spool->state == SPOOL_IDLE || spool->session != session)
+    {
+        pthread_mutex_unlock(&spool->lock);
+        return -1;
+    }
+
+    int count = spool->entry_count + spool->pending_count;
+    printf("Stream spool: session %016llx reconnected, replaying %d frames "
+           "(%u recorded, %u spilled to disk, %u evicted, %u dropped)\n",
+           (unsigned long long)session, count, spool->recorded, spool->spilled, spool->evicted, spool->dropped);
+    __atomic_store_n(&spool->state, SPOOL_REPLAYING, __ATOMIC_RELEASE);
+    spool->deadline_ns = monotonic_ns() + (uint64_t)spool->config.timeout_ms * NS_PER_MS;
+    pthread_cond_signal(&spool->cond);
+    pthread_mutex_unlock(&spool->lock);
+    return count;
+}
+
+/**
+ * @brief 取出下一帧补发帧
+ */
+int stream_spool_next(stream_spool_t *spool, frame_ref_t **ref)
+{
+    *ref = NULL;
+
+    pthread_mutex_lock(&spool->lock);
+    if (spool->state != SPOOL_REPLAYING)
+    {
+        pthread_mutex_unlock(&spool->lock);
+        return -1;
+    }
+
+    int index = oldest_entry_locked(spool, IN_ANY);
+    if (index < 0)
+    {
+        if (spool->pending_count > 0)
+        {
+            pthread_mutex_unlock(&spool->lock);
+            return 0; // 断线前最后几帧仍在复制
+        }
+        printf("Stream spool: catch-up of session %016llx complete, %u frames replayed\n",
+               (unsigned long long)spool->session, spool->replayed);
+        __atomic_store_n(&spool->state, SPOOL_IDLE, __ATOMIC_RELEASE);
+        pthread_cond_signal(&spool->cond); // 让后台线程释放缓冲区
+        pthread_mutex_unlock(&spool->lock);
+        return -1;
+    }
+
+    if (spool->entries[index].slot < 0 && free_slot_locked(spool) < 0)
+    {
+        // 最早的帧在文件中，而内存全被较新的帧占着无法读回：先发内存中的帧 (接收端按采集序号排序)
+        int in_ram = oldest_entry_locked(spool, IN_RAM);
+        index = in_ram >= 0 ? in_ram : index;
+    }
+
+    stream_spool_entry_t entry = spool->entries[index];
+    if (entry.slot < 0 || spool->ram_state[entry.slot] != RAM_HELD)
+    {
+        pthread_cond_signal(&spool->cond); // 在文件中或读回中
+        pthread_mutex_unlock(&spool->lock);
+        return 0;
+    }
+
+    remove_entry_locked(spool, index);
+    spool->ram_state[entry.slot] = RAM_OUT;
+    spool->replayed++;
+    spool->deadline_ns = monotonic_ns() + (uint64_t)spool->config.timeout_ms * NS_PER_MS; // 补发有进展
+    pthread_mutex_unlock(&spool->lock);
+
+    // 登记到自己的帧池，发送方像普通帧一样使用和释放
+    *ref = frame_pool_wrap(&spool->pool, &entry.frame, &entry.meta);
+    if (!*ref)
+    {
+        printf("Error: No descriptor for spooled frame %u\n", entry.meta.sequence);
+        pthread_mutex_lock(&spool->lock);
+        spool->ram_state[entry.slot] = RAM_FREE;
+        pthread_mutex_unlock(&spool->lock);
+        return 0;
+    }
+    return 1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+/**
+ * @brief 后台线程：复制录入的帧、写入和读回溢出文件、处理超时
+ */
+static void *spool_thread_main(void *arg)
+{
+    stream_spool_t *spool = arg;
+
+    pthread_mutex_lock(&spool->lock);
+    while (!spool->stop)
+    {
+        // 每项工作可能暂时放开锁，完成后从头重新检查
+        if (expire_locked(spool) || copy_pending_locked(spool) || spill_locked(spool, 0) || load_locked(spool))
+        {
+            continue;
+        }
+        if (spool->state == SPOOL_IDLE)
+        {
+            trim_idle_locked(spool);
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += WORKER_IDLE_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&spool->cond, &spool->lock, &deadline);
+    }
+    pthread_mutex_unlock(&spool->lock);
+    return NULL;
+}
+
+/**
+ * @brief 把一帧等待复制的帧复制到内存缓冲区
+ * @return 1做了工作，0无事可做
+ */
+static int copy_pending_locked(stream_spool_t *spool)
+{
+    if (spool->pending_count == 0)
+    {
+        return 0;
+    }
+
+    int slot = free_slot_locked(spool);
+    if (slot < 0)
+    {
+        // 内存已满：先写一帧到文件，写不了就丢弃内存中最早的帧
+        if (spill_locked(spool, 1))
+        {
+            return 1;
+        }
+        if (evict_oldest_locked(spool, IN_RAM) < 0)
+        {
+            return 0; // 缓冲区都在补发或读写中，等它们释放
+        }
+        slot = free_slot_locked(spool);
+        if (slot < 0)
+        {
+            return 1;
+        }
+    }
+
+    frame_ref_t *ref = spool->pending[0];
+    memmove(&spool->pending[0], &spool->pending[1], (size_t)(spool->pending_count - 1) * sizeof(spool->pending[0]));
+    spool->pending_count--;
+    spool->ram_state[slot] = RAM_BUSY;
+    uint32_t generation = spool->generation;
+    pthread_mutex_unlock(&spool->lock);
+
+    media_frame_t frame = ref->frame;
+    frame_meta_t meta = ref->meta;
+    int ok = ensure_capacity(spool, slot, frame.size) == 0;
+    if (ok)
+    {
+        memcpy(spool->ram[slot], frame.data, frame.size);
+    }
+    frame_pool_release(ref);
+
+    pthread_mutex_lock(&spool->lock);
+    if (!ok || generation != spool->generation || spool->state == SPOOL_IDLE ||
+        find_entry_locked(spool, meta.sequence) >= 0)
+    {
+        spool->ram_state[slot] = RAM_FREE;
+        return 1;
+    }
+    if (spool->entry_count == STREAM_SPOOL_MAX_ENTRIES && evict_oldest_locked(spool, IN_ANY) < 0)
+    {
+        spool->ram_state[slot] = RAM_FREE; // 最早的帧正在读写，放弃新帧
+        spool->dropped++;
+        return 1;
+    }
+
+    stream_spool_entry_t *entry = &spool->entries[spool->entry_count++];
+    entry->frame = frame;
+    entry->frame.data = spool->ram[slot];
+    entry->meta = meta;
+    entry->slot = slot;
+    entry->record = -1;
+    spool->ram_state[slot] = RAM_HELD;
+    spool->recorded++;
+    if (spool->state == SPOOL_REPLAYING && spool->ready_fn)
+    {
+        spool->ready_fn(spool->ready_user); // 重连前的最后几帧
+    }
+    return 1;
+}
+
+/**
+ * @brief 把内存中最早的一帧写入溢出文件
+ * @param force 1: 内存已满必须腾出空间；0: 录入时空闲缓冲区低于水位才写
+ * @return 1做了工作，0无事可做
+ */
+static int spill_locked(stream_spool_t *spool, int force)
+{
+    if (spool->state != SPOOL_RECORDING || !spool->config.dir[0] || spool->config.disk_mb <= 0)
+    {
+        return 0;
+    }
+
+    if (!force)
+    {
+        int free_slots = 0;
+        for (int i = 0; i < spool->config.ram_frames; i++)
+        {
+            free_slots += (spool->ram_state[i] == RAM_FREE);
+        }
+        if (free_slots >= SPILL_LOW_WATER)
+        {
+            return 0;
+        }
+    }
+
+    int index = oldest_entry_locked(spool, IN_RAM);
+    if (index < 0)
+    {
+        return 0;
+    }
+    if (spool->disk_fd < 0 || spool->entries[index].frame.size > spool->record_size)
+    {
+        if (open_spill_file_locked(spool, spool->entries[index].frame.size) != 0)
+        {
+            return 0;
+        }
+    }
+
+    // 找空闲记录，文件已满时丢弃文件中最早的帧
+    int record = -1;
+    for (int i = 0; i < spool->record_count && record < 0; i++)
+    {
+        record = spool->record_used[i] ? -1 : i;
+    }
+    if (record < 0)
+    {
+        int victim = oldest_entry_locked(spool, ON_DISK);
+        if (victim < 0)
+        {
+            return 0;
+        }
+        record = spool->entries[victim].record;
+        remove_entry_locked(spool, victim);
+        spool->record_used[record] = 0;
+        spool->evicted++;
+        index = oldest_entry_locked(spool, IN_RAM); // 删除会移动数组元素
+    }
+
+    stream_spool_entry_t entry = spool->entries[index];
+    spool->record_used[record] = 1;
+    spool->ram_state[entry.slot] = RAM_BUSY;
+    uint32_t generation = spool->generation;
+    int fd = spool->disk_fd;
+    off_t offset = (off_t)record * (off_t)spool->record_size;
+    pthread_mutex_unlock(&spool->lock);
+
+    ssize_t written = pwrite(fd, spool->ram[entry.slot], entry.frame.size, offset);
+
+    pthread_mutex_lock(&spool->lock);
+    if (generation != spool->generation)
+    {
+        spool->ram_state[entry.slot] = RAM_FREE; // 缓存已被丢弃，记录也已清空
+        return 1;
+    }
+
+    index = find_entry_locked(spool, entry.meta.sequence);
+    if (index < 0)
+    {
+        spool->record_used[record] = 0;
+        spool->ram_state[entry.slot] = RAM_FREE;
+        return 1;
+    }
+    if (written != (ssize_t)entry.frame.size)
+    {
+        // 写入失败 (空间不足或存储被拔出)：本次会话不再使用文件
+        printf("Warning: Stream spool write failed: %s, spilling disabled\n",
+               written < 0 ? strerror(errno) : "short write");
+        spool->record_used[record] = 0;
+        spool->record_count = 0;
+        spool->ram_state[entry.slot] = RAM_HELD;
+        return 1;
+    }
+
+    spool->entries[index].slot = -1;
+    spool->entries[index].record = record;
+    spool->entries[index].frame.data = NULL;
+    spool->ram_state[entry.slot] = RAM_FREE;
+    spool->spilled++;
+    return 1;
+}
+
+/**
+ * @brief 补发时把文件中最早的一帧读回内存
+ * @return 1做了工作，0无事可做
+ */
+static int load_locked(stream_spool_t *spool)
+{
+    if (spool->state != SPOOL_REPLAYING)
+    {
+        return 0;
+    }
+
+    int index = oldest_entry_locked(spool, ON_DISK);
+    int slot = index >= 0 ? free_slot_locked(spool) : -1;
+    if (slot < 0)
+    {
+        return 0;
+    }
+
+    stream_spool_entry_t entry = spool->entries[index];
+    spool->entries[index].slot = slot; // 读回期间缓冲区为读写中，不会被取走
+    spool->ram_state[slot] = RAM_BUSY;
+    uint32_t generation = spool->generation;
+    int fd = spool->disk_fd;
+    off_t offset = (off_t)entry.record * (off_t)spool->record_size;
+    pthread_mutex_unlock(&spool->lock);
+
+    int ok = ensure_capacity(spool, slot, entry.frame.size) == 0 &&
+             pread(fd, spool->ram[slot], entry.frame.size, offset) == (ssize_t)entry.frame.size;
+
+    pthread_mutex_lock(&spool->lock);
+    if (generation != spool->generation)
+    {
+        spool->ram_state[slot] = RAM_FREE;
+        return 1;
+    }
+
+    index = find_entry_locked(spool, entry.meta.sequence);
+    spool->record_used[entry.record] = 0;
+    if (!ok)
+    {
+        printf("Warning: Stream spool read of frame %u failed, skipping it\n", entry.meta.sequence);
+        remove_entry_locked(spool, index);
+        spool->ram_state[slot] = RAM_FREE;
+    }
+    else
+    {
+        spool->entries[index].record = -1;
+        spool->entries[index].frame.data = spool->ram[slot];
+        spool->ram_state[slot] = RAM_HELD;
+    }
+
+    if (spool->ready_fn)
+    {
+        spool->ready_fn(spool->ready_user);
+    }
+    return 1;
+}
+
+/**
+ * @brief 录入超时 (会话没有按时重连) 或补发长时间无进展时丢弃缓存
+ * @return 1做了工作，0无事可做
+ */
+static int expire_locked(stream_spool_t *spool)
+{
+    if (spool->state == SPOOL_IDLE || monotonic_ns() < spool->deadline_ns)
+    {
+        return 0;
+    }
+
+    if (spool->state == SPOOL_RECORDING)
+    {
+        printf("Stream spool: session %016llx did not reconnect, discarding %d frames\n",
+               (unsigned long long)spool->session, spool->entry_count + spool->pending_count);
+    }
+    else
+    {
+        // 重连的客户端长时间不取补发帧 (链路停滞)：不再占用内存缓冲区和溢出文件
+        printf("Stream spool: catch-up of session %016llx made no progress for %d s, discarding %d frames "
+               "(%u replayed)\n", (unsigned long long)spool->session, spool->config.timeout_ms / 1000,
+               spool->entry_count + spool->pending_count, spool->replayed);
+    }
+    __atomic_store_n(&spool->state, SPOOL_IDLE, __ATOMIC_RELEASE);
+
+    frame_ref_t *released[STREAM_SPOOL_PENDING];
+    int count = discard_locked(spool, released);
+    pthread_mutex_unlock(&spool->lock);
+    for (int i = 0; i < count; i++)
+    {
+        frame_pool_release(released[i]);
+    }
+    pthread_mutex_lock(&spool->lock);
+    return 1;
+}
+
+/**
+ * @brief 空闲时释放内存缓冲区和溢出文件 (设备内存有限，不长期占用)
+ */
+static void trim_idle_locked(stream_spool_t *spool)
+{
+    for (int i = 0; i < STREAM_SPOOL_MAX_RAM; i++)
+    {
+        if (spool->ram[i] && spool->ram_state[i] == RAM_FREE)
+        {
+            free(spool->ram[i]);
+            spool->ram[i] = NULL;
+            spool->ram_capacity[i] = 0;
+        }
+    }
+    if (spool->disk_fd >= 0 && spool->entry_count == 0)
+    {
+        close_spill_file(spool);
+    }
+}
+
+/**
+ * @brief 按帧大小 (重新) 创建溢出文件 (文件中没有帧时才可以重建)
+ * @return 0成功，-1失败或文件中仍有帧
+ */
+static int open_spill_file_locked(stream_spool_t *spool, size_t frame_size)
+{
+    for (int i = 0; i < spool->record_count; i++)
+    {
+        if (spool->record_used[i])
+        {
+            return -1; // 帧大小变化，旧记录读完前不能重建
+        }
+    }
+    if (spool->disk_fd >= 0 && spool->record_count == 0)
+    {
+        return -1; // 本次会话写入失败过
+    }
+    close_spill_file(spool);
+
+    size_t limit = (size_t)spool->config.disk_mb << 20;
+    int records = frame_size > 0 ? (int)(limit / frame_size) : 0;
+    if (records > STREAM_SPOOL_MAX_ENTRIES)
+    {
+        records = STREAM_SPOOL_MAX_ENTRIES;
+    }
+    if (records < 1)
+    {
+        return -1;
+    }
+
+    char path[192];
+    snprintf(path, sizeof(path), "%s/%s", spool->config.dir, STREAM_SPOOL_FILE);
+    spool->disk_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (spool->disk_fd < 0)
+    {
+        printf("Warning: Failed to create spool file %s: %s\n", path, strerror(errno));
+        spool->config.disk_mb = 0; // 不再尝试
+        return -1;
+    }
+
+    spool->record_size = frame_size;
+    spool->record_count = records;
+    memset(spool->record_used, 0, sizeof(spool->record_used));
+    printf("Stream spool: spill file %s holds %d frames\n", path, records);
+    return 0;
+}
+
+/**
+ * @brief 关闭并删除溢出文件
+ */
+static void close_spill_file(stream_spool_t *spool)
+{
+    if (spool->disk_fd < 0)
+    {
+        return;
+    }
+
+    char path[192];
+    snprintf(path, sizeof(path), "%s/%s", spool->config.dir, STREAM_SPOOL_FILE);
+    close(spool->disk_fd);
+    unlink(path);
+    spool->disk_fd = -1;
+    spool->record_size = 0;
+    spool->record_count = 0;
+    memset(spool->record_used, 0, sizeof(spool->record_used));
+}
+
+/**
+ * @brief 丢弃所有缓存的帧
+ * @param released 输出：等待复制的帧引用，调用者在放开锁之后释放
+ *                 (引用可能来自本缓存的帧池，其交还函数需要本缓存的锁)
+ * @return released 中的引用数
+ */
+static int discard_locked(stream_spool_t *spool, frame_ref_t **released)
+{
+    for (int i = 0; i < spool->entry_count; i++)
+    {
+        int slot = spool->entries[i].slot;
+        if (slot >= 0 && spool->ram_state[slot] == RAM_HELD)
+        {
+            spool->ram_state[slot] = RAM_FREE;
+        }
+    }
+    spool->entry_count = 0;
+    memset(spool->record_used, 0, sizeof(spool->record_used));
+    spool->generation++;
+
+    int count = spool->pending_count;
+    memcpy(released, spool->pending, (size_t)count * sizeof(spool->pending[0]));
+    spool->pending_count = 0;
+    return count;
+}
+
+/**
+ * @brief 查找空闲的内存缓冲区
+ * @return 缓冲区编号，没有返回-1
+ */
+static int free_slot_locked(stream_spool_t *spool)
+{
+    for (int i = 0; i < spool->config.ram_frames; i++)
+    {
+        if (spool->ram_state[i] == RAM_FREE)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 查找采集序号最早的帧 (跳过读写中的帧)
+ * @param where IN_ANY / IN_RAM (存于内存) / ON_DISK (存于文件且未在读回)
+ * @return 数组下标，没有返回-1
+ */
+static int oldest_entry_locked(stream_spool_t *spool, int where)
+{
+    int oldest = -1;
+    for (int i = 0; i < spool->entry_count; i++)
+    {
+        const stream_spool_entry_t *entry = &spool->entries[i];
+        int in_ram = entry->slot >= 0 && spool->ram_state[entry->slot] == RAM_HELD;
+        int on_disk = entry->slot < 0;
+        if ((where == IN_RAM && !in_ram) || (where == ON_DISK && !on_disk))
+        {
+            continue;
+        }
+        // 采集序号按差值比较，回绕后仍然正确
+        if (oldest < 0 || (int32_t)(entry->meta.sequence - spool->entries[oldest].meta.sequence) < 0)
+        {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief 按采集序号查找帧
+ * @return 数组下标，没有返回-1
+ */
+static int find_entry_locked(stream_spool_t *spool, uint32_t sequence)
+{
+    for (int i = 0; i < spool->entry_count; i++)
+    {
+        if (spool->entries[i].meta.sequence == sequence)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 从数组中删除一帧 (与最后一项交换)
+ */
+static void remove_entry_locked(stream_spool_t *spool, int index)
+{
+    spool->entries[index] = spool->entries[--spool->entry_count];
+}
+
+/**
+ * @brief 丢弃最早的一帧 (缓存满)
+ * @param where IN_ANY / IN_RAM / ON_DISK
+ * @return 被腾出的内存缓冲区或文件记录编号，没有可丢弃的帧返回-1
+ */
+static int evict_oldest_locked(stream_spool_t *spool, int where)
+{
+    int index = oldest_entry_locked(spool, where);
+    if (index < 0 || (where == IN_ANY && spool->entries[index].slot >= 0 &&
+                      spool->ram_state[spool->entries[index].slot] != RAM_HELD))
+    {
+        return -1;
+    }
+
+    stream_spool_entry_t entry = spool->entries[index];
+    remove_entry_locked(spool, index);
+    spool->evicted++;
+    if (entry.slot >= 0)
+    {
+        spool->ram_state[entry.slot] = RAM_FREE;
+        return entry.slot;
+    }
+    spool->record_used[entry.record] = 0;
+    return entry.record;
+}
+
+/**
+ * @brief 确保内存缓冲区不小于帧大小 (只由后台线程对读写中的缓冲区调用)
+ * @return 0成功，-1内存不足
+ */
+static int ensure_capacity(stream_spool_t *spool, int slot, size_t size)
+{
+    if (size <= spool->ram_capacity[slot])
+    {
+        return 0;
+    }
+
+    free(spool->ram[slot]);
+    spool->ram[slot] = malloc(size);
+    spool->ram_capacity[slot] = spool->ram[slot] ? size : 0;
+    if (!spool->ram[slot])
+    {
+        printf("Error: Failed to allocate %zu bytes for stream spool\n", size);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 补发帧的最后一个引用释放：内存缓冲区回到空闲
+ */
+static void release_replay_frame(media_frame_t *frame, void *user)
+{
+    stream_spool_t *spool = user;
+
+    pthread_mutex_lock(&spool->lock);
+    for (int i = 0; i < STREAM_SPOOL_MAX_RAM; i++)
+    {
+        if (spool->ram[i] == frame->data && spool->ram_state[i] == RAM_OUT)
+        {
+            spool->ram_state[i] = RAM_FREE;
+            pthread_cond_signal(&spool->cond);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&spool->lock);
+}
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
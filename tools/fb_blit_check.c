@@ -0,0 +1,474 @@
+/**
+ * @file fb_blit_check.c
+ * @brief 帧缓冲直写模块的主机端检查工具
+ * @details 用普通文件模拟帧缓冲 (fb_blit 的非设备分支)，按设备上的用法依次执行：
+ *          整屏填充、按区域地址和行跨度写入RGB565图案、超出屏幕的填充裁剪、
+ *          预览内核直接渲染到屏幕区域，关闭后从文件读回并与内存中的期望图像逐像素比较。
+ *          同时检查文件过小和区域越界时的失败路径
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fb_blit.h"
+#include "preview.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define INITIAL_BYTE 0x5A           // 文件初始内容 (检查整屏填充是否覆盖每个像素)
+#define BACKGROUND_COLOR 0x001F     // 整屏填充色 (蓝)
+#define CLIP_COLOR 0xF800           // 越界填充色 (红)
+#define CLIP_SIZE 24                // 越界填充的边长 (左下角各有一半超出屏幕)
+#define PREVIEW_SOURCE_WIDTH 640    // 预览渲染的合成RAW帧尺寸
+#define PREVIEW_SOURCE_HEIGHT 480
+
+/**
+ * @brief 命令行选项
+ */
+typedef struct {
+    int width;              // 模拟屏幕宽度
+    int height;             // 模拟屏幕高度
+    const char *keep;       // 保留结果图像的文件路径，NULL时使用临时文件并在结束后删除
+} check_options_t;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void print_usage(const char *program);
+static int parse_options(int argc, char **argv, check_options_t *options);
+static int create_file(const check_options_t *options, char *path, size_t path_size);
+static int resize_file(const char *path, size_t size);
+static uint16_t pattern_pixel(int col, int row, int width, int height);
+static void model_fill(uint16_t *model, int width, int height,
+                       int x, int y, int w, int h, uint16_t color);
+static int render_preview(fb_blit_t *fb, uint16_t *model, int x, int y, int w, int h);
+static int check_bounds(fb_blit_t *fb);
+static int compare_file(const char *path, const uint16_t *model, int width, int height);
+static int run_check(const check_options_t *options, const char *path);
+
+// ============================================================================
+// 主函数
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    check_options_t options;
+    if (parse_options(argc, argv, &options) != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    char path[256];
+    if (create_file(&options, path, sizeof(path)) != 0)
+    {
+        return 1;
+    }
+
+    int ret = run_check(&options, path);
+    if (!options.keep)
+    {
+        unlink(path);
+    }
+    else if (ret == 0)
+    {
+        printf("Result image kept in %s (%dx%d RGB565)\n", path, options.width, options.height);
+    }
+
+    printf(ret == 0 ? "fb_blit check passed\n" : "fb_blit check FAILED\n");
+    return ret == 0 ? 0 : 1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+static void print_usage(const char *program)
+{
+    printf("Usage:\n");
+    printf("  %s [options]\n", program);
+    printf("\nOptions:\n");
+    printf("  --width W --height H  fake screen size (default 320x240, at least %dx%d)\n",
+           2 * CLIP_SIZE, 2 * CLIP_SIZE);
+    printf("  --keep PATH         write the fake framebuffer to PATH and keep it\n");
+}
+
+/**
+ * @brief 解析选项
+ * @return 0成功，-1参数无效
+ */
+static int parse_options(int argc, char **argv, check_options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->width = 320;
+    options->height = 240;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *name = argv[i];
+        if (i + 1 >= argc)
+        {
+            printf("Error: Missing value for %s\n", name);
+            return -1;
+        }
+
+        const char *value = argv[++i];
+        if (strcmp(name, "--width") == 0)
+        {
+            options->width = atoi(value);
+        }
+        else if (strcmp(name, "--height") == 0)
+        {
+            options->height = atoi(value);
+        }
+        else if (strcmp(name, "--keep") == 0)
+        {
+            options->keep = value;
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", name);
+            return -1;
+        }
+    }
+
+    if (options->width < 2 * CLIP_SIZE || options->height < 2 * CLIP_SIZE ||
+        options->width > 4096 || options->height > 4096)
+    {
+        printf("Error: Invalid screen size\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 创建模拟帧缓冲文件 (大小先比屏幕少一行，用于检查文件过小时的失败路径)
+ * @return 0成功，-1失败
+ */
+static int create_file(const check_options_t *options, char *path, size_t path_size)
+{
+    int fd;
+    if (options->keep)
+    {
+        snprintf(path, path_size, "%s", options->keep);
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    else
+    {
+        snprintf(path, path_size, "/tmp/fb_blit_check.XXXXXX");
+        fd = mkstemp(path);
+    }
+    if (fd < 0)
+    {
+        printf("Error: Failed to create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    close(fd);
+
+    size_t line_bytes = (size_t)options->width * sizeof(uint16_t);
+    return resize_file(path, line_bytes * (options->height - 1));
+}
+
+/**
+ * @brief 把文件设为指定大小，内容全部为 INITIAL_BYTE
+ * @return 0成功，-1失败
+ */
+static int resize_file(const char *path, size_t size)
+{
+    int fd = open(path, O_WRONLY | O_TRUNC);
+    if (fd < 0)
+    {
+        printf("Error: Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    uint8_t block[4096];
+    memset(block, INITIAL_BYTE, sizeof(block));
+    size_t written = 0;
+    while (written < size)
+    {
+        size_t chunk = size - written < sizeof(block) ? size - written : sizeof(block);
+        ssize_t n = write(fd, block, chunk);
+        if (n <= 0)
+        {
+            printf("Error: Failed to write %s: %s\n", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        written += (size_t)n;
+    }
+
+    close(fd);
+    return 0;
+}
+
+/**
+ * @brief 区域写入的RGB565图案：红色随列、绿色随行渐变，蓝色为对角条纹
+ */
+static uint16_t pattern_pixel(int col, int row, int width, int height)
+{
+    uint16_t red = (uint16_t)(col * 31 / (width - 1));
+    uint16_t green = (uint16_t)(row * 63 / (height - 1));
+    uint16_t blue = (uint16_t)((col + row) & 31);
+    return (uint16_t)((red << 11) | (green << 5) | blue);
+}
+
+/**
+ * @brief 在期望图像上按 fb_blit_fill 的规则 (裁剪到屏幕) 填充
+ */
+static void model_fill(uint16_t *model, int width, int height,
+                       int x, int y, int w, int h, uint16_t color)
+{
+    for (int row = y; row < y + h; row++)
+    {
+        for (int col = x; col < x + w; col++)
+        {
+            if (row >= 0 && row < height && col >= 0 && col < width)
+            {
+                model[(size_t)row * width + col] = color;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 与设备相同，预览内核直接渲染到屏幕区域 (dst_stride 为屏幕行跨度)；
+ *        期望图像用同一上下文渲染到紧凑缓冲区后写入对应位置
+ * @return 0成功，-1失败
+ */
+static int render_preview(fb_blit_t *fb, uint16_t *model, int x, int y, int w, int h)
+{
+    raw_layout_t layout;
+    raw_layout_detect(&layout, raw_format_find("SBGGR10"), PREVIEW_SOURCE_WIDTH, PREVIEW_SOURCE_HEIGHT,
+                      0, 0, RAW_PACKING_ROCKCHIP);
+    size_t raw_size = layout.stride * (size_t)layout.height;
+
+    uint8_t *raw = malloc(raw_size);
+    uint16_t *compact = malloc((size_t)w * h * sizeof(uint16_t));
+    static preview_context_t ctx; // 含4个查找表，不放在栈上
+    int ret = -1;
+
+    if (raw && compact)
+    {
+        uint32_t seed = 0x2468ACE0u;
+        for (size_t i = 0; i < raw_size; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            raw[i] = (uint8_t)(seed >> 24);
+        }
+
+        preview_params_t params = {PREVIEW_MODE_COLOR, PREVIEW_GAIN_UNITY, PREVIEW_GAIN_UNITY,
+                                   PREVIEW_GAIN_UNITY, 0, 1.0f, 1.0f};
+        preview_context_init(&ctx);
+        preview_set_params(&ctx, &params);
+
+        int stride;
+        uint16_t *dst = fb_blit_region(fb, x, y, w, h, &stride);
+        if (dst && preview_render_raw(&ctx, &layout, raw, raw_size, dst, stride, w, h) == 0 &&
+            preview_render_raw(&ctx, &layout, raw, raw_size, compact, w, w, h) == 0)
+        {
+            for (int row = 0; row < h; row++)
+            {
+                memcpy(model + (size_t)(y + row) * fb->width + x, compact + (size_t)row * w,
+                       (size_t)w * sizeof(uint16_t));
+            }
+            ret = 0;
+        }
+        else
+        {
+            printf("Error: Preview render into framebuffer region failed\n");
+        }
+        preview_context_release(&ctx);
+    }
+    else
+    {
+        printf("Error: Failed to allocate preview buffers\n");
+    }
+
+    free(raw);
+    free(compact);
+    return ret;
+}
+
+/**
+ * @brief 越界区域必须返回NULL
+ * @return 0成功，-1失败
+ */
+static int check_bounds(fb_blit_t *fb)
+{
+    static const int cases[][4] = {
+        {-1, 0, 4, 4}, {0, -1, 4, 4}, {0, 0, 0, 4}, {0, 0, 4, 0}, {0, 0, -1, -1},
+    };
+    int stride;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        if (fb_blit_region(fb, cases[i][0], cases[i][1], cases[i][2], cases[i][3], &stride))
+        {
+            printf("Error: Region (%d,%d %dx%d) should be rejected\n",
+                   cases[i][0], cases[i][1], cases[i][2], cases[i][3]);
+            return -1;
+        }
+    }
+
+    // 恰好到达右下角的区域有效，多一个像素无效
+    if (!fb_blit_region(fb, fb->width - 4, fb->height - 4, 4, 4, &stride) ||
+        fb_blit_region(fb, fb->width - 4, fb->height - 4, 5, 4, &stride) ||
+        fb_blit_region(fb, fb->width - 4, fb->height - 4, 4, 5, &stride))
+    {
+        printf("Error: Region bounds at the bottom-right corner are wrong\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 从文件读回图像 (不经映射) 并与期望图像逐像素比较
+ * @return 0一致，-1不一致或读取失败
+ */
+static int compare_file(const char *path, const uint16_t *model, int width, int height)
+{
+    size_t size = (size_t)width * height * sizeof(uint16_t);
+    uint16_t *image = malloc(size);
+    int fd = open(path, O_RDONLY);
+    if (!image || fd < 0)
+    {
+        printf("Error: Failed to read back %s\n", path);
+        free(image);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    ssize_t n = pread(fd, image, size, 0);
+    close(fd);
+    if (n != (ssize_t)size)
+    {
+        printf("Error: Read back %zd of %zu bytes\n", n, size);
+        free(image);
+        return -1;
+    }
+
+    int mismatches = 0;
+    for (int row = 0; row < height; row++)
+    {
+        for (int col = 0; col < width; col++)
+        {
+            size_t i = (size_t)row * width + col;
+            if (image[i] != model[i] && mismatches++ < 5)
+            {
+                printf("  mismatch at (%d,%d): 0x%04X, expected 0x%04X\n", col, row, image[i], model[i]);
+            }
+        }
+    }
+    free(image);
+
+    if (mismatches > 0)
+    {
+        printf("Error: %d of %d pixels differ\n", mismatches, width * height);
+        return -1;
+    }
+    printf("  %d pixels match\n", width * height);
+    return 0;
+}
+
+/**
+ * @brief 依次执行各项检查
+ * @return 0全部通过，-1失败
+ */
+static int run_check(const check_options_t *options, const char *path)
+{
+    int width = options->width;
+    int height = options->height;
+    fb_blit_t fb = {.fd = -1};
+
+    // 文件比屏幕少一行时必须拒绝映射 (fb_blit_open 打印的错误是预期的)
+    printf("Undersized file (expect an error):\n");
+    if (fb_blit_open(&fb, path, width, height) == 0)
+    {
+        printf("Error: Undersized fake framebuffer was accepted\n");
+        fb_blit_close(&fb);
+        return -1;
+    }
+    if (resize_file(path, (size_t)width * height * sizeof(uint16_t)) != 0 ||
+        fb_blit_open(&fb, path, width, height) != 0)
+    {
+        return -1;
+    }
+    if (fb.width != width || fb.height != height || fb.line_length != (size_t)width * sizeof(uint16_t))
+    {
+        printf("Error: Fake framebuffer geometry %dx%d, %zu bytes/line\n",
+               fb.width, fb.height, fb.line_length);
+        fb_blit_close(&fb);
+        return -1;
+    }
+
+    uint16_t *model = malloc((size_t)width * height * sizeof(uint16_t));
+    if (!model)
+    {
+        fb_blit_close(&fb);
+        return -1;
+    }
+    int ret = check_bounds(&fb);
+
+    // 整屏填充
+    fb_blit_fill(&fb, 0, 0, width, height, BACKGROUND_COLOR);
+    model_fill(model, width, height, 0, 0, width, height, BACKGROUND_COLOR);
+
+    // 屏幕中央四分之一区域按行跨度逐像素写入图案
+    int region_x = width / 4;
+    int region_y = height / 4;
+    int region_w = width / 2;
+    int region_h = height / 2;
+    int stride;
+    uint16_t *dst = fb_blit_region(&fb, region_x, region_y, region_w, region_h, &stride);
+    if (!dst || stride != width)
+    {
+        printf("Error: Center region rejected or stride %d != %d\n", dst ? stride : -1, width);
+        ret = -1;
+    }
+    else
+    {
+        for (int row = 0; row < region_h; row++)
+        {
+            for (int col = 0; col < region_w; col++)
+            {
+                uint16_t color = pattern_pixel(col, row, region_w, region_h);
+                dst[(size_t)row * stride + col] = color;
+                model[(size_t)(region_y + row) * width + region_x + col] = color;
+            }
+        }
+    }
+
+    // 左下角和右上角的填充各有一半超出屏幕，只写入可见部分
+    fb_blit_fill(&fb, -CLIP_SIZE / 2, height - CLIP_SIZE / 2, CLIP_SIZE, CLIP_SIZE, CLIP_COLOR);
+    model_fill(model, width, height, -CLIP_SIZE / 2, height - CLIP_SIZE / 2, CLIP_SIZE, CLIP_SIZE, CLIP_COLOR);
+    fb_blit_fill(&fb, width - CLIP_SIZE / 2, -CLIP_SIZE / 2, CLIP_SIZE, CLIP_SIZE, CLIP_COLOR);
+    model_fill(model, width, height, width - CLIP_SIZE / 2, -CLIP_SIZE / 2, CLIP_SIZE, CLIP_SIZE, CLIP_COLOR);
+
+    // 预览渲染到左上角区域 (不与图案区域重叠)
+    if (render_preview(&fb, model, 1, 1, region_x - 1, region_y - 1) != 0)
+    {
+        ret = -1;
+    }
+
+    fb_blit_close(&fb);
+
+    if (compare_file(path, model, width, height) != 0)
+    {
+        ret = -1;
+    }
+    free(model);
+    return ret;
+}
@@ -0,0 +1,25 @@
+/**
+ * @file media.h
+ * @brief 主机编译时替代 libmedia 的头文件
+ * @details 主机端工具只链接帧池、帧流服务器等与硬件无关的模块，
+ *          它们只用到 media_frame_t 的这几个字段；设备程序仍使用 libmedia 的头文件
+ */
+
+#ifndef MXCAMERA_TOOLS_MEDIA_H
+#define MXCAMERA_TOOLS_MEDIA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 一帧图像数据
+ */
+typedef struct {
+    void *data;             /**< 帧数据 */
+    size_t size;            /**< 数据大小（字节） */
+    int width;              /**< 图像宽度 */
+    int height;             /**< 图像高度 */
+    uint32_t pixelformat;   /**< V4L2 像素格式 */
+} media_frame_t;
+
+#endif // MXCAMERA_TOOLS_MEDIA_H
@@ -0,0 +1,424 @@
+/**
+ * @file local_consumer.c
+ * @brief mxCamera 本机帧共享的示例消费者与基准测试工具
+ * @details - connect：连接设备上 mxCamera 的 Unix 域套接字，接收共享缓冲区中的帧，
+ *            统计帧率、采集到可读的延迟和跳过的帧数 (分析进程可以照此接入)
+ *          - loopback：在本机运行帧池和本机帧共享服务器，由合成帧驱动，
+ *            再用同样的消费者逻辑连接测量
+ *          --work-ms 模拟消费者每帧的处理时间，--hold 为同时持有的帧数
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frame_pool.h"
+#include "local_stream.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define DEFAULT_SOCKET_PATH "/tmp/mxcamera.sock"   // 与设备端默认配置相同
+#define MAX_HOLD 4
+
+/**
+ * @brief 命令行选项
+ */
+typedef struct {
+    const char *path;       // 套接字路径
+    uint32_t frames;        // 接收的帧数，0为不限
+    double work_ms;         // 每帧模拟处理时间
+    int hold;               // 同时持有的帧数
+
+    // loopback
+    int width;              // 合成帧宽度
+    int height;             // 合成帧高度 (每像素2字节)
+    double fps;             // 合成帧帧率
+    int clients;            // 并发消费者个数
+} consumer_options_t;
+
+/**
+ * @brief 消费者线程参数
+ */
+typedef struct {
+    const consumer_options_t *options;
+    int index;              // 消费者编号 (从1开始)
+    int result;             // 0成功
+} consumer_job_t;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void print_usage(const char *program);
+static int parse_options(int argc, char **argv, int first, consumer_options_t *options);
+static uint64_t monotonic_ns(void);
+static int compare_u64(const void *a, const void *b);
+static int consume_frames(const consumer_options_t *options, const char *label);
+static void *consumer_thread(void *arg);
+static void *server_thread_main(void *arg);
+static void loopback_release(media_frame_t *frame, void *user);
+static int command_loopback(consumer_options_t *options);
+
+// ============================================================================
+// 主函数
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    consumer_options_t options;
+    if (argc >= 2 && strcmp(argv[1], "connect") == 0 && parse_options(argc, argv, 2, &options) == 0)
+    {
+        return consume_frames(&options, "local") == 0 ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "loopback") == 0 && parse_options(argc, argv, 2, &options) == 0)
+    {
+        return command_loopback(&options) == 0 ? 0 : 1;
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+static void print_usage(const char *program)
+{
+    printf("Usage:\n");
+    printf("  %s connect [options]\n", program);
+    printf("  %s loopback [options] [loopback options]\n", program);
+    printf("\nOptions:\n");
+    printf("  --path PATH       Unix socket path (default %s)\n", DEFAULT_SOCKET_PATH);
+    printf("  --frames N        stop after N frames (default 300, 0 = unlimited)\n");
+    printf("  --work-ms M       simulated processing time per frame (default 0)\n");
+    printf("  --hold N          frames held at once, 1 ~ %d (default 1)\n", MAX_HOLD);
+    printf("\nLoopback options:\n");
+    printf("  --width W --height H  synthetic 16-bit frame size (default 1920x1080)\n");
+    printf("  --fps F           capture rate (default 30)\n");
+    printf("  --clients N       concurrent consumers (default 1)\n");
+}
+
+/**
+ * @brief 解析选项 (从 argv[first] 开始)
+ * @return 0成功，-1参数无效
+ */
+static int parse_options(int argc, char **argv, int first, consumer_options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->path = DEFAULT_SOCKET_PATH;
+    options->frames = 300;
+    options->hold = 1;
+    options->width = 1920;
+    options->height = 1080;
+    options->fps = 30;
+    options->clients = 1;
+
+    for (int i = first; i < argc; i++)
+    {
+        const char *name = argv[i];
+        if (i + 1 >= argc)
+        {
+            printf("Error: Missing value for %s\n", name);
+            return -1;
+        }
+
+        const char *value = argv[++i];
+        if (strcmp(name, "--path") == 0)
+        {
+            options->path = value;
+        }
+        else if (strcmp(name, "--frames") == 0)
+        {
+            options->frames = (uint32_t)strtoul(value, NULL, 10);
+        }
+        else if (strcmp(name, "--work-ms") == 0)
+        {
+            options->work_ms = atof(value);
+        }
+        else if (strcmp(name, "--hold") == 0)
+        {
+            options->hold = atoi(value);
+        }
+        else if (strcmp(name, "--width") == 0)
+        {
+            options->width = atoi(value);
+        }
+        else if (strcmp(name, "--height") == 0)
+        {
+            options->height = atoi(value);
+        }
+        else if (strcmp(name, "--fps") == 0)
+        {
+            options->fps = atof(value);
+        }
+        else if (strcmp(name, "--clients") == 0)
+        {
+            options->clients = atoi(value);
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", name);
+            return -1;
+        }
+    }
+
+    if (options->hold < 1 || options->hold > MAX_HOLD || options->clients < 1 ||
+        options->clients > LOCAL_STREAM_MAX_CLIENTS || options->width <= 0 || options->height <= 0 ||
+        options->fps <= 0)
+    {
+        printf("Error: Invalid hold count, client count, frame size or rate\n");
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief 接收帧并打印统计
+ * @return 0成功，-1连接失败或没有收到帧
+ */
+static int consume_frames(const consumer_options_t *options, const char *label)
+{
+    local_stream_t stream;
+    if (local_stream_connect(&stream, options->path) != 0)
+    {
+        printf("Error: Cannot connect to %s: %s\n", options->path, strerror(errno));
+        return -1;
+    }
+
+    size_t capacity = options->frames ? options->frames : 1024;
+    uint64_t *latency = malloc(capacity * sizeof(uint64_t));
+    local_frame_t held[MAX_HOLD];
+    int held_count = 0;
+    uint32_t frames = 0;
+    uint64_t dropped = 0;
+    uint64_t checksum = 0;
+    uint64_t first_ns = 0;
+    uint64_t last_ns = 0;
+    uint32_t width = 0, height = 0, size = 0;
+
+    while (latency && (options->frames == 0 || frames < options->frames))
+    {
+        local_frame_t frame;
+        int ret = local_stream_next(&stream, &frame, 2000);
+        if (ret != 0)
+        {
+            printf("%s: %s\n", label, ret > 0 ? "no frame for 2s" : "connection closed");
+            break;
+        }
+
+        uint64_t now = monotonic_ns();
+        if (frames == capacity)
+        {
+            capacity *= 2;
+            uint64_t *grown = realloc(latency, capacity * sizeof(uint64_t));
+            if (!grown)
+            {
+                break;
+            }
+            latency = grown;
+        }
+        latency[frames] = now - frame.info.capture_ns;
+        first_ns = frames == 0 ? now : first_ns;
+        last_ns = now;
+        frames++;
+        dropped += frame.info.dropped;
+        width = frame.info.width;
+        height = frame.info.height;
+        size = frame.info.size;
+
+        // 读取帧中每页的一个字节，确认映射可读 (真正的分析代码在这里处理整帧)
+        const uint8_t *data = frame.data;
+        for (uint32_t offset = 0; offset < frame.info.size; offset += 4096)
+        {
+            checksum += data[offset];
+        }
+        if (options->work_ms > 0)
+        {
+            usleep((useconds_t)(options->work_ms * 1000.0));
+        }
+
+        // 持有最近 hold 帧，超出时释放最早的一帧
+        if (held_count == options->hold)
+        {
+            local_stream_release(&stream, &held[0]);
+            memmove(&held[0], &held[1], (size_t)(held_count - 1) * sizeof(held[0]));
+            held_count--;
+        }
+        held[held_count++] = frame;
+    }
+
+    if (frames > 0)
+    {
+        qsort(latency, frames, sizeof(uint64_t), compare_u64);
+        double seconds = (double)(last_ns - first_ns) / 1e9;
+        printf("%s summary: %u frames of %ux%u (%u bytes), %.2f fps, %llu skipped by the server\n", label,
+               frames, width, height, size, seconds > 0 ? (frames - 1) / seconds : 0.0,
+               (unsigned long long)dropped);
+        printf("  capture->readable     p50 %.3f  p95 %.3f  p99 %.3f  max %.3f ms  (sample sum %llu)\n",
+               latency[frames / 2] / 1e6, latency[(frames - 1) * 95 / 100] / 1e6,
+               latency[(frames - 1) * 99 / 100] / 1e6, latency[frames - 1] / 1e6,
+               (unsigned long long)checksum);
+    }
+
+    free(latency);
+    local_stream_close(&stream);
+    return frames > 0 ? 0 : -1;
+}
+
+static void *consumer_thread(void *arg)
+{
+    consumer_job_t *job = arg;
+    char label[16];
+    snprintf(label, sizeof(label), "local%d", job->index);
+    job->result = consume_frames(job->options, label);
+    return NULL;
+}
+
+static void *server_thread_main(void *arg)
+{
+    local_server_run(arg);
+    return NULL;
+}
+
+/**
+ * @brief 帧池交还缓冲区 (合成帧缓冲区由主循环复用，这里无需处理)
+ */
+static void loopback_release(media_frame_t *frame, void *user)
+{
+    (void)frame;
+    (void)user;
+}
+
+static int command_loopback(consumer_options_t *options)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/mxcamera-loopback-%d.sock", (int)getpid());
+    options->path = path;
+
+    // 合成帧：16位像素，帧池的缓冲区释放函数不做任何事，因此准备足够多的缓冲区轮流使用
+    size_t frame_size = (size_t)options->width * (size_t)options->height * 2;
+    uint8_t *frames[FRAME_POOL_MAX_SLOTS];
+    for (int i = 0; i < FRAME_POOL_MAX_SLOTS; i++)
+    {
+        frames[i] = malloc(frame_size);
+        if (!frames[i])
+        {
+            printf("Error: Out of memory for synthetic frames\n");
+            return -1;
+        }
+        memset(frames[i], i * 17, frame_size);
+    }
+
+    frame_pool_t pool;
+    frame_pool_init(&pool, 3, loopback_release, NULL);
+
+    // 每个消费者持有 hold + 1 帧时仍有一个空闲缓冲区 (不超过上限)
+    int buffers = options->clients * (options->hold + 1) + 1;
+    local_server_t server;
+    local_server_config_t config = {
+        .max_clients = options->clients,
+        .buffers = buffers < LOCAL_STREAM_MAX_BUFFERS ? buffers : LOCAL_STREAM_MAX_BUFFERS,
+        .max_held = options->hold + 1, // 持有 hold 帧的同时接收下一帧
+        .stride = (size_t)options->width * 2};
+    if (local_server_init(&server, path, &config) != 0)
+    {
+        frame_pool_destroy(&pool);
+        return -1;
+    }
+
+    pthread_t server_thread;
+    pthread_create(&server_thread, NULL, server_thread_main, &server);
+
+    consumer_job_t jobs[LOCAL_STREAM_MAX_CLIENTS];
+    pthread_t consumers[LOCAL_STREAM_MAX_CLIENTS];
+    int joined[LOCAL_STREAM_MAX_CLIENTS] = {0}; // 已回收的线程不能再次 join
+    for (int i = 0; i < options->clients; i++)
+    {
+        jobs[i] = (consumer_job_t){.options = options, .index = i + 1, .result = -1};
+        pthread_create(&consumers[i], NULL, consumer_thread, &jobs[i]);
+    }
+
+    // 采集循环：按帧率发布，直到所有消费者结束
+    uint64_t period_ns = (uint64_t)(1e9 / options->fps);
+    uint64_t next_ns = monotonic_ns();
+    uint32_t sequence = 0;
+    for (;;)
+    {
+        int running = 0;
+        for (int i = 0; i < options->clients; i++)
+        {
+            if (!joined[i])
+            {
+                joined[i] = (pthread_tryjoin_np(consumers[i], NULL) == 0);
+                running |= !joined[i];
+            }
+        }
+        if (!running)
+        {
+            break;
+        }
+
+        next_ns += period_ns;
+        uint64_t now = monotonic_ns();
+        if (next_ns > now)
+        {
+            usleep((useconds_t)((next_ns - now) / 1000));
+        }
+
+        media_frame_t frame = {
+            .data = frames[sequence % FRAME_POOL_MAX_SLOTS],
+            .size = frame_size,
+            .width = options->width,
+            .height = options->height,
+            .pixelformat = 0};
+        frame_meta_t meta = {.timestamp = monotonic_ns(), .sequence = ++sequence};
+        if (frame_pool_publish(&pool, &frame, &meta) == 0)
+        {
+            frame_ref_t *ref = frame_pool_acquire_latest(&pool);
+            local_server_publish(&server, ref);
+            frame_pool_release(ref);
+        }
+    }
+
+    local_server_stop(&server);
+    pthread_join(server_thread, NULL);
+    printf("Loopback server: %u frames published, %u skipped before copy\n", sequence, server.skipped);
+    local_server_destroy(&server);
+    frame_pool_destroy(&pool);
+
+    int result = 0;
+    for (int i = 0; i < options->clients; i++)
+    {
+        result |= jobs[i].result;
+    }
+    for (int i = 0; i < FRAME_POOL_MAX_SLOTS; i++)
+    {
+        free(frames[i]);
+    }
+    return result;
+}
@@ -0,0 +1,458 @@
+/**
+ * @file mjpeg_preview.c
+ * @brief HTTP MJPEG 预览服务器的本机测试与基准工具
+ * @details - serve：在本机运行与设备相同的预览服务器，图像源为合成的RAW帧 (30 fps 的移动图案)，
+ *            经设备的预览渲染和JPEG编码后推送，可直接用 curl 或浏览器验证：
+ *              curl -o preview.mjpg http://127.0.0.1:8080/stream
+ *              curl -o snapshot.jpg http://127.0.0.1:8080/snapshot
+ *          - bench：不经网络，逐帧测量预览渲染和JPEG编码的耗时与输出大小
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "jpeg_encoder.h"
+#include "mjpeg_server.h"
+#include "preview.h"
+#include "raw_codec.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define SYNTHETIC_FRAMES 8          // 轮流使用的合成帧数
+#define SYNTHETIC_FPS 30            // 合成帧的"采集"帧率
+
+/**
+ * @brief 命令行选项
+ */
+typedef struct {
+    int port;               // HTTP 端口
+    int width;              // 预览最大宽度
+    int height;             // 预览最大高度
+    int fps;                // 预览帧率
+    int quality;            // JPEG 质量
+    int gray;               // 灰度预览
+    int sensor_width;       // 合成帧宽度
+    int sensor_height;      // 合成帧高度
+    const raw_format_t *format; // 合成帧像素格式
+    int seconds;            // serve：运行时间，0为直到 Ctrl-C
+    int frames;             // bench：编码的帧数
+} preview_options_t;
+
+/**
+ * @brief 合成图像源
+ */
+typedef struct {
+    raw_layout_t layout;                // 合成帧布局
+    uint8_t *frames[SYNTHETIC_FRAMES];  // 合成帧数据
+    preview_context_t preview;          // 预览渲染上下文
+    uint64_t start_ns;                  // 开始时刻 (按时间推算当前帧)
+    uint32_t last_sequence;             // 上一次渲染的帧序号
+} synthetic_source_t;
+
+// ============================================================================
+// 全局变量
+// ============================================================================
+
+static mjpeg_server_t *running_server = NULL; // 信号处理函数停止的服务器
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void print_usage(const char *program);
+static int parse_options(int argc, char **argv, int first, preview_options_t *options);
+static uint64_t monotonic_ns(void);
+static int synthetic_init(synthetic_source_t *source, const preview_options_t *options);
+static void synthetic_destroy(synthetic_source_t *source);
+static int synthetic_render(synthetic_source_t *source, mjpeg_image_t *image, uint32_t sequence);
+static int synthetic_source(mjpeg_image_t *image, void *user);
+static void handle_signal(int sig);
+static int command_serve(const preview_options_t *options);
+static int command_bench(const preview_options_t *options);
+
+// ============================================================================
+// 主函数
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    preview_options_t options;
+    if (argc >= 2 && strcmp(argv[1], "serve") == 0 && parse_options(argc, argv, 2, &options) == 0)
+    {
+        return command_serve(&options) == 0 ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0 && parse_options(argc, argv, 2, &options) == 0)
+    {
+        return command_bench(&options) == 0 ? 0 : 1;
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+static void print_usage(const char *program)
+{
+    printf("Usage:\n");
+    printf("  %s serve [options]\n", program);
+    printf("  %s bench [options]\n", program);
+    printf("\nOptions:\n");
+    printf("  --port N            HTTP port (default 8080)\n");
+    printf("  --width W --height H  largest preview size (default 320x240)\n");
+    printf("  --fps F             preview rate, 1 ~ %d (default 10)\n", MJPEG_SERVER_MAX_FPS);
+    printf("  --quality Q         JPEG quality, 1 ~ 100 (default %d)\n", JPEG_QUALITY_DEFAULT);
+    printf("  --gray              grayscale preview\n");
+    printf("  --sensor-width W --sensor-height H  synthetic RAW frame size (default 1920x1080)\n");
+    printf("  --format NAME       synthetic pixel format, e.g. SBGGR10 (default)\n");
+    printf("  --seconds S         serve: stop after S seconds (default 0 = until Ctrl-C)\n");
+    printf("  --frames N          bench: frames to render and encode (default 200)\n");
+}
+
+/**
+ * @brief 解析选项 (从 argv[first] 开始)
+ * @return 0成功，-1参数无效
+ */
+static int parse_options(int argc, char **argv, int first, preview_options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->port = 8080;
+    options->width = 320;
+    options->height = 240;
+    options->fps = 10;
+    options->quality = JPEG_QUALITY_DEFAULT;
+    options->sensor_width = 1920;
+    options->sensor_height = 1080;
+    options->format = raw_format_find("SBGGR10");
+    options->frames = 200;
+
+    for (int i = first; i < argc; i++)
+    {
+        const char *name = argv[i];
+        if (strcmp(name, "--gray") == 0)
+        {
+            options->gray = 1;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            printf("Error: Missing value for %s\n", name);
+            return -1;
+        }
+
+        const char *value = argv[++i];
+        if (strcmp(name, "--port") == 0)
+        {
+            options->port = atoi(value);
+        }
+        else if (strcmp(name, "--width") == 0)
+        {
+            options->width = atoi(value);
+        }
+        else if (strcmp(name, "--height") == 0)
+        {
+            options->height = atoi(value);
+        }
+        else if (strcmp(name, "--fps") == 0)
+        {
+            options->fps = atoi(value);
+        }
+        else if (strcmp(name, "--quality") == 0)
+        {
+            options->quality = atoi(value);
+        }
+        else if (strcmp(name, "--sensor-width") == 0)
+        {
+            options->sensor_width = atoi(value);
+        }
+        else if (strcmp(name, "--sensor-height") == 0)
+        {
+            options->sensor_height = atoi(value);
+        }
+        else if (strcmp(name, "--format") == 0)
+        {
+            options->format = raw_format_find(value);
+        }
+        else if (strcmp(name, "--seconds") == 0)
+        {
+            options->seconds = atoi(value);
+        }
+        else if (strcmp(name, "--frames") == 0)
+        {
+            options->frames = atoi(value);
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", name);
+            return -1;
+        }
+    }
+
+    if (!options->format || options->width < 16 || options->height < 16 || options->sensor_width < 16 ||
+        options->sensor_height < 16 || options->frames < 1 || options->seconds < 0)
+    {
+        printf("Error: Invalid format, preview size, sensor size, frame count or duration\n");
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 生成合成帧：彩色渐变、移动的斜条纹和少量噪声，按Bayer排列取各像素的颜色分量
+ * @return 0成功，-1内存不足
+ */
+static int synthetic_init(synthetic_source_t *source, const preview_options_t *options)
+{
+    memset(source, 0, sizeof(*source));
+    source->layout = (raw_layout_t){
+        .width = options->sensor_width,
+        .height = options->sensor_height,
+        .packing = RAW_PACKING_ROCKCHIP,
+        .bit_depth = options->format->bit_depth,
+        .bayer = options->format->bayer};
+    source->layout.stride = raw_layout_min_stride(source->layout.width, source->layout.bit_depth,
+                                                  source->layout.packing);
+
+    // 每种Bayer排列中 2x2 四个位置的颜色 (0红 1绿 2蓝)
+    static const int site_color[RAW_BAYER_COUNT][4] = {
+        {2, 1, 1, 0}, // BGGR
+        {1, 2, 0, 1}, // GBRG
+        {1, 0, 2, 1}, // GRBG
+        {0, 1, 1, 2}, // RGGB
+    };
+    const int *sites = site_color[source->layout.bayer];
+
+    int width = source->layout.width;
+    int height = source->layout.height;
+    int max = (1 << source->layout.bit_depth) - 1;
+    uint16_t *row = malloc((size_t)width * sizeof(uint16_t));
+    if (!row)
+    {
+        return -1;
+    }
+
+    uint32_t state = 0x9E3779B9u;
+    for (int f = 0; f < SYNTHETIC_FRAMES; f++)
+    {
+        source->frames[f] = malloc(source->layout.stride * (size_t)height);
+        if (!source->frames[f])
+        {
+            free(row);
+            return -1;
+        }
+
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                int color = sites[(y & 1) * 2 + (x & 1)];
+                int value;
+                if (color == 0)
+                {
+                    value = x * max / width;
+                }
+                else if (color == 1)
+                {
+                    value = y * max / height;
+                }
+                else
+                {
+                    value = ((x + y + f * width / 32) / (width / 16)) & 1 ? max * 3 / 4 : max / 8;
+                }
+                state = state * 1664525u + 1013904223u;
+                value += (int)(state >> 29) - 4;
+                row[x] = (uint16_t)(value < 0 ? 0 : (value > max ? max : value));
+            }
+            raw_codec_pack_row(&source->layout, row, source->frames[f] + (size_t)y * source->layout.stride);
+        }
+    }
+    free(row);
+
+    preview_context_init(&source->preview);
+    preview_params_t params = {
+        options->gray ? PREVIEW_MODE_GRAY : PREVIEW_MODE_COLOR, PREVIEW_GAIN_UNITY, PREVIEW_GAIN_UNITY,
+        PREVIEW_GAIN_UNITY, 0, 2.2f, 1.0f};
+    preview_set_params(&source->preview, &params);
+    source->start_ns = monotonic_ns();
+    return 0;
+}
+
+static void synthetic_destroy(synthetic_source_t *source)
+{
+    for (int f = 0; f < SYNTHETIC_FRAMES; f++)
+    {
+        free(source->frames[f]);
+        source->frames[f] = NULL;
+    }
+    preview_context_release(&source->preview);
+}
+
+/**
+ * @brief 渲染第 sequence 帧 (与设备的图像源相同：按比例放入预览范围后渲染)
+ * @return 0成功，-1失败
+ */
+static int synthetic_render(synthetic_source_t *source, mjpeg_image_t *image, uint32_t sequence)
+{
+    mjpeg_fit_size(source->layout.width, source->layout.height, image->max_width, image->max_height,
+                   &image->width, &image->height);
+    image->gray = source->preview.params.mode == PREVIEW_MODE_GRAY;
+    image->sequence = sequence;
+    const uint8_t *raw = source->frames[sequence % SYNTHETIC_FRAMES];
+    return preview_render_raw(&source->preview, &source->layout, raw,
+                              source->layout.stride * (size_t)source->layout.height,
+                              image->pixels, image->max_width, image->width, image->height);
+}
+
+/**
+ * @brief 服务器的图像源：按经过的时间推算"采集"到第几帧
+ */
+static int synthetic_source(mjpeg_image_t *image, void *user)
+{
+    synthetic_source_t *source = user;
+    uint32_t sequence = (uint32_t)((monotonic_ns() - source->start_ns) * SYNTHETIC_FPS / 1000000000ULL) + 1;
+    if (sequence == source->last_sequence)
+    {
+        return 0;
+    }
+    source->last_sequence = sequence;
+    return synthetic_render(source, image, sequence) == 0 ? 1 : -1;
+}
+
+static void handle_signal(int sig)
+{
+    (void)sig;
+    if (running_server)
+    {
+        mjpeg_server_stop(running_server);
+    }
+}
+
+static int command_serve(const preview_options_t *options)
+{
+    synthetic_source_t source;
+    if (synthetic_init(&source, options) != 0)
+    {
+        printf("Error: Out of memory for synthetic frames\n");
+        synthetic_destroy(&source);
+        return -1;
+    }
+
+    mjpeg_server_t server;
+    mjpeg_server_config_t config = {
+        .port = options->port,
+        .max_clients = MJPEG_SERVER_MAX_CLIENTS,
+        .width = options->width,
+        .height = options->height,
+        .fps = options->fps,
+        .quality = options->quality,
+        .source_fn = synthetic_source,
+        .source_user = &source};
+    if (mjpeg_server_init(&server, &config) != 0)
+    {
+        synthetic_destroy(&source);
+        return -1;
+    }
+
+    printf("Serving synthetic %dx%d %s frames: http://127.0.0.1:%d/stream (Ctrl-C to stop)\n",
+           options->sensor_width, options->sensor_height, options->format->name, options->port);
+    running_server = &server;
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    signal(SIGALRM, handle_signal);
+    if (options->seconds > 0)
+    {
+        alarm((unsigned)options->seconds);
+    }
+
+    mjpeg_server_run(&server);
+
+    running_server = NULL;
+    mjpeg_server_destroy(&server);
+    synthetic_destroy(&source);
+    return 0;
+}
+
+static int command_bench(const preview_options_t *options)
+{
+    synthetic_source_t source;
+    mjpeg_image_t image = {.max_width = options->width, .max_height = options->height};
+    image.pixels = malloc((size_t)options->width * (size_t)options->height * sizeof(uint16_t));
+    if (!image.pixels || synthetic_init(&source, options) != 0)
+    {
+        printf("Error: Out of memory for synthetic frames\n");
+        free(image.pixels);
+        synthetic_destroy(&source);
+        return -1;
+    }
+
+    jpeg_encoder_t encoder;
+    jpeg_encoder_init(&encoder, options->quality);
+    mjpeg_fit_size(options->sensor_width, options->sensor_height, options->width, options->height,
+                   &image.width, &image.height);
+    size_t capacity = jpeg_encoder_bound(image.width, image.height, options->gray);
+    uint8_t *jpeg = malloc(capacity);
+
+    uint64_t render_ns = 0;
+    uint64_t encode_ns = 0;
+    uint64_t bytes = 0;
+    int result = 0;
+    for (int i = 0; jpeg && i < options->frames; i++)
+    {
+        uint64_t t0 = monotonic_ns();
+        if (synthetic_render(&source, &image, (uint32_t)i) != 0)
+        {
+            printf("Error: Preview render failed\n");
+            result = -1;
+            break;
+        }
+        uint64_t t1 = monotonic_ns();
+        size_t size = jpeg_encode_rgb565(&encoder, image.pixels, image.max_width, image.width, image.height,
+                                         image.gray, jpeg, capacity);
+        uint64_t t2 = monotonic_ns();
+        if (size == 0)
+        {
+            printf("Error: JPEG encode failed\n");
+            result = -1;
+            break;
+        }
+        render_ns += t1 - t0;
+        encode_ns += t2 - t1;
+        bytes += size;
+    }
+
+    if (result == 0 && jpeg)
+    {
+        size_t raw_size = source.layout.stride * (size_t)source.layout.height;
+        double frame_bytes = (double)bytes / options->frames;
+        printf("%dx%d %s -> %dx%d %s JPEG q%d: render %.3f ms, encode %.3f ms, %.1f KB per frame "
+               "(%.0fx smaller than RAW, %.1f KB/s at %d fps)\n",
+               options->sensor_width, options->sensor_height, options->format->name, image.width, image.height,
+               options->gray ? "gray" : "color", encoder.quality, render_ns / 1e6 / options->frames,
+               encode_ns / 1e6 / options->frames, frame_bytes / 1024.0, raw_size / frame_bytes,
+               frame_bytes * options->fps / 1024.0, options->fps);
+    }
+
+    free(jpeg);
+    free(image.pixels);
+    synthetic_destroy(&source);
+    return jpeg ? result : -1;
+}
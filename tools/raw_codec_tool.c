@@ -0,0 +1,430 @@
+/**
+ * @file raw_codec_tool.c
+ * @brief RAW无损压缩主机工具
+ * @details 与设备端共用 raw_codec 模块：
+ *          - decode：把TCP流中收到的压缩负载 (或 encode 的输出) 还原为原始排列的RAW数据
+ *          - encode：按指定布局压缩RAW文件 (用于生成测试数据)
+ *          - bench：对录制的帧统计压缩率和编解码速度，并逐像素校验无损。
+ *            拍照保存的 .raw 文件为16位非打包像素 (默认布局)；一个文件可包含多帧。
+ *          用设备的交叉编译器编译本工具即可在 Cortex-A7 上测量编码耗时
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "raw_codec.h"
+#include "raw_decode.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+/**
+ * @brief 命令行选项
+ */
+typedef struct {
+    raw_layout_t layout;    // 输入数据布局
+    int iterations;         // bench 每帧重复次数
+} tool_options_t;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void print_usage(const char *program);
+static int parse_options(int argc, char **argv, int first, tool_options_t *options);
+static uint8_t *read_file(const char *path, size_t *size);
+static int write_file(const char *path, const uint8_t *data, size_t size);
+static double now_ms(void);
+static int compare_pixels(const raw_layout_t *layout, const uint8_t *original, const uint8_t *decoded);
+static int command_decode(const char *input, const char *output);
+static int command_encode(const char *input, const char *output, const tool_options_t *options);
+static int command_bench(const char *input, const tool_options_t *options);
+
+// ============================================================================
+// 主函数
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    raw_decode_init();
+
+    tool_options_t options;
+    if (strcmp(argv[1], "decode") == 0 && argc == 4)
+    {
+        return command_decode(argv[2], argv[3]) == 0 ? 0 : 1;
+    }
+    if (strcmp(argv[1], "encode") == 0 && argc >= 4 && parse_options(argc, argv, 4, &options) == 0)
+    {
+        return command_encode(argv[2], argv[3], &options) == 0 ? 0 : 1;
+    }
+    if (strcmp(argv[1], "bench") == 0 && parse_options(argc, argv, 3, &options) == 0)
+    {
+        return command_bench(argv[2], &options) == 0 ? 0 : 1;
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+static void print_usage(const char *program)
+{
+    printf("Usage:\n");
+    printf("  %s decode <input.mxr> <output.raw>\n", program);
+    printf("  %s encode <input.raw> <output.mxr> --width W --height H [layout options]\n", program);
+    printf("  %s bench <input.raw> --width W --height H [layout options] [--iterations N]\n", program);
+    printf("\nLayout options:\n");
+    printf("  --bits N          bit depth, 8-14 (default 10)\n");
+    printf("  --packing NAME    rockchip / mipi / unpacked16 (default unpacked16, as saved by photo capture)\n");
+    printf("  --stride N        bytes per row including padding (default: minimum for the packing)\n");
+}
+
+/**
+ * @brief 解析布局选项 (从 argv[first] 开始)
+ * @return 0成功，-1参数无效
+ */
+static int parse_options(int argc, char **argv, int first, tool_options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->layout.bit_depth = 10;
+    options->layout.packing = RAW_PACKING_UNPACKED16;
+    options->layout.bayer = RAW_BAYER_BGGR;
+    options->iterations = 5;
+
+    for (int i = first; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            printf("Error: Missing value for %s\n", argv[i]);
+            return -1;
+        }
+
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "--width") == 0)
+        {
+            options->layout.width = atoi(value);
+        }
+        else if (strcmp(argv[i - 1], "--height") == 0)
+        {
+            options->layout.height = atoi(value);
+        }
+        else if (strcmp(argv[i - 1], "--bits") == 0)
+        {
+            options->layout.bit_depth = atoi(value);
+        }
+        else if (strcmp(argv[i - 1], "--stride") == 0)
+        {
+            options->layout.stride = (size_t)atol(value);
+        }
+        else if (strcmp(argv[i - 1], "--iterations") == 0)
+        {
+            options->iterations = atoi(value) > 0 ? atoi(value) : 1;
+        }
+        else if (strcmp(argv[i - 1], "--packing") == 0)
+        {
+            if (raw_packing_from_name(value, &options->layout.packing) != 0)
+            {
+                printf("Error: Unknown packing '%s'\n", value);
+                return -1;
+            }
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[i - 1]);
+            return -1;
+        }
+    }
+
+    raw_layout_t *layout = &options->layout;
+    if (layout->width <= 0 || layout->height <= 0 || layout->bit_depth < 8 || layout->bit_depth > 14)
+    {
+        printf("Error: --width, --height and a bit depth of 8-14 are required\n");
+        return -1;
+    }
+
+    size_t min_stride = raw_layout_min_stride(layout->width, layout->bit_depth, layout->packing);
+    if (layout->stride == 0)
+    {
+        layout->stride = min_stride;
+    }
+    if (layout->stride < min_stride)
+    {
+        printf("Error: Stride %zu is smaller than a row (%zu bytes)\n", layout->stride, min_stride);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 读入整个文件
+ */
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        printf("Error: Cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *data = (length > 0) ? malloc((size_t)length) : NULL;
+    if (!data || fread(data, 1, (size_t)length, file) != (size_t)length)
+    {
+        printf("Error: Cannot read %s\n", path);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+}
+
+/**
+ * @brief 写出整个文件
+ */
+static int write_file(const char *path, const uint8_t *data, size_t size)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        printf("Error: Cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    size_t written = fwrite(data, 1, size, file);
+    fclose(file);
+    if (written != size)
+    {
+        printf("Error: Incomplete write to %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief 逐像素比较原始帧与解码结果 (解码结果无行尾填充)
+ * @return 0一致，-1不一致
+ */
+static int compare_pixels(const raw_layout_t *layout, const uint8_t *original, const uint8_t *decoded)
+{
+    raw_layout_t packed = *layout;
+    packed.stride = raw_layout_min_stride(layout->width, layout->bit_depth, layout->packing);
+
+    uint16_t *expected = malloc((size_t)layout->width * sizeof(uint16_t));
+    uint16_t *actual = malloc((size_t)layout->width * sizeof(uint16_t));
+    int result = (expected && actual) ? 0 : -1;
+
+    for (int y = 0; y < layout->height && result == 0; y++)
+    {
+        raw_decode_row(layout, original + (size_t)y * layout->stride, expected);
+        raw_decode_row(&packed, decoded + (size_t)y * packed.stride, actual);
+        if (memcmp(expected, actual, (size_t)layout->width * sizeof(uint16_t)) != 0)
+        {
+            printf("Error: Pixel mismatch in row %d\n", y);
+            result = -1;
+        }
+    }
+
+    free(expected);
+    free(actual);
+    return result;
+}
+
+/**
+ * @brief 解压一个压缩流文件
+ */
+static int command_decode(const char *input, const char *output)
+{
+    size_t size;
+    uint8_t *src = read_file(input, &size);
+    if (!src)
+    {
+        return -1;
+    }
+
+    raw_codec_header_t header;
+    if (raw_codec_read_header(src, size, &header) != 0)
+    {
+        printf("Error: %s is not a raw_codec stream\n", input);
+        free(src);
+        return -1;
+    }
+
+    uint8_t *dst = malloc(header.raw_size);
+    int result = (dst && raw_codec_decode(src, size, dst, header.raw_size) == 0) ? 0 : -1;
+    if (result == 0)
+    {
+        printf("%s: %ux%u RAW%u %s, %zu -> %u bytes\n", input, header.width, header.height,
+               header.bit_depth, raw_packing_name((raw_packing_t)header.packing), size, header.raw_size);
+        result = write_file(output, dst, header.raw_size);
+    }
+    else
+    {
+        printf("Error: Corrupt or truncated stream %s\n", input);
+    }
+
+    free(src);
+    free(dst);
+    return result;
+}
+
+/**
+ * @brief 压缩一个RAW文件 (首帧)
+ */
+static int command_encode(const char *input, const char *output, const tool_options_t *options)
+{
+    const raw_layout_t *layout = &options->layout;
+    size_t size;
+    uint8_t *src = read_file(input, &size);
+    if (!src)
+    {
+        return -1;
+    }
+
+    size_t frame_size = layout->stride * (size_t)layout->height;
+    size_t raw_size = raw_codec_raw_size(layout, layout->height);
+    uint8_t *dst = malloc(raw_size);
+    size_t coded_size = 0;
+    int result = -1;
+
+    if (size < frame_size)
+    {
+        printf("Error: %s holds %zu bytes, one frame needs %zu\n", input, size, frame_size);
+    }
+    else if (!dst || raw_codec_encode(layout, src, layout->height, dst, raw_size, &coded_size) != 0)
+    {
+        printf("Error: Frame is not compressible\n");
+    }
+    else
+    {
+        printf("%s: %zu -> %zu bytes (ratio %.2f)\n", input, raw_size, coded_size, (double)raw_size / coded_size);
+        result = write_file(output, dst, coded_size);
+    }
+
+    free(src);
+    free(dst);
+    return result;
+}
+
+/**
+ * @brief 统计录制帧的压缩率和编解码速度
+ */
+static int command_bench(const char *input, const tool_options_t *options)
+{
+    const raw_layout_t *layout = &options->layout;
+    size_t size;
+    uint8_t *src = read_file(input, &size);
+    if (!src)
+    {
+        return -1;
+    }
+
+    size_t frame_size = layout->stride * (size_t)layout->height;
+    size_t frames = size / frame_size;
+    size_t raw_size = raw_codec_raw_size(layout, layout->height);
+    uint8_t *coded = malloc(raw_size);
+    uint8_t *decoded = malloc(raw_size);
+    if (frames == 0 || !coded || !decoded)
+    {
+        printf("Error: %s holds no complete %dx%d frame (%zu bytes each)\n",
+               input, layout->width, layout->height, frame_size);
+        free(src);
+        free(coded);
+        free(decoded);
+        return -1;
+    }
+
+    printf("%s: %zu frame(s), %dx%d RAW%d %s, stride %zu\n", input, frames, layout->width, layout->height,
+           layout->bit_depth, raw_packing_name(layout->packing), layout->stride);
+
+    uint64_t total_raw = 0;
+    uint64_t total_coded = 0;
+    double encode_ms = 0;
+    double decode_ms = 0;
+    int result = 0;
+
+    for (size_t f = 0; f < frames && result == 0; f++)
+    {
+        const uint8_t *frame = src + f * frame_size;
+        size_t coded_size = 0;
+
+        double start = now_ms();
+        for (int i = 0; i < options->iterations; i++)
+        {
+            if (raw_codec_encode(layout, frame, layout->height, coded, raw_size, &coded_size) != 0)
+            {
+                coded_size = 0;
+                break;
+            }
+        }
+        encode_ms += (now_ms() - start) / options->iterations;
+
+        if (coded_size == 0)
+        {
+            // 不可压缩的帧按原始大小计入 (设备端会直接发送原始数据)
+            printf("  frame %zu: not compressible\n", f);
+            total_raw += raw_size;
+            total_coded += raw_size;
+            continue;
+        }
+
+        start = now_ms();
+        for (int i = 0; i < options->iterations && result == 0; i++)
+        {
+            result = raw_codec_decode(coded, coded_size, decoded, raw_size);
+        }
+        decode_ms += (now_ms() - start) / options->iterations;
+
+        if (result != 0 || compare_pixels(layout, frame, decoded) != 0)
+        {
+            printf("  frame %zu: decode mismatch\n", f);
+            result = -1;
+            break;
+        }
+
+        total_raw += raw_size;
+        total_coded += coded_size;
+    }
+
+    if (result == 0)
+    {
+        double pixels = (double)layout->width * layout->height;
+        printf("Ratio: %.3f (%.2f bits/pixel, %.2f MB -> %.2f MB per frame)\n",
+               (double)total_raw / total_coded, total_coded * 8.0 / (pixels * frames),
+               raw_size / 1e6, total_coded / 1e6 / frames);
+        printf("Encode: %.2f ms/frame (%.1f Mpixel/s)\n", encode_ms / frames, pixels * frames / encode_ms / 1e3);
+        printf("Decode: %.2f ms/frame (%.1f Mpixel/s)\n", decode_ms / frames, pixels * frames / decode_ms / 1e3);
+        printf("Lossless: verified\n");
+    }
+
+    free(src);
+    free(coded);
+    free(decoded);
+    return result;
+}
@@ -0,0 +1,353 @@
+/**
+ * @file raw_decode_check.c
+ * @brief RAW10解包内核的主机端逐位一致性检查工具
+ * @details 设备启动时 raw_decode_init 只对64组数据自检，失败时静默回退到标量内核，
+ *          内核回归不会导致任何失败。本工具在主机上 (交叉编译后也可在设备上) 对
+ *          Rockchip 和 MIPI 两种排列逐位比对：
+ *          - 标量参考内核与按格式定义逐位计算的结果
+ *          - 通用内核 (ARM 上另加 NEON 内核) 与标量参考内核：随机组数 (含不足一个向量批次的长度)、
+ *            非对齐的源地址，并检查不会写出输出范围
+ *          - raw_decode_image 整帧解包：随机宽度 (含行尾不足一组的像素) 和带填充的行跨度
+ *          任何不一致都以非0退出
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "raw_decode.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define GROUP_BYTES 5           // RAW10 每组字节数
+#define GROUP_PIXELS 4          // RAW10 每组像素数
+#define MAX_GROUPS 1024         // 组级比对的最大组数
+#define MAX_ALIGN 16            // 源地址偏移范围 (0 ~ MAX_ALIGN-1)
+#define GUARD_PIXELS 16         // 输出末尾的哨兵像素数
+#define GUARD_VALUE 0xA5A5      // 哨兵值 (大于10位，不会是解包结果)
+#define MAX_FRAME_WIDTH 700     // 整帧比对的最大宽度
+#define MAX_FRAME_HEIGHT 9      // 整帧比对的最大高度
+#define MAX_STRIDE_PAD 64       // 行尾填充的最大字节数
+
+/**
+ * @brief 命令行选项
+ */
+typedef struct {
+    int iterations;         // 每个内核、每种排列的随机用例数
+    uint32_t seed;          // 随机数种子
+} check_options_t;
+
+/**
+ * @brief 一种排列的内核集合
+ */
+typedef struct {
+    const char *name;           // 排列名称
+    raw_packing_t packing;      // 排列方式
+    raw10_unpack_fn scalar;     // 标量参考内核
+    raw10_unpack_fn portable;   // 通用内核
+    raw10_unpack_fn neon;       // NEON内核 (非ARM为NULL)
+} packing_kernels_t;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void print_usage(const char *program);
+static int parse_options(int argc, char **argv, check_options_t *options);
+static uint32_t next_random(uint32_t *state);
+static void fill_random(uint8_t *data, size_t size, uint32_t *state);
+static uint16_t reference_pixel(raw_packing_t packing, const uint8_t *group, int lane);
+static int check_scalar(const packing_kernels_t *kernels, const check_options_t *options);
+static int check_kernel(const packing_kernels_t *kernels, const char *kernel_name, raw10_unpack_fn fn,
+                        const check_options_t *options);
+static int check_frames(raw_packing_t packing, raw_kernel_t kernel, const check_options_t *options);
+
+// ============================================================================
+// 主函数
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    check_options_t options;
+    if (parse_options(argc, argv, &options) != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const packing_kernels_t packings[] = {
+        {"rockchip", RAW_PACKING_ROCKCHIP, raw10_unpack_groups_scalar, raw10_unpack_groups_portable,
+#if defined(__arm__) || defined(__aarch64__)
+         raw10_unpack_groups_neon
+#else
+         NULL
+#endif
+        },
+        {"mipi", RAW_PACKING_MIPI, raw10_mipi_unpack_groups_scalar, raw10_mipi_unpack_groups_portable,
+#if defined(__arm__) || defined(__aarch64__)
+         raw10_mipi_unpack_groups_neon
+#else
+         NULL
+#endif
+        },
+    };
+
+    printf("RAW10 kernel check: %d cases per kernel, seed 0x%08X\n", options.iterations, options.seed);
+
+    int failures = 0;
+    for (size_t p = 0; p < sizeof(packings) / sizeof(packings[0]); p++)
+    {
+        const packing_kernels_t *kernels = &packings[p];
+        failures += check_scalar(kernels, &options) != 0;
+        failures += check_kernel(kernels, "portable", kernels->portable, &options) != 0;
+        failures += check_frames(kernels->packing, RAW_KERNEL_PORTABLE, &options) != 0;
+
+        // NEON 内核需要运行时支持 (raw_decode_set_kernel 检测CPU特性)
+        if (kernels->neon && raw_decode_set_kernel(RAW_KERNEL_NEON) == 0)
+        {
+            failures += check_kernel(kernels, "neon", kernels->neon, &options) != 0;
+            failures += check_frames(kernels->packing, RAW_KERNEL_NEON, &options) != 0;
+        }
+        else
+        {
+            printf("  %-8s neon     : skipped (not available on this CPU/build)\n", kernels->name);
+        }
+    }
+
+    printf(failures == 0 ? "RAW10 kernel check passed\n" : "RAW10 kernel check FAILED (%d checks)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+static void print_usage(const char *program)
+{
+    printf("Usage:\n");
+    printf("  %s [options]\n", program);
+    printf("\nOptions:\n");
+    printf("  --iterations N      random cases per kernel and packing (default 2000)\n");
+    printf("  --seed S            random seed (default 0x1234ABCD)\n");
+}
+
+/**
+ * @brief 解析选项
+ * @return 0成功，-1参数无效
+ */
+static int parse_options(int argc, char **argv, check_options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->iterations = 2000;
+    options->seed = 0x1234ABCDu;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *name = argv[i];
+        if (i + 1 >= argc)
+        {
+            printf("Error: Missing value for %s\n", name);
+            return -1;
+        }
+
+        const char *value = argv[++i];
+        if (strcmp(name, "--iterations") == 0)
+        {
+            options->iterations = atoi(value);
+        }
+        else if (strcmp(name, "--seed") == 0)
+        {
+            options->seed = (uint32_t)strtoul(value, NULL, 0);
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", name);
+            return -1;
+        }
+    }
+
+    if (options->iterations < 1)
+    {
+        printf("Error: Invalid iteration count\n");
+        return -1;
+    }
+    return 0;
+}
+
+static uint32_t next_random(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void fill_random(uint8_t *data, size_t size, uint32_t *state)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        data[i] = (uint8_t)next_random(state);
+    }
+}
+
+/**
+ * @brief 按格式定义逐位计算一个像素 (与内核实现无关)
+ * @details Rockchip：5字节组为小端位流，像素 i 为第 10i ~ 10i+9 位；
+ *          MIPI：字节 i 为像素 i 的高8位，字节4的第 2i ~ 2i+1 位为低2位
+ */
+static uint16_t reference_pixel(raw_packing_t packing, const uint8_t *group, int lane)
+{
+    if (packing == RAW_PACKING_MIPI)
+    {
+        return (uint16_t)(((unsigned)group[lane] << 2) | ((group[4] >> (2 * lane)) & 0x3));
+    }
+
+    uint16_t value = 0;
+    for (int bit = 0; bit < 10; bit++)
+    {
+        int position = lane * 10 + bit;
+        value |= (uint16_t)(((group[position / 8] >> (position % 8)) & 1) << bit);
+    }
+    return value;
+}
+
+/**
+ * @brief 标量参考内核与格式定义逐位比对 (穷举每个字节的全部取值)
+ * @return 0一致，-1不一致
+ */
+static int check_scalar(const packing_kernels_t *kernels, const check_options_t *options)
+{
+    uint32_t state = options->seed;
+    uint8_t group[GROUP_BYTES];
+    uint16_t pixels[GROUP_PIXELS];
+    int cases = 0;
+
+    for (int byte = 0; byte < GROUP_BYTES; byte++)
+    {
+        for (int value = 0; value < 256; value++)
+        {
+            fill_random(group, sizeof(group), &state);
+            group[byte] = (uint8_t)value;
+            kernels->scalar(group, pixels, 1);
+            cases++;
+
+            for (int lane = 0; lane < GROUP_PIXELS; lane++)
+            {
+                uint16_t expected = reference_pixel(kernels->packing, group, lane);
+                if (pixels[lane] != expected)
+                {
+                    printf("  %-8s scalar   : FAIL, bytes %02X %02X %02X %02X %02X pixel %d = 0x%03X, expected 0x%03X\n",
+                           kernels->name, group[0], group[1], group[2], group[3], group[4], lane,
+                           pixels[lane], expected);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("  %-8s scalar   : ok (%d groups against the format definition)\n", kernels->name, cases);
+    return 0;
+}
+
+/**
+ * @brief 内核与标量参考内核按组逐位比对
+ * @details 组数覆盖 0 ~ 63 的全部值 (向量主循环与尾部的各种组合) 和随机的较大值，
+ *          源地址在 0 ~ MAX_ALIGN-1 字节偏移间变化，输出末尾的哨兵检查越界写入
+ * @return 0一致，-1不一致
+ */
+static int check_kernel(const packing_kernels_t *kernels, const char *kernel_name, raw10_unpack_fn fn,
+                        const check_options_t *options)
+{
+    static uint8_t source[MAX_GROUPS * GROUP_BYTES + MAX_ALIGN];
+    static uint16_t expected[MAX_GROUPS * GROUP_PIXELS];
+    static uint16_t actual[MAX_GROUPS * GROUP_PIXELS + GUARD_PIXELS];
+    uint32_t state = options->seed ^ (uint32_t)kernels->packing;
+
+    for (int iteration = 0; iteration < options->iterations; iteration++)
+    {
+        size_t groups = iteration < 64 ? (size_t)iteration : next_random(&state) % (MAX_GROUPS + 1);
+        size_t align = next_random(&state) % MAX_ALIGN;
+        const uint8_t *src = source + align;
+
+        fill_random(source, sizeof(source), &state);
+        for (size_t i = 0; i < sizeof(actual) / sizeof(actual[0]); i++)
+        {
+            actual[i] = GUARD_VALUE;
+        }
+
+        kernels->scalar(src, expected, groups);
+        fn(src, actual, groups);
+
+        size_t pixels = groups * GROUP_PIXELS;
+        for (size_t i = 0; i < pixels + GUARD_PIXELS; i++)
+        {
+            uint16_t want = i < pixels ? expected[i] : GUARD_VALUE;
+            if (actual[i] != want)
+            {
+                printf("  %-8s %-8s : FAIL, %zu groups at offset %zu: pixel %zu = 0x%04X, expected 0x%04X%s\n",
+                       kernels->name, kernel_name, groups, align, i, actual[i], want,
+                       i < pixels ? "" : " (written past the output)");
+                return -1;
+            }
+        }
+    }
+
+    printf("  %-8s %-8s : ok (%d group runs, 0 ~ %d groups, unaligned sources)\n",
+           kernels->name, kernel_name, options->iterations, MAX_GROUPS);
+    return 0;
+}
+
+/**
+ * @brief 整帧解包 (raw_decode_image) 在指定内核与标量内核下逐位比对
+ * @details 宽度随机 (含不是4的倍数的宽度，行尾不足一组的像素走尾部处理)，
+ *          行跨度为最小值加 0 ~ MAX_STRIDE_PAD 字节填充，填充字节为随机值
+ * @return 0一致，-1不一致
+ */
+static int check_frames(raw_packing_t packing, raw_kernel_t kernel, const check_options_t *options)
+{
+    static uint8_t frame[MAX_FRAME_HEIGHT * (MAX_FRAME_WIDTH * 2 + MAX_STRIDE_PAD)];
+    static uint16_t expected[MAX_FRAME_WIDTH * MAX_FRAME_HEIGHT];
+    static uint16_t actual[MAX_FRAME_WIDTH * MAX_FRAME_HEIGHT];
+    const char *packing_name = raw_packing_name(packing);
+    uint32_t state = options->seed ^ 0x5A5A0000u ^ (uint32_t)packing;
+    int ret = 0;
+
+    for (int iteration = 0; iteration < options->iterations && ret == 0; iteration++)
+    {
+        raw_layout_t layout = {
+            .width = 1 + (int)(next_random(&state) % MAX_FRAME_WIDTH),
+            .height = 1 + (int)(next_random(&state) % MAX_FRAME_HEIGHT),
+            .packing = packing,
+            .bit_depth = 10,
+            .bayer = RAW_BAYER_BGGR,
+        };
+        layout.stride = raw_layout_min_stride(layout.width, 10, packing) + next_random(&state) % (MAX_STRIDE_PAD + 1);
+        size_t size = layout.stride * (size_t)layout.height;
+        size_t pixels = (size_t)layout.width * layout.height;
+        fill_random(frame, size, &state);
+
+        raw_decode_set_kernel(RAW_KERNEL_SCALAR);
+        raw_decode_image(&layout, frame, size, expected);
+        raw_decode_set_kernel(kernel);
+        raw_decode_image(&layout, frame, size, actual);
+
+        for (size_t i = 0; i < pixels; i++)
+        {
+            if (actual[i] != expected[i])
+            {
+                printf("  %-8s %-8s : FAIL, frame %dx%d stride %zu: pixel (%zu,%zu) = 0x%03X, expected 0x%03X\n",
+                       packing_name, raw_decode_kernel_name(kernel), layout.width, layout.height, layout.stride,
+                       i % layout.width, i / layout.width, actual[i], expected[i]);
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    if (ret == 0)
+    {
+        printf("  %-8s %-8s : ok (%d frames, widths 1 ~ %d, stride padding 0 ~ %d bytes)\n",
+               packing_name, raw_decode_kernel_name(kernel), options->iterations, MAX_FRAME_WIDTH, MAX_STRIDE_PAD);
+    }
+    return ret;
+}
@@ -0,0 +1,1667 @@
+/**
+ * @file stream_receiver.c
+ * @brief mxCamera 帧流接收与链路基准测试工具
+ * @details 与设备端共用协议头文件 (stream_protocol.h)：
+ *          - connect：连接设备，可选发送视图/抽帧/帧头版本请求，逐帧校验同步标识、
+ *            帧头、负载大小和校验和，统计吞吐量、帧率、帧间隔抖动和延迟分位数；
+ *            可按帧率发送曝光控制请求，测量应答往返时间并核对应答所指帧起的帧头曝光值；
+ *            可请求压扩 (8位码值)，按收到的码表还原并统计相对打包RAW的负载比例
+ *          - loopback：在本机运行设备的发送路径 (帧池 + stream_server + stream_format)，
+ *            由合成帧驱动，再用同样的接收逻辑连接回环地址测量
+ *          v2 帧头的延迟为 接收时刻 (CLOCK_REALTIME) - 采集时刻，需要设备与主机时钟同步；
+ *          回环模式下两端同一时钟，v1 帧头也能计算延迟
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "frame_pool.h"
+#include "raw_codec.h"
+#include "raw_compand.h"
+#include "raw_decode.h"
+#include "stream_checksum.h"
+#include "stream_format.h"
+#include "stream_protocol.h"
+#include "stream_server.h"
+#include "stream_spool.h"
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+#define DEFAULT_PORT 8888           // 设备端 TCP 端口
+#define READ_CHUNK (256 * 1024)     // 每次 recv 的最大字节数
+#define MAX_PAYLOAD (64u << 20)     // 认为合理的最大负载，超过视为帧头损坏
+#define LOOPBACK_BUFFERS 6          // 回环模式的合成"驱动缓冲区"个数
+#define LOOPBACK_MAX_LATENCY_MS 500 // 回环服务器的码率控制延迟上限 (与设备默认值相同)
+#define LOOPBACK_SPOOL_TIMEOUT_MS 10000 // 回环服务器的断线补发等待时间 (与设备默认值相同)
+#define LOOPBACK_CONTROL_DELAY 2    // 回环"传感器"的曝光/增益生效延迟 (帧，与设备相同)
+#define CONTROL_EXPOSURE_LOW 100    // 控制测试交替请求的两个曝光值
+#define CONTROL_EXPOSURE_HIGH 400
+
+/**
+ * @brief 命令行选项
+ */
+typedef struct {
+    const char *host;               // connect 的目标地址
+    int port;                       // 端口 (loopback 为0时自动分配)
+    uint32_t frames;                // 接收的帧数，0为不限
+    double seconds;                 // 接收的最长时间，0为不限
+    int header_version;             // 请求的帧头版本
+    int checksum;                   // 请求并校验负载校验和
+    int view[5];                    // 视图请求：left, top, width, height, binning
+    int has_view;                   // 是否发送视图请求
+    int decimation;                 // 抽帧请求，0为不发送
+    raw_packing_t packing;          // 原始负载的排列方式 (用于校验大小)
+    int decode;                     // 解压压缩负载并校验
+    int max_latency;                // 码率控制请求的延迟上限 (毫秒)，-1为不发送
+    int adapt_all;                  // 码率控制请求同时允许压缩和合并
+    double read_limit;              // 接收端限速 (MB/s)，0为不限，用于模拟慢速链路
+    uint64_t session;               // 会话标识，0为不发送会话请求
+    uint32_t reconnect_after;       // 每个连接接收的帧数，之后断开并重连，0为不断开
+    double pause;                   // 断开到重连的间隔 (秒)
+    uint32_t control_every;         // 每收到N帧发送一次曝光控制请求，0为不发送
+    int compand;                    // 请求的压扩曲线 (stream_compand_curve_t)，-1为不发送
+
+    // loopback
+    int width;                      // 合成帧宽度
+    int height;                     // 合成帧高度
+    const raw_format_t *format;     // 合成帧像素格式
+    double fps;                     // 合成帧帧率，0为尽快
+    int clients;                    // 并发接收端个数
+    int compress;                   // 设备端压缩
+    int queue_depth;                // 每客户端队列深度
+    frame_queue_policy_t policy;    // 队列满时的策略
+    int zerocopy;                   // 尝试 MSG_ZEROCOPY
+    int spool_frames;               // 断线补发缓存的内存帧数，0为不启用
+    const char *spool_dir;          // 补发缓存的溢出文件目录
+    int spool_disk_mb;              // 溢出文件大小上限 (MB)
+} receiver_options_t;
+
+/**
+ * @brief 带缓冲的套接字读取器
+ */
+typedef struct {
+    int fd;
+    uint8_t *buf;
+    size_t capacity;
+    size_t start;                   // 未消费数据起点
+    size_t end;                     // 未消费数据终点
+} stream_reader_t;
+
+/**
+ * @brief 可增长的样本数组 (毫秒)
+ */
+typedef struct {
+    double *values;
+    size_t count;
+    size_t capacity;
+} sample_set_t;
+
+/**
+ * @brief 接收统计
+ */
+typedef struct {
+    uint32_t frames;                // 收到的完整帧
+    uint64_t wire_bytes;            // 同步标识 + 帧头 + 负载
+    uint64_t payload_bytes;         // 负载
+    uint64_t raw_bytes;             // 解码后的负载 (未压缩时等于负载)
+    uint64_t resync_bytes;          // 寻找同步标识时跳过的字节
+    uint32_t bad_headers;           // 魔数或字段不合理
+    uint32_t size_errors;           // 负载大小与宽高格式不符
+    uint32_t checksum_errors;       // 校验和不符
+    uint32_t decode_errors;         // 压缩负载无法解码
+    uint32_t id_gaps;               // 帧序号不连续 (缺失的帧数)
+    uint64_t device_dropped;        // v2 帧头报告的丢帧数之和
+    uint32_t v2_frames;             // 使用 v2 帧头的帧数
+    uint32_t rate_changes;          // 帧头中码率控制级别的变化次数
+    int max_rate_level;             // 出现过的最高码率控制级别
+    uint32_t catchup_frames;        // 补发帧数 (v2 帧头带 STREAM_FRAME_CATCHUP)
+    uint32_t connections;           // 建立的连接数
+    uint32_t *sequences;            // 收到的采集序号 (v2，用于检查断线前后的覆盖)
+    size_t sequence_count;
+    size_t sequence_capacity;
+    uint32_t controls_sent;         // 发送的控制请求数
+    uint32_t control_acks;          // 收到的控制应答数
+    uint32_t control_rejected;      // 状态不是成功或限幅的应答数
+    uint32_t control_checked;       // 按应答核对过曝光值的帧数
+    uint32_t control_mismatches;    // 曝光值与应答不符的帧数
+    uint32_t compand_tables;        // 收到的压扩码表数
+    uint32_t compand_frames;        // 压扩负载的帧数
+    uint64_t compand_bytes;         // 压扩负载字节数
+    uint64_t compand_packed_bytes;  // 同样的像素按打包RAW发送的字节数
+    sample_set_t control_rtt;       // 控制请求 -> 应答
+    sample_set_t interval;          // 帧间隔
+    sample_set_t latency;           // 采集 -> 接收完成
+    sample_set_t device_latency;    // 采集 -> 开始发送 (v2)
+    double start_ms;                // 开始接收的时刻
+    double first_ms;                // 第一帧到达时刻
+    double last_ms;                 // 最后一帧到达时刻
+} receiver_stats_t;
+
+/**
+ * @brief 解析后的帧头 (v1 / v2 统一表示)
+ */
+typedef struct {
+    int version;
+    uint32_t frame_id;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixfmt;
+    uint32_t size;
+    uint32_t encoding;
+    uint32_t raw_size;
+    uint64_t capture_ns;            // CLOCK_MONOTONIC
+    uint32_t sequence;              // v2
+    int32_t exposure;               // v2
+    int32_t gain;                   // v2
+    int64_t realtime_offset_ns;     // v2
+    uint64_t send_ns;               // v2
+    uint32_t dropped;               // v2
+    uint16_t flags;                 // v2
+    uint32_t checksum;              // v2
+    int rate_level;                 // v2 (帧头含码率控制字段时)，否则为0
+    uint16_t rate_flags;            // v2
+    uint32_t decimation;            // v2，生效的抽帧系数 (0为未知)
+} parsed_header_t;
+
+/**
+ * @brief 接收线程参数
+ */
+typedef struct {
+    const receiver_options_t *options;
+    int index;                      // 接收端编号 (从1开始)
+    int same_clock;                 // 回环：v1 帧头也按单调时钟计算延迟
+    int result;                     // 0成功
+} receiver_job_t;
+
+/**
+ * @brief 回环模式的合成采集端
+ */
+typedef struct {
+    const receiver_options_t *options;
+    frame_pool_t pool;
+    stream_server_t server;
+    stream_spool_t spool;
+    stream_format_config_t format;
+    uint8_t *buffers[LOOPBACK_BUFFERS];
+    size_t frame_size;
+    int busy[LOOPBACK_BUFFERS];     // 缓冲区被帧池持有 (原子访问)
+    volatile int stop;
+    uint32_t produced;
+    uint32_t pool_dropped;
+    pthread_mutex_t sensor_lock;    // 保护以下"传感器"设置 (控制请求在服务器线程中执行)
+    int32_t exposure;               // 当前帧生效的曝光值
+    int32_t gain;                   // 当前帧生效的增益值
+    uint32_t pending_sequence;      // 待生效设置的起始采集序号，0为没有
+    int32_t pending_exposure;
+    int32_t pending_gain;
+    uint32_t sequence;              // 最近发布的采集序号
+} loopback_t;
+
+// ============================================================================
+// 内部函数声明
+// ============================================================================
+
+static void print_usage(const char *program);
+static int parse_options(int argc, char **argv, int first, receiver_options_t *options);
+static double now_ms(clockid_t clock);
+static int connect_to(const char *host, int port);
+static int send_request(int fd, uint16_t type, const void *payload, uint16_t length);
+static int send_requests(int fd, const receiver_options_t *options, uint64_t session);
+static int reader_fill(stream_reader_t *reader, size_t need);
+static int read_frame_header(stream_reader_t *reader, int expect_v2, parsed_header_t *header,
+                             stream_control_ack_t *ack, stream_compand_table_t *table, receiver_stats_t *stats);
+static int receive_session(const char *host, int port, const receiver_options_t *options, uint64_t session,
+                           int same_clock, const char *label);
+static int receive_frames(int fd, const receiver_options_t *options, int same_clock, const char *label,
+                          receiver_stats_t *stats);
+static void sequence_add(receiver_stats_t *stats, uint32_t sequence);
+static void validate_frame(const receiver_options_t *options, const parsed_header_t *header,
+                           const uint8_t *payload, const stream_compand_table_t *table, receiver_stats_t *stats);
+static void sample_add(sample_set_t *set, double value);
+static double sample_percentile(sample_set_t *set, double p);
+static void print_samples(const char *name, sample_set_t *set);
+static void print_report(const char *label, receiver_stats_t *stats);
+static void print_coverage(receiver_stats_t *stats);
+static void *receiver_thread(void *arg);
+static void *loopback_server_thread(void *arg);
+static void loopback_release(media_frame_t *frame, void *user);
+static int loopback_control(int client_id, const stream_control_request_t *request, void *user);
+static void fill_synthetic_frame(const receiver_options_t *options, uint8_t *data, size_t stride, int seed);
+static int command_connect(const receiver_options_t *options);
+static int command_loopback(receiver_options_t *options);
+
+// ============================================================================
+// 主函数
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    raw_decode_init();
+    raw_compand_init();
+
+    receiver_options_t options;
+    if (strcmp(argv[1], "connect") == 0 && argc >= 3 && parse_options(argc, argv, 3, &options) == 0)
+    {
+        options.host = argv[2];
+        return command_connect(&options) == 0 ? 0 : 1;
+    }
+    if (strcmp(argv[1], "loopback") == 0 && parse_options(argc, argv, 2, &options) == 0)
+    {
+        return command_loopback(&options) == 0 ? 0 : 1;
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
+
+// ============================================================================
+// 内部函数实现
+// ============================================================================
+
+static void print_usage(const char *program)
+{
+    printf("Usage:\n");
+    printf("  %s connect <host> [options]\n", program);
+    printf("  %s loopback [options] [loopback options]\n", program);
+    printf("\nOptions:\n");
+    printf("  --port N            TCP port (default %d; loopback picks a free port)\n", DEFAULT_PORT);
+    printf("  --frames N          stop after N frames (default 300, 0 = unlimited)\n");
+    printf("  --seconds S         stop after S seconds (default unlimited)\n");
+    printf("  --header 1|2        frame header version to request (default 2)\n");
+    printf("  --checksum          request and verify payload checksums (v2 only)\n");
+    printf("  --view L,T,W,H[,B]  request a crop rectangle and binning factor (1/2/4)\n");
+    printf("  --decimation N      request every Nth frame\n");
+    printf("  --max-latency MS    request adaptive rate control with this latency bound (0 = off)\n");
+    printf("  --adapt-all         let rate control also compress and bin (with --max-latency)\n");
+    printf("  --read-limit MB/S   read no faster than this, to emulate a slow link\n");
+    printf("  --session ID|auto   declare a session (hex id) so frames missed while disconnected are replayed\n");
+    printf("  --reconnect-after N drop the connection every N frames and reconnect (default off)\n");
+    printf("  --pause S           time to stay disconnected before reconnecting (default 2)\n");
+    printf("  --control-every N   request a new exposure every N frames and check the acknowledged frames (v2)\n");
+    printf("  --compand CURVE     request 8-bit companded payloads: sqrt / log / off\n");
+    printf("  --packing NAME      rockchip / mipi / unpacked16, for size checks (default rockchip)\n");
+    printf("  --decode            decode compressed payloads and check their size, check compand tables\n");
+    printf("\nLoopback options:\n");
+    printf("  --width W --height H  synthetic frame size (default 1920x1080)\n");
+    printf("  --format NAME       pixel format, e.g. SBGGR10 (default)\n");
+    printf("  --fps F             capture rate, 0 = as fast as possible (default 30)\n");
+    printf("  --clients N         concurrent receivers (default 1)\n");
+    printf("  --compress          compress RAW payloads on the sender\n");
+    printf("  --queue-depth N     per-client queue depth (default 2)\n");
+    printf("  --policy NAME       drop-oldest / drop-newest / block (default drop-oldest)\n");
+    printf("  --no-zerocopy       do not try MSG_ZEROCOPY\n");
+    printf("  --spool N           keep up to N frames in RAM for disconnected sessions (default 0 = off)\n");
+    printf("  --spool-dir DIR     spill the catch-up buffer to a file in DIR when RAM is full\n");
+    printf("  --spool-disk-mb MB  size limit of the spill file (default 64)\n");
+}
+
+/**
+ * @brief 解析选项 (从 argv[first] 开始)
+ * @return 0成功，-1参数无效
+ */
+static int parse_options(int argc, char **argv, int first, receiver_options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->port = -1;
+    options->frames = 300;
+    options->header_version = 2;
+    options->packing = RAW_PACKING_ROCKCHIP;
+    options->width = 1920;
+    options->height = 1080;
+    options->format = raw_format_find("SBGGR10");
+    options->fps = 30;
+    options->clients = 1;
+    options->queue_depth = 2;
+    options->policy = FRAME_QUEUE_DROP_OLDEST;
+    options->zerocopy = 1;
+    options->max_latency = -1;
+    options->pause = 2.0;
+    options->spool_disk_mb = 64;
+    options->compand = -1;
+
+    for (int i = first; i < argc; i++)
+    {
+        const char *name = argv[i];
+
+        // 不带值的选项
+        if (strcmp(name, "--checksum") == 0)
+        {
+            options->checksum = 1;
+            continue;
+        }
+        if (strcmp(name, "--decode") == 0)
+        {
+            options->decode = 1;
+            continue;
+        }
+        if (strcmp(name, "--compress") == 0)
+        {
+            options->compress = 1;
+            continue;
+        }
+        if (strcmp(name, "--no-zerocopy") == 0)
+        {
+            options->zerocopy = 0;
+            continue;
+        }
+        if (strcmp(name, "--adapt-all") == 0)
+        {
+            options->adapt_all = 1;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            printf("Error: Missing value for %s\n", name);
+            return -1;
+        }
+
+        const char *value = argv[++i];
+        if (strcmp(name, "--port") == 0)
+        {
+            options->port = atoi(value);
+        }
+        else if (strcmp(name, "--frames") == 0)
+        {
+            options->frames = (uint32_t)strtoul(value, NULL, 10);
+        }
+        else if (strcmp(name, "--seconds") == 0)
+        {
+            options->seconds = atof(value);
+        }
+        else if (strcmp(name, "--header") == 0)
+        {
+            options->header_version = atoi(value);
+            if (options->header_version != 1 && options->header_version != 2)
+            {
+                printf("Error: --header must be 1 or 2\n");
+                return -1;
+            }
+        }
+        else if (strcmp(name, "--view") == 0)
+        {
+            options->view[4] = 1;
+            int count = sscanf(value, "%d,%d,%d,%d,%d", &options->view[0], &options->view[1],
+                               &options->view[2], &options->view[3], &options->view[4]);
+            if (count < 4)
+            {
+                printf("Error: --view expects L,T,W,H[,B]\n");
+                return -1;
+            }
+            options->has_view = 1;
+        }
+        else if (strcmp(name, "--decimation") == 0)
+        {
+            options->decimation = atoi(value);
+        }
+        else if (strcmp(name, "--max-latency") == 0)
+        {
+            options->max_latency = atoi(value) > 0 ? atoi(value) : 0;
+        }
+        else if (strcmp(name, "--read-limit") == 0)
+        {
+            options->read_limit = atof(value);
+        }
+        else if (strcmp(name, "--session") == 0)
+        {
+            if (strcmp(value, "auto") == 0)
+            {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                options->session = ((uint64_t)getpid() << 40) ^ ((uint64_t)ts.tv_sec << 20) ^ (uint64_t)ts.tv_nsec;
+            }
+            else
+            {
+                options->session = strtoull(value, NULL, 16);
+            }
+            if (options->session == 0)
+            {
+                printf("Error: --session expects a non-zero hex id or 'auto'\n");
+                return -1;
+            }
+        }
+        else if (strcmp(name, "--reconnect-after") == 0)
+        {
+            options->reconnect_after = (uint32_t)strtoul(value, NULL, 10);
+        }
+        else if (strcmp(name, "--pause") == 0)
+        {
+            options->pause = atof(value);
+        }
+        else if (strcmp(name, "--control-every") == 0)
+        {
+            options->control_every = (uint32_t)strtoul(value, NULL, 10);
+        }
+        else if (strcmp(name, "--compand") == 0)
+        {
+            raw_compand_curve_t curve;
+            if (raw_compand_curve_from_name(value, &curve) != 0)
+            {
+                printf("Error: Unknown compand curve '%s'\n", value);
+                return -1;
+            }
+            options->compand = (int)curve;
+        }
+        else if (strcmp(name, "--packing") == 0)
+        {
+            if (raw_packing_from_name(value, &options->packing) != 0)
+            {
+                printf("Error: Unknown packing '%s'\n", value);
+                return -1;
+            }
+        }
+        else if (strcmp(name, "--width") == 0)
+        {
+            options->width = atoi(value);
+        }
+        else if (strcmp(name, "--height") == 0)
+        {
+            options->height = atoi(value);
+        }
+        else if (strcmp(name, "--format") == 0)
+        {
+            options->format = raw_format_find(value);
+            if (!options->format)
+            {
+                printf("Error: Unknown pixel format '%s'\n", value);
+                return -1;
+            }
+        }
+        else if (strcmp(name, "--fps") == 0)
+        {
+            options->fps = atof(value);
+        }
+        else if (strcmp(name, "--clients") == 0)
+        {
+            options->clients = atoi(value);
+        }
+        else if (strcmp(name, "--queue-depth") == 0)
+        {
+            options->queue_depth = atoi(value);
+        }
+        else if (strcmp(name, "--spool") == 0)
+        {
+            options->spool_frames = atoi(value);
+        }
+        else if (strcmp(name, "--spool-dir") == 0)
+        {
+            options->spool_dir = value;
+        }
+        else if (strcmp(name, "--spool-disk-mb") == 0)
+        {
+            options->spool_disk_mb = atoi(value);
+        }
+        else if (strcmp(name, "--policy") == 0)
+        {
+            if (frame_queue_policy_from_name(value, &options->policy) != 0)
+            {
+                printf("Error: Unknown queue policy '%s'\n", value);
+                return -1;
+            }
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", name);
+            return -1;
+        }
+    }
+
+    if (options->width <= 0 || options->height <= 0 || options->clients < 1 ||
+        options->clients > STREAM_SERVER_MAX_CLIENTS || options->queue_depth < 1 || options->spool_frames < 0 ||
+        options->spool_frames > STREAM_SPOOL_MAX_RAM)
+    {
+        printf("Error: Invalid frame size, client count, queue depth or spool size\n");
+        return -1;
+    }
+    return 0;
+}
+
+static double now_ms(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief 连接服务器
+ * @return 套接字，失败返回-1
+ */
+static int connect_to(const char *host, int port)
+{
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *result = NULL;
+    int error = getaddrinfo(host, service, &hints, &result);
+    if (error != 0)
+    {
+        printf("Error: Cannot resolve %s: %s\n", host, gai_strerror(error));
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0)
+    {
+        printf("Error: Cannot connect to %s:%d: %s\n", host, port, strerror(errno));
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+
+    if (fd >= 0)
+    {
+        // 接收缓冲区与设备端的发送缓冲区相当，避免接收端成为瓶颈
+        int size = 4 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        int flag = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+    return fd;
+}
+
+/**
+ * @brief 发送一条请求消息
+ */
+static int send_request(int fd, uint16_t type, const void *payload, uint16_t length)
+{
+    uint8_t message[sizeof(stream_request_header_t) + STREAM_REQUEST_MAX_PAYLOAD];
+    stream_request_header_t header = {.magic = STREAM_REQUEST_MAGIC, .type = type, .length = length};
+    memcpy(message, &header, sizeof(header));
+    memcpy(message + sizeof(header), payload, length);
+
+    size_t total = sizeof(header) + length;
+    return send(fd, message, total, MSG_NOSIGNAL) == (ssize_t)total ? 0 : -1;
+}
+
+/**
+ * @brief 按选项发送帧头、会话、视图、抽帧、码率控制和压扩请求
+ */
+static int send_requests(int fd, const receiver_options_t *options, uint64_t session)
+{
+    stream_header_request_t header = {
+        .version = (uint32_t)options->header_version,
+        .flags = options->checksum ? STREAM_HEADER_CHECKSUM : 0};
+    if (send_request(fd, STREAM_REQUEST_HEADER, &header, sizeof(header)) != 0)
+    {
+        return -1;
+    }
+
+    if (options->has_view)
+    {
+        stream_view_request_t view = {
+            .left = (uint32_t)options->view[0],
+            .top = (uint32_t)options->view[1],
+            .width = (uint32_t)options->view[2],
+            .height = (uint32_t)options->view[3],
+            .binning = (uint32_t)options->view[4]};
+        if (send_request(fd, STREAM_REQUEST_VIEW, &view, sizeof(view)) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (options->decimation > 0)
+    {
+        stream_decimation_request_t decimation = {.decimation = (uint32_t)options->decimation};
+        if (send_request(fd, STREAM_REQUEST_DECIMATION, &decimation, sizeof(decimation)) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (session != 0)
+    {
+        stream_session_request_t request = {.session = session};
+        if (send_request(fd, STREAM_REQUEST_SESSION, &request, sizeof(request)) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (options->max_latency >= 0)
+    {
+        stream_rate_request_t rate = {
+            .max_latency_ms = (uint32_t)options->max_latency,
+            .allow = options->adapt_all ? STREAM_RATE_ALLOW_COMPRESS | STREAM_RATE_ALLOW_BINNING : 0};
+        if (send_request(fd, STREAM_REQUEST_RATE, &rate, sizeof(rate)) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (options->compand >= 0)
+    {
+        stream_compand_request_t compand = {.curve = (uint32_t)options->compand};
+        if (send_request(fd, STREAM_REQUEST_COMPAND, &compand, sizeof(compand)) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 保证缓冲区中至少有 need 字节未消费数据
+ * @return 0成功，-1连接关闭或出错
+ */
+static int reader_fill(stream_reader_t *reader, size_t need)
+{
+    if (reader->end - reader->start >= need)
+    {
+        return 0;
+    }
+
+    // 前移未消费数据，空间仍不足时扩大缓冲区
+    if (reader->start > 0)
+    {
+        memmove(reader->buf, reader->buf + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (need + READ_CHUNK > reader->capacity)
+    {
+        size_t capacity = need + READ_CHUNK;
+        uint8_t *grown = realloc(reader->buf, capacity);
+        if (!grown)
+        {
+            printf("Error: Out of memory for a %zu byte frame\n", need);
+            return -1;
+        }
+        reader->buf = grown;
+        reader->capacity = capacity;
+    }
+
+    while (reader->end < need)
+    {
+        ssize_t n = recv(reader->fd, reader->buf + reader->end, reader->capacity - reader->end, 0);
+        if (n > 0)
+        {
+            reader->end += (size_t)n;
+        }
+        else if (n == 0 || errno != EINTR)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 寻找同步标识并解析帧头 (不消费负载)、控制应答或压扩码表
+ * @return 0帧头，1控制应答 (已消费)，2压扩码表 (已消费)，-1连接关闭
+ */
+static int read_frame_header(stream_reader_t *reader, int expect_v2, parsed_header_t *header,
+                             stream_control_ack_t *ack, stream_compand_table_t *table, receiver_stats_t *stats)
+{
+    for (;;)
+    {
+        // 先只读到魔数和长度：控制应答比 v1 帧头短，之后可能暂时没有数据
+        if (reader_fill(reader, STREAM_FRAME_SYNC_LEN + 8) != 0)
+        {
+            return -1;
+        }
+
+        uint8_t *p = reader->buf + reader->start;
+        if (memcmp(p, STREAM_FRAME_SYNC, STREAM_FRAME_SYNC_LEN) != 0)
+        {
+            // 跳到下一个可能的同步标识起点
+            uint8_t *next = memchr(p + 1, STREAM_FRAME_SYNC[0], reader->end - reader->start - 1);
+            size_t skip = next ? (size_t)(next - p) : reader->end - reader->start;
+            stats->resync_bytes += skip;
+            reader->start += skip;
+            continue;
+        }
+
+        uint8_t *h = p + STREAM_FRAME_SYNC_LEN;
+        uint32_t magic;
+        uint16_t version, header_size;
+        memcpy(&magic, h, sizeof(magic));
+        memcpy(&version, h + 4, sizeof(version));
+        memcpy(&header_size, h + 6, sizeof(header_size));
+        if (magic == STREAM_CONTROL_MAGIC && version >= offsetof(stream_control_ack_t, sequence) && version <= 1024)
+        {
+            // 控制应答：version 位置为应答长度
+            if (reader_fill(reader, STREAM_FRAME_SYNC_LEN + version) != 0)
+            {
+                return -1;
+            }
+            memset(ack, 0, sizeof(*ack));
+            memcpy(ack, reader->buf + reader->start + STREAM_FRAME_SYNC_LEN, version < sizeof(*ack) ? version : sizeof(*ack));
+            reader->start += STREAM_FRAME_SYNC_LEN + version;
+            stats->wire_bytes += STREAM_FRAME_SYNC_LEN + version;
+            return 1;
+        }
+        if (magic == STREAM_COMPAND_MAGIC && version >= sizeof(stream_compand_table_t) && version <= 4096)
+        {
+            // 压扩码表：version 位置为码表消息长度
+            if (reader_fill(reader, STREAM_FRAME_SYNC_LEN + version) != 0)
+            {
+                return -1;
+            }
+            memcpy(table, reader->buf + reader->start + STREAM_FRAME_SYNC_LEN, sizeof(*table));
+            reader->start += STREAM_FRAME_SYNC_LEN + version;
+            stats->wire_bytes += STREAM_FRAME_SYNC_LEN + version;
+            return 2;
+        }
+        if (magic != STREAM_FRAME_MAGIC)
+        {
+            stats->bad_headers++;
+            stats->resync_bytes++;
+            reader->start++;
+            continue;
+        }
+        if (reader_fill(reader, STREAM_FRAME_SYNC_LEN + sizeof(struct frame_header)) != 0)
+        {
+            return -1;
+        }
+        h = reader->buf + reader->start + STREAM_FRAME_SYNC_LEN;
+
+        memset(header, 0, sizeof(*header));
+        size_t consumed;
+        // 旧设备的 v2 帧头没有码率控制字段 (结构体在 rate_level 处结束)
+        if (expect_v2 && version == 2 && header_size >= offsetof(frame_header_v2_t, rate_level) &&
+            header_size <= 1024)
+        {
+            if (reader_fill(reader, STREAM_FRAME_SYNC_LEN + header_size) != 0)
+            {
+                return -1;
+            }
+            frame_header_v2_t v2;
+            memset(&v2, 0, sizeof(v2));
+            memcpy(&v2, reader->buf + reader->start + STREAM_FRAME_SYNC_LEN,
+                   header_size < sizeof(v2) ? header_size : sizeof(v2));
+            header->version = 2;
+            header->frame_id = v2.frame_id;
+            header->sequence = v2.sequence;
+            header->exposure = v2.exposure;
+            header->gain = v2.gain;
+            header->width = v2.width;
+            header->height = v2.height;
+            header->pixfmt = v2.pixfmt;
+            header->size = v2.size;
+            header->encoding = v2.encoding;
+            header->raw_size = v2.raw_size;
+            header->capture_ns = v2.capture_ns;
+            header->realtime_offset_ns = v2.realtime_offset_ns;
+            header->send_ns = v2.send_ns;
+            header->dropped = v2.dropped;
+            header->flags = v2.flags;
+            header->checksum = v2.checksum;
+            header->rate_level = v2.rate_level;
+            header->rate_flags = v2.rate_flags;
+            header->decimation = v2.decimation;
+            consumed = STREAM_FRAME_SYNC_LEN + header_size;
+        }
+        else
+        {
+            struct frame_header v1;
+            memcpy(&v1, h, sizeof(v1));
+            header->version = 1;
+            header->frame_id = v1.frame_id;
+            header->width = v1.width;
+            header->height = v1.height;
+            header->pixfmt = v1.pixfmt;
+            header->size = v1.size;
+            header->encoding = v1.reserved[0];
+            header->raw_size = v1.reserved[0] ? v1.reserved[1] : v1.size;
+            header->capture_ns = v1.timestamp;
+            consumed = STREAM_FRAME_SYNC_LEN + sizeof(v1);
+        }
+
+        if (header->size > MAX_PAYLOAD)
+        {
+            stats->bad_headers++;
+            stats->resync_bytes++;
+            reader->start++;
+            continue;
+        }
+
+        reader->start += consumed;
+        stats->wire_bytes += consumed;
+        return 0;
+    }
+}
+
+/**
+ * @brief 校验一帧的负载
+ */
+static void validate_frame(const receiver_options_t *options, const parsed_header_t *header,
+                           const uint8_t *payload, const stream_compand_table_t *table, receiver_stats_t *stats)
+{
+    const raw_format_t *format = raw_format_from_fourcc(header->pixfmt);
+    size_t expected = 0;
+    if (format)
+    {
+        expected = raw_layout_min_stride((int)header->width, format->bit_depth, options->packing) * header->height;
+    }
+
+    if (header->encoding == 0)
+    {
+        if (!format || header->size != expected)
+        {
+            stats->size_errors++;
+        }
+    }
+    else if (header->encoding == RAW_CODEC_FOURCC)
+    {
+        raw_codec_header_t codec;
+        if (raw_codec_read_header(payload, header->size, &codec) != 0 || codec.raw_size != header->raw_size ||
+            codec.width != header->width || codec.height != header->height ||
+            (format && codec.raw_size != expected))
+        {
+            stats->size_errors++;
+        }
+        else if (options->decode)
+        {
+            uint8_t *decoded = malloc(codec.raw_size);
+            if (!decoded || raw_codec_decode(payload, header->size, decoded, codec.raw_size) != 0)
+            {
+                stats->decode_errors++;
+            }
+            free(decoded);
+        }
+    }
+    else if (header->encoding == RAW_COMPAND_FOURCC)
+    {
+        // 每像素1字节的码值，接收端按之前收到的码表 (decode[码值]) 还原
+        if (header->size != header->width * header->height || header->raw_size != header->size)
+        {
+            stats->size_errors++;
+        }
+        else if (!table || (format && table->input_bits != format->bit_depth))
+        {
+            stats->decode_errors++;
+        }
+        else
+        {
+            stats->compand_frames++;
+            stats->compand_bytes += header->size;
+            stats->compand_packed_bytes += expected;
+        }
+    }
+    else
+    {
+        stats->size_errors++; // 未知编码
+    }
+
+    if (header->version == 2 && (header->flags & STREAM_HEADER_CHECKSUM) &&
+        stream_checksum(payload, header->size) != header->checksum)
+    {
+        stats->checksum_errors++;
+    }
+}
+
+/**
+ * @brief 连接 (按选项断开重连) 并接收帧，直到达到帧数/时间上限，然后打印报告
+ * @return 0成功，-1没有收到任何帧
+ */
+static int receive_session(const char *host, int port, const receiver_options_t *options, uint64_t session,
+                           int same_clock, const char *label)
+{
+    receiver_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.start_ms = now_ms(CLOCK_MONOTONIC);
+
+    for (;;)
+    {
+        int fd = connect_to(host, port);
+        if (fd < 0)
+        {
+            break;
+        }
+        stats.connections++;
+        if (send_requests(fd, options, session) != 0)
+        {
+            printf("Error: Failed to send requests: %s\n", strerror(errno));
+            close(fd);
+            break;
+        }
+
+        int more = receive_frames(fd, options, same_clock, label, &stats);
+        close(fd);
+        if (!more)
+        {
+            break;
+        }
+
+        printf("%s: disconnected after %u frames, reconnecting in %.1fs\n", label, stats.frames, options->pause);
+        usleep((useconds_t)(options->pause * 1e6));
+    }
+
+    print_report(label, &stats);
+
+    free(stats.interval.values);
+    free(stats.latency.values);
+    free(stats.device_latency.values);
+    free(stats.control_rtt.values);
+    free(stats.sequences);
+    return stats.frames > 0 ? 0 : -1;
+}
+
+/**
+ * @brief 在一个连接上接收帧，直到达到帧数/时间上限、本连接的帧数上限或连接关闭
+ * @return 1达到本连接的帧数上限 (应重连)，0结束
+ */
+static int receive_frames(int fd, const receiver_options_t *options, int same_clock, const char *label,
+                          receiver_stats_t *stats)
+{
+    stream_reader_t reader = {.fd = fd};
+    double start_ms = now_ms(CLOCK_MONOTONIC);
+    double report_ms = start_ms;
+    uint32_t report_frames = stats->frames;
+    uint64_t report_bytes = stats->wire_bytes;
+    uint64_t start_bytes = stats->wire_bytes;
+    uint32_t received = 0;
+    double last_live_ms = 0;
+    int have_id = 0;
+    uint32_t last_id = 0;
+    int last_level = 0;
+    int more = 0;
+
+    // 曝光控制测试：上一请求应答后才发送下一请求
+    uint32_t control_id = 0;
+    double control_sent_ms = 0;     // 等待应答时为发送时刻
+    uint32_t control_from = 0;      // 最近一次生效的修改从该采集序号起，0为尚无
+    int32_t control_expected = 0;   // 该修改生效的曝光值
+
+    // 压扩码表 (每个连接重新发送)
+    stream_compand_table_t table;
+    int have_table = 0;
+
+    while ((options->frames == 0 || stats->frames < options->frames) &&
+           (options->seconds <= 0 || now_ms(CLOCK_MONOTONIC) - stats->start_ms < options->seconds * 1000.0))
+    {
+        if (options->reconnect_after > 0 && received >= options->reconnect_after)
+        {
+            more = 1;
+            break;
+        }
+
+        parsed_header_t header;
+        stream_control_ack_t ack;
+        int kind = read_frame_header(&reader, options->header_version == 2, &header, &ack, &table, stats);
+        if (kind == 2)
+        {
+            // 码表应与本机按同一曲线生成的一致
+            const raw_compand_t *local = raw_compand_get((raw_compand_curve_t)table.curve, table.input_bits);
+            if (options->decode && (!local || memcmp(local->decode, table.decode, sizeof(table.decode)) != 0))
+            {
+                stats->decode_errors++;
+            }
+            stats->compand_tables++;
+            have_table = 1;
+            continue;
+        }
+        if (kind == 1)
+        {
+            stats->control_acks++;
+            if (control_sent_ms > 0 && ack.id == control_id)
+            {
+                sample_add(&stats->control_rtt, now_ms(CLOCK_MONOTONIC) - control_sent_ms);
+                control_sent_ms = 0;
+            }
+            if (ack.status == STREAM_CONTROL_OK || ack.status == STREAM_CONTROL_CLAMPED)
+            {
+                control_from = ack.sequence;
+                control_expected = ack.value;
+            }
+            else
+            {
+                stats->control_rejected++;
+            }
+            continue;
+        }
+        if (kind != 0 || reader_fill(&reader, header.size) != 0)
+        {
+            break;
+        }
+
+        const uint8_t *payload = reader.buf + reader.start;
+        double arrival_ms = now_ms(CLOCK_MONOTONIC);
+        double arrival_real_ms = now_ms(CLOCK_REALTIME);
+
+        validate_frame(options, &header, payload, have_table ? &table : NULL, stats);
+        reader.start += header.size;
+
+        // 帧序号连续性 (服务器从0开始为每个连接编号)
+        if (have_id && header.frame_id != last_id + 1)
+        {
+            stats->id_gaps += header.frame_id - last_id - 1;
+        }
+        have_id = 1;
+        last_id = header.frame_id;
+
+        // 补发帧在采集很久之后才发出，不计入帧间隔和延迟
+        int catchup = header.version == 2 && (header.flags & STREAM_FRAME_CATCHUP);
+        if (!catchup)
+        {
+            if (last_live_ms > 0)
+            {
+                sample_add(&stats->interval, arrival_ms - last_live_ms);
+            }
+            last_live_ms = arrival_ms;
+        }
+        if (stats->frames == 0)
+        {
+            stats->first_ms = arrival_ms;
+        }
+        stats->last_ms = arrival_ms;
+
+        if (header.version == 2)
+        {
+            if (catchup)
+            {
+                stats->catchup_frames++;
+            }
+            else
+            {
+                double capture_real_ms = (double)((int64_t)header.capture_ns + header.realtime_offset_ns) / 1e6;
+                sample_add(&stats->latency, arrival_real_ms - capture_real_ms);
+                sample_add(&stats->device_latency, (double)(header.send_ns - header.capture_ns) / 1e6);
+                stats->device_dropped += header.dropped;
+            }
+            if (stats->v2_frames > 0 && header.rate_level != last_level)
+            {
+                stats->rate_changes++;
+            }
+            last_level = header.rate_level;
+            if (header.rate_level > stats->max_rate_level)
+            {
+                stats->max_rate_level = header.rate_level;
+            }
+            stats->v2_frames++;
+            sequence_add(stats, header.sequence);
+
+            // 应答所指的帧起，帧头中的曝光值应为新值
+            if (!catchup && control_from != 0 && header.sequence >= control_from)
+            {
+                stats->control_checked++;
+                if (header.exposure != control_expected)
+                {
+                    stats->control_mismatches++;
+                }
+            }
+        }
+        else if (same_clock)
+        {
+            sample_add(&stats->latency, arrival_ms - (double)header.capture_ns / 1e6);
+        }
+
+        stats->frames++;
+        stats->wire_bytes += header.size;
+        stats->payload_bytes += header.size;
+        stats->raw_bytes += header.raw_size;
+        received++;
+
+        if (options->control_every > 0 && received % options->control_every == 0 && control_sent_ms == 0)
+        {
+            stream_control_request_t request = {
+                .id = ++control_id,
+                .control = STREAM_CONTROL_EXPOSURE,
+                .value = (control_id % 2) ? CONTROL_EXPOSURE_HIGH : CONTROL_EXPOSURE_LOW};
+            if (send_request(fd, STREAM_REQUEST_CONTROL, &request, sizeof(request)) == 0)
+            {
+                control_sent_ms = now_ms(CLOCK_MONOTONIC);
+                stats->controls_sent++;
+            }
+        }
+
+        // 限速：按已接收字节数推算应到的时刻，提前则等待 (接收缓冲区填满后发送端随之受阻)
+        if (options->read_limit > 0)
+        {
+            double due_ms = start_ms + (double)(stats->wire_bytes - start_bytes) / (options->read_limit * 1e3);
+            double ahead_ms = due_ms - now_ms(CLOCK_MONOTONIC);
+            if (ahead_ms > 0)
+            {
+                usleep((useconds_t)(ahead_ms * 1000.0));
+            }
+        }
+
+        // 每秒一行进度
+        if (arrival_ms - report_ms >= 1000.0)
+        {
+            double seconds = (arrival_ms - report_ms) / 1000.0;
+            char rate[96] = ""; // 最长约60字节 (两个数值取最大位数且两个标志都置位)
+            if (header.decimation > 0)
+            {
+                snprintf(rate, sizeof(rate), ", rate level %d (1/%u%s%s)", header.rate_level, header.decimation,
+                         (header.rate_flags & STREAM_RATE_BINNED) ? ", binned" : "",
+                         (header.rate_flags & STREAM_RATE_COMPRESSED) ? ", compressed" : "");
+            }
+            char catchup_text[32] = "";
+            if (stats->catchup_frames > 0)
+            {
+                snprintf(catchup_text, sizeof(catchup_text), ", %u catch-up", stats->catchup_frames);
+            }
+            printf("%s: %ux%u %s, %.1f fps, %.1f MB/s%s%s\n", label, header.width, header.height,
+                   header.encoding == RAW_COMPAND_FOURCC ? "companded" : (header.encoding ? "compressed" : "raw"),
+                   (stats->frames - report_frames) / seconds,
+                   (double)(stats->wire_bytes - report_bytes) / 1e6 / seconds, rate, catchup_text);
+            report_ms = arrival_ms;
+            report_frames = stats->frames;
+            report_bytes = stats->wire_bytes;
+        }
+    }
+
+    free(reader.buf);
+    return more;
+}
+
+/**
+ * @brief 记录收到的采集序号
+ */
+static void sequence_add(receiver_stats_t *stats, uint32_t sequence)
+{
+    if (stats->sequence_count == stats->sequence_capacity)
+    {
+        size_t capacity = stats->sequence_capacity ? stats->sequence_capacity * 2 : 1024;
+        uint32_t *values = realloc(stats->sequences, capacity * sizeof(uint32_t));
+        if (!values)
+        {
+            return;
+        }
+        stats->sequences = values;
+        stats->sequence_capacity = capacity;
+    }
+    stats->sequences[stats->sequence_count++] = sequence;
+}
+
+static void sample_add(sample_set_t *set, double value)
+{
+    if (set->count == set->capacity)
+    {
+        size_t capacity = set->capacity ? set->capacity * 2 : 1024;
+        double *grown = realloc(set->values, capacity * sizeof(double));
+        if (!grown)
+        {
+            return;
+        }
+        set->values = grown;
+        set->capacity = capacity;
+    }
+    set->values[set->count++] = value;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief 分位数 (排序后按位置取值)
+ */
+static double sample_percentile(sample_set_t *set, double p)
+{
+    qsort(set->values, set->count, sizeof(double), compare_double);
+    size_t index = (size_t)(p * (double)(set->count - 1) + 0.5);
+    return set->values[index];
+}
+
+static void print_samples(const char *name, sample_set_t *set)
+{
+    if (set->count == 0)
+    {
+        printf("  %-22s n/a\n", name);
+        return;
+    }
+
+    double sum = 0.0, sum_sq = 0.0;
+    for (size_t i = 0; i < set->count; i++)
+    {
+        sum += set->values[i];
+        sum_sq += set->values[i] * set->values[i];
+    }
+    double mean = sum / (double)set->count;
+    double variance = sum_sq / (double)set->count - mean * mean;
+
+    printf("  %-22s mean %.2f  sd %.2f  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms\n", name, mean,
+           variance > 0 ? sqrt(variance) : 0.0, sample_percentile(set, 0.50),
+           sample_percentile(set, 0.95), sample_percentile(set, 0.99), sample_percentile(set, 1.0));
+}
+
+static void print_report(const char *label, receiver_stats_t *stats)
+{
+    double seconds = stats->frames > 1 ? (stats->last_ms - stats->first_ms) / 1000.0 : 0.0;
+    printf("%s summary: %u frames (%u with v2 header) in %.2fs\n", label, stats->frames, stats->v2_frames, seconds);
+    if (seconds > 0)
+    {
+        printf("  throughput             %.1f MB/s on the wire, %.1f MB/s decoded, %.2f fps\n",
+               (double)stats->wire_bytes / 1e6 / seconds, (double)stats->raw_bytes / 1e6 / seconds,
+               (stats->frames - 1) / seconds);
+    }
+    print_samples("frame interval", &stats->interval);
+    print_samples("latency (capture->rx)", &stats->latency);
+    print_samples("device (capture->tx)", &stats->device_latency);
+    printf("  errors                 %llu resync bytes, %u bad headers, %u size, %u checksum, %u decode\n",
+           (unsigned long long)stats->resync_bytes, stats->bad_headers, stats->size_errors,
+           stats->checksum_errors, stats->decode_errors);
+    printf("  gaps                   %u missing frame ids, %llu frames dropped on device\n", stats->id_gaps,
+           (unsigned long long)stats->device_dropped);
+    if (stats->compand_tables > 0 || stats->compand_frames > 0)
+    {
+        printf("  compand                %u tables, %u frames, payload %.1f%% of packed RAW\n", stats->compand_tables,
+               stats->compand_frames,
+               stats->compand_packed_bytes ? 100.0 * stats->compand_bytes / stats->compand_packed_bytes : 0.0);
+    }
+    if (stats->rate_changes > 0 || stats->max_rate_level > 0)
+    {
+        printf("  rate control           %u level changes, highest level %d\n", stats->rate_changes,
+               stats->max_rate_level);
+    }
+    if (stats->controls_sent > 0 || stats->control_acks > 0)
+    {
+        printf("  control                %u requests, %u acks (%u rejected), %u frames checked, %u with stale exposure\n",
+               stats->controls_sent, stats->control_acks, stats->control_rejected, stats->control_checked,
+               stats->control_mismatches);
+        print_samples("control round trip", &stats->control_rtt);
+    }
+    if (stats->connections > 1 || stats->catchup_frames > 0)
+    {
+        print_coverage(stats);
+    }
+}
+
+static int compare_sequence(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * @brief 断线重连时的采集序号覆盖：缺失的序号即断线期间丢失 (未补发) 的帧
+ */
+static void print_coverage(receiver_stats_t *stats)
+{
+    printf("  reconnects             %u connections, %u catch-up frames\n", stats->connections,
+           stats->catchup_frames);
+    if (stats->sequence_count == 0)
+    {
+        return;
+    }
+
+    qsort(stats->sequences, stats->sequence_count, sizeof(uint32_t), compare_sequence);
+    uint32_t duplicates = 0;
+    uint32_t missing = 0;
+    for (size_t i = 1; i < stats->sequence_count; i++)
+    {
+        uint32_t step = stats->sequences[i] - stats->sequences[i - 1];
+        if (step == 0)
+        {
+            duplicates++;
+        }
+        else
+        {
+            missing += step - 1;
+        }
+    }
+    printf("  coverage               sequences %u..%u: %u missing, %u duplicates\n", stats->sequences[0],
+           stats->sequences[stats->sequence_count - 1], missing, duplicates);
+}
+
+static int command_connect(const receiver_options_t *options)
+{
+    int port = options->port > 0 ? options->port : DEFAULT_PORT;
+    printf("Connecting to %s:%d\n", options->host, port);
+    if (options->session != 0)
+    {
+        printf("Session %016llx\n", (unsigned long long)options->session);
+    }
+    return receive_session(options->host, port, options, options->session, 0, "rx");
+}
+
+static void *receiver_thread(void *arg)
+{
+    receiver_job_t *job = arg;
+    char label[16];
+    snprintf(label, sizeof(label), "rx%d", job->index);
+
+    // 每个接收端使用不同的会话，避免互相顶替
+    uint64_t session = job->options->session ? job->options->session + (uint64_t)(job->index - 1) : 0;
+    job->result = receive_session("127.0.0.1", job->options->port, job->options, session, job->same_clock, label);
+    return NULL;
+}
+
+static void *loopback_server_thread(void *arg)
+{
+    loopback_t *loopback = arg;
+    stream_server_run(&loopback->server);
+    return NULL;
+}
+
+/**
+ * @brief 帧池交还缓冲区 ("驱动"可以再次写入)
+ */
+static void loopback_release(media_frame_t *frame, void *user)
+{
+    loopback_t *loopback = user;
+    for (int i = 0; i < LOOPBACK_BUFFERS; i++)
+    {
+        if (loopback->buffers[i] == frame->data)
+        {
+            __atomic_store_n(&loopback->busy[i], 0, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+/**
+ * @brief 回环的控制请求：模拟传感器的曝光/增益 (范围与设备相同)，在服务器线程中直接执行并应答
+ */
+static int loopback_control(int client_id, const stream_control_request_t *request, void *user)
+{
+    loopback_t *loopback = user;
+    stream_control_ack_t ack = {
+        .status = STREAM_CONTROL_INVALID,
+        .id = request->id,
+        .control = request->control,
+        .target = request->target,
+        .value = request->value};
+
+    if (request->control == STREAM_CONTROL_EXPOSURE || request->control == STREAM_CONTROL_GAIN)
+    {
+        int exposure = (request->control == STREAM_CONTROL_EXPOSURE);
+        int32_t min = exposure ? 1 : 128;
+        int32_t max = exposure ? 1352 : 99614;
+        int32_t value = request->value < min ? min : (request->value > max ? max : request->value);
+
+        pthread_mutex_lock(&loopback->sensor_lock);
+        uint32_t sequence = loopback->sequence + 1 + LOOPBACK_CONTROL_DELAY;
+        if (loopback->pending_sequence == 0)
+        {
+            loopback->pending_exposure = loopback->exposure;
+            loopback->pending_gain = loopback->gain;
+        }
+        else if (loopback->pending_sequence != sequence)
+        {
+            // 与设备相同：上一项修改提前生效
+            loopback->exposure = loopback->pending_exposure;
+            loopback->gain = loopback->pending_gain;
+        }
+        *(exposure ? &loopback->pending_exposure : &loopback->pending_gain) = value;
+        loopback->pending_sequence = sequence;
+        pthread_mutex_unlock(&loopback->sensor_lock);
+
+        ack.status = (value != request->value) ? STREAM_CONTROL_CLAMPED : STREAM_CONTROL_OK;
+        ack.value = value;
+        ack.sequence = sequence;
+    }
+    else if (request->control == STREAM_CONTROL_DEVICE_MODE)
+    {
+        ack.status = STREAM_CONTROL_UNAVAILABLE; // 回环没有外设
+    }
+
+    stream_server_control_ack(&loopback->server, client_id, &ack);
+    return 0;
+}
+
+/**
+ * @brief 生成一帧合成图像：平滑渐变加少量噪声，接近真实场景的压缩率
+ */
+static void fill_synthetic_frame(const receiver_options_t *options, uint8_t *data, size_t stride, int seed)
+{
+    raw_layout_t layout = {
+        .width = options->width,
+        .height = options->height,
+        .stride = stride,
+        .packing = options->packing,
+        .bit_depth = options->format->bit_depth,
+        .bayer = options->format->bayer};
+
+    uint16_t *row = malloc((size_t)options->width * sizeof(uint16_t));
+    if (!row)
+    {
+        return;
+    }
+
+    uint32_t state = 0x9E3779B9u * (uint32_t)(seed + 1);
+    int max = (1 << layout.bit_depth) - 1;
+    for (int y = 0; y < options->height; y++)
+    {
+        for (int x = 0; x < options->width; x++)
+        {
+            state = state * 1664525u + 1013904223u;
+            int value = ((x + y + seed * 16) * max) / (options->width + options->height) + (int)(state >> 29) - 4;
+            row[x] = (uint16_t)(value < 0 ? 0 : (value > max ? max : value));
+        }
+        raw_codec_pack_row(&layout, row, data + (size_t)y * stride);
+    }
+    free(row);
+}
+
+static int command_loopback(receiver_options_t *options)
+{
+    loopback_t loopback;
+    memset(&loopback, 0, sizeof(loopback));
+    loopback.options = options;
+    loopback.exposure = 128;
+    loopback.gain = 128;
+    pthread_mutex_init(&loopback.sensor_lock, NULL);
+
+    // 合成"驱动缓冲区"：与设备相同的打包格式，行无填充
+    size_t stride = raw_layout_min_stride(options->width, options->format->bit_depth, options->packing);
+    loopback.frame_size = stride * (size_t)options->height;
+    for (int i = 0; i < LOOPBACK_BUFFERS; i++)
+    {
+        loopback.buffers[i] = malloc(loopback.frame_size);
+        if (!loopback.buffers[i])
+        {
+            printf("Error: Out of memory for synthetic frames\n");
+            return -1;
+        }
+        fill_synthetic_frame(options, loopback.buffers[i], stride, i);
+    }
+
+    // 监听回环地址
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(options->port > 0 ? options->port : 0)};
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, STREAM_SERVER_MAX_CLIENTS) != 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) != 0)
+    {
+        printf("Error: Cannot listen on loopback: %s\n", strerror(errno));
+        close(listen_fd);
+        return -1;
+    }
+    options->port = ntohs(addr.sin_port);
+
+    // 与设备相同的发送路径：帧池 -> 客户端队列 -> stream_format -> frame_tx
+    frame_pool_init(&loopback.pool, LOOPBACK_BUFFERS - 2, loopback_release, &loopback);
+    loopback.format = (stream_format_config_t){
+        .format = options->format,
+        .packing = options->packing,
+        .compress = options->compress};
+    stream_server_config_t server_config = {
+        .max_clients = options->clients,
+        .queue_depth = options->queue_depth,
+        .policy = options->policy,
+        .zerocopy = options->zerocopy,
+        .decimation = 1,
+        .send_buffer = 2 * 1024 * 1024,
+        .max_latency_ms = LOOPBACK_MAX_LATENCY_MS,
+        .compand_bits = options->format->bit_depth,
+        .control_fn = loopback_control,
+        .control_user = &loopback};
+    if (options->spool_frames > 0)
+    {
+        stream_spool_config_t spool_config = {
+            .ram_frames = options->spool_frames,
+            .disk_mb = options->spool_disk_mb,
+            .timeout_ms = LOOPBACK_SPOOL_TIMEOUT_MS};
+        snprintf(spool_config.dir, sizeof(spool_config.dir), "%s", options->spool_dir ? options->spool_dir : "");
+        if (stream_spool_init(&loopback.spool, &spool_config) != 0)
+        {
+            return -1;
+        }
+        server_config.spool = &loopback.spool;
+    }
+    loopback.server = (stream_server_t){.listen_fd = -1, .epoll_fd = -1, .wake_fd = -1};
+    if (stream_server_init(&loopback.server, listen_fd, &server_config, stream_format_frame, NULL,
+                           &loopback.format) != 0)
+    {
+        if (server_config.spool)
+        {
+            stream_spool_destroy(&loopback.spool);
+        }
+        return -1;
+    }
+
+    printf("Loopback: %dx%d %s (%s), %.0f fps, %d client(s) on port %d\n", options->width, options->height,
+           options->format->name, raw_packing_name(options->packing), options->fps, options->clients,
+           options->port);
+
+    pthread_t server_thread;
+    pthread_create(&server_thread, NULL, loopback_server_thread, &loopback);
+
+    receiver_job_t jobs[STREAM_SERVER_MAX_CLIENTS];
+    pthread_t receivers[STREAM_SERVER_MAX_CLIENTS];
+    int joined[STREAM_SERVER_MAX_CLIENTS] = {0}; // 已回收的线程不能再次 join
+    for (int i = 0; i < options->clients; i++)
+    {
+        jobs[i] = (receiver_job_t){.options = options, .index = i + 1, .same_clock = 1};
+        pthread_create(&receivers[i], NULL, receiver_thread, &jobs[i]);
+    }
+
+    // 采集循环 (调用线程)：按帧率发布合成帧，直到所有接收端结束
+    double period_ms = options->fps > 0 ? 1000.0 / options->fps : 0.0;
+    double next_ms = now_ms(CLOCK_MONOTONIC);
+    uint32_t sequence = 0;
+    int next_buffer = 0;
+    for (;;)
+    {
+        int running = 0;
+        for (int i = 0; i < options->clients; i++)
+        {
+            if (!joined[i])
+            {
+                joined[i] = (pthread_tryjoin_np(receivers[i], NULL) == 0);
+                running |= !joined[i];
+            }
+        }
+        if (!running)
+        {
+            break;
+        }
+
+        if (period_ms > 0)
+        {
+            next_ms += period_ms;
+            double wait_ms = next_ms - now_ms(CLOCK_MONOTONIC);
+            if (wait_ms > 0)
+            {
+                usleep((useconds_t)(wait_ms * 1000.0));
+            }
+        }
+
+        // "驱动"写入下一个空闲缓冲区；没有空闲缓冲区时该帧丢失 (序号照常递增)
+        sequence++;
+        int index = -1;
+        for (int k = 0; k < LOOPBACK_BUFFERS; k++)
+        {
+            int candidate = (next_buffer + k) % LOOPBACK_BUFFERS;
+            if (__atomic_load_n(&loopback.busy[candidate], __ATOMIC_ACQUIRE) == 0)
+            {
+                index = candidate;
+                break;
+            }
+        }
+        if (index < 0)
+        {
+            if (period_ms <= 0)
+            {
+                sequence--; // 尽快模式下只是还没有空闲缓冲区
+                usleep(100);
+            }
+            continue;
+        }
+        next_buffer = (index + 1) % LOOPBACK_BUFFERS;
+        __atomic_store_n(&loopback.busy[index], 1, __ATOMIC_RELEASE);
+
+        media_frame_t frame = {
+            .data = loopback.buffers[index],
+            .size = loopback.frame_size,
+            .width = options->width,
+            .height = options->height,
+            .pixelformat = options->format->fourcc};
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        frame_meta_t meta = {
+            .timestamp = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec,
+            .sequence = sequence};
+        pthread_mutex_lock(&loopback.sensor_lock);
+        loopback.sequence = sequence;
+        if (loopback.pending_sequence != 0 && sequence >= loopback.pending_sequence)
+        {
+            loopback.exposure = loopback.pending_exposure;
+            loopback.gain = loopback.pending_gain;
+            loopback.pending_sequence = 0;
+        }
+        meta.exposure = loopback.exposure;
+        meta.gain = loopback.gain;
+        pthread_mutex_unlock(&loopback.sensor_lock);
+        if (frame_pool_publish(&loopback.pool, &frame, &meta) != 0)
+        {
+            loopback.pool_dropped++;
+            continue;
+        }
+        loopback.produced++;
+
+        frame_ref_t *ref = frame_pool_acquire_latest(&loopback.pool);
+        stream_server_publish(&loopback.server, ref, 1000);
+        frame_pool_release(ref);
+    }
+
+    stream_server_stop(&loopback.server);
+    pthread_join(server_thread, NULL);
+    stream_server_destroy(&loopback.server);
+    if (server_config.spool)
+    {
+        stream_spool_destroy(&loopback.spool);
+    }
+    frame_pool_destroy(&loopback.pool);
+
+    printf("Loopback sender: %u frames published, %u dropped by the frame pool\n", loopback.produced,
+           loopback.pool_dropped);
+
+    int result = 0;
+    for (int i = 0; i < options->clients; i++)
+    {
+        result |= jobs[i].result;
+    }
+    for (int i = 0; i < LOOPBACK_BUFFERS; i++)
+    {
+        free(loopback.buffers[i]);
+    }
+    pthread_mutex_destroy(&loopback.sensor_lock);
+    return result;
+}